@@ -623,7 +623,10 @@ typedef struct aom_codec_enc_cfg {
   /*!\brief Two-pass stats buffer.
    *
    * A buffer containing all of the stats packets produced in the first
-   * pass, concatenated.
+   * pass, concatenated. The stats of a run of consecutive frames may be
+   * given instead, followed by a packet of the same size filled with zeros
+   * in place of the last packet of the first pass. The encoder then
+   * accumulates the totals of those frames itself.
    */
   aom_fixed_buf_t rc_twopass_stats_in;
 
@@ -1524,6 +1524,52 @@ enum aome_enc_control_id {
 
   AOME_SET_LUMA_BIAS_OVERRIDE = AOME_SET_DELTA_QINDEX_MULT + 27,
 
+  // Build the butteraugli rdmult map from TPL reconstructions instead of a
+  // q=96 pre-encode of every frame.
+  AOME_SET_BUTTERAUGLI_PROXY = AOME_SET_DELTA_QINDEX_MULT + 28,
+
+  // Stop the butteraugli quantization loop once the frame distance is within
+  // this many hundredths of the target, searching qindex from the measured
+  // distances. 0 keeps the fixed butteraugli-loop-count iterations.
+  AOME_SET_BUTTERAUGLI_TOLERANCE = AOME_SET_DELTA_QINDEX_MULT + 29,
+
+  // Downscale the frames scored while searching the frame-level unsharp
+  // strength for VMAF preprocessing: 0 full res, 1 half, 2 quarter.
+  AOME_SET_VMAF_PROBE_RESIZE_FACTOR = AOME_SET_DELTA_QINDEX_MULT + 30,
+
+  // Hand the images passed to aom_codec_encode() over to the encoder,
+  // aom_input_release_cb_t* parameter, set before the first frame. Images
+  // allocated by aom_img_alloc_with_border() with an alignment of 32 and the
+  // border of the first image, at least 128 pixels, are queued without a
+  // copy and may be written to; the others are copied as usual. Either way
+  // each image that reaches the encoder, including images it rejects, is
+  // passed to the callback once the encoder is done with it, at the latest
+  // when the encoder is destroyed. Images aom_codec_encode() turns down
+  // itself, such as those with a zero duration, stay with the caller. A NULL
+  // callback goes back to copying every image.
+  AOME_SET_INPUT_RELEASE_CB = AOME_SET_DELTA_QINDEX_MULT + 31,
+
+  // Find the key frames of the last pass from its first pass stats,
+  // aom_scene_cuts_t* parameter. Uses the scene cut detection and key frame
+  // distances of the current configuration, so the sequence can be split
+  // into chunks that are encoded independently.
+  AOME_GET_SCENE_CUTS = AOME_SET_DELTA_QINDEX_MULT + 32,
+
+  // Run the first pass of one pass good quality encodes (the look ahead
+  // stage, whose window is g_lag_in_frames) on its own thread, next to the
+  // encode of the previous frames, unsigned int parameter. The encoder then
+  // sees the stats of the frames up to the one given in the previous call.
+  AOME_SET_LAP_THREAD = AOME_SET_DELTA_QINDEX_MULT + 33,
+
+  // Number of frames of first pass stats the rate control of one pass good
+  // quality encodes sees ahead of the frame it codes, when more than
+  // g_lag_in_frames, up to 1024, unsigned int parameter, set before the
+  // first frame. The look ahead stage runs this many frames ahead of the
+  // encode and holds their source frames; the lag of the GF groups stays
+  // g_lag_in_frames. 0 (default) uses g_lag_in_frames. Has no effect when
+  // g_lag_in_frames is 0.
+  AOME_SET_LAP_WINDOW = AOME_SET_DELTA_QINDEX_MULT + 34,
+
   /*!\brief Codec control function to get the number of operating points. int*
    * parameter.
    */
@@ -1545,7 +1591,8 @@ enum aome_enc_control_id {
    * unsigned int parameter.
    *
    * - 0 = disable (default)
-   * - 1 = enable
+   * - 1 = enable, try every qindex offset
+   * - 2 = enable, stop searching an offset direction once the rd cost rises
    *
    * \note This is only used in sb_qp_sweep unit test.
    */
@@ -1695,6 +1742,7 @@ typedef enum {
   AOM_TUNE_VMAF_SALIENCY_MAP = 15,
   AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP = 16,
   AOM_TUNE_FAST_VMAF_PSY_QP = 17,
+  AOM_TUNE_SSIMULACRA2 = 18,
 } aom_tune_metric;
 
 /*!\brief Distortion metric to use for RD optimization.
@@ -1760,6 +1808,23 @@ typedef struct aom_svc_ref_frame_comp_pred {
   int use_comp_pred[3]; /**<Compound reference flag. */
 } aom_svc_ref_frame_comp_pred_t;
 
+/*!\brief Callback returning an input image handed over to the encoder */
+typedef void (*aom_release_input_cb_fn_t)(void *cb_priv,
+                                          const aom_image_t *img);
+
+/*!brief Parameters for AOME_SET_INPUT_RELEASE_CB */
+typedef struct aom_input_release_cb {
+  aom_release_input_cb_fn_t release_cb; /**< Called once per input image */
+  void *cb_priv; /**< Passed back to release_cb */
+} aom_input_release_cb_t;
+
+/*!brief Parameters for AOME_GET_SCENE_CUTS */
+typedef struct aom_scene_cuts {
+  int *frames;   /**< Receives the indices of the key frames after frame 0 */
+  int max_cuts;  /**< Size of frames */
+  int num_cuts;  /**< Number of key frames found, may exceed max_cuts */
+} aom_scene_cuts_t;
+
 /*!\cond */
 /*!\brief Encoder control function parameter type
  *
@@ -2302,6 +2367,27 @@ AOM_CTRL_USE_TYPE(AOME_SET_INVERT_LUMA_BIAS, int)
 AOM_CTRL_USE_TYPE(AOME_SET_LUMA_BIAS_OVERRIDE, int)
 #define AOM_CTRL_AOME_SET_LUMA_BIAS_OVERRIDE
 
+AOM_CTRL_USE_TYPE(AOME_SET_BUTTERAUGLI_PROXY, int)
+#define AOM_CTRL_AOME_SET_BUTTERAUGLI_PROXY
+
+AOM_CTRL_USE_TYPE(AOME_SET_BUTTERAUGLI_TOLERANCE, int)
+#define AOM_CTRL_AOME_SET_BUTTERAUGLI_TOLERANCE
+
+AOM_CTRL_USE_TYPE(AOME_SET_VMAF_PROBE_RESIZE_FACTOR, int)
+#define AOM_CTRL_AOME_SET_VMAF_PROBE_RESIZE_FACTOR
+
+AOM_CTRL_USE_TYPE(AOME_SET_INPUT_RELEASE_CB, aom_input_release_cb_t *)
+#define AOM_CTRL_AOME_SET_INPUT_RELEASE_CB
+
+AOM_CTRL_USE_TYPE(AOME_GET_SCENE_CUTS, aom_scene_cuts_t *)
+#define AOM_CTRL_AOME_GET_SCENE_CUTS
+
+AOM_CTRL_USE_TYPE(AOME_SET_LAP_THREAD, unsigned int)
+#define AOM_CTRL_AOME_SET_LAP_THREAD
+
+AOM_CTRL_USE_TYPE(AOME_SET_LAP_WINDOW, unsigned int)
+#define AOM_CTRL_AOME_SET_LAP_WINDOW
+
 AOM_CTRL_USE_TYPE(AV1E_GET_NUM_OPERATING_POINTS, int *)
 #define AOM_CTRL_AV1E_GET_NUM_OPERATING_POINTS
 
@@ -170,9 +170,13 @@ if(CONFIG_AV1_ENCODER)
               "${AOM_ROOT}/aom_dsp/sse.c"
               "${AOM_ROOT}/aom_dsp/ssim.c"
               "${AOM_ROOT}/aom_dsp/ssim.h"
+              "${AOM_ROOT}/aom_dsp/ssimulacra2.c"
+              "${AOM_ROOT}/aom_dsp/ssimulacra2.h"
               "${AOM_ROOT}/aom_dsp/sum_squares.c"
               "${AOM_ROOT}/aom_dsp/variance.c"
-              "${AOM_ROOT}/aom_dsp/variance.h")
+              "${AOM_ROOT}/aom_dsp/variance.h"
+              "${AOM_ROOT}/aom_dsp/yuv_to_linear_rgb.c"
+              "${AOM_ROOT}/aom_dsp/yuv_to_linear_rgb.h")
 
   # Flow estimation library
   if(NOT CONFIG_REALTIME_ONLY)
@@ -188,7 +192,8 @@ if(CONFIG_AV1_ENCODER)
                 "${AOM_ROOT}/aom_dsp/flow_estimation/x86/disflow_sse4.c")
 
     list(APPEND AOM_DSP_ENCODER_INTRIN_AVX2
-                "${AOM_ROOT}/aom_dsp/flow_estimation/x86/corner_match_avx2.c")
+                "${AOM_ROOT}/aom_dsp/flow_estimation/x86/corner_match_avx2.c"
+                "${AOM_ROOT}/aom_dsp/flow_estimation/x86/disflow_avx2.c")
   endif()
 
   list(APPEND AOM_DSP_ENCODER_ASM_SSE2 "${AOM_ROOT}/aom_dsp/x86/sad4d_sse2.asm"
@@ -233,6 +238,8 @@ if(CONFIG_AV1_ENCODER)
               "${AOM_ROOT}/aom_dsp/x86/obmc_sad_avx2.c"
               "${AOM_ROOT}/aom_dsp/x86/obmc_variance_avx2.c"
               "${AOM_ROOT}/aom_dsp/x86/blk_sse_sum_avx2.c"
+              "${AOM_ROOT}/aom_dsp/x86/ssimulacra2_avx2.c"
+              "${AOM_ROOT}/aom_dsp/x86/yuv_to_linear_rgb_avx2.c"
               "${AOM_ROOT}/aom_dsp/x86/sum_squares_avx2.c")
 
   list(APPEND AOM_DSP_ENCODER_INTRIN_AVX
@@ -253,7 +260,8 @@ if(CONFIG_AV1_ENCODER)
               "${AOM_ROOT}/aom_dsp/x86/avg_intrin_sse4.c"
               "${AOM_ROOT}/aom_dsp/x86/sse_sse4.c"
               "${AOM_ROOT}/aom_dsp/x86/obmc_sad_sse4.c"
-              "${AOM_ROOT}/aom_dsp/x86/obmc_variance_sse4.c")
+              "${AOM_ROOT}/aom_dsp/x86/obmc_variance_sse4.c"
+              "${AOM_ROOT}/aom_dsp/x86/ssimulacra2_sse4.c")
 
   list(APPEND AOM_DSP_ENCODER_INTRIN_NEON
               "${AOM_ROOT}/aom_dsp/arm/sad4d_neon.c"
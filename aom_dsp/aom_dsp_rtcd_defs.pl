@@ -19,6 +19,8 @@ print <<EOF
 #include "av1/common/blockd.h"
 #include "av1/common/enums.h"
 
+struct yuv_to_rgb_coeffs;
+
 EOF
 }
 forward_decls qw/aom_dsp_forward_decls/;
@@ -2040,9 +2042,26 @@ if (aom_config("CONFIG_AV1_ENCODER") eq "yes") {
     specialize qw/av1_compute_cross_correlation sse4_1 avx2/;
 
     add_proto qw/void aom_compute_flow_at_point/, "const uint8_t *src, const uint8_t *ref, int x, int y, int width, int height, int stride, double *u, double *v";
-    specialize qw/aom_compute_flow_at_point sse4_1/;
+    specialize qw/aom_compute_flow_at_point sse4_1 avx2/;
   }
 
+  # SSIMULACRA2
+  add_proto qw/void aom_ssimulacra2_blur_row/, "const float *src, float *dst, int width, const float *kernel";
+  specialize qw/aom_ssimulacra2_blur_row sse4_1 avx2/;
+
+  add_proto qw/void aom_ssimulacra2_blur_col/, "const float *const *rows, float *dst, int width, const float *kernel";
+  specialize qw/aom_ssimulacra2_blur_col sse4_1 avx2/;
+
+  add_proto qw/void aom_ssimulacra2_ssim_row/, "const float *mu1, const float *mu2, const float *s1122, const float *s12, int width, double *sums, float *map, float map_weight";
+  specialize qw/aom_ssimulacra2_ssim_row sse4_1 avx2/;
+
+  add_proto qw/void aom_ssimulacra2_edge_row/, "const float *img1, const float *mu1, const float *img2, const float *mu2, int width, double *sums, float *map, float artifact_weight, float detail_weight";
+  specialize qw/aom_ssimulacra2_edge_row sse4_1 avx2/;
+
+  # YUV to linear RGB
+  add_proto qw/void aom_highbd_yuv_to_linear_rgb_row/, "const uint16_t *y, const uint16_t *u, const uint16_t *v, int width, int ss_x, const struct yuv_to_rgb_coeffs *coeffs, const float *lut, float *rgb";
+  specialize qw/aom_highbd_yuv_to_linear_rgb_row avx2/;
+
 }  # CONFIG_AV1_ENCODER
 
 1;
@@ -10,161 +10,373 @@
  */
 
 #include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "config/aom_dsp_rtcd.h"
 
 #include "aom_dsp/butteraugli.h"
+#include "aom_dsp/yuv_to_linear_rgb.h"
 #include "aom_mem/aom_mem.h"
 #include "aom_ports/mem.h"
+#include "aom_util/aom_thread.h"
 #include "av1/encoder/encoder_utils.h"
 #include "third_party/libyuv/include/libyuv/convert_argb.h"
 
-int aom_calc_butteraugli(AV1_COMP *cpi, const YV12_BUFFER_CONFIG *source,
-                         const YV12_BUFFER_CONFIG *distorted, int bit_depth,
-                         aom_matrix_coefficients_t matrix_coefficients,
-                         aom_color_range_t color_range, float *dist_map, int target_intensity, int hf_asymmetry) {
-  (void)bit_depth;
-  assert(bit_depth <= 12);
-  const int width = source->y_crop_width;
-  const int height = source->y_crop_height;
-  const int ss_x = source->subsampling_x;
-  const int ss_y = source->subsampling_y;
+// Rows of context scored above and below each stripe, so that butteraugli's
+// blurs (the widest reach ~32 rows through the half-resolution pass) see the
+// same neighbourhood as a whole-frame run. Only the stripe's own rows are
+// written back to the distortion map.
+#define BUTTERAUGLI_STRIPE_BORDER 48
+// Stripes shorter than this spend more time on the borders than on their
+// own rows.
+#define BUTTERAUGLI_MIN_STRIPE_HEIGHT 128
+// Threads handed to libjxl's own runner when the frame is scored as a single
+// stripe.
+#define BUTTERAUGLI_RUNNER_THREADS 6
 
-  const struct YuvConstants *yuv_constants;
-  if (matrix_coefficients == AOM_CICP_MC_BT_709) {
-    yuv_constants = color_range == AOM_CR_FULL_RANGE ? &kYuvF709Constants
-                                                     : &kYuvH709Constants;
-  } else if (matrix_coefficients == AOM_CICP_MC_BT_2020_NCL || matrix_coefficients == AOM_CICP_MC_BT_2020_CL) {
-    yuv_constants = color_range == AOM_CR_FULL_RANGE ? &kYuvV2020Constants : &kYuv2020Constants; // Implement bt.2020 full later
-  } else {
-    yuv_constants = color_range == AOM_CR_FULL_RANGE ? &kYuvJPEGConstants
-                                                     : &kYuvI601Constants;
-  }
-
-  const int stride_argb = width * 4;
-  const size_t buffer_size = height * stride_argb * (bit_depth > 8 ? 2 : 1);
-  uint8_t *src_argb = (uint8_t *)aom_malloc(buffer_size);
-  uint8_t *distorted_argb = (uint8_t *)aom_malloc(buffer_size);
-  uint8_t *src_rgba = (uint8_t *)aom_malloc(buffer_size);
-  uint8_t *distorted_rgba = (uint8_t *)aom_malloc(buffer_size);
-  if (!src_argb || !distorted_argb) {
-    aom_free(src_argb);
-    aom_free(distorted_argb);
-    aom_free(src_rgba);
-    aom_free(distorted_rgba);
+typedef struct {
+  const YV12_BUFFER_CONFIG *source;
+  const YV12_BUFFER_CONFIG *distorted;
+  const struct YuvConstants *yvu_constants;
+  const YuvToRgbCoeffs *coeffs;
+  const float *eotf_lut;
+  int bit_depth;
+  // Bytes per pixel of the converted frames.
+  int pixel_size;
+  uint8_t *src_pixels;
+  uint8_t *distorted_pixels;
+  float *dist_map;
+  int width;
+  int height;
+  int stripe_height;
+  int num_stripes;
+  float hf_asymmetry;
+  float intensity_target;
+  int runner_threads;
+} ButteraugliFrameJob;
+
+typedef struct {
+  const ButteraugliFrameJob *job;
+  int first_stripe;
+  int stripe_step;
+  int ok;
+} ButteraugliWorkerData;
+
+void aom_free_butteraugli_buffers(AomButteraugliBuffers *buffers) {
+  aom_free(buffers->src_pixels);
+  aom_free(buffers->distorted_pixels);
+  aom_free(buffers->eotf_lut);
+  buffers->src_pixels = NULL;
+  buffers->distorted_pixels = NULL;
+  buffers->eotf_lut = NULL;
+  buffers->buffer_size = 0;
+}
+
+static int alloc_butteraugli_buffers(AomButteraugliBuffers *buffers,
+                                     size_t buffer_size, int highbd) {
+  if (highbd && !buffers->eotf_lut) {
+    buffers->eotf_lut = (float *)aom_malloc((AOM_SRGB_EOTF_LUT_SIZE + 1) *
+                                            sizeof(*buffers->eotf_lut));
+    if (!buffers->eotf_lut) return 0;
+    aom_init_srgb_eotf_lut(buffers->eotf_lut);
+  }
+  if (buffers->buffer_size >= buffer_size) return 1;
+  aom_free(buffers->src_pixels);
+  aom_free(buffers->distorted_pixels);
+  buffers->buffer_size = 0;
+  buffers->src_pixels = (uint8_t *)aom_memalign(32, buffer_size);
+  buffers->distorted_pixels = (uint8_t *)aom_memalign(32, buffer_size);
+  if (!buffers->src_pixels || !buffers->distorted_pixels) {
+    aom_free_butteraugli_buffers(buffers);
     return 0;
   }
+  buffers->buffer_size = buffer_size;
+  return 1;
+}
 
+// Converts rows [row_start, row_end) of 8-bit 'img' to interleaved RGBA.
+// libyuv's ARGB is stored as B, G, R, A in memory; swapping U and V and
+// using the mirrored YVU matrix yields the R, G, B, A order libjxl expects,
+// without a separate swizzle pass. row_start must be even for 4:2:0 input.
+static int convert_rows_to_rgba(const YV12_BUFFER_CONFIG *img,
+                                const struct YuvConstants *yvu_constants,
+                                uint8_t *rgba, int row_start, int row_end) {
+  const int width = img->y_crop_width;
+  const int rows = row_end - row_start;
+  const int stride_rgba = width * 4;
+  const int ss_x = img->subsampling_x;
+  const int ss_y = img->subsampling_y;
+  const int uv_row = row_start >> ss_y;
+  uint8_t *const dst = rgba + (size_t)row_start * stride_rgba;
+  const uint8_t *y = img->y_buffer + (size_t)row_start * img->y_stride;
+  const uint8_t *u = img->u_buffer + (size_t)uv_row * img->uv_stride;
+  const uint8_t *v = img->v_buffer + (size_t)uv_row * img->uv_stride;
+  assert(!(ss_y && (row_start & 1)));
 
   if (ss_x == 1 && ss_y == 1) {
-    if (bit_depth == 8) {
-      I420ToARGBMatrix(source->y_buffer, source->y_stride, source->u_buffer,
-                      source->uv_stride, source->v_buffer, source->uv_stride,
-                      src_argb, stride_argb, yuv_constants, width, height);
-      I420ToARGBMatrix(distorted->y_buffer, distorted->y_stride,
-                      distorted->u_buffer, distorted->uv_stride,
-                      distorted->v_buffer, distorted->uv_stride, distorted_argb,
-                      stride_argb, yuv_constants, width, height);
-    } else {
-      I010ToARGBMatrix(CONVERT_TO_SHORTPTR(source->y_buffer), source->y_stride,
-                      CONVERT_TO_SHORTPTR(source->u_buffer), source->uv_stride,
-                      CONVERT_TO_SHORTPTR(source->v_buffer), source->uv_stride,
-                      src_argb, stride_argb, yuv_constants, width, height);
-      I010ToARGBMatrix(CONVERT_TO_SHORTPTR(distorted->y_buffer), distorted->y_stride,
-                      CONVERT_TO_SHORTPTR(distorted->u_buffer), distorted->uv_stride,
-                      CONVERT_TO_SHORTPTR(distorted->v_buffer), distorted->uv_stride,
-                      distorted_argb, stride_argb, yuv_constants, width, height);
-
-      BGRAToARGB(src_argb, stride_argb, src_rgba, stride_argb, width, height);
-      BGRAToARGB(distorted_argb, stride_argb, distorted_rgba, stride_argb, width, height);
-    }
+    return !I420ToARGBMatrix(y, img->y_stride, v, img->uv_stride, u,
+                             img->uv_stride, dst, stride_rgba, yvu_constants,
+                             width, rows);
   } else if (ss_x == 1 && ss_y == 0) {
-    if (bit_depth == 8) {
-      I422ToARGBMatrix(source->y_buffer, source->y_stride, source->u_buffer,
-                      source->uv_stride, source->v_buffer, source->uv_stride,
-                      src_argb, stride_argb, yuv_constants, width, height);
-      I422ToARGBMatrix(distorted->y_buffer, distorted->y_stride,
-                      distorted->u_buffer, distorted->uv_stride,
-                      distorted->v_buffer, distorted->uv_stride, distorted_argb,
-                      stride_argb, yuv_constants, width, height);
-    } else {
-      I210ToARGBMatrix(CONVERT_TO_SHORTPTR(source->y_buffer), source->y_stride,
-                      CONVERT_TO_SHORTPTR(source->u_buffer), source->uv_stride,
-                      CONVERT_TO_SHORTPTR(source->v_buffer), source->uv_stride,
-                      src_argb, stride_argb, yuv_constants, width, height);
-      I210ToARGBMatrix(CONVERT_TO_SHORTPTR(distorted->y_buffer), distorted->y_stride,
-                      CONVERT_TO_SHORTPTR(distorted->u_buffer), distorted->uv_stride,
-                      CONVERT_TO_SHORTPTR(distorted->v_buffer), distorted->uv_stride,
-                      distorted_argb, stride_argb, yuv_constants, width, height);
-    }
+    return !I422ToARGBMatrix(y, img->y_stride, v, img->uv_stride, u,
+                             img->uv_stride, dst, stride_rgba, yvu_constants,
+                             width, rows);
   } else if (ss_x == 0 && ss_y == 0) {
-    if (bit_depth == 8) {
-      I444ToARGBMatrix(source->y_buffer, source->y_stride, source->u_buffer,
-                      source->uv_stride, source->v_buffer, source->uv_stride,
-                      src_argb, stride_argb, yuv_constants, width, height);
-      I444ToARGBMatrix(distorted->y_buffer, distorted->y_stride,
-                      distorted->u_buffer, distorted->uv_stride,
-                      distorted->v_buffer, distorted->uv_stride, distorted_argb,
-                      stride_argb, yuv_constants, width, height);
-    } else {
-      I410ToARGBMatrix(CONVERT_TO_SHORTPTR(source->y_buffer), source->y_stride,
-                      CONVERT_TO_SHORTPTR(source->u_buffer), source->uv_stride,
-                      CONVERT_TO_SHORTPTR(source->v_buffer), source->uv_stride,
-                      src_argb, stride_argb, yuv_constants, width, height);
-      I410ToARGBMatrix(CONVERT_TO_SHORTPTR(distorted->y_buffer), distorted->y_stride,
-                      CONVERT_TO_SHORTPTR(distorted->u_buffer), distorted->uv_stride,
-                      CONVERT_TO_SHORTPTR(distorted->v_buffer), distorted->uv_stride,
-                      distorted_argb, stride_argb, yuv_constants, width, height);
-    }
-  } else {
-    aom_free(src_argb);
-    aom_free(distorted_argb);
-    aom_free(src_rgba);
-    aom_free(distorted_rgba);
-    return 0;
+    return !I444ToARGBMatrix(y, img->y_stride, v, img->uv_stride, u,
+                             img->uv_stride, dst, stride_rgba, yvu_constants,
+                             width, rows);
+  }
+  return 0;
+}
+
+// Converts rows [row_start, row_end) of high bitdepth 'img' straight to the
+// interleaved float linear RGB libjxl scores, keeping every bit of the input
+// instead of rounding through 8-bit RGBA.
+static void convert_rows_to_linear_rgb(const YV12_BUFFER_CONFIG *img,
+                                       const YuvToRgbCoeffs *coeffs,
+                                       const float *lut, float *rgb,
+                                       int row_start, int row_end) {
+  const int width = img->y_crop_width;
+  const uint16_t *const y = CONVERT_TO_SHORTPTR(img->y_buffer);
+  const uint16_t *const u = CONVERT_TO_SHORTPTR(img->u_buffer);
+  const uint16_t *const v = CONVERT_TO_SHORTPTR(img->v_buffer);
+  for (int row = row_start; row < row_end; ++row) {
+    const size_t uv_offset = (size_t)(row >> img->subsampling_y) *
+                             img->uv_stride;
+    aom_highbd_yuv_to_linear_rgb_row(
+        y + (size_t)row * img->y_stride, u + uv_offset, v + uv_offset, width,
+        img->subsampling_x, coeffs, lut, rgb + (size_t)row * width * 3);
   }
-  float hf_asym_val = (float)hf_asymmetry / 10.0f;
-  JxlPixelFormat pixel_format = { 4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0 };
-  if (bit_depth == 10 || bit_depth == 12) {
-    pixel_format.data_type = JXL_TYPE_UINT16;
-    //pixel_format.endianness = JXL_BIG_ENDIAN;
+}
+
+static int convert_rows(const ButteraugliFrameJob *job,
+                        const YV12_BUFFER_CONFIG *img, uint8_t *pixels,
+                        int row_start, int row_end) {
+  if (job->bit_depth == 8) {
+    return convert_rows_to_rgba(img, job->yvu_constants, pixels, row_start,
+                                row_end);
   }
+  convert_rows_to_linear_rgb(img, job->coeffs, job->eotf_lut, (float *)pixels,
+                             row_start, row_end);
+  return 1;
+}
+
+static void get_stripe_rows(const ButteraugliFrameJob *job, int stripe,
+                            int *core_start, int *core_end) {
+  *core_start = stripe * job->stripe_height;
+  *core_end = AOMMIN(*core_start + job->stripe_height, job->height);
+}
+
+static int convert_stripe(const ButteraugliFrameJob *job, int stripe) {
+  int core_start, core_end;
+  get_stripe_rows(job, stripe, &core_start, &core_end);
+  return convert_rows(job, job->source, job->src_pixels, core_start,
+                      core_end) &&
+         convert_rows(job, job->distorted, job->distorted_pixels, core_start,
+                      core_end);
+}
+
+static int score_stripe(const ButteraugliFrameJob *job, int stripe) {
+  int core_start, core_end;
+  get_stripe_rows(job, stripe, &core_start, &core_end);
+  const int start = AOMMAX(core_start - BUTTERAUGLI_STRIPE_BORDER, 0);
+  const int end = AOMMIN(core_end + BUTTERAUGLI_STRIPE_BORDER, job->height);
+  const size_t stride = (size_t)job->width * job->pixel_size;
+  const size_t offset = (size_t)start * stride;
+  const size_t size = (size_t)(end - start) * stride;
+
   JxlButteraugliApi *api = JxlButteraugliApiCreate(NULL);
-  JxlParallelRunner runner = JxlThreadParallelRunnerCreate(NULL, 6);
-  JxlButteraugliApiSetParallelRunner(api, JxlThreadParallelRunner, runner);
-  JxlButteraugliApiSetHFAsymmetry(api, hf_asym_val);
-  JxlButteraugliApiSetIntensityTarget(api, (float)target_intensity);
+  if (api == NULL) return 0;
+  void *runner = NULL;
+  if (job->runner_threads > 1) {
+    runner = JxlThreadParallelRunnerCreate(NULL, job->runner_threads);
+    JxlButteraugliApiSetParallelRunner(api, JxlThreadParallelRunner, runner);
+  }
+  JxlButteraugliApiSetHFAsymmetry(api, job->hf_asymmetry);
+  JxlButteraugliApiSetIntensityTarget(api, job->intensity_target);
 
+  // libjxl takes 8-bit input as sRGB and float input as linear sRGB.
+  const JxlPixelFormat pixel_format =
+      job->bit_depth == 8
+          ? (JxlPixelFormat){ 4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0 }
+          : (JxlPixelFormat){ 3, JXL_TYPE_FLOAT, JXL_NATIVE_ENDIAN, 0 };
   JxlButteraugliResult *result = JxlButteraugliCompute(
-      api, width, height, &pixel_format, src_rgba, buffer_size, &pixel_format,
-      distorted_rgba, buffer_size);
+      api, job->width, end - start, &pixel_format, job->src_pixels + offset,
+      size, &pixel_format, job->distorted_pixels + offset, size);
 
   const float *distmap = NULL;
-  uint32_t row_stride;
-  JxlButteraugliResultGetDistmap(result, &distmap, &row_stride);
-  cpi->butteraugli_info.distance = JxlButteraugliResultGetDistance(result, 1.0f);
-  printf("distance: %f, bit_depth: %d, row_stride: %d\n", cpi->butteraugli_info.distance, bit_depth, row_stride);
-  if (distmap == NULL) {
-    JxlButteraugliApiDestroy(api);
-    JxlButteraugliResultDestroy(result);
-    JxlThreadParallelRunnerDestroy(runner);
-    aom_free(src_argb);
-    aom_free(distorted_argb);
-    aom_free(src_rgba);
-    aom_free(distorted_rgba);
-    return 0;
+  uint32_t row_stride = 0;
+  if (result != NULL) {
+    JxlButteraugliResultGetDistmap(result, &distmap, &row_stride);
+  }
+  if (distmap != NULL) {
+    for (int j = core_start; j < core_end; ++j) {
+      memcpy(&job->dist_map[(size_t)j * job->width],
+             &distmap[(size_t)(j - start) * row_stride],
+             job->width * sizeof(*distmap));
+    }
   }
 
+  if (result != NULL) JxlButteraugliResultDestroy(result);
+  JxlButteraugliApiDestroy(api);
+  if (runner != NULL) JxlThreadParallelRunnerDestroy(runner);
+  return distmap != NULL;
+}
+
+static int butteraugli_convert_hook(void *arg1, void *arg2) {
+  (void)arg2;
+  ButteraugliWorkerData *const data = (ButteraugliWorkerData *)arg1;
+  const ButteraugliFrameJob *const job = data->job;
+  for (int stripe = data->first_stripe; stripe < job->num_stripes;
+       stripe += data->stripe_step) {
+    data->ok &= convert_stripe(job, stripe);
+  }
+  return data->ok;
+}
+
+static int butteraugli_score_hook(void *arg1, void *arg2) {
+  (void)arg2;
+  ButteraugliWorkerData *const data = (ButteraugliWorkerData *)arg1;
+  const ButteraugliFrameJob *const job = data->job;
+  for (int stripe = data->first_stripe; stripe < job->num_stripes;
+       stripe += data->stripe_step) {
+    data->ok &= score_stripe(job, stripe);
+  }
+  return data->ok;
+}
+
+static void run_butteraugli_workers(AVxWorker *workers,
+                                    ButteraugliWorkerData *worker_data,
+                                    int num_workers, AVxWorkerHook hook) {
+  if (num_workers <= 1) {
+    hook(&worker_data[0], NULL);
+    return;
+  }
+  const AVxWorkerInterface *const winterface = aom_get_worker_interface();
+  for (int i = num_workers - 1; i >= 0; i--) {
+    AVxWorker *const worker = &workers[i];
+    worker->hook = hook;
+    worker->data1 = &worker_data[i];
+    worker->data2 = NULL;
+    if (i == 0)
+      winterface->execute(worker);
+    else
+      winterface->launch(worker);
+  }
+  for (int i = num_workers - 1; i > 0; i--) {
+    winterface->sync(&workers[i]);
+  }
+}
+
+// Frame distance as libjxl's ComputeDistanceP() derives it from the
+// distortion map: the mean of the p, 2p and 4p norms.
+static float compute_distance_p(const float *dist_map, int width, int height,
+                                double p) {
+  double sum[3] = { 0.0, 0.0, 0.0 };
   for (int j = 0; j < height; ++j) {
     for (int i = 0; i < width; ++i) {
-      dist_map[j * width + i] = distmap[j * row_stride + i];
+      double d = pow(dist_map[j * width + i], p);
+      sum[0] += d;
+      d *= d;
+      sum[1] += d;
+      d *= d;
+      sum[2] += d;
     }
   }
+  const double one_per_pixels = 1.0 / ((double)width * height);
+  double v = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    v += pow(one_per_pixels * sum[i], 1.0 / (p * (1 << i)));
+  }
+  return (float)(v / 3.0);
+}
 
-  JxlButteraugliApiDestroy(api);
-  JxlButteraugliResultDestroy(result);
-  JxlThreadParallelRunnerDestroy(runner);
-  aom_free(src_argb);
-  aom_free(distorted_argb);
-  aom_free(src_rgba);
-  aom_free(distorted_rgba);
+int aom_calc_butteraugli(AV1_COMP *cpi, const YV12_BUFFER_CONFIG *source,
+                         const YV12_BUFFER_CONFIG *distorted, int bit_depth,
+                         aom_matrix_coefficients_t matrix_coefficients,
+                         aom_color_range_t color_range, float *dist_map,
+                         int target_intensity, int hf_asymmetry) {
+  assert(bit_depth <= 12);
+  const int width = source->y_crop_width;
+  const int height = source->y_crop_height;
+  const int ss_x = source->subsampling_x;
+  const int ss_y = source->subsampling_y;
+  if (ss_x < ss_y) return 0;
+
+  const struct YuvConstants *yvu_constants;
+  if (matrix_coefficients == AOM_CICP_MC_BT_709) {
+    yvu_constants = color_range == AOM_CR_FULL_RANGE ? &kYvuF709Constants
+                                                     : &kYvuH709Constants;
+  } else if (matrix_coefficients == AOM_CICP_MC_BT_2020_NCL ||
+             matrix_coefficients == AOM_CICP_MC_BT_2020_CL) {
+    yvu_constants = color_range == AOM_CR_FULL_RANGE ? &kYvuV2020Constants
+                                                     : &kYvu2020Constants;
+  } else {
+    yvu_constants = color_range == AOM_CR_FULL_RANGE ? &kYvuJPEGConstants
+                                                     : &kYvuI601Constants;
+  }
+
+  YuvToRgbCoeffs coeffs;
+  aom_init_yuv_to_rgb_coeffs(bit_depth, matrix_coefficients, color_range,
+                             &coeffs);
+
+  const int highbd = bit_depth > 8;
+  const int pixel_size = highbd ? 3 * (int)sizeof(float) : 4;
+  AomButteraugliBuffers *const buffers = &cpi->butteraugli_info.buffers;
+  if (!alloc_butteraugli_buffers(buffers, (size_t)height * width * pixel_size,
+                                 highbd)) {
+    return 0;
+  }
+
+  // Split the frame into horizontal stripes, one per worker, each scored
+  // independently with some overlap.
+  int num_workers =
+      AOMMAX(1, AOMMIN(cpi->mt_info.num_workers, MAX_NUM_THREADS));
+  int stripe_height = (height + num_workers - 1) / num_workers;
+  stripe_height = AOMMAX(stripe_height, BUTTERAUGLI_MIN_STRIPE_HEIGHT);
+  stripe_height = (stripe_height + 1) & ~1;
+  const int num_stripes = (height + stripe_height - 1) / stripe_height;
+  num_workers = AOMMIN(num_workers, num_stripes);
+
+  const ButteraugliFrameJob job = {
+    source,
+    distorted,
+    yvu_constants,
+    &coeffs,
+    buffers->eotf_lut,
+    bit_depth,
+    pixel_size,
+    buffers->src_pixels,
+    buffers->distorted_pixels,
+    dist_map,
+    width,
+    height,
+    stripe_height,
+    num_stripes,
+    (float)hf_asymmetry / 10.0f,
+    (float)target_intensity,
+    num_workers > 1 ? 1 : BUTTERAUGLI_RUNNER_THREADS,
+  };
+  ButteraugliWorkerData worker_data[MAX_NUM_THREADS];
+  for (int i = 0; i < num_workers; ++i) {
+    worker_data[i].job = &job;
+    worker_data[i].first_stripe = i;
+    worker_data[i].stripe_step = num_workers;
+    worker_data[i].ok = 1;
+  }
+
+  // All stripes must be converted before any is scored, since each stripe
+  // reads its neighbours' rows as context.
+  run_butteraugli_workers(cpi->mt_info.workers, worker_data, num_workers,
+                          butteraugli_convert_hook);
+  run_butteraugli_workers(cpi->mt_info.workers, worker_data, num_workers,
+                          butteraugli_score_hook);
+  for (int i = 0; i < num_workers; ++i) {
+    if (!worker_data[i].ok) return 0;
+  }
+
+  cpi->butteraugli_info.distance =
+      compute_distance_p(dist_map, width, height, 1.0);
   return 1;
 }
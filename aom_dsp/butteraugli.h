@@ -18,10 +18,27 @@
 
 struct AV1_COMP;
 
+// Conversion buffers reused across calls to aom_calc_butteraugli(); they are
+// only reallocated when the frame grows. They hold 8-bit sRGB RGBA for 8-bit
+// input and float linear RGB for high bitdepth input.
+typedef struct {
+  uint8_t *src_pixels;
+  uint8_t *distorted_pixels;
+  size_t buffer_size;
+  // sRGB transfer function table of the high bitdepth conversion.
+  float *eotf_lut;
+} AomButteraugliBuffers;
+
+void aom_free_butteraugli_buffers(AomButteraugliBuffers *buffers);
+
+// Scores 'distorted' against 'source', filling 'dist_map' (one float per
+// luma pixel) and cpi->butteraugli_info.distance. The frame is split into
+// overlapping horizontal stripes that are scored on the encoder's workers.
 // Returns a boolean that indicates success/failure.
 int aom_calc_butteraugli(struct AV1_COMP *cpi, const YV12_BUFFER_CONFIG *source,
                          const YV12_BUFFER_CONFIG *distorted, int bit_depth,
                          aom_matrix_coefficients_t matrix_coefficients,
-                         aom_color_range_t color_range, float *dist_map, int target_intensity, int hf_asymmetry);
+                         aom_color_range_t color_range, float *dist_map,
+                         int target_intensity, int hf_asymmetry);
 
 #endif  // AOM_AOM_DSP_BUTTERAUGLI_H_
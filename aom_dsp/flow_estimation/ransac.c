@@ -31,6 +31,18 @@
 #define INLIER_THRESHOLD_SQUARED (INLIER_THRESHOLD * INLIER_THRESHOLD)
 #define NUM_TRIALS 20
 
+// Number of candidate models which are scored against the point set together.
+// Scoring several models per pass over the points lets each point be loaded
+// once, and puts the independent models side by side, which the compiler can
+// vectorize.
+#define RANSAC_BATCH_SIZE 4
+
+// Stop sampling once we are this confident that at least one of the trials
+// so far used only inliers of the worst kept motion. The number of trials
+// this takes follows from that motion's inlier ratio; see
+// get_num_trials_needed().
+#define RANSAC_CONFIDENCE 0.99
+
 // Flag to enable functions for finding TRANSLATION type models.
 //
 // These modes are not considered currently due to a spec bug (see comments
@@ -44,47 +56,19 @@
 typedef bool (*IsDegenerateFunc)(double *p);
 typedef bool (*FindTransformationFunc)(int points, const double *points1,
                                        const double *points2, double *params);
-typedef void (*ProjectPointsFunc)(const double *mat, const double *points,
-                                  double *proj, int n, int stride_points,
-                                  int stride_proj);
 
 // vtable-like structure which stores all of the information needed by RANSAC
 // for a particular model type
+//
+// Note: All of the supported model types are scored by projecting points
+// through the full affine parameter set (see score_models()), as the
+// translation and rotzoom models are special cases of it.
 typedef struct {
   IsDegenerateFunc is_degenerate;
   FindTransformationFunc find_transformation;
-  ProjectPointsFunc project_points;
   int minpts;
 } RansacModelInfo;
 
-#if ALLOW_TRANSLATION_MODELS
-static void project_points_translation(const double *mat, const double *points,
-                                       double *proj, int n, int stride_points,
-                                       int stride_proj) {
-  int i;
-  for (i = 0; i < n; ++i) {
-    const double x = *(points++), y = *(points++);
-    *(proj++) = x + mat[0];
-    *(proj++) = y + mat[1];
-    points += stride_points - 2;
-    proj += stride_proj - 2;
-  }
-}
-#endif  // ALLOW_TRANSLATION_MODELS
-
-static void project_points_affine(const double *mat, const double *points,
-                                  double *proj, int n, int stride_points,
-                                  int stride_proj) {
-  int i;
-  for (i = 0; i < n; ++i) {
-    const double x = *(points++), y = *(points++);
-    *(proj++) = mat[2] * x + mat[3] * y + mat[0];
-    *(proj++) = mat[4] * x + mat[5] * y + mat[1];
-    points += stride_points - 2;
-    proj += stride_proj - 2;
-  }
-}
-
 #if ALLOW_TRANSLATION_MODELS
 static bool find_translation(int np, const double *pts1, const double *pts2,
                              double *params) {
@@ -234,15 +218,74 @@ static bool is_better_motion(const RANSAC_MOTION *motion_a,
   return compare_motions(motion_a, motion_b) < 0;
 }
 
-static void copy_points_at_indices(double *dest, const double *src,
-                                   const int *indices, int num_points) {
+// Gather the points at the given indices from separate x and y arrays into
+// the interleaved layout used by the model fitting functions.
+static void copy_points_at_indices(double *dest, const double *src_x,
+                                   const double *src_y, const int *indices,
+                                   int num_points) {
   for (int i = 0; i < num_points; ++i) {
     const int index = indices[i];
-    dest[i * 2] = src[index * 2];
-    dest[i * 2 + 1] = src[index * 2 + 1];
+    dest[i * 2] = src_x[index];
+    dest[i * 2 + 1] = src_y[index];
   }
 }
 
+// Project every point through each of the RANSAC_BATCH_SIZE models in
+// 'params', and count the inliers and sum their squared errors for each
+// model. params[k][m] is parameter k of model m, and inlier_mask[i *
+// RANSAC_BATCH_SIZE + m] is set to whether point i is an inlier of model m.
+//
+// The points are stored as separate coordinate arrays, and the models are
+// kept side by side, so the inner loop is the same computation on
+// RANSAC_BATCH_SIZE independent lanes. Each lane performs the same floating
+// point operations in the same order as scoring a single model would.
+static void score_models(const double params[MAX_PARAMDIM][RANSAC_BATCH_SIZE],
+                         const double *x1, const double *y1, const double *x2,
+                         const double *y2, int npoints, uint8_t *inlier_mask,
+                         int *num_inliers, double *sse) {
+  int count[RANSAC_BATCH_SIZE] = { 0 };
+  double sum[RANSAC_BATCH_SIZE] = { 0 };
+
+  for (int i = 0; i < npoints; ++i) {
+    const double sx = x1[i];
+    const double sy = y1[i];
+    const double dx = x2[i];
+    const double dy = y2[i];
+    uint8_t *mask = &inlier_mask[i * RANSAC_BATCH_SIZE];
+    for (int m = 0; m < RANSAC_BATCH_SIZE; ++m) {
+      const double proj_x =
+          params[2][m] * sx + params[3][m] * sy + params[0][m];
+      const double proj_y =
+          params[4][m] * sx + params[5][m] * sy + params[1][m];
+      const double err_x = proj_x - dx;
+      const double err_y = proj_y - dy;
+      const double squared_error = err_x * err_x + err_y * err_y;
+      const int is_inlier = squared_error < INLIER_THRESHOLD_SQUARED;
+      mask[m] = is_inlier;
+      count[m] += is_inlier;
+      sum[m] += is_inlier ? squared_error : 0.0;
+    }
+  }
+
+  for (int m = 0; m < RANSAC_BATCH_SIZE; ++m) {
+    num_inliers[m] = count[m];
+    sse[m] = sum[m];
+  }
+}
+
+// Returns the number of trials after which, with probability
+// RANSAC_CONFIDENCE, at least one trial will have picked only inliers of a
+// motion with the given number of inliers.
+static int get_num_trials_needed(int num_inliers, int npoints, int minpts) {
+  const double inlier_ratio = (double)num_inliers / npoints;
+  const double p_all_inliers = pow(inlier_ratio, minpts);
+  if (p_all_inliers >= 1.0) return 1;
+  if (p_all_inliers <= 0.0) return NUM_TRIALS;
+  const double num_trials =
+      ceil(log(1.0 - RANSAC_CONFIDENCE) / log(1.0 - p_all_inliers));
+  return num_trials < NUM_TRIALS ? (int)num_trials : NUM_TRIALS;
+}
+
 // Returns true on success, false on error
 static bool ransac_internal(const Correspondence *matched_points, int npoints,
                             MotionModel *motion_models, int num_desired_motions,
@@ -257,8 +300,8 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
   int indices[MAX_MINPTS] = { 0 };
 
   double *points1, *points2;
-  double *corners1, *corners2;
-  double *projected_corners;
+  double *corners1_x, *corners1_y, *corners2_x, *corners2_y;
+  uint8_t *inlier_mask;
 
   // Store information for the num_desired_motions best transformations found
   // and the worst motion among them, as well as the motion currently under
@@ -266,9 +309,12 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
   RANSAC_MOTION *motions, *worst_kept_motion = NULL;
   RANSAC_MOTION current_motion;
 
-  // Store the parameters and the indices of the inlier points for the motion
-  // currently under consideration.
-  double params_this_motion[MAX_PARAMDIM];
+  // Store the parameters of the batch of motions currently under
+  // consideration, transposed so that params_batch[k][m] is parameter k of
+  // motion m, along with their inlier counts and sse.
+  double params_batch[MAX_PARAMDIM][RANSAC_BATCH_SIZE];
+  int num_inliers_batch[RANSAC_BATCH_SIZE];
+  double sse_batch[RANSAC_BATCH_SIZE];
 
   if (npoints < minpts * MINPTS_MULTIPLIER || npoints == 0) {
     return false;
@@ -278,10 +324,12 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
 
   points1 = (double *)aom_malloc(sizeof(*points1) * npoints * 2);
   points2 = (double *)aom_malloc(sizeof(*points2) * npoints * 2);
-  corners1 = (double *)aom_malloc(sizeof(*corners1) * npoints * 2);
-  corners2 = (double *)aom_malloc(sizeof(*corners2) * npoints * 2);
-  projected_corners =
-      (double *)aom_malloc(sizeof(*projected_corners) * npoints * 2);
+  corners1_x = (double *)aom_malloc(sizeof(*corners1_x) * npoints);
+  corners1_y = (double *)aom_malloc(sizeof(*corners1_y) * npoints);
+  corners2_x = (double *)aom_malloc(sizeof(*corners2_x) * npoints);
+  corners2_y = (double *)aom_malloc(sizeof(*corners2_y) * npoints);
+  inlier_mask = (uint8_t *)aom_malloc(sizeof(*inlier_mask) * npoints *
+                                      RANSAC_BATCH_SIZE);
   motions =
       (RANSAC_MOTION *)aom_calloc(num_desired_motions, sizeof(RANSAC_MOTION));
 
@@ -294,8 +342,8 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
   int *inlier_buffer = (int *)aom_malloc(sizeof(*inlier_buffer) * npoints *
                                          (num_desired_motions + 1));
 
-  if (!(points1 && points2 && corners1 && corners2 && projected_corners &&
-        motions && inlier_buffer)) {
+  if (!(points1 && points2 && corners1_x && corners1_y && corners2_x &&
+        corners2_y && inlier_mask && motions && inlier_buffer)) {
     ret_val = false;
     goto finish_ransac;
   }
@@ -310,53 +358,73 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
   current_motion.inlier_indices = inlier_buffer + num_desired_motions * npoints;
 
   for (i = 0; i < npoints; ++i) {
-    corners1[2 * i + 0] = matched_points[i].x;
-    corners1[2 * i + 1] = matched_points[i].y;
-    corners2[2 * i + 0] = matched_points[i].rx;
-    corners2[2 * i + 1] = matched_points[i].ry;
+    corners1_x[i] = matched_points[i].x;
+    corners1_y[i] = matched_points[i].y;
+    corners2_x[i] = matched_points[i].rx;
+    corners2_y[i] = matched_points[i].ry;
   }
 
-  for (int trial_count = 0; trial_count < NUM_TRIALS; trial_count++) {
-    lcg_pick(npoints, minpts, indices, &seed);
-
-    copy_points_at_indices(points1, corners1, indices, minpts);
-    copy_points_at_indices(points2, corners2, indices, minpts);
-
-    if (model_info->is_degenerate(points1)) {
-      continue;
+  int num_trials = NUM_TRIALS;
+  for (int trial_count = 0; trial_count < num_trials;
+       trial_count += RANSAC_BATCH_SIZE) {
+    // Fit a batch of candidate motions, each to a random minimal set of
+    // points. Unused slots are filled with the identity model, and their
+    // scores are ignored.
+    const int batch_size = AOMMIN(RANSAC_BATCH_SIZE, num_trials - trial_count);
+    int num_models = 0;
+    for (int m = 0; m < RANSAC_BATCH_SIZE; ++m) {
+      for (int k = 0; k < MAX_PARAMDIM; ++k) {
+        params_batch[k][m] = kIdentityParams[k];
+      }
     }
 
-    if (!model_info->find_transformation(minpts, points1, points2,
-                                         params_this_motion)) {
-      continue;
-    }
+    for (int trial = 0; trial < batch_size; ++trial) {
+      double params_this_motion[MAX_PARAMDIM];
+      lcg_pick(npoints, minpts, indices, &seed);
 
-    model_info->project_points(params_this_motion, corners1, projected_corners,
-                               npoints, 2, 2);
+      copy_points_at_indices(points1, corners1_x, corners1_y, indices, minpts);
+      copy_points_at_indices(points2, corners2_x, corners2_y, indices, minpts);
 
-    current_motion.num_inliers = 0;
-    double sse = 0.0;
-    for (i = 0; i < npoints; ++i) {
-      double dx = projected_corners[i * 2] - corners2[i * 2];
-      double dy = projected_corners[i * 2 + 1] - corners2[i * 2 + 1];
-      double squared_error = dx * dx + dy * dy;
+      if (model_info->is_degenerate(points1)) {
+        continue;
+      }
 
-      if (squared_error < INLIER_THRESHOLD_SQUARED) {
-        current_motion.inlier_indices[current_motion.num_inliers++] = i;
-        sse += squared_error;
+      if (!model_info->find_transformation(minpts, points1, points2,
+                                           params_this_motion)) {
+        continue;
       }
-    }
 
-    if (current_motion.num_inliers < min_inliers) {
-      // Reject models with too few inliers
-      continue;
+      for (int k = 0; k < MAX_PARAMDIM; ++k) {
+        params_batch[k][num_models] = params_this_motion[k];
+      }
+      num_models++;
     }
+    if (num_models == 0) continue;
+
+    score_models(params_batch, corners1_x, corners1_y, corners2_x, corners2_y,
+                 npoints, inlier_mask, num_inliers_batch, sse_batch);
+
+    // Consider the candidates in the order they were sampled
+    for (int m = 0; m < num_models; ++m) {
+      current_motion.num_inliers = num_inliers_batch[m];
+      if (current_motion.num_inliers < min_inliers) {
+        // Reject models with too few inliers
+        continue;
+      }
+
+      current_motion.sse = sse_batch[m];
+      if (!is_better_motion(&current_motion, worst_kept_motion)) continue;
 
-    current_motion.sse = sse;
-    if (is_better_motion(&current_motion, worst_kept_motion)) {
       // This motion is better than the worst currently kept motion. Remember
       // the inlier points and sse. The parameters for each kept motion
       // will be recomputed later using only the inliers.
+      int num_inliers = 0;
+      for (i = 0; i < npoints; ++i) {
+        if (inlier_mask[i * RANSAC_BATCH_SIZE + m]) {
+          current_motion.inlier_indices[num_inliers++] = i;
+        }
+      }
+      assert(num_inliers == current_motion.num_inliers);
       worst_kept_motion->num_inliers = current_motion.num_inliers;
       worst_kept_motion->sse = current_motion.sse;
 
@@ -365,7 +433,7 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
       // we can swap the underlying pointers.
       //
       // This is okay because the next time current_motion.inlier_indices
-      // is used will be in the next trial, where we ignore its previous
+      // is used will be for a later candidate, where we ignore its previous
       // contents anyway. And both arrays will be deallocated together at the
       // end of this function, so there are no lifetime issues.
       int *tmp = worst_kept_motion->inlier_indices;
@@ -378,6 +446,14 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
           worst_kept_motion = &motions[i];
         }
       }
+
+      // Once every kept motion is valid, the worst of them bounds how many
+      // more trials are worth making.
+      if (worst_kept_motion->num_inliers >= min_inliers) {
+        num_trials = AOMMIN(
+            num_trials, get_num_trials_needed(worst_kept_motion->num_inliers,
+                                              npoints, minpts));
+      }
     }
   }
 
@@ -390,10 +466,10 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
     if (num_inliers > 0) {
       assert(num_inliers >= minpts);
 
-      copy_points_at_indices(points1, corners1, motions[i].inlier_indices,
-                             num_inliers);
-      copy_points_at_indices(points2, corners2, motions[i].inlier_indices,
-                             num_inliers);
+      copy_points_at_indices(points1, corners1_x, corners1_y,
+                             motions[i].inlier_indices, num_inliers);
+      copy_points_at_indices(points2, corners2_x, corners2_y,
+                             motions[i].inlier_indices, num_inliers);
 
       if (!model_info->find_transformation(num_inliers, points1, points2,
                                            motion_models[i].params)) {
@@ -424,9 +500,11 @@ static bool ransac_internal(const Correspondence *matched_points, int npoints,
 finish_ransac:
   aom_free(inlier_buffer);
   aom_free(motions);
-  aom_free(projected_corners);
-  aom_free(corners2);
-  aom_free(corners1);
+  aom_free(inlier_mask);
+  aom_free(corners2_y);
+  aom_free(corners2_x);
+  aom_free(corners1_y);
+  aom_free(corners1_x);
   aom_free(points2);
   aom_free(points1);
 
@@ -452,18 +530,17 @@ static bool is_degenerate_affine(double *p) {
 
 static const RansacModelInfo ransac_model_info[TRANS_TYPES] = {
   // IDENTITY
-  { NULL, NULL, NULL, 0 },
+  { NULL, NULL, 0 },
 // TRANSLATION
 #if ALLOW_TRANSLATION_MODELS
-  { is_degenerate_translation, find_translation, project_points_translation,
-    3 },
+  { is_degenerate_translation, find_translation, 3 },
 #else
-  { NULL, NULL, NULL, 0 },
+  { NULL, NULL, 0 },
 #endif
   // ROTZOOM
-  { is_degenerate_affine, find_rotzoom, project_points_affine, 3 },
+  { is_degenerate_affine, find_rotzoom, 3 },
   // AFFINE
-  { is_degenerate_affine, find_affine, project_points_affine, 3 },
+  { is_degenerate_affine, find_affine, 3 },
 };
 
 // Returns true on success, false on error
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <assert.h>
+#include <immintrin.h>
+#include <math.h>
+
+#include "aom_dsp/aom_dsp_common.h"
+#include "aom_dsp/flow_estimation/disflow.h"
+#include "aom_dsp/x86/synonyms_avx2.h"
+
+#include "config/aom_dsp_rtcd.h"
+
+// This file follows the structure of disflow_sse4.c, but each 256-bit
+// register holds two rows of an 8x8 patch: the low lane holds one row and the
+// high lane holds the row below it.
+//
+// The refinement loop in aom_compute_flow_at_point_avx2() is a serial chain,
+// as each iteration needs the flow vector from the previous one. So the code
+// is arranged to keep that chain short: the gradients and source pixels are
+// computed once and kept in registers, the intermediate rows of the separable
+// filters never go through memory, and the interpolation kernels are computed
+// with vector arithmetic.
+#if DISFLOW_PATCH_SIZE != 8
+#error "Need to change disflow_avx2.c if DISFLOW_PATCH_SIZE != 8"
+#endif
+
+// Number of registers needed to hold an 8x8 patch of int16s
+#define PATCH_REGS (DISFLOW_PATCH_SIZE / 2)
+
+// Compute the cubic interpolation kernel for the fractional offset x, as the
+// pairs of 16-bit taps { 0, 1 } and { 2, 3 } broadcast to every 32-bit
+// element.
+//
+// This is bit-exact with get_cubic_kernel_int() in disflow.c: each tap is
+// evaluated with the same operations in the same order (the extra terms with
+// zero coefficients do not change the result), and the conversion to integer
+// rounds to nearest, like rint().
+static INLINE void get_cubic_kernel_int(double x, __m256i *kernel_01,
+                                        __m256i *kernel_23) {
+  assert(0 <= x && x < 1);
+  // kernel[i] = ((c1[i] * x + c2[i] * x^2) + c0[i]) + c3[i] * x^3
+  const __m256d c0 = _mm256_setr_pd(0.0, 1.0, 0.0, 0.0);
+  const __m256d c1 = _mm256_setr_pd(-0.5, 0.0, 0.5, 0.0);
+  const __m256d c2 = _mm256_setr_pd(1.0, -2.5, 2.0, -0.5);
+  const __m256d c3 = _mm256_setr_pd(-0.5, 1.5, -1.5, 0.5);
+  const __m256d x1 = _mm256_set1_pd(x);
+  const __m256d x2 = _mm256_mul_pd(x1, x1);
+  const __m256d x3 = _mm256_mul_pd(x2, x1);
+  const __m256d kernel_dbl = _mm256_add_pd(
+      _mm256_add_pd(
+          _mm256_add_pd(_mm256_mul_pd(c1, x1), _mm256_mul_pd(c2, x2)), c0),
+      _mm256_mul_pd(c3, x3));
+
+  const __m128i kernel_i32 = _mm256_cvtpd_epi32(
+      _mm256_mul_pd(kernel_dbl, _mm256_set1_pd(1 << DISFLOW_INTERP_BITS)));
+  const __m128i kernel_i16 = _mm_packs_epi32(kernel_i32, kernel_i32);
+  *kernel_01 = _mm256_broadcastd_epi32(kernel_i16);
+  *kernel_23 = _mm256_broadcastd_epi32(_mm_srli_si128(kernel_i16, 4));
+}
+
+// Load 16 pixels from each of two rows, placing 'lo' in the low lane and 'hi'
+// in the high lane.
+static INLINE __m256i load_row_pair(const uint8_t *lo, const uint8_t *hi) {
+  return yy_loadu2_128(hi, lo);
+}
+
+// Given registers holding rows (r - 1, r) and (r + 1, r + 2), form the
+// register holding rows (r, r + 1).
+static INLINE __m256i middle_rows(__m256i a, __m256i b) {
+  return _mm256_permute2x128_si256(a, b, 0x21);
+}
+
+// Apply the horizontal cubic filter to a pair of rows, producing 8 outputs
+// per row, with 6 extra bits of precision (see disflow.c for why this fits in
+// an int16_t).
+static INLINE __m256i h_filter_row_pair(const uint8_t *lo, const uint8_t *hi,
+                                        __m256i kernel_01, __m256i kernel_23) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round_const =
+      _mm256_set1_epi32(1 << (DISFLOW_INTERP_BITS - 6 - 1));
+  const __m256i rows = load_row_pair(lo, hi);
+
+  // Expand pixels to int16s. Unpacking works within each lane, so this
+  // gives pixels 0..7 and 4..11 of each row.
+  const __m256i px_0to7 = _mm256_unpacklo_epi8(rows, zero);
+  const __m256i px_4to11 =
+      _mm256_unpacklo_epi8(_mm256_srli_si256(rows, 4), zero);
+
+  // input pixels 0, 1, 1, 2, 2, 3, 3, 4  * kernel 0, 1, 0, 1, ...
+  // input pixels 2, 3, 3, 4, 4, 5, 5, 6  * kernel 2, 3, 2, 3, ...
+  const __m256i px0 =
+      _mm256_unpacklo_epi16(px_0to7, _mm256_srli_si256(px_0to7, 2));
+  const __m256i px1 = _mm256_unpacklo_epi16(_mm256_srli_si256(px_0to7, 4),
+                                            _mm256_srli_si256(px_0to7, 6));
+  const __m256i sum0 = _mm256_add_epi32(_mm256_madd_epi16(px0, kernel_01),
+                                        _mm256_madd_epi16(px1, kernel_23));
+
+  const __m256i px2 =
+      _mm256_unpacklo_epi16(px_4to11, _mm256_srli_si256(px_4to11, 2));
+  const __m256i px3 = _mm256_unpacklo_epi16(_mm256_srli_si256(px_4to11, 4),
+                                            _mm256_srli_si256(px_4to11, 6));
+  const __m256i sum1 = _mm256_add_epi32(_mm256_madd_epi16(px2, kernel_01),
+                                        _mm256_madd_epi16(px3, kernel_23));
+
+  const __m256i out0 = _mm256_srai_epi32(_mm256_add_epi32(sum0, round_const),
+                                         DISFLOW_INTERP_BITS - 6);
+  const __m256i out1 = _mm256_srai_epi32(_mm256_add_epi32(sum1, round_const),
+                                         DISFLOW_INTERP_BITS - 6);
+  return _mm256_packs_epi32(out0, out1);
+}
+
+// Compare two regions of width x height pixels, one rooted at position
+// (x, y) in src and the other at (x + u, y + v) in ref.
+// This function stores the per-pixel differences between the two regions,
+// scaled by DISFLOW_DERIV_SCALE, in dt. src_pixels holds the source patch,
+// already scaled by DISFLOW_DERIV_SCALE.
+static INLINE void compute_flow_error(const __m256i *src_pixels,
+                                      const uint8_t *ref, int width, int height,
+                                      int stride, int x, int y, double u,
+                                      double v, __m256i *dt) {
+  // Split offset into integer and fractional parts, and compute cubic
+  // interpolation kernels
+  const int u_int = (int)floor(u);
+  const int v_int = (int)floor(v);
+  const double u_frac = u - floor(u);
+  const double v_frac = v - floor(v);
+
+  __m256i h_kernel_01, h_kernel_23;
+  __m256i v_kernel_01, v_kernel_23;
+  get_cubic_kernel_int(u_frac, &h_kernel_01, &h_kernel_23);
+  get_cubic_kernel_int(v_frac, &v_kernel_01, &v_kernel_23);
+
+  // Clamp coordinates so that all pixels we fetch will remain within the
+  // allocated border region; see disflow.c for the derivation.
+  const int x0 = clamp(x + u_int, -9, width);
+  const int y0 = clamp(y + v_int, -9, height);
+
+  // Horizontal convolution, two rows at a time: tmp[k] holds rows (2k - 1)
+  // and (2k). There are an odd number (DISFLOW_PATCH_SIZE + 3) of rows, so the
+  // last row is filtered on its own.
+  __m256i tmp[PATCH_REGS + 2];
+  for (int k = 0; k < PATCH_REGS + 2; ++k) {
+    const uint8_t *ref_row = &ref[(y0 + 2 * k - 1) * stride + (x0 - 1)];
+    const uint8_t *next_row =
+        (k == PATCH_REGS + 1) ? ref_row : ref_row + stride;
+    tmp[k] = h_filter_row_pair(ref_row, next_row, h_kernel_01, h_kernel_23);
+  }
+
+  // Vertical convolution, two rows at a time
+  const int round_bits = DISFLOW_INTERP_BITS + 6 - DISFLOW_DERIV_SCALE_LOG2;
+  const __m256i round_const_v = _mm256_set1_epi32(1 << (round_bits - 1));
+
+  for (int k = 0; k < PATCH_REGS; ++k) {
+    // pxN holds rows (2k + N - 1) and (2k + N)
+    const __m256i px0 = tmp[k];
+    const __m256i px1 = middle_rows(tmp[k], tmp[k + 1]);
+    const __m256i px2 = tmp[k + 1];
+    const __m256i px3 = middle_rows(tmp[k + 1], tmp[k + 2]);
+
+    const __m256i sum0 = _mm256_add_epi32(
+        _mm256_madd_epi16(_mm256_unpacklo_epi16(px0, px1), v_kernel_01),
+        _mm256_madd_epi16(_mm256_unpacklo_epi16(px2, px3), v_kernel_23));
+    const __m256i sum1 = _mm256_add_epi32(
+        _mm256_madd_epi16(_mm256_unpackhi_epi16(px0, px1), v_kernel_01),
+        _mm256_madd_epi16(_mm256_unpackhi_epi16(px2, px3), v_kernel_23));
+
+    const __m256i sum0_rounded =
+        _mm256_srai_epi32(_mm256_add_epi32(sum0, round_const_v), round_bits);
+    const __m256i sum1_rounded =
+        _mm256_srai_epi32(_mm256_add_epi32(sum1, round_const_v), round_bits);
+    const __m256i warped = _mm256_packs_epi32(sum0_rounded, sum1_rounded);
+
+    // Calculate delta from the target patch
+    dt[k] = _mm256_sub_epi16(warped, src_pixels[k]);
+  }
+}
+
+// Load the source patch, scaled to match the warped reference pixels in
+// compute_flow_error().
+static INLINE void load_src_pixels(const uint8_t *src, int stride,
+                                   __m256i *src_pixels) {
+  for (int k = 0; k < PATCH_REGS; ++k) {
+    const uint8_t *src_row = &src[2 * k * stride];
+    const __m128i src_pixels_u8 = _mm_unpacklo_epi64(
+        _mm_loadl_epi64((const __m128i *)src_row),
+        _mm_loadl_epi64((const __m128i *)(src_row + stride)));
+    src_pixels[k] = _mm256_slli_epi16(_mm256_cvtepu8_epi16(src_pixels_u8),
+                                      DISFLOW_DERIV_SCALE_LOG2);
+  }
+}
+
+// Compute both Sobel gradients of the patch at once, as they share the same
+// input rows. dx uses the kernel {1, 0, -1} horizontally and {1, 2, 1}
+// vertically, and dy the transpose of that; see sobel_filter() in disflow.c.
+static INLINE void sobel_filter(const uint8_t *src, int src_stride,
+                                __m256i *dx, __m256i *dy) {
+  const __m256i zero = _mm256_setzero_si256();
+
+  // Horizontal filters, two rows at a time:
+  //   tmp_a[x] = image[x - 1] - image[x + 1]
+  //   tmp_b[x] = (image[x - 1] + image[x + 1]) + (image[x] << 1)
+  // tmp_a[k] and tmp_b[k] hold rows (2k - 1) and (2k).
+  __m256i tmp_a[PATCH_REGS + 1];
+  __m256i tmp_b[PATCH_REGS + 1];
+  for (int k = 0; k < PATCH_REGS + 1; ++k) {
+    const uint8_t *src_row = src + (2 * k - 1) * src_stride - 1;
+    const __m256i rows = load_row_pair(src_row, src_row + src_stride);
+    const __m256i px0 = _mm256_unpacklo_epi8(rows, zero);
+    const __m256i px1 = _mm256_unpacklo_epi8(_mm256_srli_si256(rows, 1), zero);
+    const __m256i px2 = _mm256_unpacklo_epi8(_mm256_srli_si256(rows, 2), zero);
+
+    tmp_a[k] = _mm256_sub_epi16(px0, px2);
+    tmp_b[k] =
+        _mm256_add_epi16(_mm256_add_epi16(px0, px2), _mm256_slli_epi16(px1, 1));
+  }
+
+  // Vertical filters, two rows at a time:
+  //   dx[y] = (tmp_a[y - 1] + tmp_a[y + 1]) + (tmp_a[y] << 1)
+  //   dy[y] = tmp_b[y - 1] - tmp_b[y + 1]
+  for (int k = 0; k < PATCH_REGS; ++k) {
+    const __m256i a1 = middle_rows(tmp_a[k], tmp_a[k + 1]);
+    dx[k] = _mm256_add_epi16(_mm256_add_epi16(tmp_a[k], tmp_a[k + 1]),
+                             _mm256_slli_epi16(a1, 1));
+    dy[k] = _mm256_sub_epi16(tmp_b[k], tmp_b[k + 1]);
+  }
+}
+
+// Sum the 32-bit elements of each of a and b, returning
+// { sum(a), sum(b), sum(a), sum(b) }.
+static INLINE __m128i hsum_pair_epi32(__m256i a, __m256i b) {
+  const __m128i a128 = _mm_add_epi32(_mm256_castsi256_si128(a),
+                                     _mm256_extracti128_si256(a, 1));
+  const __m128i b128 = _mm_add_epi32(_mm256_castsi256_si128(b),
+                                     _mm256_extracti128_si256(b, 1));
+  const __m128i partial_sum = _mm_hadd_epi32(a128, b128);
+  return _mm_hadd_epi32(partial_sum, partial_sum);
+}
+
+static INLINE void compute_flow_vector(const __m256i *dx, const __m256i *dy,
+                                       const __m256i *dt, int *b) {
+  __m256i b0_acc = _mm256_setzero_si256();
+  __m256i b1_acc = _mm256_setzero_si256();
+
+  for (int k = 0; k < PATCH_REGS; ++k) {
+    b0_acc = _mm256_add_epi32(b0_acc, _mm256_madd_epi16(dx[k], dt[k]));
+    b1_acc = _mm256_add_epi32(b1_acc, _mm256_madd_epi16(dy[k], dt[k]));
+  }
+
+  const __m128i sums = hsum_pair_epi32(b0_acc, b1_acc);
+  b[0] = _mm_cvtsi128_si32(sums);
+  b[1] = _mm_extract_epi32(sums, 1);
+}
+
+static INLINE void compute_flow_matrix(const __m256i *dx, const __m256i *dy,
+                                       double *M) {
+  __m256i acc_xx = _mm256_setzero_si256();
+  __m256i acc_xy = _mm256_setzero_si256();
+  __m256i acc_yy = _mm256_setzero_si256();
+
+  for (int k = 0; k < PATCH_REGS; ++k) {
+    acc_xx = _mm256_add_epi32(acc_xx, _mm256_madd_epi16(dx[k], dx[k]));
+    acc_xy = _mm256_add_epi32(acc_xy, _mm256_madd_epi16(dx[k], dy[k]));
+    acc_yy = _mm256_add_epi32(acc_yy, _mm256_madd_epi16(dy[k], dy[k]));
+  }
+
+  // Condense sums into { xx, xy, xy, yy }, then apply the same `+ 1 * I`
+  // regularization as the C code.
+  const __m128i sum_xx_xy = hsum_pair_epi32(acc_xx, acc_xy);
+  const __m128i sum_xy_yy = hsum_pair_epi32(acc_xy, acc_yy);
+  __m128i result = _mm_unpacklo_epi64(sum_xx_xy, sum_xy_yy);
+  result = _mm_add_epi32(result, _mm_set_epi32(1, 0, 0, 1));
+
+  // Convert results to doubles and store
+  _mm256_storeu_pd(M, _mm256_cvtepi32_pd(result));
+}
+
+// Try to invert the matrix M
+// As in disflow.c, the regularization ensures that det M >= 1.
+static INLINE void invert_2x2(const double *M, double *M_inv) {
+  double det = (M[0] * M[3]) - (M[1] * M[2]);
+  assert(det >= 1);
+  const double det_inv = 1 / det;
+
+  M_inv[0] = M[3] * det_inv;
+  M_inv[1] = -M[1] * det_inv;
+  M_inv[2] = -M[2] * det_inv;
+  M_inv[3] = M[0] * det_inv;
+}
+
+void aom_compute_flow_at_point_avx2(const uint8_t *src, const uint8_t *ref,
+                                    int x, int y, int width, int height,
+                                    int stride, double *u, double *v) {
+  double M[4];
+  double M_inv[4];
+  int b[2];
+  __m256i src_pixels[PATCH_REGS];
+  __m256i dt[PATCH_REGS];
+  __m256i dx[PATCH_REGS];
+  __m256i dy[PATCH_REGS];
+
+  // Compute gradients within this patch
+  const uint8_t *src_patch = &src[y * stride + x];
+  sobel_filter(src_patch, stride, dx, dy);
+  load_src_pixels(src_patch, stride, src_pixels);
+
+  compute_flow_matrix(dx, dy, M);
+  invert_2x2(M, M_inv);
+
+  double cur_u = *u;
+  double cur_v = *v;
+  for (int itr = 0; itr < DISFLOW_MAX_ITR; itr++) {
+    compute_flow_error(src_pixels, ref, width, height, stride, x, y, cur_u,
+                       cur_v, dt);
+    compute_flow_vector(dx, dy, dt, b);
+
+    // Solve flow equations to find a better estimate for the flow vector
+    // at this point
+    const double step_u = M_inv[0] * b[0] + M_inv[1] * b[1];
+    const double step_v = M_inv[2] * b[0] + M_inv[3] * b[1];
+    cur_u += fclamp(step_u * DISFLOW_STEP_SIZE, -2, 2);
+    cur_v += fclamp(step_v * DISFLOW_STEP_SIZE, -2, 2);
+
+    if (fabs(step_u) + fabs(step_v) < DISFLOW_STEP_SIZE_THRESOLD) {
+      // Stop iteration when we're close to convergence
+      break;
+    }
+  }
+  *u = cur_u;
+  *v = cur_v;
+}
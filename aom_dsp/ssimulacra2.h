@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#ifndef AOM_AOM_DSP_SSIMULACRA2_H_
+#define AOM_AOM_DSP_SSIMULACRA2_H_
+
+#include <stddef.h>
+
+#include "aom_scale/yv12config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The local means are taken with a separable gaussian of sigma 1.5, applied to
+// rows padded by SSIMULACRA2_BLUR_RADIUS on each side.
+#define SSIMULACRA2_BLUR_RADIUS 5
+#define SSIMULACRA2_BLUR_TAPS (2 * SSIMULACRA2_BLUR_RADIUS + 1)
+
+// Float planes reused across calls to aom_calc_ssimulacra2(); they are only
+// reallocated when the frame grows.
+typedef struct {
+  float *buffer;
+  size_t buffer_size;
+} AomSsimulacra2Buffers;
+
+void aom_free_ssimulacra2_buffers(AomSsimulacra2Buffers *buffers);
+
+// Computes the SSIMULACRA2 score of 'distorted' against 'source' into
+// 'score': 100 for identical frames, decreasing as the distortion becomes more
+// visible. When 'dist_map' is not NULL it receives one float per luma pixel
+// with the full resolution part of the distortion, 0 where the frames match.
+// Returns a boolean that indicates success/failure.
+int aom_calc_ssimulacra2(const YV12_BUFFER_CONFIG *source,
+                         const YV12_BUFFER_CONFIG *distorted, int bit_depth,
+                         aom_matrix_coefficients_t matrix_coefficients,
+                         aom_color_range_t color_range,
+                         AomSsimulacra2Buffers *buffers, double *score,
+                         float *dist_map);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // AOM_AOM_DSP_SSIMULACRA2_H_
@@ -70,11 +70,10 @@ static void copy_picture(const int bit_depth, const YV12_BUFFER_CONFIG *src,
 }
 
 void aom_init_vmaf_context(VmafContext **vmaf_context, VmafModel *vmaf_model,
-                           bool cal_vmaf_neg) {
-  // TODO(sdeng): make them CLI arguments.
+                           bool cal_vmaf_neg, int n_threads) {
   VmafConfiguration cfg;
   cfg.log_level = VMAF_LOG_LEVEL_NONE;
-  cfg.n_threads = 7;
+  cfg.n_threads = n_threads;
   cfg.n_subsample = 0;
   cfg.cpumask = 0;
 
@@ -127,7 +126,8 @@ void aom_calc_vmaf(VmafModel *vmaf_model, const YV12_BUFFER_CONFIG *source,
                    const YV12_BUFFER_CONFIG *distorted, int bit_depth,
                    bool cal_vmaf_neg, double *vmaf) {
   VmafContext *vmaf_context;
-  aom_init_vmaf_context(&vmaf_context, vmaf_model, cal_vmaf_neg);
+  aom_init_vmaf_context(&vmaf_context, vmaf_model, cal_vmaf_neg,
+                        AOM_VMAF_DEFAULT_THREADS);
   const int frame_index = 0;
   VmafPicture ref, dist;
   if (vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV420P, bit_depth, source->y_width,
@@ -159,21 +159,29 @@ void aom_read_vmaf_image(VmafContext *vmaf_context,
                          const YV12_BUFFER_CONFIG *distorted, int bit_depth,
                          int frame_index) {
   VmafPicture ref, dist;
-  if (vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV420P, bit_depth, source->y_width,
-                         source->y_height) ||
-      vmaf_picture_alloc(&dist, VMAF_PIX_FMT_YUV420P, bit_depth,
+  aom_alloc_vmaf_picture(&ref, source, bit_depth);
+  aom_alloc_vmaf_picture(&dist, distorted, bit_depth);
+  aom_read_vmaf_pictures(vmaf_context, &ref, &dist, frame_index);
+}
+
+void aom_alloc_vmaf_picture(VmafPicture *picture,
+                            const YV12_BUFFER_CONFIG *source, int bit_depth) {
+  if (vmaf_picture_alloc(picture, VMAF_PIX_FMT_YUV420P, bit_depth,
                          source->y_width, source->y_height)) {
     vmaf_fatal_error("Failed to alloc VMAF pictures.");
   }
-  copy_picture(bit_depth, source, &ref);
-  copy_picture(bit_depth, distorted, &dist);
-  if (vmaf_read_pictures(vmaf_context, &ref, &dist,
+  copy_picture(bit_depth, source, picture);
+}
+
+void aom_read_vmaf_pictures(VmafContext *vmaf_context, VmafPicture *ref,
+                            VmafPicture *dist, int frame_index) {
+  if (vmaf_read_pictures(vmaf_context, ref, dist,
                          /*picture index=*/frame_index)) {
     vmaf_fatal_error("Failed to read VMAF pictures.");
   }
 
-  vmaf_picture_unref(&ref);
-  vmaf_picture_unref(&dist);
+  vmaf_picture_unref(ref);
+  vmaf_picture_unref(dist);
 }
 
 double aom_calc_vmaf_at_index(VmafContext *vmaf_context, VmafModel *vmaf_model,
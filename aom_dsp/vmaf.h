@@ -17,8 +17,11 @@
 
 #include "aom_scale/yv12config.h"
 
+// Feature extraction threads used by aom_calc_vmaf().
+#define AOM_VMAF_DEFAULT_THREADS 7
+
 void aom_init_vmaf_context(VmafContext **vmaf_context, VmafModel *vmaf_model,
-                           bool cal_vmaf_neg);
+                           bool cal_vmaf_neg, int n_threads);
 void aom_close_vmaf_context(VmafContext *vmaf_context);
 
 void aom_init_vmaf_model(VmafModel **vmaf_model, const char *model_path);
@@ -33,6 +36,16 @@ void aom_read_vmaf_image(VmafContext *vmaf_context,
                          const YV12_BUFFER_CONFIG *distorted, int bit_depth,
                          int frame_index);
 
+// Allocates 'picture' and copies the luma plane of 'source' into it. Safe to
+// call from several threads at once.
+void aom_alloc_vmaf_picture(VmafPicture *picture,
+                            const YV12_BUFFER_CONFIG *source, int bit_depth);
+
+// Queues a pair of pictures from aom_alloc_vmaf_picture() for scoring at
+// 'frame_index' and releases them.
+void aom_read_vmaf_pictures(VmafContext *vmaf_context, VmafPicture *ref,
+                            VmafPicture *dist, int frame_index);
+
 double aom_calc_vmaf_at_index(VmafContext *vmaf_context, VmafModel *vmaf_model,
                               int frame_index);
 
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <immintrin.h>
+
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/ssimulacra2.h"
+
+// Adds the eight lanes of 'v' to '*sum' in double precision.
+static INLINE void add_lanes(__m256 v, double *sum) {
+  const __m256d s = _mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)),
+                                  _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  const __m128d s2 =
+      _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+  *sum += _mm_cvtsd_f64(_mm_add_sd(s2, _mm_unpackhi_pd(s2, s2)));
+}
+
+// The blurs multiply and add in the same order as the C code, so results are
+// bit-exact.
+void aom_ssimulacra2_blur_row_avx2(const float *src, float *dst, int width,
+                                   const float *kernel) {
+  const int w8 = width & ~7;
+  __m256 k[SSIMULACRA2_BLUR_TAPS];
+  for (int i = 0; i < SSIMULACRA2_BLUR_TAPS; ++i) {
+    k[i] = _mm256_set1_ps(kernel[i]);
+  }
+  for (int x = 0; x < w8; x += 8) {
+    __m256 sum = _mm256_mul_ps(k[0], _mm256_loadu_ps(src + x));
+    for (int i = 1; i < SSIMULACRA2_BLUR_TAPS; ++i) {
+      sum = _mm256_add_ps(sum,
+                          _mm256_mul_ps(k[i], _mm256_loadu_ps(src + x + i)));
+    }
+    _mm256_storeu_ps(dst + x, sum);
+  }
+  if (w8 < width) {
+    aom_ssimulacra2_blur_row_c(src + w8, dst + w8, width - w8, kernel);
+  }
+}
+
+void aom_ssimulacra2_blur_col_avx2(const float *const *rows, float *dst,
+                                   int width, const float *kernel) {
+  const int w8 = width & ~7;
+  __m256 k[SSIMULACRA2_BLUR_TAPS];
+  for (int i = 0; i < SSIMULACRA2_BLUR_TAPS; ++i) {
+    k[i] = _mm256_set1_ps(kernel[i]);
+  }
+  for (int x = 0; x < w8; x += 8) {
+    __m256 sum = _mm256_mul_ps(k[0], _mm256_loadu_ps(rows[0] + x));
+    for (int i = 1; i < SSIMULACRA2_BLUR_TAPS; ++i) {
+      sum = _mm256_add_ps(sum,
+                          _mm256_mul_ps(k[i], _mm256_loadu_ps(rows[i] + x)));
+    }
+    _mm256_storeu_ps(dst + x, sum);
+  }
+  if (w8 < width) {
+    const float *tail[SSIMULACRA2_BLUR_TAPS];
+    for (int i = 0; i < SSIMULACRA2_BLUR_TAPS; ++i) tail[i] = rows[i] + w8;
+    aom_ssimulacra2_blur_col_c(tail, dst + w8, width - w8, kernel);
+  }
+}
+
+void aom_ssimulacra2_ssim_row_avx2(const float *mu1, const float *mu2,
+                                   const float *s1122, const float *s12,
+                                   int width, double *sums, float *map,
+                                   float map_weight) {
+  const int w8 = width & ~7;
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 c2 = _mm256_set1_ps(0.0009f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 weight = _mm256_set1_ps(map_weight);
+  __m256 sum = zero;
+  __m256 sum4 = zero;
+  for (int x = 0; x < w8; x += 8) {
+    const __m256 m1 = _mm256_loadu_ps(mu1 + x);
+    const __m256 m2 = _mm256_loadu_ps(mu2 + x);
+    const __m256 diff = _mm256_sub_ps(m1, m2);
+    const __m256 num_m = _mm256_sub_ps(one, _mm256_mul_ps(diff, diff));
+    const __m256 num_s = _mm256_add_ps(
+        _mm256_mul_ps(two, _mm256_sub_ps(_mm256_loadu_ps(s12 + x),
+                                         _mm256_mul_ps(m1, m2))),
+        c2);
+    const __m256 denom_s = _mm256_add_ps(
+        _mm256_sub_ps(_mm256_loadu_ps(s1122 + x),
+                      _mm256_add_ps(_mm256_mul_ps(m1, m1),
+                                    _mm256_mul_ps(m2, m2))),
+        c2);
+    const __m256 d = _mm256_max_ps(
+        _mm256_sub_ps(one,
+                      _mm256_div_ps(_mm256_mul_ps(num_m, num_s), denom_s)),
+        zero);
+    const __m256 d2 = _mm256_mul_ps(d, d);
+    sum = _mm256_add_ps(sum, d);
+    sum4 = _mm256_add_ps(sum4, _mm256_mul_ps(d2, d2));
+    if (map) {
+      _mm256_storeu_ps(map + x, _mm256_add_ps(_mm256_loadu_ps(map + x),
+                                              _mm256_mul_ps(weight, d)));
+    }
+  }
+  add_lanes(sum, &sums[0]);
+  add_lanes(sum4, &sums[1]);
+  if (w8 < width) {
+    aom_ssimulacra2_ssim_row_c(mu1 + w8, mu2 + w8, s1122 + w8, s12 + w8,
+                               width - w8, sums, map ? map + w8 : NULL,
+                               map_weight);
+  }
+}
+
+void aom_ssimulacra2_edge_row_avx2(const float *img1, const float *mu1,
+                                   const float *img2, const float *mu2,
+                                   int width, double *sums, float *map,
+                                   float artifact_weight, float detail_weight) {
+  const int w8 = width & ~7;
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 aw = _mm256_set1_ps(artifact_weight);
+  const __m256 dw = _mm256_set1_ps(detail_weight);
+  __m256 acc[4] = { zero, zero, zero, zero };
+  for (int x = 0; x < w8; x += 8) {
+    const __m256 diff2 = _mm256_andnot_ps(
+        sign,
+        _mm256_sub_ps(_mm256_loadu_ps(img2 + x), _mm256_loadu_ps(mu2 + x)));
+    const __m256 diff1 = _mm256_andnot_ps(
+        sign,
+        _mm256_sub_ps(_mm256_loadu_ps(img1 + x), _mm256_loadu_ps(mu1 + x)));
+    const __m256 d1 = _mm256_sub_ps(
+        _mm256_div_ps(_mm256_add_ps(one, diff2), _mm256_add_ps(one, diff1)),
+        one);
+    const __m256 artifact = _mm256_max_ps(d1, zero);
+    const __m256 detail = _mm256_max_ps(_mm256_xor_ps(d1, sign), zero);
+    const __m256 artifact2 = _mm256_mul_ps(artifact, artifact);
+    const __m256 detail2 = _mm256_mul_ps(detail, detail);
+    acc[0] = _mm256_add_ps(acc[0], artifact);
+    acc[1] = _mm256_add_ps(acc[1], _mm256_mul_ps(artifact2, artifact2));
+    acc[2] = _mm256_add_ps(acc[2], detail);
+    acc[3] = _mm256_add_ps(acc[3], _mm256_mul_ps(detail2, detail2));
+    if (map) {
+      const __m256 m = _mm256_add_ps(_mm256_mul_ps(aw, artifact),
+                                     _mm256_mul_ps(dw, detail));
+      _mm256_storeu_ps(map + x, _mm256_add_ps(_mm256_loadu_ps(map + x), m));
+    }
+  }
+  for (int i = 0; i < 4; ++i) add_lanes(acc[i], &sums[i]);
+  if (w8 < width) {
+    aom_ssimulacra2_edge_row_c(img1 + w8, mu1 + w8, img2 + w8, mu2 + w8,
+                               width - w8, sums, map ? map + w8 : NULL,
+                               artifact_weight, detail_weight);
+  }
+}
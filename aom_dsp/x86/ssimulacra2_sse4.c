@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <smmintrin.h>
+
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/ssimulacra2.h"
+
+// Adds the four lanes of 'v' to '*sum' in double precision.
+static INLINE void add_lanes(__m128 v, double *sum) {
+  const __m128d lo = _mm_cvtps_pd(v);
+  const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+  const __m128d s = _mm_add_pd(lo, hi);
+  *sum += _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+// The blurs multiply and add in the same order as the C code, so results are
+// bit-exact.
+void aom_ssimulacra2_blur_row_sse4_1(const float *src, float *dst, int width,
+                                     const float *kernel) {
+  const int w4 = width & ~3;
+  __m128 k[SSIMULACRA2_BLUR_TAPS];
+  for (int i = 0; i < SSIMULACRA2_BLUR_TAPS; ++i) k[i] = _mm_set1_ps(kernel[i]);
+  for (int x = 0; x < w4; x += 4) {
+    __m128 sum = _mm_mul_ps(k[0], _mm_loadu_ps(src + x));
+    for (int i = 1; i < SSIMULACRA2_BLUR_TAPS; ++i) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(k[i], _mm_loadu_ps(src + x + i)));
+    }
+    _mm_storeu_ps(dst + x, sum);
+  }
+  if (w4 < width) {
+    aom_ssimulacra2_blur_row_c(src + w4, dst + w4, width - w4, kernel);
+  }
+}
+
+void aom_ssimulacra2_blur_col_sse4_1(const float *const *rows, float *dst,
+                                     int width, const float *kernel) {
+  const int w4 = width & ~3;
+  __m128 k[SSIMULACRA2_BLUR_TAPS];
+  for (int i = 0; i < SSIMULACRA2_BLUR_TAPS; ++i) k[i] = _mm_set1_ps(kernel[i]);
+  for (int x = 0; x < w4; x += 4) {
+    __m128 sum = _mm_mul_ps(k[0], _mm_loadu_ps(rows[0] + x));
+    for (int i = 1; i < SSIMULACRA2_BLUR_TAPS; ++i) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(k[i], _mm_loadu_ps(rows[i] + x)));
+    }
+    _mm_storeu_ps(dst + x, sum);
+  }
+  if (w4 < width) {
+    const float *tail[SSIMULACRA2_BLUR_TAPS];
+    for (int i = 0; i < SSIMULACRA2_BLUR_TAPS; ++i) tail[i] = rows[i] + w4;
+    aom_ssimulacra2_blur_col_c(tail, dst + w4, width - w4, kernel);
+  }
+}
+
+void aom_ssimulacra2_ssim_row_sse4_1(const float *mu1, const float *mu2,
+                                     const float *s1122, const float *s12,
+                                     int width, double *sums, float *map,
+                                     float map_weight) {
+  const int w4 = width & ~3;
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 c2 = _mm_set1_ps(0.0009f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 weight = _mm_set1_ps(map_weight);
+  __m128 sum = zero;
+  __m128 sum4 = zero;
+  for (int x = 0; x < w4; x += 4) {
+    const __m128 m1 = _mm_loadu_ps(mu1 + x);
+    const __m128 m2 = _mm_loadu_ps(mu2 + x);
+    const __m128 diff = _mm_sub_ps(m1, m2);
+    const __m128 num_m = _mm_sub_ps(one, _mm_mul_ps(diff, diff));
+    const __m128 num_s = _mm_add_ps(
+        _mm_mul_ps(two, _mm_sub_ps(_mm_loadu_ps(s12 + x), _mm_mul_ps(m1, m2))),
+        c2);
+    const __m128 denom_s = _mm_add_ps(
+        _mm_sub_ps(_mm_loadu_ps(s1122 + x),
+                   _mm_add_ps(_mm_mul_ps(m1, m1), _mm_mul_ps(m2, m2))),
+        c2);
+    const __m128 d = _mm_max_ps(
+        _mm_sub_ps(one, _mm_div_ps(_mm_mul_ps(num_m, num_s), denom_s)), zero);
+    const __m128 d2 = _mm_mul_ps(d, d);
+    sum = _mm_add_ps(sum, d);
+    sum4 = _mm_add_ps(sum4, _mm_mul_ps(d2, d2));
+    if (map) {
+      _mm_storeu_ps(map + x,
+                    _mm_add_ps(_mm_loadu_ps(map + x), _mm_mul_ps(weight, d)));
+    }
+  }
+  add_lanes(sum, &sums[0]);
+  add_lanes(sum4, &sums[1]);
+  if (w4 < width) {
+    aom_ssimulacra2_ssim_row_c(mu1 + w4, mu2 + w4, s1122 + w4, s12 + w4,
+                               width - w4, sums, map ? map + w4 : NULL,
+                               map_weight);
+  }
+}
+
+void aom_ssimulacra2_edge_row_sse4_1(const float *img1, const float *mu1,
+                                     const float *img2, const float *mu2,
+                                     int width, double *sums, float *map,
+                                     float artifact_weight,
+                                     float detail_weight) {
+  const int w4 = width & ~3;
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 aw = _mm_set1_ps(artifact_weight);
+  const __m128 dw = _mm_set1_ps(detail_weight);
+  __m128 acc[4] = { zero, zero, zero, zero };
+  for (int x = 0; x < w4; x += 4) {
+    const __m128 diff2 =
+        _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(img2 + x),
+                                       _mm_loadu_ps(mu2 + x)));
+    const __m128 diff1 =
+        _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(img1 + x),
+                                       _mm_loadu_ps(mu1 + x)));
+    const __m128 d1 = _mm_sub_ps(
+        _mm_div_ps(_mm_add_ps(one, diff2), _mm_add_ps(one, diff1)), one);
+    const __m128 artifact = _mm_max_ps(d1, zero);
+    const __m128 detail = _mm_max_ps(_mm_xor_ps(d1, sign), zero);
+    const __m128 artifact2 = _mm_mul_ps(artifact, artifact);
+    const __m128 detail2 = _mm_mul_ps(detail, detail);
+    acc[0] = _mm_add_ps(acc[0], artifact);
+    acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(artifact2, artifact2));
+    acc[2] = _mm_add_ps(acc[2], detail);
+    acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(detail2, detail2));
+    if (map) {
+      const __m128 m = _mm_add_ps(_mm_mul_ps(aw, artifact),
+                                  _mm_mul_ps(dw, detail));
+      _mm_storeu_ps(map + x, _mm_add_ps(_mm_loadu_ps(map + x), m));
+    }
+  }
+  for (int i = 0; i < 4; ++i) add_lanes(acc[i], &sums[i]);
+  if (w4 < width) {
+    aom_ssimulacra2_edge_row_c(img1 + w4, mu1 + w4, img2 + w4, mu2 + w4,
+                               width - w4, sums, map ? map + w4 : NULL,
+                               artifact_weight, detail_weight);
+  }
+}
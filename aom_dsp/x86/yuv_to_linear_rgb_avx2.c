@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <immintrin.h>
+
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/yuv_to_linear_rgb.h"
+
+// Same operations, in the same order, as aom_srgb_to_linear(), so results
+// are bit-exact with the C code.
+static INLINE __m256 srgb_to_linear(const float *lut, __m256 v) {
+  v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()),
+                    _mm256_set1_ps(1.0f));
+  v = _mm256_mul_ps(v, _mm256_set1_ps((float)AOM_SRGB_EOTF_LUT_SIZE));
+  const __m256i i = _mm256_min_epi32(
+      _mm256_cvttps_epi32(v), _mm256_set1_epi32(AOM_SRGB_EOTF_LUT_SIZE - 1));
+  const __m256 f = _mm256_sub_ps(v, _mm256_cvtepi32_ps(i));
+  const __m256 lo = _mm256_i32gather_ps(lut, i, 4);
+  const __m256 hi = _mm256_i32gather_ps(lut + 1, i, 4);
+  return _mm256_add_ps(lo, _mm256_mul_ps(f, _mm256_sub_ps(hi, lo)));
+}
+
+static INLINE __m256 load_samples(const uint16_t *p, __m256 offset,
+                                  __m256 scale) {
+  const __m256 s = _mm256_cvtepi32_ps(
+      _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p)));
+  return _mm256_mul_ps(_mm256_sub_ps(s, offset), scale);
+}
+
+// Loads the 4 chroma samples of 8 pixels and repeats each of them twice.
+static INLINE __m256 load_samples_ss(const uint16_t *p, __m256 offset,
+                                     __m256 scale) {
+  const __m256i s = _mm256_permutevar8x32_epi32(
+      _mm256_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)p)),
+      _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+  return _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(s), offset), scale);
+}
+
+// Stores 8 pixels of planar r, g, b as interleaved RGB.
+static INLINE void store_interleaved(float *rgb, __m256 r, __m256 g,
+                                     __m256 b) {
+  // Each output vector picks pixels 0..2, 2..5 and 5..7 of all three planes
+  // with one index, then blends the planes into R, G, B order.
+  const __m256i idx0 = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+  const __m256i idx1 = _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+  const __m256i idx2 = _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+  __m256 out = _mm256_permutevar8x32_ps(r, idx0);
+  out = _mm256_blend_ps(out, _mm256_permutevar8x32_ps(g, idx0), 0x92);
+  out = _mm256_blend_ps(out, _mm256_permutevar8x32_ps(b, idx0), 0x24);
+  _mm256_storeu_ps(rgb, out);
+  out = _mm256_permutevar8x32_ps(r, idx1);
+  out = _mm256_blend_ps(out, _mm256_permutevar8x32_ps(g, idx1), 0x24);
+  out = _mm256_blend_ps(out, _mm256_permutevar8x32_ps(b, idx1), 0x49);
+  _mm256_storeu_ps(rgb + 8, out);
+  out = _mm256_permutevar8x32_ps(r, idx2);
+  out = _mm256_blend_ps(out, _mm256_permutevar8x32_ps(g, idx2), 0x49);
+  out = _mm256_blend_ps(out, _mm256_permutevar8x32_ps(b, idx2), 0x92);
+  _mm256_storeu_ps(rgb + 16, out);
+}
+
+void aom_highbd_yuv_to_linear_rgb_row_avx2(const uint16_t *y,
+                                           const uint16_t *u,
+                                           const uint16_t *v, int width,
+                                           int ss_x,
+                                           const YuvToRgbCoeffs *coeffs,
+                                           const float *lut, float *rgb) {
+  const __m256 y_offset = _mm256_set1_ps(coeffs->y_offset);
+  const __m256 y_scale = _mm256_set1_ps(coeffs->y_scale);
+  const __m256 uv_offset = _mm256_set1_ps(coeffs->uv_offset);
+  const __m256 uv_scale = _mm256_set1_ps(coeffs->uv_scale);
+  const __m256 r_from_v = _mm256_set1_ps(coeffs->r_from_v);
+  const __m256 g_from_u = _mm256_set1_ps(coeffs->g_from_u);
+  const __m256 g_from_v = _mm256_set1_ps(coeffs->g_from_v);
+  const __m256 b_from_u = _mm256_set1_ps(coeffs->b_from_u);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    const __m256 luma = load_samples(y + x, y_offset, y_scale);
+    __m256 cb, cr;
+    if (ss_x) {
+      cb = load_samples_ss(u + (x >> 1), uv_offset, uv_scale);
+      cr = load_samples_ss(v + (x >> 1), uv_offset, uv_scale);
+    } else {
+      cb = load_samples(u + x, uv_offset, uv_scale);
+      cr = load_samples(v + x, uv_offset, uv_scale);
+    }
+    const __m256 r =
+        srgb_to_linear(lut, _mm256_add_ps(luma, _mm256_mul_ps(r_from_v, cr)));
+    const __m256 g = srgb_to_linear(
+        lut, _mm256_add_ps(_mm256_add_ps(luma, _mm256_mul_ps(g_from_u, cb)),
+                           _mm256_mul_ps(g_from_v, cr)));
+    const __m256 b =
+        srgb_to_linear(lut, _mm256_add_ps(luma, _mm256_mul_ps(b_from_u, cb)));
+    store_interleaved(rgb + 3 * x, r, g, b);
+  }
+  if (x < width) {
+    aom_highbd_yuv_to_linear_rgb_row_c(y + x, u + (x >> ss_x), v + (x >> ss_x),
+                                       width - x, ss_x, coeffs, lut,
+                                       rgb + 3 * x);
+  }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <math.h>
+
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/yuv_to_linear_rgb.h"
+
+void aom_init_yuv_to_rgb_coeffs(int bit_depth,
+                                aom_matrix_coefficients_t matrix_coefficients,
+                                aom_color_range_t color_range,
+                                YuvToRgbCoeffs *coeffs) {
+  double kr, kb;
+  switch (matrix_coefficients) {
+    case AOM_CICP_MC_BT_709:
+      kr = 0.2126;
+      kb = 0.0722;
+      break;
+    case AOM_CICP_MC_BT_2020_NCL:
+    case AOM_CICP_MC_BT_2020_CL:
+      kr = 0.2627;
+      kb = 0.0593;
+      break;
+    default:
+      kr = 0.299;
+      kb = 0.114;
+      break;
+  }
+  const double kg = 1.0 - kr - kb;
+  const int shift = bit_depth - 8;
+  if (color_range == AOM_CR_FULL_RANGE) {
+    const double max_value = (double)((1 << bit_depth) - 1);
+    coeffs->y_offset = 0.0f;
+    coeffs->y_scale = (float)(1.0 / max_value);
+    coeffs->uv_offset = (float)(1 << (bit_depth - 1));
+    coeffs->uv_scale = (float)(1.0 / max_value);
+  } else {
+    coeffs->y_offset = (float)(16 << shift);
+    coeffs->y_scale = (float)(1.0 / (219 << shift));
+    coeffs->uv_offset = (float)(128 << shift);
+    coeffs->uv_scale = (float)(1.0 / (224 << shift));
+  }
+  coeffs->r_from_v = (float)(2.0 * (1.0 - kr));
+  coeffs->b_from_u = (float)(2.0 * (1.0 - kb));
+  coeffs->g_from_u = (float)(-2.0 * (1.0 - kb) * kb / kg);
+  coeffs->g_from_v = (float)(-2.0 * (1.0 - kr) * kr / kg);
+}
+
+void aom_init_srgb_eotf_lut(float *lut) {
+  for (int i = 0; i <= AOM_SRGB_EOTF_LUT_SIZE; ++i) {
+    const double v = (double)i / AOM_SRGB_EOTF_LUT_SIZE;
+    lut[i] = (float)(v <= 0.04045 ? v / 12.92
+                                  : pow((v + 0.055) / 1.055, 2.4));
+  }
+}
+
+void aom_highbd_yuv_to_linear_rgb_row_c(const uint16_t *y, const uint16_t *u,
+                                        const uint16_t *v, int width,
+                                        int ss_x,
+                                        const YuvToRgbCoeffs *coeffs,
+                                        const float *lut, float *rgb) {
+  for (int x = 0; x < width; ++x) {
+    const float luma = ((float)y[x] - coeffs->y_offset) * coeffs->y_scale;
+    const float cb =
+        ((float)u[x >> ss_x] - coeffs->uv_offset) * coeffs->uv_scale;
+    const float cr =
+        ((float)v[x >> ss_x] - coeffs->uv_offset) * coeffs->uv_scale;
+    rgb[3 * x] = aom_srgb_to_linear(lut, luma + coeffs->r_from_v * cr);
+    rgb[3 * x + 1] = aom_srgb_to_linear(
+        lut, luma + coeffs->g_from_u * cb + coeffs->g_from_v * cr);
+    rgb[3 * x + 2] = aom_srgb_to_linear(lut, luma + coeffs->b_from_u * cb);
+  }
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#ifndef AOM_AOM_DSP_YUV_TO_LINEAR_RGB_H_
+#define AOM_AOM_DSP_YUV_TO_LINEAR_RGB_H_
+
+#include "aom/aom_image.h"
+#include "aom_dsp/aom_dsp_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Segments of the piecewise linear sRGB transfer function; the table holds
+// AOM_SRGB_EOTF_LUT_SIZE + 1 entries.
+#define AOM_SRGB_EOTF_LUT_SIZE 4096
+
+// Maps YUV samples to gamma-encoded R'G'B' in [0, 1]:
+//   luma = (Y - y_offset) * y_scale, u = (U - uv_offset) * uv_scale, ...
+//   R' = luma + r_from_v * v
+//   G' = luma + g_from_u * u + g_from_v * v
+//   B' = luma + b_from_u * u
+typedef struct yuv_to_rgb_coeffs {
+  float y_offset;
+  float y_scale;
+  float uv_offset;
+  float uv_scale;
+  float r_from_v;
+  float g_from_u;
+  float g_from_v;
+  float b_from_u;
+} YuvToRgbCoeffs;
+
+// Derives the coefficients from the BT.601, BT.709 or BT.2020 matrix (BT.601
+// for anything else) and the range of 'bit_depth' samples.
+void aom_init_yuv_to_rgb_coeffs(int bit_depth,
+                                aom_matrix_coefficients_t matrix_coefficients,
+                                aom_color_range_t color_range,
+                                YuvToRgbCoeffs *coeffs);
+
+void aom_init_srgb_eotf_lut(float *lut);
+
+// Linearly interpolates the sRGB transfer function for a gamma-encoded value,
+// clamping it to [0, 1] first.
+static INLINE float aom_srgb_to_linear(const float *lut, float v) {
+  v = AOMMIN(AOMMAX(v, 0.0f), 1.0f) * AOM_SRGB_EOTF_LUT_SIZE;
+  const int i = AOMMIN((int)v, AOM_SRGB_EOTF_LUT_SIZE - 1);
+  const float f = v - (float)i;
+  return lut[i] + f * (lut[i + 1] - lut[i]);
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // AOM_AOM_DSP_YUV_TO_LINEAR_RGB_H_
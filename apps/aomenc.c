@@ -32,6 +32,7 @@
 #include "aom_dsp/aom_dsp_common.h"
 #include "aom_ports/aom_timer.h"
 #include "aom_ports/mem_ops.h"
+#include "aom_util/aom_thread.h"
 #include "common/args.h"
 #include "common/ivfenc.h"
 #include "common/tools_common.h"
@@ -111,6 +112,223 @@ static int read_frame(struct AvxInputContext *input_ctx, aom_image_t *img) {
   return !shortread;
 }
 
+// Frames the input thread reads ahead of the encoder.
+#define INPUT_QUEUE_SIZE 4
+
+struct input_frame {
+  // Image passed to the encoder.
+  aom_image_t img;
+  // Planes of a Y4M frame, which the reader returns in its own buffer.
+  aom_image_t buf;
+};
+
+// File offsets of the input frames, from which the scene chunks are read.
+struct frame_index {
+  FileOffset *offsets;
+  int count;
+  int size;
+};
+
+// Reads the input and converts it to the stream bit depth, on a thread of
+// its own when multithreading is enabled.
+struct input_queue {
+  struct AvxInputContext *input;
+  // Records the offset of each frame read when not NULL.
+  struct frame_index *index;
+  // Frame read before the conversion.
+  aom_image_t *raw;
+  int upshift;
+  int input_shift;
+  // Number of frames to read, 0 for all of them.
+  int limit;
+  struct input_frame frames[INPUT_QUEUE_SIZE];
+#if CONFIG_MULTITHREAD
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int read_idx;
+  int write_idx;
+  int count;
+  int eof;
+  int stop;
+#endif
+};
+
+static void copy_image_planes(aom_image_t *dst, const aom_image_t *src) {
+  const int bytes_per_sample = (src->fmt & AOM_IMG_FMT_HIGHBITDEPTH) ? 2 : 1;
+  const int num_planes = src->monochrome ? 1 : 3;
+  for (int plane = 0; plane < num_planes; ++plane) {
+    const int w = aom_img_plane_width(src, plane) * bytes_per_sample;
+    const int h = aom_img_plane_height(src, plane);
+    for (int y = 0; y < h; ++y) {
+      memcpy(dst->planes[plane] + y * dst->stride[plane],
+             src->planes[plane] + y * src->stride[plane], w);
+    }
+  }
+}
+
+static void frame_index_push(struct frame_index *index, FileOffset offset) {
+  if (index->count == index->size) {
+    index->size = AOMMAX(2 * index->size, 256);
+    FileOffset *const offsets =
+        realloc(index->offsets, index->size * sizeof(*offsets));
+    if (!offsets) fatal("Failed to allocate the frame index.");
+    index->offsets = offsets;
+  }
+  index->offsets[index->count++] = offset;
+}
+
+static int convert_input_frame(struct input_queue *queue,
+                               struct input_frame *frame) {
+  struct AvxInputContext *const input = queue->input;
+  aom_image_t *const raw = queue->raw;
+  if (queue->upshift) {
+    if (!read_frame(input, raw)) return 0;
+    if (!frame->img.img_data) {
+      aom_img_alloc(&frame->img, raw->fmt | AOM_IMG_FMT_HIGHBITDEPTH,
+                    input->width, input->height, 32);
+    }
+    aom_img_upshift(&frame->img, raw, queue->input_shift);
+    return 1;
+  }
+  if (input->file_type != FILE_TYPE_Y4M) {
+    if (!frame->img.img_data) {
+      aom_img_alloc(&frame->img, input->fmt, input->width, input->height, 32);
+    }
+    return read_frame(input, &frame->img);
+  }
+  // The next Y4M frame overwrites this one, so keep a copy.
+  if (!read_frame(input, raw)) return 0;
+  if (!frame->buf.img_data) {
+    aom_img_alloc(&frame->buf, raw->fmt, raw->d_w, raw->d_h, 32);
+  }
+  copy_image_planes(&frame->buf, raw);
+  frame->img = *raw;
+  for (int plane = 0; plane < 3; ++plane) {
+    frame->img.planes[plane] = frame->buf.planes[plane];
+    frame->img.stride[plane] = frame->buf.stride[plane];
+  }
+  return 1;
+}
+
+// Reads the next frame into 'frame' and returns whether there was one.
+static int read_input_frame(struct input_queue *queue,
+                            struct input_frame *frame) {
+  const struct AvxInputContext *const input = queue->input;
+  FileOffset offset = 0;
+  if (queue->index) {
+    offset = ftello(input->file);
+    // Bytes of a raw file already read by the file type detection belong to
+    // the first frame.
+    if (input->file_type != FILE_TYPE_Y4M) {
+      offset -= (FileOffset)(input->detect.buf_read - input->detect.position);
+    }
+  }
+  if (!convert_input_frame(queue, frame)) return 0;
+  if (queue->index) frame_index_push(queue->index, offset);
+  return 1;
+}
+
+#if CONFIG_MULTITHREAD
+static THREADFN input_thread_main(void *arg) {
+  struct input_queue *const queue = (struct input_queue *)arg;
+  int frames_read = 0;
+  int frame_avail = 1;
+
+  while (frame_avail && (!queue->limit || frames_read < queue->limit)) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == INPUT_QUEUE_SIZE && !queue->stop) {
+      pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    const int stop = queue->stop;
+    pthread_mutex_unlock(&queue->mutex);
+    if (stop) break;
+
+    frame_avail = read_input_frame(queue, &queue->frames[queue->write_idx]);
+    if (frame_avail) {
+      queue->write_idx = (queue->write_idx + 1) % INPUT_QUEUE_SIZE;
+      ++frames_read;
+      pthread_mutex_lock(&queue->mutex);
+      ++queue->count;
+      pthread_cond_signal(&queue->cond);
+      pthread_mutex_unlock(&queue->mutex);
+    }
+  }
+
+  pthread_mutex_lock(&queue->mutex);
+  queue->eof = 1;
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+  return THREAD_RETURN(NULL);
+}
+#endif  // CONFIG_MULTITHREAD
+
+static void input_queue_start(struct input_queue *queue,
+                              struct AvxInputContext *input,
+                              struct frame_index *index, aom_image_t *raw,
+                              int upshift, int input_shift, int limit) {
+  memset(queue, 0, sizeof(*queue));
+  queue->input = input;
+  queue->index = index;
+  queue->raw = raw;
+  queue->upshift = upshift;
+  queue->input_shift = input_shift;
+  queue->limit = limit;
+#if CONFIG_MULTITHREAD
+  if (pthread_mutex_init(&queue->mutex, NULL) ||
+      pthread_cond_init(&queue->cond, NULL) ||
+      pthread_create(&queue->thread, NULL, input_thread_main, queue)) {
+    fatal("Failed to start the input thread");
+  }
+#endif
+}
+
+// Returns the next frame to encode, or NULL at the end of the input. The
+// frame stays valid until input_queue_release().
+static aom_image_t *input_queue_pop(struct input_queue *queue) {
+#if CONFIG_MULTITHREAD
+  aom_image_t *img = NULL;
+  pthread_mutex_lock(&queue->mutex);
+  while (queue->count == 0 && !queue->eof) {
+    pthread_cond_wait(&queue->cond, &queue->mutex);
+  }
+  if (queue->count > 0) img = &queue->frames[queue->read_idx].img;
+  pthread_mutex_unlock(&queue->mutex);
+  return img;
+#else
+  return read_input_frame(queue, &queue->frames[0]) ? &queue->frames[0].img
+                                                    : NULL;
+#endif
+}
+
+static void input_queue_release(struct input_queue *queue) {
+#if CONFIG_MULTITHREAD
+  pthread_mutex_lock(&queue->mutex);
+  queue->read_idx = (queue->read_idx + 1) % INPUT_QUEUE_SIZE;
+  --queue->count;
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+#else
+  (void)queue;
+#endif
+}
+
+static void input_queue_finish(struct input_queue *queue) {
+#if CONFIG_MULTITHREAD
+  pthread_mutex_lock(&queue->mutex);
+  queue->stop = 1;
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+  pthread_join(queue->thread, NULL);
+  pthread_cond_destroy(&queue->cond);
+  pthread_mutex_destroy(&queue->mutex);
+#endif
+  for (int i = 0; i < INPUT_QUEUE_SIZE; ++i) {
+    aom_img_free(&queue->frames[i].img);
+    aom_img_free(&queue->frames[i].buf);
+  }
+}
+
 static int file_is_y4m(const char detect[4]) {
   if (memcmp(detect, "YUV4", 4) == 0) {
     return 1;
@@ -263,17 +481,22 @@ static const int av1_arg_ctrl_map[] = { AOME_SET_CPUUSED,
                                         AOME_SET_BUTTERAUGLI_RESIZE_FACTOR,
                                         AOME_SET_BUTTERAUGLI_QUANT_MULT_POS,
                                         AOME_SET_BUTTERAUGLI_QUANT_MULT_NEG,
+                                        AOME_SET_BUTTERAUGLI_PROXY,
+                                        AOME_SET_BUTTERAUGLI_TOLERANCE,
 #endif
                                         AOME_SET_LOOPFILTER_SHARPNESS,
                                         AOME_SET_ENABLE_EXPERIMENTAL_PSY,
 #if CONFIG_TUNE_VMAF
                                         AOME_SET_VMAF_RESIZE_FACTOR,
                                         AOME_SET_VMAF_RD_MULT,
+                                        AOME_SET_VMAF_PROBE_RESIZE_FACTOR,
 #endif
                                         AOME_SET_TPL_STRENGTH,
                                         AOME_SET_LUMA_BIAS_STRENGTH,
                                         AOME_SET_LUMA_BIAS_MIDPOINT,
                                         AOME_SET_INVERT_LUMA_BIAS,
+                                        AOME_SET_LAP_THREAD,
+                                        AOME_SET_LAP_WINDOW,
                                         AOME_SET_LUMA_BIAS_OVERRIDE,
                                         0 };
 
@@ -287,6 +510,7 @@ const arg_def_t *main_args[] = { &g_av1_codec_arg_defs.help,
                                  &g_av1_codec_arg_defs.fpf_name,
                                  &g_av1_codec_arg_defs.limit,
                                  &g_av1_codec_arg_defs.skip,
+                                 &g_av1_codec_arg_defs.scene_chunks,
                                  &g_av1_codec_arg_defs.good_dl,
                                  &g_av1_codec_arg_defs.rt_dl,
                                  &g_av1_codec_arg_defs.ai_dl,
@@ -505,17 +729,22 @@ const arg_def_t *av1_ctrl_args[] = {
   &g_av1_codec_arg_defs.butteraugli_resize_factor,
   &g_av1_codec_arg_defs.butteraugli_quant_mult_pos,
   &g_av1_codec_arg_defs.butteraugli_quant_mult_neg,
+  &g_av1_codec_arg_defs.butteraugli_proxy,
+  &g_av1_codec_arg_defs.butteraugli_tolerance,
 #endif
   &g_av1_codec_arg_defs.loopfilter_sharpness,
   &g_av1_codec_arg_defs.enable_experimental_psy,
 #if CONFIG_TUNE_VMAF
   &g_av1_codec_arg_defs.vmaf_resize_factor,
   &g_av1_codec_arg_defs.vmaf_rd_mult,
+  &g_av1_codec_arg_defs.vmaf_probe_resize_factor,
 #endif
   &g_av1_codec_arg_defs.tpl_strength,
   &g_av1_codec_arg_defs.luma_bias_strength,
   &g_av1_codec_arg_defs.luma_bias_midpoint,
   &g_av1_codec_arg_defs.invert_luma_bias,
+  &g_av1_codec_arg_defs.lap_thread,
+  &g_av1_codec_arg_defs.lap_window,
   NULL,
 };
 
@@ -746,6 +975,8 @@ static void parse_global_config(struct AvxEncoderConfig *global, char ***argv) {
       global->limit = arg_parse_uint(&arg);
     } else if (arg_match(&arg, &g_av1_codec_arg_defs.skip, argi)) {
       global->skip_frames = arg_parse_uint(&arg);
+    } else if (arg_match(&arg, &g_av1_codec_arg_defs.scene_chunks, argi)) {
+      global->scene_chunks = arg_parse_uint(&arg);
     } else if (arg_match(&arg, &g_av1_codec_arg_defs.psnrarg, argi)) {
       if (arg.val)
         global->show_psnr = arg_parse_int(&arg);
@@ -1573,7 +1804,27 @@ static void setup_pass(struct stream_state *stream,
     }
   }
 
-  if (pass) {
+  if (pass == 0) {
+    stream->stats.first_frame = global->skip_frames;
+  } else {
+    // A first pass over more frames than --skip and --limit leave is cut
+    // down to the frames to encode.
+    const int64_t num_frames = stats_num_frames(&stream->stats);
+    if (num_frames >= 0) {
+      const int64_t start = global->skip_frames - stream->stats.first_frame;
+      int64_t count = num_frames - start;
+      if (global->limit) {
+        count = AOMMIN(count, (int64_t)global->limit - global->skip_frames);
+      }
+      if (start < 0 || count <= 0)
+        fatal("First-pass stats do not cover the frames to encode");
+      if (start > 0 || count < num_frames) {
+        stats_io_t all = stream->stats;
+        if (!stats_open_range(&stream->stats, &all, start, count))
+          fatal("Failed to open statistics store");
+        stats_close(&all, all.pass);
+      }
+    }
     stream->config.cfg.rc_twopass_stats_in = stats_get(&stream->stats);
   }
 
@@ -1802,17 +2053,159 @@ static void update_quantizer_histogram(struct stream_state *stream) {
   }
 }
 
+static void write_frame_packet(struct stream_state *stream,
+                               const aom_codec_cx_pkt_t *pkt) {
+  static size_t fsize = 0;
+  static FileOffset ivf_header_pos = 0;
+
+#if CONFIG_WEBM_IO
+  if (stream->config.write_webm) {
+    if (write_webm_block(&stream->webm_ctx, &stream->config.cfg, pkt) != 0) {
+      fatal("WebM writer failed.");
+    }
+  }
+#endif
+  if (!stream->config.write_webm) {
+    if (stream->config.write_ivf) {
+      if (pkt->data.frame.partition_id <= 0) {
+        ivf_header_pos = ftello(stream->file);
+        fsize = pkt->data.frame.sz;
+
+        ivf_write_frame_header(stream->file, pkt->data.frame.pts, fsize);
+      } else {
+        fsize += pkt->data.frame.sz;
+
+        const FileOffset currpos = ftello(stream->file);
+        fseeko(stream->file, ivf_header_pos, SEEK_SET);
+        ivf_write_frame_size(stream->file, fsize);
+        fseeko(stream->file, currpos, SEEK_SET);
+      }
+    }
+
+    (void)fwrite(pkt->data.frame.buf, 1, pkt->data.frame.sz, stream->file);
+  }
+}
+
+// Packets the output thread may fall behind the encoder.
+#define OUTPUT_QUEUE_SIZE 32
+
+struct output_packet {
+  struct stream_state *stream;
+  aom_codec_cx_pkt_t pkt;
+  // Copy of the frame data, which the encoder reuses.
+  uint8_t *buf;
+  size_t buf_size;
+};
+
+// Writes the frame packets of all the streams, on a thread of its own when
+// multithreading is enabled.
+struct output_queue {
+  struct output_packet packets[OUTPUT_QUEUE_SIZE];
+#if CONFIG_MULTITHREAD
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+#endif
+  int read_idx;
+  int count;
+  int done;
+};
+
+#if CONFIG_MULTITHREAD
+static THREADFN output_thread_main(void *arg) {
+  struct output_queue *const queue = (struct output_queue *)arg;
+
+  for (;;) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && !queue->done) {
+      pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    const int count = queue->count;
+    pthread_mutex_unlock(&queue->mutex);
+    if (count == 0) break;
+
+    const struct output_packet *const packet = &queue->packets[queue->read_idx];
+    write_frame_packet(packet->stream, &packet->pkt);
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->read_idx = (queue->read_idx + 1) % OUTPUT_QUEUE_SIZE;
+    --queue->count;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+  }
+  return THREAD_RETURN(NULL);
+}
+#endif  // CONFIG_MULTITHREAD
+
+static void output_queue_start(struct output_queue *queue) {
+  memset(queue, 0, sizeof(*queue));
+#if CONFIG_MULTITHREAD
+  if (pthread_mutex_init(&queue->mutex, NULL) ||
+      pthread_cond_init(&queue->cond, NULL) ||
+      pthread_create(&queue->thread, NULL, output_thread_main, queue)) {
+    fatal("Failed to start the output thread");
+  }
+#endif
+}
+
+static void output_queue_push(struct output_queue *queue,
+                              struct stream_state *stream,
+                              const aom_codec_cx_pkt_t *pkt) {
+#if CONFIG_MULTITHREAD
+  pthread_mutex_lock(&queue->mutex);
+  while (queue->count == OUTPUT_QUEUE_SIZE) {
+    pthread_cond_wait(&queue->cond, &queue->mutex);
+  }
+  struct output_packet *const packet =
+      &queue->packets[(queue->read_idx + queue->count) % OUTPUT_QUEUE_SIZE];
+  pthread_mutex_unlock(&queue->mutex);
+
+  if (packet->buf_size < pkt->data.frame.sz) {
+    free(packet->buf);
+    packet->buf = malloc(pkt->data.frame.sz);
+    if (!packet->buf) fatal("Failed to allocate output packet.");
+    packet->buf_size = pkt->data.frame.sz;
+  }
+  memcpy(packet->buf, pkt->data.frame.buf, pkt->data.frame.sz);
+  packet->stream = stream;
+  packet->pkt = *pkt;
+  packet->pkt.data.frame.buf = packet->buf;
+
+  pthread_mutex_lock(&queue->mutex);
+  ++queue->count;
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+#else
+  (void)queue;
+  write_frame_packet(stream, pkt);
+#endif
+}
+
+// Waits for the queued packets to be written.
+static void output_queue_finish(struct output_queue *queue) {
+#if CONFIG_MULTITHREAD
+  pthread_mutex_lock(&queue->mutex);
+  queue->done = 1;
+  pthread_cond_signal(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+  pthread_join(queue->thread, NULL);
+  pthread_cond_destroy(&queue->cond);
+  pthread_mutex_destroy(&queue->mutex);
+  for (int i = 0; i < OUTPUT_QUEUE_SIZE; ++i) free(queue->packets[i].buf);
+#else
+  (void)queue;
+#endif
+}
+
 static void get_cx_data(struct stream_state *stream,
-                        struct AvxEncoderConfig *global, int *got_data) {
+                        struct AvxEncoderConfig *global,
+                        struct output_queue *output, int *got_data) {
   const aom_codec_cx_pkt_t *pkt;
   const struct aom_codec_enc_cfg *cfg = &stream->config.cfg;
   aom_codec_iter_t iter = NULL;
 
   *got_data = 0;
   while ((pkt = aom_codec_get_cx_data(&stream->encoder, &iter))) {
-    static size_t fsize = 0;
-    static FileOffset ivf_header_pos = 0;
-
     switch (pkt->kind) {
       case AOM_CODEC_CX_FRAME_PKT:
         ++stream->frames_out;
@@ -1820,33 +2213,7 @@ static void get_cx_data(struct stream_state *stream,
           fprintf(stderr, " %6luF", (unsigned long)pkt->data.frame.sz);
 
         update_rate_histogram(stream->rate_hist, cfg, pkt);
-#if CONFIG_WEBM_IO
-        if (stream->config.write_webm) {
-          if (write_webm_block(&stream->webm_ctx, cfg, pkt) != 0) {
-            fatal("WebM writer failed.");
-          }
-        }
-#endif
-        if (!stream->config.write_webm) {
-          if (stream->config.write_ivf) {
-            if (pkt->data.frame.partition_id <= 0) {
-              ivf_header_pos = ftello(stream->file);
-              fsize = pkt->data.frame.sz;
-
-              ivf_write_frame_header(stream->file, pkt->data.frame.pts, fsize);
-            } else {
-              fsize += pkt->data.frame.sz;
-
-              const FileOffset currpos = ftello(stream->file);
-              fseeko(stream->file, ivf_header_pos, SEEK_SET);
-              ivf_write_frame_size(stream->file, fsize);
-              fseeko(stream->file, currpos, SEEK_SET);
-            }
-          }
-
-          (void)fwrite(pkt->data.frame.buf, 1, pkt->data.frame.sz,
-                       stream->file);
-        }
+        output_queue_push(output, stream, pkt);
         stream->nbytes += pkt->data.raw.sz;
 
         *got_data = 1;
@@ -2024,6 +2391,249 @@ static void print_time(int64_t etl) {
   }
 }
 
+// A run of frames from one key frame to the next, encoded by an encoder of
+// its own.
+struct scene_chunk {
+  int start;
+  int frames;
+  struct output_packet *packets;
+  int num_packets;
+  int packets_size;
+  int counts[64];
+  int done;
+};
+
+struct scene_chunks {
+  struct stream_state *stream;
+  struct AvxEncoderConfig *global;
+  const struct AvxInputContext *input;
+  const struct frame_index *index;
+  int upshift;
+  int input_shift;
+  struct scene_chunk *chunks;
+  int num_chunks;
+#if CONFIG_MULTITHREAD
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+#endif
+  int next_chunk;
+};
+
+// Collects the frame packets of a chunk encoder and returns whether there
+// were any.
+static int get_chunk_data(struct stream_state *stream,
+                          struct scene_chunk *chunk) {
+  const aom_codec_cx_pkt_t *pkt;
+  aom_codec_iter_t iter = NULL;
+  int got_data = 0;
+
+  while ((pkt = aom_codec_get_cx_data(&stream->encoder, &iter))) {
+    if (pkt->kind == AOM_CODEC_CX_FRAME_PKT) {
+      if (chunk->num_packets == chunk->packets_size) {
+        chunk->packets_size = AOMMAX(2 * chunk->packets_size, 16);
+        struct output_packet *const packets = realloc(
+            chunk->packets, chunk->packets_size * sizeof(*chunk->packets));
+        if (!packets) fatal("Failed to allocate chunk packets.");
+        chunk->packets = packets;
+      }
+      struct output_packet *const packet = &chunk->packets[chunk->num_packets];
+      packet->buf = malloc(pkt->data.frame.sz);
+      if (!packet->buf) fatal("Failed to allocate chunk packets.");
+      memcpy(packet->buf, pkt->data.frame.buf, pkt->data.frame.sz);
+      packet->buf_size = pkt->data.frame.sz;
+      packet->pkt = *pkt;
+      packet->pkt.data.frame.buf = packet->buf;
+      ++chunk->num_packets;
+      got_data = 1;
+    }
+  }
+  return got_data;
+}
+
+// Runs the last pass over one chunk, with its range of the first pass
+// stats. The frames keep their timestamps in the whole sequence, so the
+// packets can be written as they are.
+static void encode_scene_chunk(const struct scene_chunks *chunks,
+                               struct scene_chunk *chunk) {
+  struct AvxEncoderConfig global = *chunks->global;
+  global.quiet = 1;
+  global.show_psnr = 0;
+  global.test_decode = TEST_DECODE_OFF;
+
+  struct stream_state stream = *chunks->stream;
+  stream.next = NULL;
+  stream.file = NULL;
+  stream.rate_hist = NULL;
+  stream.img = NULL;
+  memset(&stream.encoder, 0, sizeof(stream.encoder));
+  memset(stream.counts, 0, sizeof(stream.counts));
+  stream.config.cfg.g_limit = chunk->frames;
+
+  struct AvxInputContext input = *chunks->input;
+  open_input_file(&input, global.csp);
+  aom_image_t raw;
+  memset(&raw, 0, sizeof(raw));
+  if (input.file_type != FILE_TYPE_Y4M) {
+    aom_img_alloc(&raw, input.fmt, input.width, input.height, 32);
+  }
+  struct input_queue queue;
+  memset(&queue, 0, sizeof(queue));
+  queue.input = &input;
+  queue.raw = &raw;
+  queue.upshift = chunks->upshift;
+  queue.input_shift = chunks->input_shift;
+  struct input_frame *const frame = &queue.frames[0];
+
+  if (fseeko(input.file, chunks->index->offsets[chunk->start], SEEK_SET))
+    fatal("Failed to seek to frame %d", chunk->start);
+  input.detect.buf_read = 0;
+  input.detect.position = 0;
+
+  if (!stats_open_range(&stream.stats, &chunks->stream->stats, chunk->start,
+                        chunk->frames)) {
+    fatal("Failed to open statistics store");
+  }
+  stream.config.cfg.rc_twopass_stats_in = stats_get(&stream.stats);
+  initialize_encoder(&stream, &global);
+  for (int i = 0; i < chunk->frames; ++i) {
+    if (!read_input_frame(&queue, frame))
+      fatal("Failed to read frame %d", chunk->start + i);
+    encode_frame(&stream, &global, &frame->img, chunk->start + i + 1);
+    update_quantizer_histogram(&stream);
+    get_chunk_data(&stream, chunk);
+  }
+  do {
+    encode_frame(&stream, &global, NULL, chunk->start + chunk->frames);
+  } while (get_chunk_data(&stream, chunk));
+  aom_codec_destroy(&stream.encoder);
+  stats_close(&stream.stats, stream.stats.pass);
+  memcpy(chunk->counts, stream.counts, sizeof(chunk->counts));
+
+  aom_img_free(&frame->img);
+  aom_img_free(&frame->buf);
+  aom_img_free(&raw);
+  aom_img_free(stream.img);
+  close_input_file(&input);
+}
+
+static void encode_scene_chunks_worker(struct scene_chunks *chunks) {
+  for (;;) {
+#if CONFIG_MULTITHREAD
+    pthread_mutex_lock(&chunks->mutex);
+#endif
+    const int i = chunks->next_chunk++;
+#if CONFIG_MULTITHREAD
+    pthread_mutex_unlock(&chunks->mutex);
+#endif
+    if (i >= chunks->num_chunks) break;
+
+    encode_scene_chunk(chunks, &chunks->chunks[i]);
+
+#if CONFIG_MULTITHREAD
+    pthread_mutex_lock(&chunks->mutex);
+    chunks->chunks[i].done = 1;
+    pthread_cond_broadcast(&chunks->cond);
+    pthread_mutex_unlock(&chunks->mutex);
+#else
+    chunks->chunks[i].done = 1;
+#endif
+  }
+}
+
+#if CONFIG_MULTITHREAD
+static THREADFN scene_chunks_thread_main(void *arg) {
+  encode_scene_chunks_worker((struct scene_chunks *)arg);
+  return THREAD_RETURN(NULL);
+}
+#endif  // CONFIG_MULTITHREAD
+
+// Splits the last pass at the key frames found in the first pass stats and
+// encodes the chunks on 'global->scene_chunks' threads. The main thread
+// writes the chunks in order as they complete.
+static void encode_scene_chunks(struct stream_state *stream,
+                                struct AvxEncoderConfig *global,
+                                const struct AvxInputContext *input,
+                                const struct frame_index *index, int upshift,
+                                int input_shift) {
+  const int num_frames = index->count;
+  if (num_frames == 0) return;
+
+  int *const cuts = malloc(num_frames * sizeof(*cuts));
+  if (!cuts) fatal("Failed to allocate the scene cuts.");
+  aom_scene_cuts_t scene_cuts = { cuts, num_frames, 0 };
+  AOM_CODEC_CONTROL_TYPECHECKED(&stream->encoder, AOME_GET_SCENE_CUTS,
+                                &scene_cuts);
+  ctx_exit_on_error(&stream->encoder, "Failed to find the scene cuts");
+
+  struct scene_chunks chunks;
+  memset(&chunks, 0, sizeof(chunks));
+  chunks.stream = stream;
+  chunks.global = global;
+  chunks.input = input;
+  chunks.index = index;
+  chunks.upshift = upshift;
+  chunks.input_shift = input_shift;
+  chunks.num_chunks = AOMMIN(scene_cuts.num_cuts, num_frames) + 1;
+  chunks.chunks = calloc(chunks.num_chunks, sizeof(*chunks.chunks));
+  if (!chunks.chunks) fatal("Failed to allocate the scene chunks.");
+  for (int i = 0; i < chunks.num_chunks; ++i) {
+    struct scene_chunk *const chunk = &chunks.chunks[i];
+    chunk->start = i ? cuts[i - 1] : 0;
+    chunk->frames =
+        (i + 1 < chunks.num_chunks ? cuts[i] : num_frames) - chunk->start;
+  }
+  free(cuts);
+
+#if CONFIG_MULTITHREAD
+  const int num_workers = AOMMIN(global->scene_chunks, chunks.num_chunks);
+  pthread_t *const workers = malloc(num_workers * sizeof(*workers));
+  if (!workers || pthread_mutex_init(&chunks.mutex, NULL) ||
+      pthread_cond_init(&chunks.cond, NULL)) {
+    fatal("Failed to start the scene chunk threads");
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    if (pthread_create(&workers[i], NULL, scene_chunks_thread_main, &chunks))
+      fatal("Failed to start the scene chunk threads");
+  }
+#else
+  encode_scene_chunks_worker(&chunks);
+#endif
+
+  for (int i = 0; i < chunks.num_chunks; ++i) {
+    struct scene_chunk *const chunk = &chunks.chunks[i];
+    if (!global->quiet) {
+      fprintf(stderr, "\rPass %d/%d chunk %d/%d frame %4d/%-4d", 2,
+              global->passes, i + 1, chunks.num_chunks, chunk->start,
+              num_frames);
+      fflush(stderr);
+    }
+#if CONFIG_MULTITHREAD
+    pthread_mutex_lock(&chunks.mutex);
+    while (!chunk->done) pthread_cond_wait(&chunks.cond, &chunks.mutex);
+    pthread_mutex_unlock(&chunks.mutex);
+#endif
+    for (int j = 0; j < chunk->num_packets; ++j) {
+      const aom_codec_cx_pkt_t *const pkt = &chunk->packets[j].pkt;
+      update_rate_histogram(stream->rate_hist, &stream->config.cfg, pkt);
+      write_frame_packet(stream, pkt);
+      ++stream->frames_out;
+      stream->nbytes += pkt->data.frame.sz;
+      free(chunk->packets[j].buf);
+    }
+    free(chunk->packets);
+    for (int q = 0; q < 64; ++q) stream->counts[q] += chunk->counts[q];
+  }
+  if (!global->quiet) fprintf(stderr, "\033[K");
+
+#if CONFIG_MULTITHREAD
+  for (int i = 0; i < num_workers; ++i) pthread_join(workers[i], NULL);
+  free(workers);
+  pthread_cond_destroy(&chunks.cond);
+  pthread_mutex_destroy(&chunks.mutex);
+#endif
+  free(chunks.chunks);
+}
+
 static void clear_stream_count_state(struct stream_state *stream) {
   // PSNR counters
   for (int k = 0; k < 2; k++) {
@@ -2051,11 +2661,12 @@ static int pass_need_downscale(int global_pass, int global_passes, int pass) {
 int main(int argc, const char **argv_) {
   int pass;
   aom_image_t raw;
-  aom_image_t raw_shift;
-  int allocated_raw_shift = 0;
   int do_16bit_internal = 0;
   int input_shift = 0;
   int frame_avail, got_data;
+  struct input_queue input_queue;
+  struct output_queue output_queue;
+  struct frame_index frame_index = { NULL, 0, 0 };
 
   struct AvxInputContext input;
   struct AvxEncoderConfig global;
@@ -2141,6 +2752,19 @@ int main(int argc, const char **argv_) {
     usage_exit();
   }
 
+  if (global.scene_chunks) {
+    if (global.passes != 2 || global.pass)
+      die("Error: --scene-chunks requires --passes=2 without --pass\n");
+    if (stream_cnt > 1)
+      die("Error: --scene-chunks supports a single stream\n");
+    if (global.skip_frames || global.show_psnr ||
+        global.test_decode != TEST_DECODE_OFF)
+      die("Error: --scene-chunks does not support --skip, --psnr or "
+          "--test-decode\n");
+    if (!strcmp(input.filename, "-"))
+      die("Error: --scene-chunks requires a seekable input file\n");
+  }
+
   /* Decide if other chroma subsamplings than 4:2:0 are supported */
   if (get_fourcc_by_aom_encoder(global.codec) == AV1_FOURCC)
     input.only_i420 = 0;
@@ -2489,14 +3113,34 @@ int main(int argc, const char **argv_) {
       }
     }
 
-    frame_avail = 1;
+    // When input bit depth and stream bit depth do not match, the input
+    // thread up shifts frames to stream bit depth.
+    const int upshift =
+        input_shift || (do_16bit_internal && input.bit_depth == 8);
+    assert(!upshift || do_16bit_internal);
+    // With --scene-chunks the first pass indexes the input frames, and the
+    // last pass is encoded in chunks instead of the loop below.
+    const int chunk_pass = global.scene_chunks && pass == 1;
+    if (chunk_pass) {
+      encode_scene_chunks(streams, &global, &input, &frame_index, upshift,
+                          input_shift);
+    } else {
+      input_queue_start(&input_queue, &input,
+                        global.scene_chunks ? &frame_index : NULL, &raw,
+                        upshift, input_shift, global.limit);
+      output_queue_start(&output_queue);
+    }
+
+    frame_avail = !chunk_pass;
     got_data = 0;
 
     while (frame_avail || got_data) {
       struct aom_usec_timer timer;
+      aom_image_t *frame_to_encode = NULL;
 
       if (!global.limit || frames_in < global.limit) {
-        frame_avail = read_frame(&input, &raw);
+        frame_to_encode = input_queue_pop(&input_queue);
+        frame_avail = frame_to_encode != NULL;
 
         if (frame_avail) frames_in++;
         seen_frames =
@@ -2536,36 +3180,21 @@ int main(int argc, const char **argv_) {
       }
 
       if (frames_in > global.skip_frames) {
-        aom_image_t *frame_to_encode;
-        if (input_shift || (do_16bit_internal && input.bit_depth == 8)) {
-          assert(do_16bit_internal);
-          // Input bit depth and stream bit depth do not match, so up
-          // shift frame to stream bit depth
-          if (!allocated_raw_shift) {
-            aom_img_alloc(&raw_shift, raw.fmt | AOM_IMG_FMT_HIGHBITDEPTH,
-                          input.width, input.height, 32);
-            allocated_raw_shift = 1;
-          }
-          aom_img_upshift(&raw_shift, &raw, input_shift);
-          frame_to_encode = &raw_shift;
-        } else {
-          frame_to_encode = &raw;
-        }
         aom_usec_timer_start(&timer);
         if (do_16bit_internal) {
-          assert(frame_to_encode->fmt & AOM_IMG_FMT_HIGHBITDEPTH);
+          assert(!frame_to_encode ||
+                 (frame_to_encode->fmt & AOM_IMG_FMT_HIGHBITDEPTH));
           FOREACH_STREAM(stream, streams) {
             if (stream->config.use_16bit_internal)
-              encode_frame(stream, &global,
-                           frame_avail ? frame_to_encode : NULL, frames_in);
+              encode_frame(stream, &global, frame_to_encode, frames_in);
             else
               assert(0);
           }
         } else {
-          assert((frame_to_encode->fmt & AOM_IMG_FMT_HIGHBITDEPTH) == 0);
+          assert(!frame_to_encode ||
+                 (frame_to_encode->fmt & AOM_IMG_FMT_HIGHBITDEPTH) == 0);
           FOREACH_STREAM(stream, streams) {
-            encode_frame(stream, &global, frame_avail ? frame_to_encode : NULL,
-                         frames_in);
+            encode_frame(stream, &global, frame_to_encode, frames_in);
           }
         }
         aom_usec_timer_mark(&timer);
@@ -2575,7 +3204,7 @@ int main(int argc, const char **argv_) {
 
         got_data = 0;
         FOREACH_STREAM(stream, streams) {
-          get_cx_data(stream, &global, &got_data);
+          get_cx_data(stream, &global, &output_queue, &got_data);
         }
 
         if (got_data && global.test_decode != TEST_DECODE_OFF) {
@@ -2584,10 +3213,15 @@ int main(int argc, const char **argv_) {
           }
         }
       }
+      if (frame_to_encode) input_queue_release(&input_queue);
 
       fflush(stdout);
       if (!global.quiet) fprintf(stderr, "\033[K");
     }
+    if (!chunk_pass) {
+      input_queue_finish(&input_queue);
+      output_queue_finish(&output_queue);
+    }
 
     if (global.show_psnr >= 1) {
       if (get_fourcc_by_aom_encoder(global.codec) == AV1_FOURCC) {
@@ -2616,7 +3250,8 @@ int main(int argc, const char **argv_) {
       }
     }
 
-    if (pass == global.passes - 1) {
+    // The level checks need the encoder that encoded the frames.
+    if (pass == global.passes - 1 && !chunk_pass) {
       FOREACH_STREAM(stream, streams) {
         int num_operating_points;
         int levels[32];
@@ -2700,8 +3335,8 @@ int main(int argc, const char **argv_) {
   }
 #endif
 
-  if (allocated_raw_shift) aom_img_free(&raw_shift);
   aom_img_free(&raw);
+  free(frame_index.offsets);
   free(argv);
   free(streams);
   return res ? EXIT_FAILURE : EXIT_SUCCESS;
@@ -38,6 +38,8 @@ struct AvxEncoderConfig {
   int verbose;
   int limit;
   int skip_frames;
+  // Number of threads encoding scene chunks, 0 to encode in one piece.
+  int scene_chunks;
   int show_psnr;
   enum TestDecodeFatality test_decode;
   int have_framerate;
@@ -56,6 +56,7 @@ static const struct arg_enum_list tuning_enum[] = {
   { "vmaf_saliency_map", AOM_TUNE_VMAF_SALIENCY_MAP },
   { "ipq_vmaf_psy", AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP }, // Tunes at this point and after use VMAF Q Adjustment
   { "vmaf_psy_qp", AOM_TUNE_FAST_VMAF_PSY_QP },
+  { "ssimulacra2", AOM_TUNE_SSIMULACRA2 },
   { NULL, 0 }
 };
 
@@ -175,6 +176,9 @@ const av1_codec_arg_definitions_t g_av1_codec_arg_defs = {
   .fpf_name = ARG_DEF(NULL, "fpf", 1, "First pass statistics file name"),
   .limit = ARG_DEF(NULL, "limit", 1, "Stop encoding after n input frames"),
   .skip = ARG_DEF(NULL, "skip", 1, "Skip the first n input frames"),
+  .scene_chunks = ARG_DEF(NULL, "scene-chunks", 1,
+                          "Split a two-pass encode at scene cuts and encode "
+                          "the chunks on n threads"),
   .good_dl = ARG_DEF(NULL, "good", 0, "Use Good Quality Deadline"),
   .rt_dl = ARG_DEF(NULL, "rt", 0, "Use Realtime Quality Deadline"),
   .ai_dl = ARG_DEF(NULL, "allintra", 0, "Use all intra mode"),
@@ -768,6 +772,12 @@ const av1_codec_arg_definitions_t g_av1_codec_arg_defs = {
   .butteraugli_quant_mult_neg = ARG_DEF(NULL, "butteraugli-quant-neg", 1,
                        "Multiplier for negative block-based butteraugli quantization (NOT RECOMMENDED) "
                                   "(Advanced control, defaults to -1 (Disabled))"),
+  .butteraugli_proxy = ARG_DEF(NULL, "butteraugli-proxy", 1,
+                       "Build the butteraugli rdmult map from TPL reconstructions instead of a q=96 pre-encode ((0)..1)\n "
+                       "                                        Falls back to the pre-encode for frames without TPL stats."),
+  .butteraugli_tolerance = ARG_DEF(NULL, "butteraugli-tolerance", 1,
+                       "Stop the butteraugli quantization loop once the distance is within this many hundredths of the target ((0)..100)\n "
+                       "                                        0 always runs butteraugli-loop-count iterations."),
 #endif
   .loopfilter_sharpness = ARG_DEF(NULL, "loopfilter-sharpness", 1,
                        "Adjust sharpness for the loopfilter, can reduce detail blur at the expense of artifacts. ((0)..7)"),
@@ -780,6 +790,9 @@ const av1_codec_arg_definitions_t g_av1_codec_arg_defs = {
   .vmaf_rd_mult = ARG_DEF(NULL, "vmaf-rd-mult", 1,
                        "Multiplier for vmaf tunes rdmult "
                                   "(Meant for hyper-tuning, only active with tunes that utilize vmaf rdo, defaults to 100)"),
+  .vmaf_probe_resize_factor = ARG_DEF(NULL, "vmaf-probe-resize-factor", 1,
+                       "Downscale the frames scored by the vmaf preprocessing unsharp strength search\n "
+                       "                                        0 - Do not resize (Default), 1 - Resize to half res, 2 - Resize to quarter res."),
 #endif
   .tpl_strength = ARG_DEF(NULL, "tpl-strength", 1,
                        "Multiplier for tpl filtering strength, defaults to 100 "
@@ -793,10 +806,17 @@ const av1_codec_arg_definitions_t g_av1_codec_arg_defs = {
   .invert_luma_bias = ARG_DEF(NULL, "invert-luma-bias", 1,
                        "If inverted (1), raise rdmult in the opposite luminance direction (raises rdmult around and past the midpoint) "
                                   "Value range: (0)...1"),
+  .lap_thread = ARG_DEF(NULL, "lap-thread", 1,
+                       "Run the look ahead first pass of one pass encodes on its own thread ((0)..1)\n "
+                       "                                        The encoder then sees the stats up to the previous input frame."),
+  .lap_window = ARG_DEF(NULL, "lap-window", 1,
+                       "Frames of look ahead first pass stats the rate control sees, when more than --lag-in-frames ((0)..1024)\n "
+                       "                                        The look ahead holds this many source frames."),
   .sb_qp_sweep =
       ARG_DEF(NULL, "sb-qp-sweep", 1,
               "When set to 1, enable the superblock level qp sweep for a "
-              "given lambda to minimize the rdcost."),
+              "given lambda to minimize the rdcost. 2 stops the sweep in a "
+              "direction once the rdcost keeps rising (faster)."),
   .global_motion_method = ARG_DEF_ENUM(NULL, "global-motion-method", 1,
                                        "Global motion search method "
                                        "(default: disflow):",
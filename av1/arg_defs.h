@@ -44,6 +44,7 @@ typedef struct av1_codec_arg_definitions {
   arg_def_t fpf_name;
   arg_def_t limit;
   arg_def_t skip;
+  arg_def_t scene_chunks;
   arg_def_t good_dl;
   arg_def_t rt_dl;
   arg_def_t ai_dl;
@@ -259,17 +260,22 @@ typedef struct av1_codec_arg_definitions {
   arg_def_t butteraugli_resize_factor;
   arg_def_t butteraugli_quant_mult_pos;
   arg_def_t butteraugli_quant_mult_neg;
+  arg_def_t butteraugli_proxy;
+  arg_def_t butteraugli_tolerance;
 #endif
   arg_def_t loopfilter_sharpness;
   arg_def_t enable_experimental_psy;
 #if CONFIG_TUNE_VMAF
   arg_def_t vmaf_resize_factor;
   arg_def_t vmaf_rd_mult;
+  arg_def_t vmaf_probe_resize_factor;
 #endif
   arg_def_t tpl_strength;
   arg_def_t luma_bias_strength;
   arg_def_t luma_bias_midpoint;
   arg_def_t invert_luma_bias;
+  arg_def_t lap_thread;
+  arg_def_t lap_window;
   arg_def_t sb_qp_sweep;
   arg_def_t global_motion_method;
 #endif  // CONFIG_AV1_ENCODER
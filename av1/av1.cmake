@@ -201,6 +201,8 @@ list(APPEND AOM_AV1_ENCODER_SOURCES
             "${AOM_ROOT}/av1/encoder/partition_strategy.c"
             "${AOM_ROOT}/av1/encoder/pass2_strategy.h"
             "${AOM_ROOT}/av1/encoder/pass2_strategy.c"
+            "${AOM_ROOT}/av1/encoder/perceptual_map.c"
+            "${AOM_ROOT}/av1/encoder/perceptual_map.h"
             "${AOM_ROOT}/av1/encoder/pickcdef.c"
             "${AOM_ROOT}/av1/encoder/pickcdef.h"
             "${AOM_ROOT}/av1/encoder/picklpf.c"
@@ -238,6 +240,8 @@ list(APPEND AOM_AV1_ENCODER_SOURCES
             "${AOM_ROOT}/av1/encoder/tokenize.h"
             "${AOM_ROOT}/av1/encoder/tpl_model.c"
             "${AOM_ROOT}/av1/encoder/tpl_model.h"
+            "${AOM_ROOT}/av1/encoder/tune_ssimulacra2.c"
+            "${AOM_ROOT}/av1/encoder/tune_ssimulacra2.h"
             "${AOM_ROOT}/av1/encoder/tx_search.c"
             "${AOM_ROOT}/av1/encoder/tx_search.h"
             "${AOM_ROOT}/av1/encoder/txb_rdopt.c"
@@ -393,6 +397,12 @@ list(APPEND AOM_AV1_COMMON_INTRIN_VSX "${AOM_ROOT}/av1/common/ppc/cfl_ppc.c")
 if(CONFIG_TUNE_VMAF)
   list(APPEND AOM_AV1_ENCODER_SOURCES "${AOM_ROOT}/av1/encoder/tune_vmaf.c"
               "${AOM_ROOT}/av1/encoder/tune_vmaf.h")
+
+  list(APPEND AOM_AV1_ENCODER_INTRIN_SSE4_1
+              "${AOM_ROOT}/av1/encoder/x86/tune_vmaf_sse4.c")
+
+  list(APPEND AOM_AV1_ENCODER_INTRIN_AVX2
+              "${AOM_ROOT}/av1/encoder/x86/tune_vmaf_avx2.c")
 endif()
 
 if(CONFIG_TUNE_BUTTERAUGLI)
@@ -404,6 +414,9 @@ endif()
 if(CONFIG_SALIENCY_MAP)
   list(APPEND AOM_AV1_ENCODER_SOURCES "${AOM_ROOT}/av1/encoder/saliency_map.c"
               "${AOM_ROOT}/av1/encoder/saliency_map.h")
+
+  list(APPEND AOM_AV1_ENCODER_INTRIN_AVX2
+              "${AOM_ROOT}/av1/encoder/x86/saliency_map_avx2.c")
 endif()
 
 if(CONFIG_OPTICAL_FLOW_API)
@@ -22,6 +22,7 @@
 
 #include "aom_dsp/flow_estimation/flow_estimation.h"
 
+#include "av1/av1_cx_iface.h"
 #include "av1/av1_iface_common.h"
 #include "av1/encoder/bitstream.h"
 #include "av1/encoder/encoder.h"
@@ -29,6 +30,7 @@
 #include "av1/encoder/ethread.h"
 #include "av1/encoder/external_partition.h"
 #include "av1/encoder/firstpass.h"
+#include "av1/encoder/pass2_strategy.h"
 #include "av1/encoder/rc_utils.h"
 #include "av1/arg_defs.h"
 
@@ -217,15 +219,20 @@ struct av1_extracfg {
   int butteraugli_resize_factor;
   int butteraugli_quant_mult_pos;
   int butteraugli_quant_mult_neg;
+  int butteraugli_proxy;
+  int butteraugli_tolerance;
   int loopfilter_sharpness;
   int enable_experimental_psy;
   int vmaf_resize_factor;
   int vmaf_rd_mult;
+  int vmaf_probe_resize_factor;
   int tpl_strength;
   int luma_bias_strength;
   int luma_bias_midpoint;
   int invert_luma_bias;
   int luma_bias_override;
+  int lap_thread;
+  int lap_window;
   int sb_qp_sweep;
   GlobalMotionMethod global_motion_method;
 };
@@ -412,15 +419,20 @@ static const struct av1_extracfg default_extra_cfg = {
   1,               // butteraugli_resize_factor
   -1,              // butteraugli_quant_mult_pos
   -1,              // butteraugli_quant_mult_neg
+  0,               // butteraugli_proxy
+  0,               // butteraugli_tolerance
   0,               // loopfilter_sharpness
   0,               // enable_experimental_psy
   1,               // vmaf_resize_factor
   100,             // vmaf_rd_mult
+  0,               // vmaf_probe_resize_factor
   100,             // tpl_strength
   10,              // luma_bias_strength
   40,              // luma_bias_midpoint
   0,               // invert_luma_bias
   0,               // luma_bias_override
+  0,               // lap_thread
+  0,               // lap_window
   0,               // sb_qp_sweep
   GLOBAL_MOTION_METHOD_DISFLOW,  // global_motion_method
 };
@@ -593,15 +605,20 @@ static const struct av1_extracfg default_extra_cfg = {
   1,               // butteraugli_resize_factor
   -1,              // butteraugli_quant_mult_pos
   -1,              // butteraugli_quant_mult_neg
+  0,               // butteraugli_proxy
+  0,               // butteraugli_tolerance
   0,               // loopfilter_sharpness
   0,               // enable_experimental_psy
   1,               // vmaf_resize_factor
   100,             // vmaf_rd_mult
+  0,               // vmaf_probe_resize_factor
   100,             // tpl_strength
   10,              // luma_bias_strength
   40,              // luma_bias_midpoint
   0,               // invert_luma_bias
   0,               // luma_bias_override
+  0,               // lap_thread
+  0,               // lap_window
   0,               // sb_qp_sweep
   GLOBAL_MOTION_METHOD_DISFLOW,  // global_motion_method
 };
@@ -629,9 +646,17 @@ struct aom_codec_alg_priv {
   // lookahead instance variables
   BufferPool *buffer_pool_lap;
   FIRSTPASS_STATS *frame_stats_buffer;
+  // Ring buffer of the first pass info for a LAP window longer than its
+  // static buffer.
+  FIRSTPASS_STATS *lap_window_stats;
   // Number of stats buffers required for look ahead
   int num_lap_buffers;
   STATS_BUFFER_CTX stats_buf_context;
+  // Set by AOME_SET_INPUT_RELEASE_CB.
+  aom_input_release_cb_t input_release;
+  // The image of the current encoder_encode() call while it is handed over,
+  // until the lookahead takes it over.
+  LookaheadFrameRelease pending_input;
 };
 
 static INLINE int gcd(int64_t a, int b) {
@@ -850,7 +875,8 @@ static aom_codec_err_t validate_config(aom_codec_alg_priv_t *ctx,
     stats =
         (const FIRSTPASS_STATS *)cfg->rc_twopass_stats_in.buf + n_packets - 1;
 
-    if ((int)(stats->count + 0.5) != n_packets - 1)
+    // A zeroed EOS packet stands for the totals of the packets before it.
+    if (stats->count != 0.0 && (int)(stats->count + 0.5) != n_packets - 1)
       ERROR("rc_twopass_stats_in missing EOS stats packet");
   }
 
@@ -916,7 +942,8 @@ static aom_codec_err_t validate_config(aom_codec_alg_priv_t *ctx,
 #if !CONFIG_TUNE_VMAF
   if ((extra_cfg->tuning >= AOM_TUNE_VMAF_WITH_PREPROCESSING &&
        extra_cfg->tuning <= AOM_TUNE_VMAF_NEG_MAX_GAIN) ||
-       extra_cfg->tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+       (extra_cfg->tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
+        extra_cfg->tuning <= AOM_TUNE_FAST_VMAF_PSY_QP) ||
        extra_cfg->tuning == AOM_TUNE_LAVISH_VMAF_RD ||
        extra_cfg->vmaf_preprocessing >= 1 ||
        extra_cfg->vmaf_quantization == 1) {
@@ -927,7 +954,7 @@ static aom_codec_err_t validate_config(aom_codec_alg_priv_t *ctx,
 #endif
 
   RANGE_CHECK(extra_cfg, tuning, AOM_TUNE_PSNR,
-              AOM_TUNE_FAST_VMAF_PSY_QP); // In mainline AOM, this is AOM_TUNE_VMAF_SALIENCY_MAP
+              AOM_TUNE_SSIMULACRA2); // In mainline AOM, this is AOM_TUNE_VMAF_SALIENCY_MAP
 
   RANGE_CHECK(extra_cfg, dist_metric, AOM_DIST_METRIC_PSNR,
               AOM_DIST_METRIC_QM_PSNR);
@@ -977,7 +1004,7 @@ static aom_codec_err_t validate_config(aom_codec_alg_priv_t *ctx,
   RANGE_CHECK_HI(extra_cfg, enable_cdef, 2);
   RANGE_CHECK_BOOL(extra_cfg, auto_intra_tools_off);
   RANGE_CHECK_BOOL(extra_cfg, strict_level_conformance);
-  RANGE_CHECK_BOOL(extra_cfg, sb_qp_sweep);
+  RANGE_CHECK(extra_cfg, sb_qp_sweep, 0, 2);
   RANGE_CHECK(extra_cfg, global_motion_method,
               GLOBAL_MOTION_METHOD_FEATURE_MATCH, GLOBAL_MOTION_METHOD_LAST);
 
@@ -1008,16 +1035,25 @@ static aom_codec_err_t validate_config(aom_codec_alg_priv_t *ctx,
   RANGE_CHECK(extra_cfg, butteraugli_resize_factor, 0, 2);
   RANGE_CHECK(extra_cfg, butteraugli_quant_mult_pos, -1, 1000);
   RANGE_CHECK(extra_cfg, butteraugli_quant_mult_neg, -1, 1000);
+  RANGE_CHECK(extra_cfg, butteraugli_proxy, 0, 1);
+  RANGE_CHECK(extra_cfg, butteraugli_tolerance, 0, 100);
 #endif
 #if CONFIG_TUNE_VMAF
   RANGE_CHECK(extra_cfg, vmaf_resize_factor, 0, 3);
   RANGE_CHECK(extra_cfg, vmaf_rd_mult, 1, 1000);
+  RANGE_CHECK(extra_cfg, vmaf_probe_resize_factor, 0, 2);
   RANGE_CHECK_BOOL(extra_cfg, vmaf_quantization);
 #endif
   RANGE_CHECK(extra_cfg, tpl_strength, 0, 1000);
   RANGE_CHECK(extra_cfg, luma_bias_strength, 1, 100);
   RANGE_CHECK(extra_cfg, luma_bias_midpoint, 0, 255);
   RANGE_CHECK_BOOL(extra_cfg, invert_luma_bias);
+  RANGE_CHECK_BOOL(extra_cfg, lap_thread);
+  RANGE_CHECK_HI(extra_cfg, lap_window, MAX_LAP_WINDOW);
+  // The look ahead is sized by the window when the first frame comes in.
+  if (ctx->ppi != NULL && ctx->ppi->lookahead != NULL &&
+      extra_cfg->lap_window != ctx->extra_cfg.lap_window)
+    ERROR("Cannot change the LAP window after the first frame");
   RANGE_CHECK_HI(extra_cfg, loopfilter_sharpness, 7);
   RANGE_CHECK_BOOL(extra_cfg, enable_experimental_psy);
   return AOM_CODEC_OK;
@@ -1649,6 +1685,10 @@ static void set_encoder_config(AV1EncoderConfig *oxcf,
   oxcf->butteraugli_quant_mult_pos = extra_cfg->butteraugli_quant_mult_pos;
 
   oxcf->butteraugli_quant_mult_neg = extra_cfg->butteraugli_quant_mult_neg;
+
+  oxcf->butteraugli_proxy = extra_cfg->butteraugli_proxy;
+
+  oxcf->butteraugli_tolerance = extra_cfg->butteraugli_tolerance;
 #endif
 
   oxcf->loopfilter_sharpness = extra_cfg->loopfilter_sharpness;
@@ -1669,6 +1709,8 @@ static void set_encoder_config(AV1EncoderConfig *oxcf,
                                             : BLOCK_32X32;
 
   oxcf->vmaf_rd_mult = extra_cfg->vmaf_rd_mult;
+
+  oxcf->vmaf_probe_resize_factor = extra_cfg->vmaf_probe_resize_factor;
 #endif
 
   oxcf->tpl_strength = extra_cfg->tpl_strength;
@@ -1681,6 +1723,9 @@ static void set_encoder_config(AV1EncoderConfig *oxcf,
 
   oxcf->luma_bias_override = extra_cfg->luma_bias_override;
 
+  oxcf->lap_thread = extra_cfg->lap_thread;
+  oxcf->lap_window = extra_cfg->lap_window;
+
   oxcf->frame_periodic_boost = extra_cfg->frame_periodic_boost;
 
   oxcf->sb_qp_sweep = extra_cfg->sb_qp_sweep;
@@ -1783,6 +1828,82 @@ static aom_codec_err_t ctrl_get_baseline_gf_interval(aom_codec_alg_priv_t *ctx,
   return AOM_CODEC_OK;
 }
 
+// Returns the number of frames of first pass stats the LAP stage keeps ahead
+// of the encode stage, 0 when the encode does not use the LAP stage, and sets
+// the lag of the LAP stage itself.
+static int get_num_lap_buffers(const aom_codec_enc_cfg_t *cfg,
+                               const AV1EncoderConfig *oxcf,
+                               int *lap_lag_in_frames) {
+  int num_lap_buffers = 0;
+  *lap_lag_in_frames = 0;
+  if (oxcf->rc_cfg.mode != AOM_CBR && oxcf->pass == AOM_RC_ONE_PASS &&
+      oxcf->mode == GOOD) {
+    // Stats past the next forced key frame are never used.
+    const int max_window =
+        oxcf->kf_cfg.key_freq_max + SCENE_CUT_KEY_TEST_INTERVAL;
+    // Enable look ahead - enabled for AOM_Q, AOM_CQ, AOM_VBR
+    num_lap_buffers = AOMMIN((int)cfg->g_lag_in_frames,
+                             AOMMIN(MAX_LAP_BUFFERS, max_window));
+    // A longer stats window than the lag, up to MAX_LAP_WINDOW frames.
+    if (num_lap_buffers > 0 && oxcf->lap_window > num_lap_buffers) {
+      num_lap_buffers = AOMMIN(oxcf->lap_window, max_window);
+    }
+    if ((int)cfg->g_lag_in_frames - num_lap_buffers >= LAP_LAG_IN_FRAMES) {
+      *lap_lag_in_frames = LAP_LAG_IN_FRAMES;
+    }
+  }
+  return num_lap_buffers;
+}
+
+#if !CONFIG_REALTIME_ONLY
+// Sizes the stats buffer and the LAP stage for the stats window of the
+// current configuration. The look ahead takes its depth from it when the
+// first frame comes in.
+static aom_codec_err_t resize_lap_window(aom_codec_alg_priv_t *ctx) {
+  AV1_PRIMARY *const ppi = ctx->ppi;
+  int lap_lag_in_frames;
+  const int num_lap_buffers =
+      get_num_lap_buffers(&ctx->cfg, &ctx->oxcf, &lap_lag_in_frames);
+  assert(ppi->lookahead == NULL);
+  if (ppi->cpi_lap == NULL || num_lap_buffers == 0 ||
+      num_lap_buffers == ctx->num_lap_buffers)
+    return AOM_CODEC_OK;
+
+  av1_destroy_stats_buffer(&ctx->stats_buf_context, ctx->frame_stats_buffer);
+  ctx->frame_stats_buffer = NULL;
+  av1_zero(ctx->stats_buf_context);
+  const aom_codec_err_t res = av1_create_stats_buffer(
+      &ctx->frame_stats_buffer, &ctx->stats_buf_context, num_lap_buffers);
+  if (res != AOM_CODEC_OK) return res;
+  const int size = get_stats_buf_size(num_lap_buffers, MAX_LAG_BUFFERS);
+  for (int i = 0; i < size; i++)
+    ppi->twopass.frame_stats_arr[i] = &ctx->frame_stats_buffer[i];
+  for (int i = 0; i < ppi->num_fp_contexts; i++) {
+    ppi->parallel_cpi[i]->twopass_frame.stats_in =
+        ppi->twopass.stats_buf_ctx->stats_in_start;
+  }
+
+  // The first pass info keeps one past frame next to the window.
+  const int info_size = num_lap_buffers + FIRSTPASS_INFO_STATS_PAST_MIN;
+  aom_free(ctx->lap_window_stats);
+  ctx->lap_window_stats = NULL;
+  if (info_size > FIRSTPASS_INFO_STATIC_BUF_SIZE) {
+    ctx->lap_window_stats =
+        (FIRSTPASS_STATS *)aom_calloc(info_size, sizeof(FIRSTPASS_STATS));
+    if (ctx->lap_window_stats == NULL) return AOM_CODEC_MEM_ERROR;
+    av1_firstpass_info_init_ring(&ppi->twopass.firstpass_info,
+                                 ctx->lap_window_stats, info_size);
+  } else {
+    av1_firstpass_info_init(&ppi->twopass.firstpass_info, NULL, 0);
+  }
+
+  ppi->cpi_lap->oxcf.gf_cfg.lag_in_frames = lap_lag_in_frames;
+  av1_set_scenecut_detection(ppi, num_lap_buffers);
+  ctx->num_lap_buffers = num_lap_buffers;
+  return AOM_CODEC_OK;
+}
+#endif  // !CONFIG_REALTIME_ONLY
+
 static aom_codec_err_t update_extra_cfg(aom_codec_alg_priv_t *ctx,
                                         const struct av1_extracfg *extra_cfg) {
   const aom_codec_err_t res = validate_config(ctx, &ctx->cfg, extra_cfg);
@@ -1799,6 +1920,9 @@ static aom_codec_err_t update_extra_cfg(aom_codec_alg_priv_t *ctx,
     if (ctx->ppi->cpi_lap != NULL) {
       av1_change_config(ctx->ppi->cpi_lap, &ctx->oxcf, is_sb_size_changed);
     }
+#if !CONFIG_REALTIME_ONLY
+    if (ctx->ppi->lookahead == NULL) return resize_lap_window(ctx);
+#endif  // !CONFIG_REALTIME_ONLY
   }
   return res;
 }
@@ -2899,18 +3023,8 @@ static aom_codec_err_t encoder_init(aom_codec_ctx_t *ctx) {
       reduce_ratio(&priv->timestamp_ratio);
 
       set_encoder_config(&priv->oxcf, &priv->cfg, &priv->extra_cfg);
-      if (priv->oxcf.rc_cfg.mode != AOM_CBR &&
-          priv->oxcf.pass == AOM_RC_ONE_PASS && priv->oxcf.mode == GOOD) {
-        // Enable look ahead - enabled for AOM_Q, AOM_CQ, AOM_VBR
-        *num_lap_buffers =
-            AOMMIN((int)priv->cfg.g_lag_in_frames,
-                   AOMMIN(MAX_LAP_BUFFERS, priv->oxcf.kf_cfg.key_freq_max +
-                                               SCENE_CUT_KEY_TEST_INTERVAL));
-        if ((int)priv->cfg.g_lag_in_frames - (*num_lap_buffers) >=
-            LAP_LAG_IN_FRAMES) {
-          lap_lag_in_frames = LAP_LAG_IN_FRAMES;
-        }
-      }
+      *num_lap_buffers = get_num_lap_buffers(&priv->cfg, &priv->oxcf,
+                                             &lap_lag_in_frames);
       priv->oxcf.use_highbitdepth =
           (ctx->init_flags & AOM_CODEC_USE_HIGHBITDEPTH) ? 1 : 0;
 
@@ -3032,6 +3146,7 @@ static aom_codec_err_t encoder_destroy(aom_codec_alg_priv_t *ctx) {
     av1_remove_primary_compressor(ppi);
   }
   av1_destroy_stats_buffer(&ctx->stats_buf_context, ctx->frame_stats_buffer);
+  aom_free(ctx->lap_window_stats);
   aom_free(ctx);
   return AOM_CODEC_OK;
 }
@@ -3068,13 +3183,56 @@ static INLINE int get_src_border_in_pixels(AV1_COMP *cpi, BLOCK_SIZE sb_size) {
   return border_in_pixels;
 }
 
+static void release_input_image(void *cb_priv, void *frame) {
+  const aom_codec_alg_priv_t *const ctx = (const aom_codec_alg_priv_t *)cb_priv;
+  ctx->input_release.release_cb(ctx->input_release.cb_priv,
+                                (const aom_image_t *)frame);
+}
+
+// Returns the border around every plane of 'img' if it has the layout of
+// aom_img_alloc_with_border(), and 0 otherwise.
+static int get_img_alloc_border(const aom_image_t *img) {
+  const int bps = (img->fmt & AOM_IMG_FMT_HIGHBITDEPTH) ? 2 : 1;
+  const int uv_flip = (img->fmt & AOM_IMG_FMT_UV_FLIP) != 0;
+  const unsigned char *const u_plane = img->planes[uv_flip ? 2 : 1];
+  const unsigned char *const v_plane = img->planes[uv_flip ? 1 : 2];
+  const int y_stride = img->stride[AOM_PLANE_Y];
+  const int uv_stride = img->stride[AOM_PLANE_U];
+  if (img->img_data == NULL || !(img->fmt & AOM_IMG_FMT_PLANAR) ||
+      v_plane == NULL || img->stride[AOM_PLANE_V] != uv_stride ||
+      img->planes[AOM_PLANE_Y] < img->img_data || y_stride <= 0) {
+    return 0;
+  }
+  const size_t y_offset = img->planes[AOM_PLANE_Y] - img->img_data;
+  const int border = (int)(y_offset / (y_stride + bps));
+  if (y_offset != (size_t)border * (y_stride + bps)) return 0;
+
+  const int uv_border_w = border >> img->x_chroma_shift;
+  const int uv_border_h = border >> img->y_chroma_shift;
+  const size_t uv_plane_size =
+      (size_t)((img->h >> img->y_chroma_shift) + 2 * uv_border_h) * uv_stride;
+  const size_t uv_offset = (size_t)uv_border_h * uv_stride + uv_border_w * bps;
+  const unsigned char *const u_data =
+      img->img_data + (size_t)(img->h + 2 * border) * y_stride;
+  if (u_plane != u_data + uv_offset ||
+      v_plane != u_data + uv_plane_size + uv_offset ||
+      img->sz < (size_t)(u_data - img->img_data) + 2 * uv_plane_size) {
+    return 0;
+  }
+  // Rows start as aligned as in the encoder's own frame buffers.
+  if (((uintptr_t)img->planes[AOM_PLANE_Y] | (uintptr_t)y_stride) & 31) {
+    return 0;
+  }
+  return border;
+}
+
 // TODO(Mufaddal): Check feasibility of abstracting functions related to LAP
 // into a separate function.
-static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
-                                      const aom_image_t *img,
-                                      aom_codec_pts_t pts,
-                                      unsigned long duration,
-                                      aom_enc_frame_flags_t enc_flags) {
+static aom_codec_err_t encoder_encode_impl(aom_codec_alg_priv_t *ctx,
+                                           const aom_image_t *img,
+                                           aom_codec_pts_t pts,
+                                           unsigned long duration,
+                                           aom_enc_frame_flags_t enc_flags) {
   const size_t kMinCompressedSize = 8192;
   volatile aom_codec_err_t res = AOM_CODEC_OK;
   AV1_PRIMARY *const ppi = ctx->ppi;
@@ -3148,6 +3306,9 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
   // before it returns.
   if (setjmp(ppi->error.jmp)) {
     ppi->error.setjmp = 0;
+#if !CONFIG_REALTIME_ONLY
+    av1_finish_lap_stage(ppi);
+#endif  // !CONFIG_REALTIME_ONLY
     res = update_error_state(ctx, &ppi->error);
     return res;
   }
@@ -3167,7 +3328,8 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
 #if CONFIG_TUNE_VMAF
   if ((ctx->extra_cfg.tuning >= AOM_TUNE_VMAF_WITH_PREPROCESSING &&
        ctx->extra_cfg.tuning <= AOM_TUNE_VMAF_NEG_MAX_GAIN) ||
-       ctx->extra_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+       (ctx->extra_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
+        ctx->extra_cfg.tuning <= AOM_TUNE_FAST_VMAF_PSY_QP) ||
        ctx->extra_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD ||
        ctx->extra_cfg.vmaf_preprocessing >= 1 ||
        ctx->extra_cfg.vmaf_quantization == 1) {
@@ -3231,7 +3393,13 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
           ppi->parallel_cpi[i]->oxcf.border_in_pixels = oxcf->border_in_pixels;
         }
 
-        const int src_border_in_pixels = get_src_border_in_pixels(cpi, sb_size);
+        int src_border_in_pixels = get_src_border_in_pixels(cpi, sb_size);
+        // Queued frames share one stride, so give the lookahead the border
+        // of the caller's images when they are handed over.
+        if (ctx->input_release.release_cb != NULL) {
+          src_border_in_pixels =
+              AOMMAX(src_border_in_pixels, get_img_alloc_border(img));
+        }
         ppi->lookahead = av1_lookahead_init(
             cpi->oxcf.frm_dim_cfg.width, cpi->oxcf.frm_dim_cfg.height,
             subsampling_x, subsampling_y, use_highbitdepth, lag_in_frames,
@@ -3251,10 +3419,19 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
                                 subsampling_y);
       }
 
+      // A handed over image is queued in place when it has a border the
+      // encoder can extend into.
+      LookaheadFrameRelease *input_release = NULL;
+      if (ctx->input_release.release_cb != NULL) {
+        sd.border = get_img_alloc_border(img);
+        input_release = &ctx->pending_input;
+      }
+
       // Store the original flags in to the frame buffer. Will extract the
       // key frame flag when we actually encode this frame.
       if (av1_receive_raw_frame(cpi, flags | ctx->next_frame_flags, &sd,
-                                src_time_stamp, src_end_time_stamp)) {
+                                src_time_stamp, src_end_time_stamp,
+                                input_release)) {
         res = update_error_state(ctx, cpi->common.error);
       }
       ctx->next_frame_flags = 0;
@@ -3315,8 +3492,15 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
       av1_init_frame_mt(ppi, cpi_lap);
     }
 
+#if !CONFIG_REALTIME_ONLY
+    // Run the LAP stage next to the encode of the frames below, once the
+    // sequence header no longer changes.
+    if (cpi_lap != NULL && cpi->oxcf.lap_thread && ppi->seq_params_locked)
+      av1_launch_lap_stage(ppi, !img, &ctx->timestamp_ratio);
+#endif  // !CONFIG_REALTIME_ONLY
+
     // Call for LAP stage
-    if (cpi_lap != NULL) {
+    if (cpi_lap != NULL && !ppi->lap_running) {
       AV1_COMP_DATA cpi_lap_data = { 0 };
       cpi_lap_data.flush = !img;
       cpi_lap_data.timestamp_ratio = &ctx->timestamp_ratio;
@@ -3461,6 +3645,11 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
           (!is_frame_visible &&
            cpi->common.current_frame.frame_type == KEY_FRAME);
     }
+#if !CONFIG_REALTIME_ONLY
+    if (av1_finish_lap_stage(ppi) != AOM_CODEC_OK) {
+      aom_internal_error(&ppi->error, AOM_CODEC_ERROR, NULL);
+    }
+#endif  // !CONFIG_REALTIME_ONLY
     if (is_frame_visible) {
       // Add the frame packet to the list of returned packets.
       aom_codec_cx_pkt_t pkt;
@@ -3509,6 +3698,27 @@ static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
   return res;
 }
 
+static aom_codec_err_t encoder_encode(aom_codec_alg_priv_t *ctx,
+                                      const aom_image_t *img,
+                                      aom_codec_pts_t pts,
+                                      unsigned long duration,
+                                      aom_enc_frame_flags_t enc_flags) {
+  if (img != NULL && ctx->input_release.release_cb != NULL) {
+    ctx->pending_input.release_cb = release_input_image;
+    ctx->pending_input.cb_priv = ctx;
+    ctx->pending_input.frame = (void *)img;
+  }
+  const aom_codec_err_t res =
+      encoder_encode_impl(ctx, img, pts, duration, enc_flags);
+  // A handed over image the lookahead did not take, because it was rejected
+  // or the encoder failed before queuing it, goes back to the caller here.
+  if (ctx->pending_input.frame != NULL) {
+    release_input_image(ctx, ctx->pending_input.frame);
+    ctx->pending_input.frame = NULL;
+  }
+  return res;
+}
+
 static const aom_codec_cx_pkt_t *encoder_get_cxdata(aom_codec_alg_priv_t *ctx,
                                                     aom_codec_iter_t *iter) {
   return aom_codec_pkt_list_get(&ctx->pkt_list.head, iter);
@@ -4375,6 +4585,12 @@ static aom_codec_err_t encoder_set_option(aom_codec_alg_priv_t *ctx,
   } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.butteraugli_quant_mult_neg,
                               argv, err_string)) {
     extra_cfg.butteraugli_quant_mult_neg = arg_parse_int_helper(&arg, err_string);
+  } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.butteraugli_proxy,
+                              argv, err_string)) {
+    extra_cfg.butteraugli_proxy = arg_parse_int_helper(&arg, err_string);
+  } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.butteraugli_tolerance,
+                              argv, err_string)) {
+    extra_cfg.butteraugli_tolerance = arg_parse_int_helper(&arg, err_string);
 #endif
   } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.loopfilter_sharpness,
                               argv, err_string)) {
@@ -4389,6 +4605,9 @@ static aom_codec_err_t encoder_set_option(aom_codec_alg_priv_t *ctx,
   } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.vmaf_rd_mult,
                               argv, err_string)) {
     extra_cfg.vmaf_rd_mult = arg_parse_int_helper(&arg, err_string);
+  } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.vmaf_probe_resize_factor,
+                              argv, err_string)) {
+    extra_cfg.vmaf_probe_resize_factor = arg_parse_int_helper(&arg, err_string);
 #endif
   } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.tpl_strength,
                               argv, err_string)) {
@@ -4402,6 +4621,12 @@ static aom_codec_err_t encoder_set_option(aom_codec_alg_priv_t *ctx,
   } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.invert_luma_bias,
                               argv, err_string)) {
     extra_cfg.invert_luma_bias = arg_parse_int_helper(&arg, err_string);
+  } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.lap_thread, argv,
+                              err_string)) {
+    extra_cfg.lap_thread = arg_parse_int_helper(&arg, err_string);
+  } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.lap_window, argv,
+                              err_string)) {
+    extra_cfg.lap_window = arg_parse_int_helper(&arg, err_string);
   } else if (arg_match_helper(&arg, &g_av1_codec_arg_defs.tile_height, argv,
                               err_string)) {
     ctx->cfg.tile_height_count = arg_parse_list_helper(
@@ -4584,6 +4809,20 @@ static aom_codec_err_t ctrl_set_butteraugli_quant_mult_neg(aom_codec_alg_priv_t
   return update_extra_cfg(ctx, &extra_cfg);
 }
 
+static aom_codec_err_t ctrl_set_butteraugli_proxy(aom_codec_alg_priv_t *ctx,
+                                          va_list args) {
+  struct av1_extracfg extra_cfg = ctx->extra_cfg;
+  extra_cfg.butteraugli_proxy = CAST(AOME_SET_BUTTERAUGLI_PROXY, args);
+  return update_extra_cfg(ctx, &extra_cfg);
+}
+
+static aom_codec_err_t ctrl_set_butteraugli_tolerance(aom_codec_alg_priv_t *ctx,
+                                          va_list args) {
+  struct av1_extracfg extra_cfg = ctx->extra_cfg;
+  extra_cfg.butteraugli_tolerance = CAST(AOME_SET_BUTTERAUGLI_TOLERANCE, args);
+  return update_extra_cfg(ctx, &extra_cfg);
+}
+
 static aom_codec_err_t ctrl_set_loopfilter_sharpness(aom_codec_alg_priv_t *ctx,
                                           va_list args) {
   struct av1_extracfg extra_cfg = ctx->extra_cfg;
@@ -4612,6 +4851,59 @@ static aom_codec_err_t ctrl_set_vmaf_rd_mult(aom_codec_alg_priv_t *ctx,
   return update_extra_cfg(ctx, &extra_cfg);
 }
 
+static aom_codec_err_t ctrl_set_vmaf_probe_resize_factor(aom_codec_alg_priv_t *ctx,
+                                          va_list args) {
+  struct av1_extracfg extra_cfg = ctx->extra_cfg;
+  extra_cfg.vmaf_probe_resize_factor = CAST(AOME_SET_VMAF_PROBE_RESIZE_FACTOR, args);
+  return update_extra_cfg(ctx, &extra_cfg);
+}
+
+static aom_codec_err_t ctrl_set_lap_thread(aom_codec_alg_priv_t *ctx,
+                                           va_list args) {
+  struct av1_extracfg extra_cfg = ctx->extra_cfg;
+  extra_cfg.lap_thread = CAST(AOME_SET_LAP_THREAD, args);
+  return update_extra_cfg(ctx, &extra_cfg);
+}
+
+static aom_codec_err_t ctrl_set_lap_window(aom_codec_alg_priv_t *ctx,
+                                           va_list args) {
+  struct av1_extracfg extra_cfg = ctx->extra_cfg;
+  extra_cfg.lap_window = CAST(AOME_SET_LAP_WINDOW, args);
+  return update_extra_cfg(ctx, &extra_cfg);
+}
+
+static aom_codec_err_t ctrl_set_input_release_cb(aom_codec_alg_priv_t *ctx,
+                                                 va_list args) {
+  const aom_input_release_cb_t *const cb =
+      CAST(AOME_SET_INPUT_RELEASE_CB, args);
+  if (cb == NULL) return AOM_CODEC_INVALID_PARAM;
+  ctx->input_release = *cb;
+  return AOM_CODEC_OK;
+}
+
+static aom_codec_err_t ctrl_get_scene_cuts(aom_codec_alg_priv_t *ctx,
+                                           va_list args) {
+  aom_scene_cuts_t *const cuts = va_arg(args, aom_scene_cuts_t *);
+  if (cuts == NULL || (cuts->frames == NULL && cuts->max_cuts > 0))
+    return AOM_CODEC_INVALID_PARAM;
+#if CONFIG_REALTIME_ONLY
+  ERROR("AOME_GET_SCENE_CUTS is not supported in realtime only build.");
+#else
+  const aom_fixed_buf_t *const stats_in = &ctx->cfg.rc_twopass_stats_in;
+  const size_t packet_sz = sizeof(FIRSTPASS_STATS);
+  if (ctx->cfg.g_pass < AOM_RC_SECOND_PASS || stats_in->buf == NULL ||
+      stats_in->sz % packet_sz || stats_in->sz < 2 * packet_sz) {
+    ERROR("AOME_GET_SCENE_CUTS requires the first pass stats.");
+  }
+  // The last packet holds the totals of the sequence.
+  const int num_stats = (int)(stats_in->sz / packet_sz) - 1;
+  cuts->num_cuts =
+      av1_find_scene_cuts(&ctx->oxcf, (const FIRSTPASS_STATS *)stats_in->buf,
+                          num_stats, cuts->frames, cuts->max_cuts);
+  return AOM_CODEC_OK;
+#endif  // CONFIG_REALTIME_ONLY
+}
+
 static aom_codec_err_t ctrl_set_tpl_strength(aom_codec_alg_priv_t *ctx,
                                           va_list args) {
   struct av1_extracfg extra_cfg = ctx->extra_cfg;
@@ -4817,10 +5109,17 @@ static aom_codec_ctrl_fn_map_t encoder_ctrl_maps[] = {
   { AOME_SET_BUTTERAUGLI_RESIZE_FACTOR, ctrl_set_butteraugli_resize_factor },
   { AOME_SET_BUTTERAUGLI_QUANT_MULT_POS, ctrl_set_butteraugli_quant_mult_pos },
   { AOME_SET_BUTTERAUGLI_QUANT_MULT_NEG, ctrl_set_butteraugli_quant_mult_neg },
+  { AOME_SET_BUTTERAUGLI_PROXY, ctrl_set_butteraugli_proxy },
+  { AOME_SET_BUTTERAUGLI_TOLERANCE, ctrl_set_butteraugli_tolerance },
   { AOME_SET_LOOPFILTER_SHARPNESS, ctrl_set_loopfilter_sharpness },
   { AOME_SET_ENABLE_EXPERIMENTAL_PSY, ctrl_set_enable_experimental_psy },
   { AOME_SET_VMAF_RESIZE_FACTOR, ctrl_set_vmaf_resize_factor },
   { AOME_SET_VMAF_RD_MULT, ctrl_set_vmaf_rd_mult },
+  { AOME_SET_VMAF_PROBE_RESIZE_FACTOR, ctrl_set_vmaf_probe_resize_factor },
+  { AOME_SET_INPUT_RELEASE_CB, ctrl_set_input_release_cb },
+  { AOME_GET_SCENE_CUTS, ctrl_get_scene_cuts },
+  { AOME_SET_LAP_THREAD, ctrl_set_lap_thread },
+  { AOME_SET_LAP_WINDOW, ctrl_set_lap_window },
   { AOME_SET_TPL_STRENGTH, ctrl_set_tpl_strength },
   { AOME_SET_LUMA_BIAS_STRENGTH, ctrl_set_luma_bias_strength },
   { AOME_SET_LUMA_BIAS_MIDPOINT, ctrl_set_luma_bias_midpoint },
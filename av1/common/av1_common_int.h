@@ -1132,7 +1132,9 @@ static INLINE int get_free_fb(AV1_COMMON *cm) {
 static INLINE RefCntBuffer *assign_cur_frame_new_fb(AV1_COMMON *const cm) {
   // Release the previously-used frame-buffer
   if (cm->cur_frame != NULL) {
+    lock_buffer_pool(cm->buffer_pool);
     --cm->cur_frame->ref_count;
+    unlock_buffer_pool(cm->buffer_pool);
     cm->cur_frame = NULL;
   }
 
@@ -495,6 +495,22 @@ if (aom_config("CONFIG_AV1_ENCODER") eq "yes") {
     add_proto qw/int av1_denoiser_filter/, "const uint8_t *sig, int sig_stride, const uint8_t *mc_avg, int mc_avg_stride, uint8_t *avg, int avg_stride, int increase_denoising, BLOCK_SIZE bs, int motion_magnitude";
     specialize qw/av1_denoiser_filter neon sse2/;
   }
+
+  # VMAF preprocessing
+  if (aom_config("CONFIG_TUNE_VMAF") eq "yes") {
+    add_proto qw/void av1_unsharp_rect/, "const uint8_t *source, int source_stride, const uint8_t *blurred, int blurred_stride, uint8_t *dst, int dst_stride, int w, int h, double amount";
+    specialize qw/av1_unsharp_rect sse4_1 avx2/;
+    add_proto qw/void av1_highbd_unsharp_rect/, "const uint16_t *source, int source_stride, const uint16_t *blurred, int blurred_stride, uint16_t *dst, int dst_stride, int w, int h, double amount, int bit_depth";
+    specialize qw/av1_highbd_unsharp_rect sse4_1 avx2/;
+  }
+
+  # Saliency map
+  if (aom_config("CONFIG_SALIENCY_MAP") eq "yes") {
+    add_proto qw/void av1_saliency_decimate_row/, "const float *const *rows, int width, float *tmp, float *dst";
+    specialize qw/av1_saliency_decimate_row avx2/;
+    add_proto qw/void av1_saliency_gabor_row/, "const float *const *rows, int width, const float *kernel, float *dst";
+    specialize qw/av1_saliency_gabor_row avx2/;
+  }
 }
 # end encoder functions
 
@@ -735,6 +735,44 @@ int av1_get_sbq_perceptual_ai(AV1_COMP *const cpi, BLOCK_SIZE bsize, int mi_row,
 
 void av1_init_mb_ur_var_buffer(AV1_COMP *cpi) {
   AV1_COMMON *cm = &cpi->common;
+  const CommonModeInfoParams *const mi_params = &cm->mi_params;
+  UserRatingDeltaqInfo *const info = &cpi->ur_deltaq;
+  const BLOCK_SIZE block_size = cm->seq_params->sb_size;
+  const int num_mi_w = mi_size_wide[block_size];
+  const int num_mi_h = mi_size_high[block_size];
+  const int num_sbs = ((mi_params->mi_cols + num_mi_w - 1) / num_mi_w) *
+                      ((mi_params->mi_rows + num_mi_h - 1) / num_mi_h);
+
+  if (info->num_sbs < num_sbs) {
+    aom_free(info->sb_delta_q[0]);
+    aom_free(info->sb_delta_q[1]);
+    info->sb_delta_q[1] = NULL;
+    info->num_sbs = 0;
+    CHECK_MEM_ERROR(cm, info->sb_delta_q[0],
+                    aom_malloc(num_sbs * sizeof(*info->sb_delta_q[0])));
+    CHECK_MEM_ERROR(cm, info->sb_delta_q[1],
+                    aom_malloc(num_sbs * sizeof(*info->sb_delta_q[1])));
+    info->num_sbs = num_sbs;
+  }
+
+#if CONFIG_TFLITE
+  if (info->model == NULL) {
+    info->model =
+        TfLiteModelCreate(av1_deltaq4_model_file, av1_deltaq4_model_fsize);
+    if (info->options == NULL)
+      info->options = TfLiteInterpreterOptionsCreate();
+    if (info->model == NULL || info->options == NULL) {
+      aom_internal_error(cm->error, AOM_CODEC_ERROR,
+                         "Failed to call TFlite functions.");
+    }
+    // With several workers each interpreter runs on its own thread.
+    const MultiThreadInfo *const mt_info = &cpi->mt_info;
+    const int num_workers =
+        AOMMIN(mt_info->num_mod_workers[MOD_ENC], mt_info->num_workers);
+    TfLiteInterpreterOptionsSetNumThreads(info->options,
+                                          num_workers > 1 ? 1 : 2);
+  }
+#endif
 
   if (cpi->mb_delta_q) return;
 
@@ -743,131 +781,235 @@ void av1_init_mb_ur_var_buffer(AV1_COMP *cpi) {
                              sizeof(*cpi->mb_delta_q)));
 }
 
+void av1_free_mb_ur_var_buffers(UserRatingDeltaqInfo *info) {
+  aom_free(info->sb_delta_q[0]);
+  aom_free(info->sb_delta_q[1]);
 #if CONFIG_TFLITE
-static int model_predict(BLOCK_SIZE block_size, int num_cols, int num_rows,
-                         int bit_depth, uint8_t *y_buffer, int y_stride,
-                         float *predicts0, float *predicts1) {
-  // Create the model and interpreter options.
-  TfLiteModel *model =
-      TfLiteModelCreate(av1_deltaq4_model_file, av1_deltaq4_model_fsize);
-  if (model == NULL) return 1;
-
-  TfLiteInterpreterOptions *options = TfLiteInterpreterOptionsCreate();
-  TfLiteInterpreterOptionsSetNumThreads(options, 2);
-  if (options == NULL) {
-    TfLiteModelDelete(model);
-    return 1;
+  for (int i = 0; i < MAX_NUM_THREADS; ++i) {
+    if (info->interpreter[i] != NULL)
+      TfLiteInterpreterDelete(info->interpreter[i]);
   }
+  if (info->options != NULL) TfLiteInterpreterOptionsDelete(info->options);
+  if (info->model != NULL) TfLiteModelDelete(info->model);
+#endif
+  memset(info, 0, sizeof(*info));
+}
 
-  // Create the interpreter.
-  TfLiteInterpreter *interpreter = TfLiteInterpreterCreate(model, options);
-  if (interpreter == NULL) {
-    TfLiteInterpreterOptionsDelete(options);
-    TfLiteModelDelete(model);
-    return 1;
+#if CONFIG_TFLITE
+// Resizes the batch dimension of the input to 'batch_size' superblocks and
+// checks that the output holds the two predictions of each of them.
+static int resize_batch(TfLiteInterpreter *interpreter, int batch_size,
+                        int block_pixels) {
+  const TfLiteTensor *input = TfLiteInterpreterGetInputTensor(interpreter, 0);
+  if (input == NULL) return 0;
+  const int num_dims = TfLiteTensorNumDims(input);
+  int dims[4];
+  if (num_dims < 1 || num_dims > 4) return 0;
+  for (int i = 0; i < num_dims; ++i) dims[i] = TfLiteTensorDim(input, i);
+  dims[0] = batch_size;
+  if (TfLiteInterpreterResizeInputTensor(interpreter, 0, dims, num_dims) !=
+          kTfLiteOk ||
+      TfLiteInterpreterAllocateTensors(interpreter) != kTfLiteOk) {
+    return 0;
   }
 
-  // Allocate tensors and populate the input tensor data.
-  TfLiteInterpreterAllocateTensors(interpreter);
-  TfLiteTensor *input_tensor = TfLiteInterpreterGetInputTensor(interpreter, 0);
-  if (input_tensor == NULL) {
-    TfLiteInterpreterDelete(interpreter);
-    TfLiteInterpreterOptionsDelete(options);
-    TfLiteModelDelete(model);
-    return 1;
+  input = TfLiteInterpreterGetInputTensor(interpreter, 0);
+  const TfLiteTensor *output =
+      TfLiteInterpreterGetOutputTensor(interpreter, 0);
+  return input != NULL && output != NULL &&
+         TfLiteTensorByteSize(input) ==
+             (size_t)batch_size * block_pixels * sizeof(float) &&
+         TfLiteTensorByteSize(output) ==
+             (size_t)batch_size * 2 * sizeof(float);
+}
+
+// Returns the interpreter of worker 'worker_id', set up to predict the
+// superblocks of a row of 'num_cols' of them. The whole row goes in one batch
+// unless the model has a fixed batch size, then superblocks go one by one.
+static TfLiteInterpreter *get_interpreter(UserRatingDeltaqInfo *info,
+                                          int worker_id, int num_cols,
+                                          int block_pixels) {
+  TfLiteInterpreter *interpreter = info->interpreter[worker_id];
+  if (interpreter == NULL) {
+    interpreter = TfLiteInterpreterCreate(info->model, info->options);
+    if (interpreter == NULL) return NULL;
+    info->interpreter[worker_id] = interpreter;
+    info->batch_cols[worker_id] = 0;
   }
+  if (info->batch_cols[worker_id] == num_cols) return interpreter;
 
-  size_t input_size = TfLiteTensorByteSize(input_tensor);
-  float *input_data = aom_calloc(input_size, 1);
-  if (input_data == NULL) {
-    TfLiteInterpreterDelete(interpreter);
-    TfLiteInterpreterOptionsDelete(options);
-    TfLiteModelDelete(model);
-    return 1;
+  info->batch_cols[worker_id] = 0;
+  if (resize_batch(interpreter, num_cols, block_pixels)) {
+    info->batch_size[worker_id] = num_cols;
+  } else if (resize_batch(interpreter, 1, block_pixels)) {
+    info->batch_size[worker_id] = 1;
+  } else {
+    return NULL;
   }
+  info->batch_cols[worker_id] = num_cols;
+  return interpreter;
+}
 
+static int model_predict_row(AV1_COMP *cpi, int worker_id, int row) {
+  const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+  UserRatingDeltaqInfo *const info = &cpi->ur_deltaq;
+  const uint8_t *y_buffer = cpi->source->y_buffer;
+  const int y_stride = cpi->source->y_stride;
+  const BLOCK_SIZE block_size = cpi->common.seq_params->sb_size;
+  const int bit_depth = cpi->td.mb.e_mbd.bd;
   const int num_mi_w = mi_size_wide[block_size];
   const int num_mi_h = mi_size_high[block_size];
-  for (int row = 0; row < num_rows; ++row) {
-    for (int col = 0; col < num_cols; ++col) {
-      const int row_offset = (row * num_mi_h) << 2;
-      const int col_offset = (col * num_mi_w) << 2;
-
-      uint8_t *buf = y_buffer + row_offset * y_stride + col_offset;
-      int r = row_offset, pos = 0;
-      const float base = (float)((1 << bit_depth) - 1);
-      while (r < row_offset + (num_mi_h << 2)) {
-        for (int c = 0; c < (num_mi_w << 2); ++c) {
-          input_data[pos++] = bit_depth > 8
-                                  ? (float)*CONVERT_TO_SHORTPTR(buf + c) / base
-                                  : (float)*(buf + c) / base;
+  const int num_cols = (mi_params->mi_cols + num_mi_w - 1) / num_mi_w;
+  const int block_w = num_mi_w << 2;
+  const int block_h = num_mi_h << 2;
+  const int block_pixels = block_w * block_h;
+  const float base = (float)((1 << bit_depth) - 1);
+
+  TfLiteInterpreter *interpreter =
+      get_interpreter(info, worker_id, num_cols, block_pixels);
+  if (interpreter == NULL) return 0;
+  const int batch_size = info->batch_size[worker_id];
+  assert(num_cols % batch_size == 0);
+
+  for (int col0 = 0; col0 < num_cols; col0 += batch_size) {
+    // The input and output tensors may move when the interpreter runs, so
+    // they are looked up for each batch.
+    TfLiteTensor *input_tensor =
+        TfLiteInterpreterGetInputTensor(interpreter, 0);
+    float *input_data = (float *)TfLiteTensorData(input_tensor);
+    if (input_data == NULL) return 0;
+
+    for (int col = col0; col < col0 + batch_size; ++col) {
+      const int row_offset = row * block_h;
+      const int col_offset = col * block_w;
+      const uint8_t *buf = y_buffer + row_offset * y_stride + col_offset;
+      float *dst = input_data + (col - col0) * block_pixels;
+      for (int r = 0; r < block_h; ++r) {
+        if (bit_depth > 8) {
+          const uint16_t *buf16 = CONVERT_TO_SHORTPTR(buf);
+          for (int c = 0; c < block_w; ++c) *dst++ = (float)buf16[c] / base;
+        } else {
+          for (int c = 0; c < block_w; ++c) *dst++ = (float)buf[c] / base;
         }
         buf += y_stride;
-        ++r;
-      }
-      TfLiteTensorCopyFromBuffer(input_tensor, input_data, input_size);
-
-      // Execute inference.
-      if (TfLiteInterpreterInvoke(interpreter) != kTfLiteOk) {
-        TfLiteInterpreterDelete(interpreter);
-        TfLiteInterpreterOptionsDelete(options);
-        TfLiteModelDelete(model);
-        return 1;
-      }
-
-      // Extract the output tensor data.
-      const TfLiteTensor *output_tensor =
-          TfLiteInterpreterGetOutputTensor(interpreter, 0);
-      if (output_tensor == NULL) {
-        TfLiteInterpreterDelete(interpreter);
-        TfLiteInterpreterOptionsDelete(options);
-        TfLiteModelDelete(model);
-        return 1;
       }
+    }
 
-      size_t output_size = TfLiteTensorByteSize(output_tensor);
-      float output_data[2];
+    // Execute inference.
+    if (TfLiteInterpreterInvoke(interpreter) != kTfLiteOk) return 0;
+
+    const TfLiteTensor *output_tensor =
+        TfLiteInterpreterGetOutputTensor(interpreter, 0);
+    const float *output_data =
+        output_tensor ? (const float *)TfLiteTensorData(output_tensor) : NULL;
+    if (output_data == NULL) return 0;
+    for (int i = 0; i < batch_size; ++i) {
+      const int index = row * num_cols + col0 + i;
+      info->sb_delta_q[0][index] = output_data[2 * i];
+      info->sb_delta_q[1][index] = output_data[2 * i + 1];
+    }
+  }
+  return 1;
+}
+#else  // !CONFIG_TFLITE
+// Approximates the model change between current version (Spet 2021) and the
+// baseline (July 2021).
+static const double ur_model_change[] = { 3.0, 3.0 };
+// The following parameters are fitted from user labeled data.
+static const double ur_a[] = { -24.50 * 4.0, -17.20 * 4.0 };
+static const double ur_b[] = { 0.004898, 0.003093 };
+static const double ur_c[] = { (29.932 + ur_model_change[0]) * 4.0,
+                               (42.100 + ur_model_change[1]) * 4.0 };
+
+static int variance_predict_row(AV1_COMP *cpi, int row) {
+  const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+  const MACROBLOCKD *const xd = &cpi->td.mb.e_mbd;
+  UserRatingDeltaqInfo *const info = &cpi->ur_deltaq;
+  uint8_t *y_buffer = cpi->source->y_buffer;
+  const int y_stride = cpi->source->y_stride;
+  const int block_size = cpi->common.seq_params->sb_size;
+  const int num_mi_w = mi_size_wide[block_size];
+  const int num_mi_h = mi_size_high[block_size];
+  const int num_cols = (mi_params->mi_cols + num_mi_w - 1) / num_mi_w;
 
-      TfLiteTensorCopyToBuffer(output_tensor, output_data, output_size);
-      predicts0[row * num_cols + col] = output_data[0];
-      predicts1[row * num_cols + col] = output_data[1];
+  for (int col = 0; col < num_cols; ++col) {
+    double var = 0.0, num_of_var = 0.0;
+    const int index = row * num_cols + col;
+
+    // Loop through each 8x8 block.
+    for (int mi_row = row * num_mi_h;
+         mi_row < mi_params->mi_rows && mi_row < (row + 1) * num_mi_h;
+         mi_row += 2) {
+      for (int mi_col = col * num_mi_w;
+           mi_col < mi_params->mi_cols && mi_col < (col + 1) * num_mi_w;
+           mi_col += 2) {
+        struct buf_2d buf;
+        const int row_offset_y = mi_row << 2;
+        const int col_offset_y = mi_col << 2;
+
+        buf.buf = y_buffer + row_offset_y * y_stride + col_offset_y;
+        buf.stride = y_stride;
+
+        unsigned int block_variance;
+        block_variance = av1_get_perpixel_variance_facade(
+            cpi, xd, &buf, BLOCK_8X8, AOM_PLANE_Y);
+
+        block_variance = AOMMAX(block_variance, 1);
+        var += log((double)block_variance);
+        num_of_var += 1.0;
+      }
+    }
+    var = exp(var / num_of_var);
+    // The predictions are whole numbers.
+    for (int i = 0; i < 2; ++i) {
+      info->sb_delta_q[i][index] =
+          (float)RINT(ur_a[i] * exp(-ur_b[i] * var) + ur_c[i]);
     }
   }
+  return 1;
+}
+#endif  // CONFIG_TFLITE
 
-  // Dispose of the model and interpreter objects.
-  TfLiteInterpreterDelete(interpreter);
-  TfLiteInterpreterOptionsDelete(options);
-  TfLiteModelDelete(model);
-  aom_free(input_data);
-  return 0;
+int av1_set_mb_ur_variance_row(AV1_COMP *cpi, int worker_id, int row) {
+#if CONFIG_TFLITE
+  return model_predict_row(cpi, worker_id, row);
+#else
+  (void)worker_id;
+  return variance_predict_row(cpi, row);
+#endif
 }
 
 void av1_set_mb_ur_variance(AV1_COMP *cpi) {
   const AV1_COMMON *cm = &cpi->common;
   const CommonModeInfoParams *const mi_params = &cm->mi_params;
-  uint8_t *y_buffer = cpi->source->y_buffer;
-  const int y_stride = cpi->source->y_stride;
+  const MultiThreadInfo *const mt_info = &cpi->mt_info;
+  UserRatingDeltaqInfo *const info = &cpi->ur_deltaq;
   const int block_size = cpi->common.seq_params->sb_size;
-  const uint32_t bit_depth = cpi->td.mb.e_mbd.bd;
 
   const int num_mi_w = mi_size_wide[block_size];
   const int num_mi_h = mi_size_high[block_size];
   const int num_cols = (mi_params->mi_cols + num_mi_w - 1) / num_mi_w;
   const int num_rows = (mi_params->mi_rows + num_mi_h - 1) / num_mi_h;
+  const int num_workers = AOMMIN(
+      AOMMIN(mt_info->num_mod_workers[MOD_ENC], mt_info->num_workers),
+      num_rows);
 
-  // TODO(sdeng): fit a better model_1; disable it at this time.
-  float *mb_delta_q0, *mb_delta_q1, delta_q_avg0 = 0.0f;
-  CHECK_MEM_ERROR(cm, mb_delta_q0,
-                  aom_calloc(num_rows * num_cols, sizeof(float)));
-  CHECK_MEM_ERROR(cm, mb_delta_q1,
-                  aom_calloc(num_rows * num_cols, sizeof(float)));
-
-  if (model_predict(block_size, num_cols, num_rows, bit_depth, y_buffer,
-                    y_stride, mb_delta_q0, mb_delta_q1)) {
+  info->error = 0;
+  if (num_workers > 1) {
+    av1_set_mb_ur_variance_mt(cpi, num_workers);
+  } else {
+    for (int row = 0; row < num_rows && !info->error; ++row)
+      info->error = !av1_set_mb_ur_variance_row(cpi, 0, row);
+  }
+  if (info->error) {
     aom_internal_error(cm->error, AOM_CODEC_ERROR,
                        "Failed to call TFlite functions.");
   }
 
+#if CONFIG_TFLITE
+  // TODO(sdeng): fit a better model_1; disable it at this time.
+  const float *mb_delta_q0 = info->sb_delta_q[0];
+  float delta_q_avg0 = 0.0f;
   // Loop through each SB block.
   for (int row = 0; row < num_rows; ++row) {
     for (int col = 0; col < num_cols; ++col) {
@@ -894,73 +1036,14 @@ void av1_set_mb_ur_variance(AV1_COMP *cpi) {
                scaling_factor * (mb_delta_q0[index] - delta_q_avg0));
     }
   }
-
-  aom_free(mb_delta_q0);
-  aom_free(mb_delta_q1);
-}
 #else  // !CONFIG_TFLITE
-void av1_set_mb_ur_variance(AV1_COMP *cpi) {
-  const AV1_COMMON *cm = &cpi->common;
-  const CommonModeInfoParams *const mi_params = &cm->mi_params;
-  const MACROBLOCKD *const xd = &cpi->td.mb.e_mbd;
-  uint8_t *y_buffer = cpi->source->y_buffer;
-  const int y_stride = cpi->source->y_stride;
-  const int block_size = cpi->common.seq_params->sb_size;
-
-  const int num_mi_w = mi_size_wide[block_size];
-  const int num_mi_h = mi_size_high[block_size];
-  const int num_cols = (mi_params->mi_cols + num_mi_w - 1) / num_mi_w;
-  const int num_rows = (mi_params->mi_rows + num_mi_h - 1) / num_mi_h;
-
-  int *mb_delta_q[2];
-  CHECK_MEM_ERROR(cm, mb_delta_q[0],
-                  aom_calloc(num_rows * num_cols, sizeof(*mb_delta_q[0])));
-  CHECK_MEM_ERROR(cm, mb_delta_q[1],
-                  aom_calloc(num_rows * num_cols, sizeof(*mb_delta_q[1])));
-
-  // Approximates the model change between current version (Spet 2021) and the
-  // baseline (July 2021).
-  const double model_change[] = { 3.0, 3.0 };
-  // The following parameters are fitted from user labeled data.
-  const double a[] = { -24.50 * 4.0, -17.20 * 4.0 };
-  const double b[] = { 0.004898, 0.003093 };
-  const double c[] = { (29.932 + model_change[0]) * 4.0,
-                       (42.100 + model_change[1]) * 4.0 };
+  const float *const *mb_delta_q = (const float *const *)info->sb_delta_q;
   int delta_q_avg[2] = { 0, 0 };
-  // Loop through each SB block.
   for (int row = 0; row < num_rows; ++row) {
     for (int col = 0; col < num_cols; ++col) {
-      double var = 0.0, num_of_var = 0.0;
       const int index = row * num_cols + col;
-
-      // Loop through each 8x8 block.
-      for (int mi_row = row * num_mi_h;
-           mi_row < mi_params->mi_rows && mi_row < (row + 1) * num_mi_h;
-           mi_row += 2) {
-        for (int mi_col = col * num_mi_w;
-             mi_col < mi_params->mi_cols && mi_col < (col + 1) * num_mi_w;
-             mi_col += 2) {
-          struct buf_2d buf;
-          const int row_offset_y = mi_row << 2;
-          const int col_offset_y = mi_col << 2;
-
-          buf.buf = y_buffer + row_offset_y * y_stride + col_offset_y;
-          buf.stride = y_stride;
-
-          unsigned int block_variance;
-          block_variance = av1_get_perpixel_variance_facade(
-              cpi, xd, &buf, BLOCK_8X8, AOM_PLANE_Y);
-
-          block_variance = AOMMAX(block_variance, 1);
-          var += log((double)block_variance);
-          num_of_var += 1.0;
-        }
-      }
-      var = exp(var / num_of_var);
-      mb_delta_q[0][index] = RINT(a[0] * exp(-b[0] * var) + c[0]);
-      mb_delta_q[1][index] = RINT(a[1] * exp(-b[1] * var) + c[1]);
-      delta_q_avg[0] += mb_delta_q[0][index];
-      delta_q_avg[1] += mb_delta_q[1][index];
+      delta_q_avg[0] += (int)mb_delta_q[0][index];
+      delta_q_avg[1] += (int)mb_delta_q[1][index];
     }
   }
 
@@ -1000,11 +1083,8 @@ void av1_set_mb_ur_variance(AV1_COMP *cpi) {
       }
     }
   }
-
-  aom_free(mb_delta_q[0]);
-  aom_free(mb_delta_q[1]);
+#endif  // CONFIG_TFLITE
 }
-#endif
 
 int av1_get_sbq_user_rating_based(AV1_COMP *const cpi, int mi_row, int mi_col) {
   const BLOCK_SIZE bsize = cpi->common.seq_params->sb_size;
@@ -37,6 +37,12 @@ int av1_get_sbq_perceptual_ai(AV1_COMP *const cpi, BLOCK_SIZE bsize, int mi_row,
 // User rating based mode
 void av1_init_mb_ur_var_buffer(AV1_COMP *cpi);
 
+void av1_free_mb_ur_var_buffers(UserRatingDeltaqInfo *info);
+
+// Predicts the delta q of the superblocks of a row, using the interpreter of
+// worker 'worker_id' with CONFIG_TFLITE. Returns 0 on failure.
+int av1_set_mb_ur_variance_row(AV1_COMP *cpi, int worker_id, int row);
+
 void av1_set_mb_ur_variance(AV1_COMP *cpi);
 
 int av1_get_sbq_user_rating_based(AV1_COMP *const cpi, int mi_row, int mi_col);
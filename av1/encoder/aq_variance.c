@@ -10,7 +10,9 @@
  */
 
 #include <math.h>
+#include <string.h>
 
+#include "aom_mem/aom_mem.h"
 #include "aom_ports/mem.h"
 
 #include "av1/encoder/aq_variance.h"
@@ -212,6 +214,111 @@ int av1_log_block_avg_hbd(MACROBLOCK *x, BLOCK_SIZE bs) {
   return avg;
 }
 
+// Adds the luma of the four pixel rows of 4x4 block row 'row' to 'cell_sum',
+// one entry per 4x4 block. Pixels past the right and bottom edges of the frame
+// repeat the last column and row, as the extended border of the source does.
+static void accumulate_luma_cell_row(const YV12_BUFFER_CONFIG *src, int row,
+                                     int cols, uint32_t *cell_sum) {
+  const int width = src->y_crop_width;
+  const int height = src->y_crop_height;
+  const int full_cols = AOMMIN(cols, width >> 2);
+
+  memset(cell_sum, 0, cols * sizeof(*cell_sum));
+  for (int i = 0; i < 4; ++i) {
+    const int y = AOMMIN(row * 4 + i, height - 1);
+    if (src->flags & YV12_FLAG_HIGHBITDEPTH) {
+      const uint16_t *p =
+          CONVERT_TO_SHORTPTR(src->y_buffer) + y * src->y_stride;
+      for (int c = 0; c < full_cols; ++c) {
+        cell_sum[c] += p[4 * c] + p[4 * c + 1] + p[4 * c + 2] + p[4 * c + 3];
+      }
+      for (int c = full_cols; c < cols; ++c) {
+        for (int j = 0; j < 4; ++j) {
+          cell_sum[c] += p[AOMMIN(4 * c + j, width - 1)];
+        }
+      }
+    } else {
+      const uint8_t *p = src->y_buffer + y * src->y_stride;
+      for (int c = 0; c < full_cols; ++c) {
+        cell_sum[c] += p[4 * c] + p[4 * c + 1] + p[4 * c + 2] + p[4 * c + 3];
+      }
+      for (int c = full_cols; c < cols; ++c) {
+        for (int j = 0; j < 4; ++j) {
+          cell_sum[c] += p[AOMMIN(4 * c + j, width - 1)];
+        }
+      }
+    }
+  }
+}
+
+static int luma_stats_needed(const AV1_COMP *cpi) {
+  const AV1EncoderConfig *const oxcf = &cpi->oxcf;
+  const DeltaQInfo *const delta_q_info = &cpi->common.delta_q_info;
+  if (oxcf->luma_bias != 0 || (oxcf->tune_cfg.content == AOM_CONTENT_PSY &&
+                               oxcf->luma_bias_override == 0)) {
+    return 1;
+  }
+  return delta_q_info->delta_q_present_flag &&
+         ((oxcf->q_cfg.deltaq_mode == DELTA_Q_LAVISH &&
+           oxcf->algo_cfg.enable_tpl_model) ||
+          oxcf->q_cfg.enable_hdr_deltaq);
+}
+
+void av1_setup_luma_stats(AV1_COMP *cpi) {
+  AV1_COMMON *const cm = &cpi->common;
+  LumaStats *const stats = &cpi->luma_stats;
+  const int mib_size_log2 = cm->seq_params->mib_size_log2;
+
+  stats->source = NULL;
+  if (!luma_stats_needed(cpi)) return;
+
+  const int rows = ALIGN_POWER_OF_TWO(cm->mi_params.mi_rows, mib_size_log2);
+  const int cols = ALIGN_POWER_OF_TWO(cm->mi_params.mi_cols, mib_size_log2);
+  const int stride = cols + 1;
+  const int size = (rows + 1) * stride;
+  if (size > stats->alloc_size) {
+    aom_free(stats->sum);
+    stats->alloc_size = 0;
+    CHECK_MEM_ERROR(cm, stats->sum, aom_malloc(size * sizeof(*stats->sum)));
+    stats->alloc_size = size;
+  }
+  stats->rows = rows;
+  stats->cols = cols;
+  stats->stride = stride;
+
+  uint32_t *const sum = stats->sum;
+  memset(sum, 0, stride * sizeof(*sum));
+  for (int r = 0; r < rows; ++r) {
+    const uint32_t *const above = sum + r * stride;
+    uint32_t *const cur = sum + (r + 1) * stride;
+    accumulate_luma_cell_row(cpi->source, r, cols, cur + 1);
+    uint32_t row_sum = 0;
+    cur[0] = 0;
+    for (int c = 1; c <= cols; ++c) {
+      row_sum += cur[c];
+      cur[c] = above[c] + row_sum;
+    }
+  }
+  stats->source = cpi->source;
+}
+
+int av1_get_block_luma_avg(const AV1_COMP *cpi, MACROBLOCK *x, int mi_row,
+                           int mi_col, BLOCK_SIZE bs) {
+  const LumaStats *const stats = &cpi->luma_stats;
+  if (stats->source != cpi->source) {
+    return is_cur_buf_hbd(&x->e_mbd) ? av1_log_block_avg_hbd(x, bs)
+                                     : av1_log_block_avg(x, bs);
+  }
+
+  const int bw = mi_size_wide[bs];
+  const int bh = mi_size_high[bs];
+  assert(mi_row + bh <= stats->rows && mi_col + bw <= stats->cols);
+  const uint32_t *const top = stats->sum + mi_row * stats->stride + mi_col;
+  const uint32_t *const bottom = top + bh * stats->stride;
+  const uint32_t sum = bottom[bw] - bottom[0] - top[bw] + top[0];
+  return (int)(sum / (uint32_t)(bw * bh * 16));
+}
+
 #define DEFAULT_E_MIDPOINT 10.0
 
 static unsigned int haar_ac_energy(MACROBLOCK *x, BLOCK_SIZE bs) {
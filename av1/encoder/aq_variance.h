@@ -30,6 +30,16 @@ int av1_block_wavelet_energy_level(const AV1_COMP *cpi, MACROBLOCK *x,
 int av1_log_block_y(MACROBLOCK *x, BLOCK_SIZE bs, bool is_8bit);
 double av1_log_block_wavelet_energy(MACROBLOCK *x, BLOCK_SIZE bs);
 
+// Computes cpi->luma_stats from cpi->source when luma bias or a delta q mode
+// that needs block brightness is active for the current frame, and
+// invalidates it otherwise.
+void av1_setup_luma_stats(AV1_COMP *cpi);
+
+// Returns the average luma of the block at (mi_row, mi_col) in the bit depth of
+// the source, equal to av1_log_block_avg() / av1_log_block_avg_hbd().
+int av1_get_block_luma_avg(const AV1_COMP *cpi, MACROBLOCK *x, int mi_row,
+                           int mi_col, BLOCK_SIZE bs);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
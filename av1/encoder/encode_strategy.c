@@ -1310,7 +1310,7 @@ int av1_encode_strategy(AV1_COMP *const cpi, size_t *const size,
 
   cpi->skip_tpl_setup_stats = 0;
 #if !CONFIG_REALTIME_ONLY
-  if (oxcf->pass != AOM_RC_FIRST_PASS) {
+  if (!is_stat_generation_stage(cpi)) {
     TplParams *const tpl_data = &cpi->ppi->tpl_data;
     if (tpl_data->tpl_stats_pool[0] == NULL) {
       av1_setup_tpl_buffers(cpi->ppi, &cm->mi_params, oxcf->frm_dim_cfg.width,
@@ -1706,7 +1706,8 @@ int av1_encode_strategy(AV1_COMP *const cpi, size_t *const size,
   if (!is_stat_generation_stage(cpi) &&
       ((oxcf->tune_cfg.tuning >= AOM_TUNE_VMAF_WITH_PREPROCESSING &&
        oxcf->tune_cfg.tuning <= AOM_TUNE_VMAF_NEG_MAX_GAIN) ||
-       oxcf->tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+       (oxcf->tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
+        oxcf->tune_cfg.tuning <= AOM_TUNE_FAST_VMAF_PSY_QP) ||
        oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD ||
        oxcf->vmaf_quantization == 1)) {
     av1_update_vmaf_curve(cpi);
@@ -64,6 +64,7 @@
 #include "av1/encoder/partition_model_weights.h"
 #endif
 #include "av1/encoder/partition_search.h"
+#include "av1/encoder/perceptual_map.h"
 #include "av1/encoder/rd.h"
 #include "av1/encoder/rdopt.h"
 #include "av1/encoder/reconinter_enc.h"
@@ -291,7 +292,7 @@ static AOM_INLINE void setup_delta_q(AV1_COMP *const cpi, ThreadData *td,
   } else if (cpi->oxcf.q_cfg.deltaq_mode == DELTA_Q_USER_RATING_BASED) {
     current_qindex = av1_get_sbq_user_rating_based(cpi, mi_row, mi_col);
   } else if (cpi->oxcf.q_cfg.enable_hdr_deltaq) {
-    current_qindex = av1_get_q_for_hdr(cpi, x, sb_size);
+    current_qindex = av1_get_q_for_hdr(cpi, x, sb_size, mi_row, mi_col);
   }
 
   x->rdmult_cur_qindex = current_qindex;
@@ -708,6 +709,51 @@ static void sb_qp_sweep_init_quantizers(AV1_COMP *cpi, ThreadData *td,
   av1_invalid_rd_stats(rd_cost);
 }
 
+// Runs a dry partition search of the superblock with its qindex offset by
+// 'sweep_qp_delta' and returns the rd cost in 'cur_rdc'.
+static void sb_qp_sweep_eval(AV1_COMP *const cpi, ThreadData *td,
+                             TileDataEnc *tile_data, TokenExtra **tp,
+                             int mi_row, int mi_col, BLOCK_SIZE bsize,
+                             SIMPLE_MOTION_DATA_TREE *sms_tree,
+                             SB_FIRST_PASS_STATS *sb_org_stats,
+                             int sweep_qp_delta, RD_STATS *cur_rdc) {
+  AV1_COMMON *const cm = &cpi->common;
+  sb_qp_sweep_init_quantizers(cpi, td, tile_data, sms_tree, cur_rdc, mi_row,
+                              mi_col, sweep_qp_delta);
+
+  const int alloc_mi_idx = get_alloc_mi_idx(&cm->mi_params, mi_row, mi_col);
+  const int backup_current_qindex =
+      cm->mi_params.mi_alloc[alloc_mi_idx].current_qindex;
+
+  av1_reset_mbmi(&cm->mi_params, bsize, mi_row, mi_col);
+  av1_restore_sb_state(sb_org_stats, cpi, td, tile_data, mi_row, mi_col);
+  cm->mi_params.mi_alloc[alloc_mi_idx].current_qindex = backup_current_qindex;
+
+  PC_TREE *const pc_root = av1_alloc_pc_tree_node(bsize);
+  av1_rd_pick_partition(cpi, td, tile_data, tp, mi_row, mi_col, bsize, cur_rdc,
+                        *cur_rdc, pc_root, sms_tree, NULL, SB_DRY_PASS, NULL);
+}
+
+// Returns 1 if the candidate with offset 'sweep_qp_delta' replaces the winner.
+// Ties go to the offset nearest the rdmult qindex.
+static int sb_qp_sweep_update_winner(const MACROBLOCK *x,
+                                     const RD_STATS *cur_rdc,
+                                     int sweep_qp_delta, RD_STATS *rdc_winner,
+                                     int *best_qindex) {
+  if ((rdc_winner->rdcost > cur_rdc->rdcost) ||
+      (abs(sweep_qp_delta) < abs(*best_qindex - x->rdmult_delta_qindex) &&
+       rdc_winner->rdcost == cur_rdc->rdcost)) {
+    *rdc_winner = *cur_rdc;
+    *best_qindex = x->rdmult_delta_qindex + sweep_qp_delta;
+    return 1;
+  }
+  return 0;
+}
+
+// Returns the qindex of the candidate with the lowest rd cost. The candidates
+// are searched one after another on the calling thread. Each dry pass writes
+// the superblock's mode info into the frame mi grid and uses the tile's above
+// contexts, so candidates of the same superblock cannot run concurrently.
 static int sb_qp_sweep(AV1_COMP *const cpi, ThreadData *td,
                        TileDataEnc *tile_data, TokenExtra **tp, int mi_row,
                        int mi_col, BLOCK_SIZE bsize,
@@ -723,29 +769,38 @@ static int sb_qp_sweep(AV1_COMP *const cpi, ThreadData *td,
   const int end = cm->current_frame.frame_type == KEY_FRAME ? 20 : 12;
   const int step = cm->delta_q_info.delta_q_res;
 
-  for (int sweep_qp_delta = start; sweep_qp_delta <= end;
-       sweep_qp_delta += step) {
-    sb_qp_sweep_init_quantizers(cpi, td, tile_data, sms_tree, &cur_rdc, mi_row,
-                                mi_col, sweep_qp_delta);
-
-    const int alloc_mi_idx = get_alloc_mi_idx(&cm->mi_params, mi_row, mi_col);
-    const int backup_current_qindex =
-        cm->mi_params.mi_alloc[alloc_mi_idx].current_qindex;
-
-    av1_reset_mbmi(&cm->mi_params, bsize, mi_row, mi_col);
-    av1_restore_sb_state(sb_org_stats, cpi, td, tile_data, mi_row, mi_col);
-    cm->mi_params.mi_alloc[alloc_mi_idx].current_qindex = backup_current_qindex;
-
-    PC_TREE *const pc_root = av1_alloc_pc_tree_node(bsize);
-    av1_rd_pick_partition(cpi, td, tile_data, tp, mi_row, mi_col, bsize,
-                          &cur_rdc, cur_rdc, pc_root, sms_tree, NULL,
-                          SB_DRY_PASS, NULL);
-
-    if ((rdc_winner.rdcost > cur_rdc.rdcost) ||
-        (abs(sweep_qp_delta) < abs(best_qindex - x->rdmult_delta_qindex) &&
-         rdc_winner.rdcost == cur_rdc.rdcost)) {
-      rdc_winner = cur_rdc;
-      best_qindex = x->rdmult_delta_qindex + sweep_qp_delta;
+  if (cpi->oxcf.sb_qp_sweep == 1) {
+    for (int sweep_qp_delta = start; sweep_qp_delta <= end;
+         sweep_qp_delta += step) {
+      sb_qp_sweep_eval(cpi, td, tile_data, tp, mi_row, mi_col, bsize, sms_tree,
+                       sb_org_stats, sweep_qp_delta, &cur_rdc);
+      sb_qp_sweep_update_winner(x, &cur_rdc, sweep_qp_delta, &rdc_winner,
+                                &best_qindex);
+    }
+    return best_qindex;
+  }
+
+  // The rd cost is close to convex in the qindex. Start from the candidate
+  // nearest the rdmult qindex and walk outwards, giving up on a direction at
+  // the first candidate that loses to the winner.
+  const int num_candidates = (end - start) / step + 1;
+  int center = 0;
+  for (int i = 1; i < num_candidates; ++i) {
+    if (abs(start + i * step) < abs(start + center * step)) center = i;
+  }
+  sb_qp_sweep_eval(cpi, td, tile_data, tp, mi_row, mi_col, bsize, sms_tree,
+                   sb_org_stats, start + center * step, &cur_rdc);
+  sb_qp_sweep_update_winner(x, &cur_rdc, start + center * step, &rdc_winner,
+                            &best_qindex);
+  for (int dir = -1; dir <= 1; dir += 2) {
+    for (int i = center + dir; i >= 0 && i < num_candidates; i += dir) {
+      const int sweep_qp_delta = start + i * step;
+      sb_qp_sweep_eval(cpi, td, tile_data, tp, mi_row, mi_col, bsize, sms_tree,
+                       sb_org_stats, sweep_qp_delta, &cur_rdc);
+      if (!sb_qp_sweep_update_winner(x, &cur_rdc, sweep_qp_delta, &rdc_winner,
+                                     &best_qindex)) {
+        break;
+      }
     }
   }
 
@@ -1622,6 +1677,10 @@ static int allow_deltaq_mode(AV1_COMP *cpi) {
   int sbs_wide = mi_size_wide[sb_size];
   int sbs_high = mi_size_high[sb_size];
 
+  // The tpl sums of each superblock are shared by this pass, the encoding of
+  // the superblocks and all the recode iterations of the frame.
+  av1_tpl_sb_cache_setup(cpi);
+
   int64_t delta_rdcost = 0;
   for (int mi_row = 0; mi_row < cm->mi_params.mi_rows; mi_row += sbs_high) {
     for (int mi_col = 0; mi_col < cm->mi_params.mi_cols; mi_col += sbs_wide) {
@@ -1944,6 +2003,8 @@ static AOM_INLINE void encode_frame_internal(AV1_COMP *cpi) {
   av1_initialize_rd_consts(cpi);
   av1_set_sad_per_bit(cpi, &x->sadperbit, quant_params->base_qindex);
   populate_thresh_to_force_zeromv_skip(cpi);
+  av1_setup_luma_stats(cpi);
+  av1_setup_perceptual_maps(cpi);
 
   enc_row_mt->sync_read_ptr = av1_row_mt_sync_read_dummy;
   enc_row_mt->sync_write_ptr = av1_row_mt_sync_write_dummy;
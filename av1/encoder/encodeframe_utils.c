@@ -15,55 +15,34 @@
 
 #include "av1/encoder/encoder.h"
 #include "av1/encoder/encodeframe_utils.h"
+#include "av1/encoder/perceptual_map.h"
 #include "av1/encoder/rdopt.h"
 #include "aq_variance.h"
 
 void av1_set_ssim_rdmult(const AV1_COMP *const cpi, int *errorperbit,
                          const BLOCK_SIZE bsize, const int mi_row,
                          const int mi_col, int *const rdmult) {
-  const AV1_COMMON *const cm = &cpi->common;
-
-  const int bsize_base = BLOCK_16X16;
-  const int num_mi_w = mi_size_wide[bsize_base];
-  const int num_mi_h = mi_size_high[bsize_base];
-  const int num_cols = (cm->mi_params.mi_cols + num_mi_w - 1) / num_mi_w;
-  const int num_rows = (cm->mi_params.mi_rows + num_mi_h - 1) / num_mi_h;
-  const int num_bcols = (mi_size_wide[bsize] + num_mi_w - 1) / num_mi_w;
-  const int num_brows = (mi_size_high[bsize] + num_mi_h - 1) / num_mi_h;
-  int row, col;
-  double num_of_mi = 0.0;
-  double geom_mean_of_scale = 1.0;
-
-  // To avoid overflow of 'geom_mean_of_scale', bsize_base must be at least
-  // BLOCK_8X8.
-  //
-  // For bsize=BLOCK_128X128 and bsize_base=BLOCK_8X8, the loop below would
-  // iterate 256 times. Considering the maximum value of
-  // cpi->ssim_rdmult_scaling_factors (see av1_set_mb_ssim_rdmult_scaling()),
-  // geom_mean_of_scale can go up to 4.8323^256, which is within DBL_MAX
-  // (maximum value a double data type can hold). If bsize_base is modified to
-  // BLOCK_4X4 (minimum possible block size), geom_mean_of_scale can go up
-  // to 4.8323^1024 and exceed DBL_MAX, resulting in data overflow.
-  assert(bsize_base >= BLOCK_8X8);
+  const PerceptualMapPlane *const plane =
+      &cpi->perceptual_maps[PERCEPTUAL_MAP_SSIM];
   assert(cpi->oxcf.tune_cfg.tuning == AOM_TUNE_SSIM ||
          cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY ||
          cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
          cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH ||
          cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST ||
+         cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD ||
          cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI);
-
-  for (row = mi_row / num_mi_w;
-       row < num_rows && row < mi_row / num_mi_w + num_brows; ++row) {
-    for (col = mi_col / num_mi_h;
-         col < num_cols && col < mi_col / num_mi_h + num_bcols; ++col) {
-      const int index = row * num_cols + col;
-      assert(cpi->ssim_rdmult_scaling_factors[index] != 0.0);
-      geom_mean_of_scale *= cpi->ssim_rdmult_scaling_factors[index];
-      num_of_mi += 1.0;
-    }
-  }
-  geom_mean_of_scale = pow(geom_mean_of_scale * cpi->oxcf.ssim_rd_mult / 100.0, (1.0 / num_of_mi));
-  //printf("weight_mod: %f\n", geom_mean_of_scale);
+  // The SSIM map is set up for every frame of these tunes.
+  assert(plane->valid);
+  // The factors are per 16x16 unit, see av1_set_mb_ssim_rdmult_scaling().
+  assert(plane->unit_mi_log2 >= mi_size_wide_log2[BLOCK_8X8]);
+
+  // Geometric mean of the 16x16 scaling factors covered by the block, with
+  // ssim_rd_mult applied once to their product.
+  int num_of_mi;
+  const double log_sum =
+      av1_perceptual_map_log_sum(plane, bsize, mi_row, mi_col, &num_of_mi);
+  const double geom_mean_of_scale =
+      exp((log_sum + log(cpi->oxcf.ssim_rd_mult / 100.0)) / num_of_mi);
   *rdmult = (int)((double)(*rdmult) * geom_mean_of_scale + 0.5);
   *rdmult = AOMMAX(*rdmult, 0);
   av1_set_error_per_bit(errorperbit, *rdmult);
@@ -965,19 +944,17 @@ void av1_get_tpl_stats_sb(AV1_COMP *cpi, BLOCK_SIZE bsize, int mi_row,
   sb_enc->tpl_data_count = mi_count;
 }
 
-// analysis_type 0: Use mc_dep_cost and intra_cost
-// analysis_type 1: Use count of best inter predictor chosen
-// analysis_type 2: Use cost reduction from intra to inter for best inter
-//                  predictor chosen
-int av1_get_q_for_deltaq_objective(AV1_COMP *const cpi, ThreadData *td,
-                                   int64_t *delta_dist, BLOCK_SIZE bsize,
-                                   int mi_row, int mi_col) {
-  AV1_COMMON *const cm = &cpi->common;
-  assert(IMPLIES(cpi->ppi->gf_group.size > 0,
-                 cpi->gf_frame_index < cpi->ppi->gf_group.size));
-  const int tpl_idx = cpi->gf_frame_index;
-  TplParams *const tpl_data = &cpi->ppi->tpl_data;
+// Computes the sums of the tpl stats of the block at (mi_row, mi_col) used by
+// the objective delta q modes.
+static void compute_tpl_sb_stats(const AV1_COMP *const cpi,
+                                 const TplDepFrame *tpl_frame,
+                                 BLOCK_SIZE bsize, int mi_row, int mi_col,
+                                 TplSbStats *sb_stats) {
+  const AV1_COMMON *const cm = &cpi->common;
+  const TplParams *const tpl_data = &cpi->ppi->tpl_data;
   const uint8_t block_mis_log2 = tpl_data->tpl_stats_block_mis_log2;
+  const TplDepStats *tpl_stats = tpl_frame->tpl_stats_ptr;
+  const int tpl_stride = tpl_frame->stride;
   double intra_cost = 0;
   double mc_dep_reg = 0;
   double mc_dep_cost = 0;
@@ -987,14 +964,6 @@ int av1_get_q_for_deltaq_objective(AV1_COMP *const cpi, ThreadData *td,
   double srcrf_rate = 0;
   const int mi_wide = mi_size_wide[bsize];
   const int mi_high = mi_size_high[bsize];
-  const int base_qindex = cm->quant_params.base_qindex;
-
-  if (tpl_idx >= MAX_TPL_FRAME_IDX) return base_qindex;
-
-  TplDepFrame *tpl_frame = &tpl_data->tpl_frame[tpl_idx];
-  TplDepStats *tpl_stats = tpl_frame->tpl_stats_ptr;
-  int tpl_stride = tpl_frame->stride;
-  if (!tpl_frame->is_valid) return base_qindex;
 
 #ifndef NDEBUG
   int mi_count = 0;
@@ -1011,7 +980,7 @@ int av1_get_q_for_deltaq_objective(AV1_COMP *const cpi, ThreadData *td,
   for (int row = mi_row; row < mi_row + mi_high; row += row_step) {
     for (int col = mi_col_sr; col < mi_col_end_sr; col += col_step_sr) {
       if (row >= cm->mi_params.mi_rows || col >= mi_cols_sr) continue;
-      TplDepStats *this_stats =
+      const TplDepStats *this_stats =
           &tpl_stats[av1_tpl_ptr_pos(row, col, tpl_stride, block_mis_log2)];
       double cbcmp = (double)this_stats->srcrf_dist;
       int64_t mc_dep_delta =
@@ -1032,6 +1001,106 @@ int av1_get_q_for_deltaq_objective(AV1_COMP *const cpi, ThreadData *td,
   }
   assert(mi_count <= MAX_TPL_BLK_IN_SB * MAX_TPL_BLK_IN_SB);
 
+  sb_stats->intra_cost = intra_cost;
+  sb_stats->mc_dep_cost = mc_dep_cost;
+  sb_stats->mc_dep_reg = mc_dep_reg;
+  sb_stats->cbcmp_base = cbcmp_base;
+  sb_stats->srcrf_dist = srcrf_dist;
+  sb_stats->srcrf_sse = srcrf_sse;
+  sb_stats->srcrf_rate = srcrf_rate;
+}
+
+void av1_tpl_sb_cache_setup(AV1_COMP *const cpi) {
+  AV1_COMMON *const cm = &cpi->common;
+  TplSbCache *const cache = &cpi->tpl_sb_cache;
+  const BLOCK_SIZE sb_size = cm->seq_params->sb_size;
+
+  if (cache->ready && cache->superres_denom == cm->superres_scale_denominator &&
+      cache->sb_size == sb_size && cache->mi_rows == cm->mi_params.mi_rows &&
+      cache->mi_cols == cm->mi_params.mi_cols)
+    return;
+
+  const int mib_size_log2 = mi_size_wide_log2[sb_size];
+  const int sb_cols = CEIL_POWER_OF_TWO(cm->mi_params.mi_cols, mib_size_log2);
+  const int sb_rows = CEIL_POWER_OF_TWO(cm->mi_params.mi_rows, mib_size_log2);
+  const int num_sbs = sb_rows * sb_cols;
+  if (num_sbs > cache->alloc_size) {
+    aom_free(cache->stats);
+    cache->stats = NULL;
+    cache->alloc_size = 0;
+    CHECK_MEM_ERROR(cm, cache->stats,
+                    aom_calloc(num_sbs, sizeof(*cache->stats)));
+    cache->alloc_size = num_sbs;
+  }
+  for (int i = 0; i < num_sbs; ++i) cache->stats[i].valid = 0;
+
+  cache->ready = 1;
+  cache->superres_denom = cm->superres_scale_denominator;
+  cache->sb_size = sb_size;
+  cache->mi_rows = cm->mi_params.mi_rows;
+  cache->mi_cols = cm->mi_params.mi_cols;
+  cache->sb_cols = sb_cols;
+}
+
+// Returns the sums of the tpl stats of the block at (mi_row, mi_col). The sums
+// of superblocks are taken from cpi->tpl_sb_cache when it was set up for this
+// frame, and computed into 'buf' otherwise.
+static const TplSbStats *get_tpl_sb_stats(AV1_COMP *const cpi,
+                                          const TplDepFrame *tpl_frame,
+                                          BLOCK_SIZE bsize, int mi_row,
+                                          int mi_col, TplSbStats *buf) {
+  const AV1_COMMON *const cm = &cpi->common;
+  TplSbCache *const cache = &cpi->tpl_sb_cache;
+  const int mib_size_log2 = mi_size_wide_log2[bsize];
+
+  if (!cache->ready || bsize != cache->sb_size ||
+      cache->superres_denom != cm->superres_scale_denominator ||
+      cache->mi_rows != cm->mi_params.mi_rows ||
+      cache->mi_cols != cm->mi_params.mi_cols) {
+    compute_tpl_sb_stats(cpi, tpl_frame, bsize, mi_row, mi_col, buf);
+    return buf;
+  }
+
+  TplSbStats *sb_stats =
+      &cache->stats[(mi_row >> mib_size_log2) * cache->sb_cols +
+                    (mi_col >> mib_size_log2)];
+  if (!sb_stats->valid) {
+    compute_tpl_sb_stats(cpi, tpl_frame, bsize, mi_row, mi_col, sb_stats);
+    sb_stats->valid = 1;
+  }
+  return sb_stats;
+}
+
+// analysis_type 0: Use mc_dep_cost and intra_cost
+// analysis_type 1: Use count of best inter predictor chosen
+// analysis_type 2: Use cost reduction from intra to inter for best inter
+//                  predictor chosen
+int av1_get_q_for_deltaq_objective(AV1_COMP *const cpi, ThreadData *td,
+                                   int64_t *delta_dist, BLOCK_SIZE bsize,
+                                   int mi_row, int mi_col) {
+  AV1_COMMON *const cm = &cpi->common;
+  assert(IMPLIES(cpi->ppi->gf_group.size > 0,
+                 cpi->gf_frame_index < cpi->ppi->gf_group.size));
+  const int tpl_idx = cpi->gf_frame_index;
+  TplParams *const tpl_data = &cpi->ppi->tpl_data;
+  TplSbStats sb_stats_buf;
+  const int base_qindex = cm->quant_params.base_qindex;
+
+  if (tpl_idx >= MAX_TPL_FRAME_IDX) return base_qindex;
+
+  TplDepFrame *tpl_frame = &tpl_data->tpl_frame[tpl_idx];
+  if (!tpl_frame->is_valid) return base_qindex;
+
+  const TplSbStats *sb_stats =
+      get_tpl_sb_stats(cpi, tpl_frame, bsize, mi_row, mi_col, &sb_stats_buf);
+  const double intra_cost = sb_stats->intra_cost;
+  const double mc_dep_cost = sb_stats->mc_dep_cost;
+  const double mc_dep_reg = sb_stats->mc_dep_reg;
+  const double cbcmp_base = sb_stats->cbcmp_base;
+  const double srcrf_dist = sb_stats->srcrf_dist;
+  const double srcrf_sse = sb_stats->srcrf_sse;
+  const double srcrf_rate = sb_stats->srcrf_rate;
+
   int offset = 0;
   double beta = 1.0;
   double rk;
@@ -1076,12 +1145,13 @@ static const int hdr10_qp_offset[HDR_QP_LEVELS] = { 3,  2,  1,  0,  -1,
                                                     -2, -3, -4, -5, -6 };
 
 int av1_get_q_for_hdr(AV1_COMP *const cpi, MACROBLOCK *const x,
-                      BLOCK_SIZE bsize) {
+                      BLOCK_SIZE bsize, int mi_row, int mi_col) {
   AV1_COMMON *const cm = &cpi->common;
   assert(cm->seq_params->bit_depth == AOM_BITS_10);
 
   // calculate pixel average
-  const int block_luma_avg = av1_log_block_avg_hbd(x, bsize);
+  const int block_luma_avg =
+      av1_get_block_luma_avg(cpi, x, mi_row, mi_col, bsize);
   // adjust offset based on average of the pixel block
   int offset = 0;
   for (int i = 0; i < HDR_QP_LEVELS; i++) {
@@ -1115,16 +1185,7 @@ int av1_get_q_for_deltaq_lavish(AV1_COMP *const cpi, ThreadData *td,
                  cpi->gf_frame_index < cpi->ppi->gf_group.size));
   const int tpl_idx = cpi->gf_frame_index;
   TplParams *const tpl_data = &cpi->ppi->tpl_data;
-  const uint8_t block_mis_log2 = tpl_data->tpl_stats_block_mis_log2;
-  double intra_cost = 0;
-  double mc_dep_reg = 0;
-  double mc_dep_cost = 0;
-  double cbcmp_base = 1;
-  double srcrf_dist = 0;
-  double srcrf_sse = 0;
-  double srcrf_rate = 0;
-  const int mi_wide = mi_size_wide[bsize];
-  const int mi_high = mi_size_high[bsize];
+  TplSbStats sb_stats_buf;
   int base_qindex = cm->quant_params.base_qindex;
   //base_qindex -= (int)(cm->quant_params.base_qindex / 2 * (1 - log(1 + av1_log_block_wavelet_energy(x, bsize))));
   base_qindex -= cm->quant_params.base_qindex * ((2000 / (av1_log_block_y(x, bsize, cm->seq_params->bit_depth == AOM_BITS_8) + 85)) - 10) / 14;
@@ -1132,8 +1193,6 @@ int av1_get_q_for_deltaq_lavish(AV1_COMP *const cpi, ThreadData *td,
   if (tpl_idx >= MAX_TPL_FRAME_IDX) return base_qindex;
 
   TplDepFrame *tpl_frame = &tpl_data->tpl_frame[tpl_idx];
-  TplDepStats *tpl_stats = tpl_frame->tpl_stats_ptr;
-  int tpl_stride = tpl_frame->stride;
   if (!tpl_frame->is_valid) return base_qindex;
 
   int deltaq_multiplier = 100;
@@ -1141,8 +1200,12 @@ int av1_get_q_for_deltaq_lavish(AV1_COMP *const cpi, ThreadData *td,
   double hdr_offset_double = 0.0;
   int hdr_offset = 0;
 
-  // calculate pixel average
-  const int block_luma_avg = av1_log_block_avg_hbd(x, bsize);
+  // calculate pixel average, on the 10-bit scale of the threshold tables
+  const int bit_depth = cm->seq_params->bit_depth;
+  const int luma_avg = av1_get_block_luma_avg(cpi, x, mi_row, mi_col, bsize);
+  const int block_luma_avg = bit_depth < AOM_BITS_10
+                                 ? luma_avg << (AOM_BITS_10 - bit_depth)
+                                 : luma_avg >> (bit_depth - AOM_BITS_10);
   // adjust offset based on average of the pixel block
   if (cpi->oxcf.color_cfg.color_primaries == AOM_CICP_CP_BT_2020) {
     for (int i = 0; i < HDR_QP_LEVELS; i++) {
@@ -1183,41 +1246,15 @@ int av1_get_q_for_deltaq_lavish(AV1_COMP *const cpi, ThreadData *td,
   }
   
   base_qindex += hdr_offset;
-#ifndef NDEBUG
-  int mi_count = 0;
-#endif
-  const int mi_col_sr =
-      coded_to_superres_mi(mi_col, cm->superres_scale_denominator);
-  const int mi_col_end_sr =
-      coded_to_superres_mi(mi_col + mi_wide, cm->superres_scale_denominator);
-  const int mi_cols_sr = av1_pixels_to_mi(cm->superres_upscaled_width);
-  const int step = 1 << block_mis_log2;
-  const int row_step = step;
-  const int col_step_sr =
-      coded_to_superres_mi(step, cm->superres_scale_denominator);
-  for (int row = mi_row; row < mi_row + mi_high; row += row_step) {
-    for (int col = mi_col_sr; col < mi_col_end_sr; col += col_step_sr) {
-      if (row >= cm->mi_params.mi_rows || col >= mi_cols_sr) continue;
-      TplDepStats *this_stats =
-          &tpl_stats[av1_tpl_ptr_pos(row, col, tpl_stride, block_mis_log2)];
-      double cbcmp = (double)this_stats->srcrf_dist;
-      int64_t mc_dep_delta =
-          RDCOST(tpl_frame->base_rdmult, this_stats->mc_dep_rate,
-                 this_stats->mc_dep_dist);
-      double dist_scaled = (double)(this_stats->recrf_dist << RDDIV_BITS);
-      intra_cost += log(dist_scaled) * cbcmp;
-      mc_dep_cost += log(dist_scaled + mc_dep_delta) * cbcmp;
-      mc_dep_reg += log(3 * dist_scaled + mc_dep_delta) * cbcmp;
-      srcrf_dist += (double)(this_stats->srcrf_dist << RDDIV_BITS);
-      srcrf_sse += (double)(this_stats->srcrf_sse << RDDIV_BITS);
-      srcrf_rate += (double)(this_stats->srcrf_rate << TPL_DEP_COST_SCALE_LOG2);
-#ifndef NDEBUG
-      mi_count++;
-#endif
-      cbcmp_base += cbcmp;
-    }
-  }
-  assert(mi_count <= MAX_TPL_BLK_IN_SB * MAX_TPL_BLK_IN_SB);
+  const TplSbStats *sb_stats =
+      get_tpl_sb_stats(cpi, tpl_frame, bsize, mi_row, mi_col, &sb_stats_buf);
+  const double intra_cost = sb_stats->intra_cost;
+  const double mc_dep_cost = sb_stats->mc_dep_cost;
+  const double mc_dep_reg = sb_stats->mc_dep_reg;
+  const double cbcmp_base = sb_stats->cbcmp_base;
+  const double srcrf_dist = sb_stats->srcrf_dist;
+  const double srcrf_sse = sb_stats->srcrf_sse;
+  const double srcrf_rate = sb_stats->srcrf_rate;
 
   int offset = 0;
   double beta = 1.0;
@@ -356,6 +356,8 @@ int av1_active_v_edge(const AV1_COMP *cpi, int mi_col, int mi_step);
 void av1_get_tpl_stats_sb(AV1_COMP *cpi, BLOCK_SIZE bsize, int mi_row,
                           int mi_col, SuperBlockEnc *sb_enc);
 
+void av1_tpl_sb_cache_setup(AV1_COMP *const cpi);
+
 int av1_get_q_for_deltaq_objective(AV1_COMP *const cpi, ThreadData *td,
                                    int64_t *delta_dist, BLOCK_SIZE bsize,
                                    int mi_row, int mi_col);
@@ -365,7 +367,7 @@ int av1_get_q_for_deltaq_lavish(AV1_COMP *const cpi, ThreadData *td,
                                    int mi_row, int mi_col, MACROBLOCK *const x);
 
 int av1_get_q_for_hdr(AV1_COMP *const cpi, MACROBLOCK *const x,
-                      BLOCK_SIZE bsize);
+                      BLOCK_SIZE bsize, int mi_row, int mi_col);
 
 int av1_get_cb_rdmult(const AV1_COMP *const cpi, MACROBLOCK *const x,
                       const BLOCK_SIZE bsize, const int mi_row,
@@ -742,6 +742,30 @@ void av1_change_config_seq(struct AV1_PRIMARY *ppi,
   set_primary_rc_buffer_sizes(oxcf, ppi);
 }
 
+// Sets the number of image pyramid levels allocated with each frame buffer.
+// Depends on the speed features, so it is set again once they change.
+static void set_image_pyramid_levels(AV1_COMP *cpi) {
+#if CONFIG_REALTIME_ONLY
+  assert(!cpi->oxcf.tool_cfg.enable_global_motion);
+  cpi->image_pyramid_levels = 0;
+#else
+  const AV1EncoderConfig *const oxcf = &cpi->oxcf;
+  if (oxcf->tool_cfg.enable_global_motion) {
+    cpi->image_pyramid_levels =
+        global_motion_pyr_levels[oxcf->global_motion_method];
+  } else {
+    cpi->image_pyramid_levels = 0;
+  }
+  // The motion search of the temporal filter and tpl shares the pyramids.
+  const int pyramid_search_levels = cpi->sf.mv_sf.pyramid_search_levels;
+  if (pyramid_search_levels > 1 && oxcf->mode == GOOD &&
+      oxcf->gf_cfg.lag_in_frames > 1) {
+    cpi->image_pyramid_levels =
+        AOMMAX(cpi->image_pyramid_levels, pyramid_search_levels);
+  }
+#endif  // CONFIG_REALTIME_ONLY
+}
+
 void av1_change_config(struct AV1_COMP *cpi, const AV1EncoderConfig *oxcf,
                        bool is_sb_size_changed) {
   AV1_COMMON *const cm = &cpi->common;
@@ -919,17 +943,7 @@ void av1_change_config(struct AV1_COMP *cpi, const AV1EncoderConfig *oxcf,
     cpi->oxcf.gf_cfg.lag_in_frames = lap_lag_in_frames;
   }
 
-#if CONFIG_REALTIME_ONLY
-  assert(!oxcf->tool_cfg.enable_global_motion);
-  cpi->image_pyramid_levels = 0;
-#else
-  if (oxcf->tool_cfg.enable_global_motion) {
-    cpi->image_pyramid_levels =
-        global_motion_pyr_levels[oxcf->global_motion_method];
-  } else {
-    cpi->image_pyramid_levels = 0;
-  }
-#endif  // CONFIG_REALTIME_ONLY
+  set_image_pyramid_levels(cpi);
 }
 
 static INLINE void init_frame_info(FRAME_INFO *frame_info,
@@ -958,6 +972,25 @@ static INLINE void update_counters_for_show_frame(AV1_COMP *const cpi) {
   cpi->common.current_frame.frame_number++;
 }
 
+void av1_set_scenecut_detection(AV1_PRIMARY *ppi, int num_lap_buffers) {
+  // For two pass and lag_in_frames > 33 in LAP.
+  ppi->p_rc.enable_scenecut_detection = ENABLE_SCENECUT_MODE_2;
+  if (ppi->lap_enabled) {
+    if ((num_lap_buffers <
+         (MAX_GF_LENGTH_LAP + SCENE_CUT_KEY_TEST_INTERVAL + 1)) &&
+        num_lap_buffers >= (MAX_GF_LENGTH_LAP + 3)) {
+      /*
+       * For lag in frames >= 19 and <33, enable scenecut
+       * with limited future frame prediction.
+       */
+      ppi->p_rc.enable_scenecut_detection = ENABLE_SCENECUT_MODE_1;
+    } else if (num_lap_buffers < (MAX_GF_LENGTH_LAP + 3)) {
+      // Disable scenecut when lag_in_frames < 19.
+      ppi->p_rc.enable_scenecut_detection = DISABLE_SCENECUT;
+    }
+  }
+}
+
 AV1_PRIMARY *av1_create_primary_compressor(
     struct aom_codec_pkt_list *pkt_list_head, int num_lap_buffers,
     const AV1EncoderConfig *oxcf) {
@@ -981,6 +1014,8 @@ AV1_PRIMARY *av1_create_primary_compressor(
   ppi->b_calculate_psnr = CONFIG_INTERNAL_STATS;
   ppi->frames_left = oxcf->input_cfg.limit;
   ppi->num_fp_contexts = 1;
+  aom_get_worker_interface()->init(&ppi->lap_worker);
+  ppi->lap_worker.thread_name = "aom lap worker";
 
   init_config_sequence(ppi, oxcf);
 
@@ -990,22 +1025,7 @@ AV1_PRIMARY *av1_create_primary_compressor(
 
   av1_primary_rc_init(oxcf, &ppi->p_rc);
 
-  // For two pass and lag_in_frames > 33 in LAP.
-  ppi->p_rc.enable_scenecut_detection = ENABLE_SCENECUT_MODE_2;
-  if (ppi->lap_enabled) {
-    if ((num_lap_buffers <
-         (MAX_GF_LENGTH_LAP + SCENE_CUT_KEY_TEST_INTERVAL + 1)) &&
-        num_lap_buffers >= (MAX_GF_LENGTH_LAP + 3)) {
-      /*
-       * For lag in frames >= 19 and <33, enable scenecut
-       * with limited future frame prediction.
-       */
-      ppi->p_rc.enable_scenecut_detection = ENABLE_SCENECUT_MODE_1;
-    } else if (num_lap_buffers < (MAX_GF_LENGTH_LAP + 3)) {
-      // Disable scenecut when lag_in_frames < 19.
-      ppi->p_rc.enable_scenecut_detection = DISABLE_SCENECUT;
-    }
-  }
+  av1_set_scenecut_detection(ppi, num_lap_buffers);
 
 #define BFP(BT, SDF, SDAF, VF, SVF, SVAF, SDX4DF, SDX3DF, JSDAF, JSVAF) \
   ppi->fn_ptr[BT].sdf = SDF;                                            \
@@ -1453,6 +1473,7 @@ AV1_COMP *av1_create_compressor(AV1_PRIMARY *ppi, const AV1EncoderConfig *oxcf,
 
   av1_set_speed_features_framesize_independent(cpi, oxcf->speed);
   av1_set_speed_features_framesize_dependent(cpi, oxcf->speed);
+  set_image_pyramid_levels(cpi);
 
   int max_mi_cols = mi_params->mi_cols;
   int max_mi_rows = mi_params->mi_rows;
@@ -1524,6 +1545,8 @@ AV1_COMP *av1_create_compressor(AV1_PRIMARY *ppi, const AV1EncoderConfig *oxcf,
            sizeof(cpi->butteraugli_info.source));
     memset(&cpi->butteraugli_info.resized_source, 0,
            sizeof(cpi->butteraugli_info.resized_source));
+    memset(&cpi->butteraugli_info.buffers, 0,
+           sizeof(cpi->butteraugli_info.buffers));
     cpi->butteraugli_info.distance = -1.0f;
     cpi->butteraugli_info.recon_set = false;
   }
@@ -1632,6 +1655,7 @@ static AOM_INLINE void free_thread_data(AV1_PRIMARY *ppi) {
     aom_free(thread_data->td->src_var_info_of_4x4_sub_blocks);
     release_obmc_buffers(&thread_data->td->obmc_buffer);
     aom_free(thread_data->td->vt64x64);
+    tf_dealloc_data(&thread_data->td->tf_data);
 
     for (int x = 0; x < 2; x++) {
       for (int y = 0; y < 2; y++) {
@@ -1651,6 +1675,8 @@ static AOM_INLINE void free_thread_data(AV1_PRIMARY *ppi) {
 
 void av1_remove_primary_compressor(AV1_PRIMARY *ppi) {
   if (!ppi) return;
+  aom_get_worker_interface()->end(&ppi->lap_worker);
+  aom_free(ppi->lap_ppi);
 #if !CONFIG_REALTIME_ONLY
   av1_tf_info_free(&ppi->tf_info);
 #endif  // !CONFIG_REALTIME_ONLY
@@ -2132,6 +2158,7 @@ void av1_check_initial_width(AV1_COMP *cpi, int use_highbitdepth,
 
     av1_set_speed_features_framesize_independent(cpi, cpi->oxcf.speed);
     av1_set_speed_features_framesize_dependent(cpi, cpi->oxcf.speed);
+    set_image_pyramid_levels(cpi);
 
     if (!is_stat_generation_stage(cpi)) {
 #if !CONFIG_REALTIME_ONLY
@@ -2612,6 +2639,13 @@ static int encode_without_recode(AV1_COMP *cpi) {
         cpi->image_pyramid_levels);
   }
 
+  // Without a recode loop the TPL reconstruction is the only one available
+  // before the frame is coded.
+  if (oxcf->tune_cfg.tuning == AOM_TUNE_SSIMULACRA2) {
+    cpi->ssimulacra2_info.recon_set = false;
+    av1_setup_ssimulacra2_rdmult_from_tpl(cpi);
+  }
+
   if (cpi->sf.rt_sf.use_temporal_noise_estimate) {
     av1_update_noise_estimate(cpi);
   }
@@ -2849,8 +2883,20 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
   cpi->butteraugli_info.recon_set = false;
   cpi->butteraugli_info.original_qindex = -1;
   bool butteraugli_quantization = cpi->oxcf.butteraugli_quant_mult > 0;
+  // Set when the first rdmult map came from the TPL proxy, which stands in
+  // for the q=96 pre-encode iteration.
+  int butteraugli_proxy_used = 0;
+  // With a tolerance set, qindex is searched from the measured distances and
+  // the loop stops as soon as the target is met.
+  const int butteraugli_converge =
+      butteraugli_quantization && oxcf->butteraugli_tolerance > 0;
+  ButteraugliQSearch butteraugli_search;
+  av1_zero(butteraugli_search);
+  int butteraugli_next_qindex = -1;
 #endif
 
+  cpi->ssimulacra2_info.recon_set = false;
+
   cpi->num_frame_recode = 0;
 
   // Loop variables
@@ -2879,17 +2925,27 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
 
 #if CONFIG_TUNE_BUTTERAUGLI
     if (oxcf->tune_cfg.tuning == AOM_TUNE_BUTTERAUGLI || oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH || oxcf->tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL) {
-      if (loop_count == 0) { // If there hasn't been a loop;
-        av1_setup_butteraugli_source(cpi); // Setup the frame for butteraugli
+      if (loop_count == 0) {
         cpi->butteraugli_info.original_qindex = q; // set stored original_qindex to q
+        butteraugli_proxy_used =
+            oxcf->butteraugli_proxy &&
+            av1_setup_butteraugli_rdmult_from_tpl(
+                cpi, (oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH ||
+                      oxcf->tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL)
+                         ? 0.0
+                         : 0.4);
+      }
+      const int butteraugli_loop = loop_count + butteraugli_proxy_used;
+      if (butteraugli_loop == 0) { // If there hasn't been a loop;
+        av1_setup_butteraugli_source(cpi); // Setup the frame for butteraugli
         q = 96;// if there hasnt been a loop, set q to 96
       } else { // if we'have looped at least once
-        if (butteraugli_quantization && loop_count <= cpi->oxcf.butteraugli_loop_count) { // Between 1 and butteraugli-loop-count
+        if (butteraugli_quantization && butteraugli_loop <= cpi->oxcf.butteraugli_loop_count && !butteraugli_search.converged) { // Between 1 and butteraugli-loop-count
           av1_setup_butteraugli_source(cpi); // setup the recently adjusted frame for re-adjustment with butteraugli
-          cpi->butteraugli_info.original_qindex = av1_get_butteraugli_base_qindex(cpi, cpi->butteraugli_info.original_qindex, cpi->oxcf.butteraugli_quant_mult);
+          cpi->butteraugli_info.original_qindex = butteraugli_next_qindex >= 0 ? butteraugli_next_qindex : av1_get_butteraugli_base_qindex(cpi, cpi->butteraugli_info.original_qindex, cpi->oxcf.butteraugli_quant_mult);
           q = cpi->butteraugli_info.original_qindex;
         } else if (butteraugli_quantization) { // Don't setup source on final butteraugli recode, otherwise a messed up frame gets produced.
-          cpi->butteraugli_info.original_qindex = av1_get_butteraugli_base_qindex(cpi, cpi->butteraugli_info.original_qindex, cpi->oxcf.butteraugli_quant_mult);
+          cpi->butteraugli_info.original_qindex = butteraugli_next_qindex >= 0 ? butteraugli_next_qindex : av1_get_butteraugli_base_qindex(cpi, cpi->butteraugli_info.original_qindex, cpi->oxcf.butteraugli_quant_mult);
           q = cpi->butteraugli_info.original_qindex;
         } else { // If we don't have butteraugli quantization at all
           q = cpi->butteraugli_info.original_qindex;
@@ -2905,6 +2961,10 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
           cpi->image_pyramid_levels);
     }
 
+    if (oxcf->tune_cfg.tuning == AOM_TUNE_SSIMULACRA2 && loop_count == 0) {
+      av1_setup_ssimulacra2_rdmult_from_tpl(cpi);
+    }
+
     int scale_references = 0;
 #if CONFIG_FPMT_TEST
     scale_references =
@@ -2923,7 +2983,8 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
 #if CONFIG_TUNE_VMAF
     if ((oxcf->tune_cfg.tuning >= AOM_TUNE_VMAF_WITH_PREPROCESSING &&
        oxcf->tune_cfg.tuning <= AOM_TUNE_VMAF_NEG_MAX_GAIN) ||
-       (oxcf->tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+       ((oxcf->tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
+        oxcf->tune_cfg.tuning <= AOM_TUNE_FAST_VMAF_PSY_QP) ||
        oxcf->vmaf_quantization == 1)) {
       cpi->vmaf_info.original_qindex = q;
       q = av1_get_vmaf_base_qindex(cpi, q);
@@ -3107,7 +3168,8 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
 #if CONFIG_TUNE_VMAF
     if ((oxcf->tune_cfg.tuning >= AOM_TUNE_VMAF_WITH_PREPROCESSING &&
        oxcf->tune_cfg.tuning <= AOM_TUNE_VMAF_NEG_MAX_GAIN) ||
-       oxcf->tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+       (oxcf->tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
+        oxcf->tune_cfg.tuning <= AOM_TUNE_FAST_VMAF_PSY_QP) ||
        oxcf->vmaf_quantization == 1) {
       q = cpi->vmaf_info.original_qindex;
     }
@@ -3120,7 +3182,7 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
     }
 
 #if CONFIG_TUNE_BUTTERAUGLI
-    if (loop_count <= cpi->oxcf.butteraugli_loop_count && (oxcf->tune_cfg.tuning == AOM_TUNE_BUTTERAUGLI ||
+    if (loop_count + butteraugli_proxy_used <= cpi->oxcf.butteraugli_loop_count && !butteraugli_search.converged && (oxcf->tune_cfg.tuning == AOM_TUNE_BUTTERAUGLI ||
         oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH ||
         oxcf->tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL)) {
       loop = 1;
@@ -3129,10 +3191,24 @@ static int encode_with_recode_loop(AV1_COMP *cpi, size_t *size, uint8_t *dest) {
       } else {
         av1_setup_butteraugli_rdmult_and_restore_source(cpi, 0.4);
       }
+      if (butteraugli_converge) {
+        butteraugli_next_qindex = av1_update_butteraugli_qsearch(
+            cpi, &butteraugli_search, cm->quant_params.base_qindex,
+            cpi->butteraugli_info.original_qindex);
+      }
       //printf("distance: %f\n", cpi->butteraugli_info.distance);
     }
 #endif
 
+    // Without a TPL reconstruction, the first encode stands in for one: its
+    // reconstruction is measured and the frame is coded again with the
+    // resulting rdmult scaling.
+    if (oxcf->tune_cfg.tuning == AOM_TUNE_SSIMULACRA2 &&
+        !cpi->ssimulacra2_info.recon_set && loop_count == 0) {
+      av1_setup_ssimulacra2_rdmult(cpi, &cm->cur_frame->buf);
+      if (cpi->ssimulacra2_info.recon_set) loop = 1;
+    }
+
     if (cpi->use_ducky_encode) {
       // Ducky encode currently does not support recode loop.
       loop = 0;
@@ -3836,6 +3912,9 @@ static int encode_frame_to_data_rate(AV1_COMP *cpi, size_t *size,
            oxcf->tune_cfg.tuning == AOM_TUNE_VMAF_NEG_MAX_GAIN ||
             oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD) {
     av1_set_mb_vmaf_rdmult_scaling(cpi);
+    // The VMAF rdmult is blended with the SSIM one.
+    if (oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD)
+      av1_set_mb_ssim_rdmult_scaling(cpi);
   }
 #endif
 
@@ -4133,7 +4212,8 @@ static int apply_denoise_2d(AV1_COMP *cpi, YV12_BUFFER_CONFIG *sd,
 
 int av1_receive_raw_frame(AV1_COMP *cpi, aom_enc_frame_flags_t frame_flags,
                           YV12_BUFFER_CONFIG *sd, int64_t time_stamp,
-                          int64_t end_time) {
+                          int64_t end_time,
+                          LookaheadFrameRelease *release) {
   AV1_COMMON *const cm = &cpi->common;
   const SequenceHeader *const seq_params = cm->seq_params;
   int res = 0;
@@ -4193,9 +4273,18 @@ int av1_receive_raw_frame(AV1_COMP *cpi, aom_enc_frame_flags_t frame_flags,
   }
 #endif  //  CONFIG_DENOISE
 
+  // The lookahead takes over the frame of 'release' from here on, and
+  // releases it itself if the push fails.
+  LookaheadFrameRelease frame_release;
+  const LookaheadFrameRelease *push_release = NULL;
+  if (release != NULL && release->frame != NULL) {
+    frame_release = *release;
+    release->frame = NULL;
+    push_release = &frame_release;
+  }
   if (av1_lookahead_push(cpi->ppi->lookahead, sd, time_stamp, end_time,
                          use_highbitdepth, cpi->image_pyramid_levels,
-                         frame_flags)) {
+                         frame_flags, push_release)) {
     aom_internal_error(cm->error, AOM_CODEC_ERROR,
                        "av1_lookahead_push() failed");
     res = -1;
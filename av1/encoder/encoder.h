@@ -71,6 +71,10 @@
 #if CONFIG_TUNE_BUTTERAUGLI
 #include "av1/encoder/tune_butteraugli.h"
 #endif
+#include "av1/encoder/tune_ssimulacra2.h"
+#if CONFIG_SALIENCY_MAP
+#include "av1/encoder/saliency_map.h"
+#endif
 
 #include "aom/internal/aom_codec_internal.h"
 #include "aom_util/aom_thread.h"
@@ -1137,6 +1141,14 @@ typedef struct AV1EncoderConfig {
   int butteraugli_quant_mult_pos;
 
   int butteraugli_quant_mult_neg;
+
+  // Use TPL reconstructions as the butteraugli proxy recon (skips the q=96
+  // pre-encode when available).
+  int butteraugli_proxy;
+
+  // Tolerance, in hundredths, around the butteraugli-quant-mult target distance
+  // within which the butteraugli quantization loop stops early. 0 disables.
+  int butteraugli_tolerance;
 #endif
 
   int loopfilter_sharpness;
@@ -1149,6 +1161,10 @@ typedef struct AV1EncoderConfig {
   int vmaf_resize_factor;
 
   int vmaf_rd_mult;
+
+  // Downscaling of the frames scored by the frame-level unsharp strength
+  // search (0: none, 1: half, 2: quarter).
+  int vmaf_probe_resize_factor;
 #endif
 
   int tpl_strength;
@@ -1161,9 +1177,17 @@ typedef struct AV1EncoderConfig {
 
   bool luma_bias_override;
 
+  // Run the LAP stage on its own thread, next to the encode stage.
+  int lap_thread;
+
+  // Number of frames of LAP stats the encode stage sees, when larger than
+  // lag_in_frames. 0 uses lag_in_frames.
+  int lap_window;
+
   int frame_periodic_boost; // Fully implement frame periodic boost from VP9
 
-  // A flag to control if we enable the superblock qp sweep for a given lambda
+  // Superblock qp sweep for a given lambda: 0 off, 1 exhaustive, 2 stops a
+  // direction once the rd cost keeps rising.
   int sb_qp_sweep;
 
   // Selected global motion search method
@@ -2096,6 +2120,20 @@ typedef struct {
   int segment_map_w; /*!< segment map width */
   int segment_map_h; /*!< segment map height */
   /**@}*/
+
+  /*!
+   * Inliers and segment map used by the single-threaded global motion search.
+   * Kept across frames, and reallocated only when the source size changes.
+   */
+  GlobalMotionThreadData thread_data;
+
+  /**
+   * \name Source dimensions for which thread_data is allocated.
+   */
+  /**@{*/
+  int allocated_width;  /*!< allocated source width */
+  int allocated_height; /*!< allocated source height */
+  /**@}*/
 } GlobalMotionInfo;
 
 /*!
@@ -2372,6 +2410,68 @@ typedef struct WeberStats {
   double max_scale;
 } WeberStats;
 
+/*!\cond */
+// Integral image of the luma sums of the 4x4 blocks of the frame being
+// encoded, so the average brightness of any block is an O(1) lookup. Entries
+// wrap modulo 2^32; the sum of any single block always fits in 32 bits, so
+// the difference of four entries is still exact.
+typedef struct {
+  uint32_t *sum;
+  // Size in 4x4 units, padded to whole superblocks.
+  int rows;
+  int cols;
+  int stride;
+  int alloc_size;
+  // Source frame the sums were computed from, or NULL when not set up.
+  const YV12_BUFFER_CONFIG *source;
+} LumaStats;
+
+// State of the user rating based delta q mode (deltaq-mode 4), kept across
+// frames. The superblock rows of a frame are split between the workers.
+typedef struct {
+  // Outputs of the two models for each superblock.
+  float *sb_delta_q[2];
+  int num_sbs;
+  // Set by a worker that failed.
+  int error;
+#if CONFIG_TFLITE
+  // The deltaq4 model, shared by one interpreter per worker. Interpreters are
+  // created on first use, with their input resized to a whole superblock row
+  // when the model allows it.
+  struct TfLiteModel *model;
+  struct TfLiteInterpreterOptions *options;
+  struct TfLiteInterpreter *interpreter[MAX_NUM_THREADS];
+  // Superblocks per Invoke, and the row width it was chosen for.
+  int batch_size[MAX_NUM_THREADS];
+  int batch_cols[MAX_NUM_THREADS];
+#endif
+} UserRatingDeltaqInfo;
+
+// Perceptual rdmult maps, each a grid of per-unit scaling factors owned by a
+// tune. See perceptual_map.h.
+enum {
+  PERCEPTUAL_MAP_SSIM,
+  PERCEPTUAL_MAP_VMAF,
+  PERCEPTUAL_MAP_BUTTERAUGLI,
+  PERCEPTUAL_MAP_SSIMULACRA2,
+  PERCEPTUAL_MAPS
+};
+
+// Integral image of the log scaling factors of one map, so the geometric mean
+// of the map over any block is an O(1) lookup.
+typedef struct {
+  // (rows + 1) x (cols + 1) sums, with a zero first row and column.
+  double *log_sum;
+  int alloc_size;
+  int rows;
+  int cols;
+  // Size of a map unit in mi.
+  int unit_mi_log2;
+  // Set when the map holds the factors of the frame being encoded.
+  int valid;
+} PerceptualMapPlane;
+/*!\endcond */
+
 typedef struct {
   struct loopfilter lf;
   CdefInfo cdef_info;
@@ -2676,6 +2776,33 @@ typedef struct AV1_PRIMARY {
    */
   struct AV1_COMP *cpi_lap;
 
+  /*!
+   * Worker that runs the LAP stage when oxcf.lap_thread is set.
+   */
+  AVxWorker lap_worker;
+
+  /*!
+   * Data of the LAP stage call run by lap_worker.
+   */
+  AV1_COMP_DATA lap_data;
+
+  /*!
+   * Status returned by the LAP stage call run by lap_worker.
+   */
+  int lap_status;
+
+  /*!
+   * Set from av1_launch_lap_stage() until av1_finish_lap_stage().
+   */
+  int lap_running;
+
+  /*!
+   * Copy of the fields of this struct the LAP stage reads, taken at
+   * av1_launch_lap_stage(), while the encode stage updates the GF group and
+   * rate control state.
+   */
+  struct AV1_PRIMARY *lap_ppi;
+
   /*!
    * Look-ahead context.
    */
@@ -3007,6 +3134,12 @@ typedef struct AV1_COMP {
    */
   double *tpl_rdmult_scaling_factors;
 
+  /*!
+   * Per superblock sums of the tpl stats used by the objective delta q modes,
+   * kept across the recode iterations of a frame.
+   */
+  TplSbCache tpl_sb_cache;
+
   /*!
    * Temporal filter context.
    */
@@ -3388,6 +3521,11 @@ typedef struct AV1_COMP {
   TuneButteraugliInfo butteraugli_info;
 #endif
 
+  /*!
+   * Parameters for SSIMULACRA2 tuning.
+   */
+  TuneSsimulacra2Info ssimulacra2_info;
+
   /*!
    * Parameters for scalable video coding.
    */
@@ -3512,6 +3650,16 @@ typedef struct AV1_COMP {
    */
   WeberStats *mb_weber_stats;
 
+  /*!
+   * Per-frame luma sums used by luma bias and the lavish/HDR delta q modes.
+   */
+  LumaStats luma_stats;
+
+  /*!
+   * Integral images of the perceptual rdmult maps used by the tune.
+   */
+  PerceptualMapPlane perceptual_maps[PERCEPTUAL_MAPS];
+
   /*!
    * Buffer to store rate cost estimates for each macro block (8x8) in the
    * preprocessing stage used in allintra mode.
@@ -3544,6 +3692,11 @@ typedef struct AV1_COMP {
    */
   int *mb_delta_q;
 
+  /*!
+   * Model outputs and interpreters of delta-q mode 4.
+   */
+  UserRatingDeltaqInfo ur_deltaq;
+
   /*!
    * Flag to indicate that current frame is dropped.
    */
@@ -3568,6 +3721,23 @@ typedef struct AV1_COMP {
    */
   TWO_PASS_FRAME twopass_frame;
 
+  /*!
+   * Keep the first pass stats of the frame in deferred_fp_stats instead of
+   * adding them to the stats buffer. Set for a LAP stage that runs on its own
+   * thread, so that the buffer is only changed by the encode stage.
+   */
+  int defer_fp_stats;
+
+  /*!
+   * Whether deferred_fp_stats holds stats not yet added to the buffer.
+   */
+  int has_deferred_fp_stats;
+
+  /*!
+   * First pass stats of the last frame when defer_fp_stats is set.
+   */
+  FIRSTPASS_STATS deferred_fp_stats;
+
   /*!
    * Context needed for third pass encoding.
    */
@@ -3627,6 +3797,11 @@ typedef struct AV1_COMP {
    * Superblock level rdmult scaling factor driven by saliency map.
    */
   double *sm_scaling_factor;
+
+  /*!
+   * Buffers of the saliency map computation, kept across frames.
+   */
+  SaliencyMapBuffers saliency_bufs;
 #endif
 
   /*!
@@ -3716,6 +3891,9 @@ struct AV1_COMP *av1_create_compressor(AV1_PRIMARY *ppi,
                                        COMPRESSOR_STAGE stage,
                                        int lap_lag_in_frames);
 
+// Sets the scene cut detection mode the number of LAP buffers allows.
+void av1_set_scenecut_detection(AV1_PRIMARY *ppi, int num_lap_buffers);
+
 struct AV1_PRIMARY *av1_create_primary_compressor(
     struct aom_codec_pkt_list *pkt_list_head, int num_lap_buffers,
     const AV1EncoderConfig *oxcf);
@@ -3776,15 +3954,20 @@ int av1_init_parallel_frame_context(const AV1_COMP_DATA *const first_cpi_data,
  * \param[in,out] sd             Contain raw frame data
  * \param[in]     time_stamp     Time stamp of the frame
  * \param[in]     end_time_stamp End time stamp
+ * \param[in,out] release        Release callback when the caller hands over
+ *                               the frame, or NULL. Its frame is cleared
+ *                               once the lookahead has taken it over
  *
  * \return Returns a value to indicate if the frame data is received
  * successfully.
- * \note The caller can assume that a copy of this frame is made and not just a
- * copy of the pointer.
+ * \note Without \p release the caller can assume that a copy of this frame is
+ * made and not just a copy of the pointer. With it, the frame may be
+ * referenced until \p release is called; see av1_lookahead_push().
  */
 int av1_receive_raw_frame(AV1_COMP *cpi, aom_enc_frame_flags_t frame_flags,
                           YV12_BUFFER_CONFIG *sd, int64_t time_stamp,
-                          int64_t end_time_stamp);
+                          int64_t end_time_stamp,
+                          LookaheadFrameRelease *release);
 
 /*!\brief Encode a frame
  *
@@ -12,11 +12,14 @@
 #ifndef AOM_AV1_ENCODER_ENCODER_ALLOC_H_
 #define AOM_AV1_ENCODER_ENCODER_ALLOC_H_
 
+#include "av1/encoder/allintra_vis.h"
 #include "av1/encoder/block.h"
 #include "av1/encoder/encoder.h"
 #include "av1/encoder/encodetxb.h"
 #include "av1/encoder/ethread.h"
+#include "av1/encoder/global_motion_facade.h"
 #include "av1/encoder/intra_mode_search_utils.h"
+#include "av1/encoder/perceptual_map.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -200,6 +203,13 @@ static AOM_INLINE void dealloc_compressor_data(AV1_COMP *cpi) {
   aom_free(cpi->tpl_rdmult_scaling_factors);
   cpi->tpl_rdmult_scaling_factors = NULL;
 
+  aom_free(cpi->tpl_sb_cache.stats);
+  av1_zero(cpi->tpl_sb_cache);
+
+  aom_free(cpi->luma_stats.sum);
+  av1_zero(cpi->luma_stats);
+  av1_free_perceptual_maps(cpi->perceptual_maps);
+
 #if CONFIG_TUNE_VMAF
   aom_free(cpi->vmaf_info.rdmult_scaling_factors);
   cpi->vmaf_info.rdmult_scaling_factors = NULL;
@@ -211,11 +221,15 @@ static AOM_INLINE void dealloc_compressor_data(AV1_COMP *cpi) {
   cpi->butteraugli_info.rdmult_scaling_factors = NULL;
   aom_free_frame_buffer(&cpi->butteraugli_info.source);
   aom_free_frame_buffer(&cpi->butteraugli_info.resized_source);
+  aom_free_butteraugli_buffers(&cpi->butteraugli_info.buffers);
 #endif
 
+  av1_free_ssimulacra2_info(&cpi->ssimulacra2_info);
+
 #if CONFIG_SALIENCY_MAP
   aom_free(cpi->saliency_map);
   aom_free(cpi->sm_scaling_factor);
+  av1_free_saliency_map_buffers(&cpi->saliency_bufs);
 #endif
 
   release_obmc_buffers(&cpi->td.mb.obmc_buffer);
@@ -256,6 +270,7 @@ static AOM_INLINE void dealloc_compressor_data(AV1_COMP *cpi) {
 
   av1_free_pmc(cpi->td.firstpass_ctx, av1_num_planes(cm));
   cpi->td.firstpass_ctx = NULL;
+  tf_dealloc_data(&cpi->td.tf_data);
 
   av1_free_txb_buf(cpi);
   av1_free_context_buffers(cm);
@@ -263,6 +278,7 @@ static AOM_INLINE void dealloc_compressor_data(AV1_COMP *cpi) {
   aom_free_frame_buffer(&cpi->last_frame_uf);
 #if !CONFIG_REALTIME_ONLY
   av1_free_restoration_buffers(cm);
+  av1_dealloc_global_motion_data(cpi);
 #endif
 
   if (!is_stat_generation_stage(cpi)) {
@@ -326,6 +342,7 @@ static AOM_INLINE void dealloc_compressor_data(AV1_COMP *cpi) {
 
   aom_free(cpi->mb_delta_q);
   cpi->mb_delta_q = NULL;
+  av1_free_mb_ur_var_buffers(&cpi->ur_deltaq);
 }
 
 static AOM_INLINE void allocate_gradient_info_for_hog(AV1_COMP *cpi) {
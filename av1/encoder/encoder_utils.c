@@ -16,6 +16,7 @@
 #include "av1/encoder/encoder.h"
 #include "av1/encoder/encoder_alloc.h"
 #include "av1/encoder/encodetxb.h"
+#include "av1/encoder/ethread.h"
 #include "av1/encoder/encoder_utils.h"
 #include "av1/encoder/grain_test_vectors.h"
 #include "av1/encoder/mv_prec.h"
@@ -541,6 +542,7 @@ void av1_set_size_dependent_vars(AV1_COMP *cpi, int *q, int *bottom_index,
 
 #if !CONFIG_REALTIME_ONLY
   GF_GROUP *gf_group = &cpi->ppi->gf_group;
+  cpi->tpl_sb_cache.ready = 0;
   if (cpi->oxcf.algo_cfg.enable_tpl_model &&
       av1_tpl_stats_ready(&cpi->ppi->tpl_data, cpi->gf_frame_index)) {
     process_tpl_stats_frame(cpi);
@@ -1292,7 +1294,7 @@ int av1_is_integer_mv(const YV12_BUFFER_CONFIG *cur_picture,
   return 0;
 }
 
-void av1_set_mb_ssim_rdmult_scaling(AV1_COMP *cpi) {
+void av1_set_mb_ssim_rdmult_scaling_row(const AV1_COMP *cpi, int row) {
   const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
   const MACROBLOCKD *const xd = &cpi->td.mb.e_mbd;
   uint8_t *y_buffer = cpi->source->y_buffer;
@@ -1302,83 +1304,106 @@ void av1_set_mb_ssim_rdmult_scaling(AV1_COMP *cpi) {
   const int num_mi_w = mi_size_wide[block_size];
   const int num_mi_h = mi_size_high[block_size];
   const int num_cols = (mi_params->mi_cols + num_mi_w - 1) / num_mi_w;
-  const int num_rows = (mi_params->mi_rows + num_mi_h - 1) / num_mi_h;
-  double log_sum = 0.0;
 
-  // Loop through each 16x16 block.
-  for (int row = 0; row < num_rows; ++row) {
-    for (int col = 0; col < num_cols; ++col) {
-      double var = 0.0, num_of_var = 0.0, var_log = 0.0;
-      const int index = row * num_cols + col;
-
-      // Loop through each 8x8 block.
-      for (int mi_row = row * num_mi_h;
-           mi_row < mi_params->mi_rows && mi_row < (row + 1) * num_mi_h;
-           mi_row += 2) {
-        for (int mi_col = col * num_mi_w;
-             mi_col < mi_params->mi_cols && mi_col < (col + 1) * num_mi_w;
-             mi_col += 2) {
-          struct buf_2d buf;
-          const int row_offset_y = mi_row << 2;
-          const int col_offset_y = mi_col << 2;
-
-          buf.buf = y_buffer + row_offset_y * y_stride + col_offset_y;
-          buf.stride = y_stride;
-
-          double blk_var;
-          blk_var = av1_get_perpixel_variance_facade(cpi, xd, &buf, BLOCK_8X8,
-                                                  AOM_PLANE_Y);
-          var_log += log(AOMMAX(blk_var, 1));
-          var += blk_var;
-          num_of_var += 1.0;
-        }
+  // Loop through each 16x16 block of the row.
+  for (int col = 0; col < num_cols; ++col) {
+    double var = 0.0, num_of_var = 0.0, var_log = 0.0;
+    const int index = row * num_cols + col;
+
+    // Loop through each 8x8 block.
+    for (int mi_row = row * num_mi_h;
+         mi_row < mi_params->mi_rows && mi_row < (row + 1) * num_mi_h;
+         mi_row += 2) {
+      for (int mi_col = col * num_mi_w;
+           mi_col < mi_params->mi_cols && mi_col < (col + 1) * num_mi_w;
+           mi_col += 2) {
+        struct buf_2d buf;
+        const int row_offset_y = mi_row << 2;
+        const int col_offset_y = mi_col << 2;
+
+        buf.buf = y_buffer + row_offset_y * y_stride + col_offset_y;
+        buf.stride = y_stride;
+
+        double blk_var;
+        blk_var = av1_get_perpixel_variance_facade(cpi, xd, &buf, BLOCK_8X8,
+                                                AOM_PLANE_Y);
+        var_log += log(AOMMAX(blk_var, 1));
+        var += blk_var;
+        num_of_var += 1.0;
       }
-      if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI) {
-        int cq_level = cpi->oxcf.rc_cfg.cq_level;
-        double hq_level = 30 * 4;
-        double delta;
-        if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH ||
-        cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST) { // Sharper RD to mix with Butteraugli
-          cq_level = *xd->qindex;
-          delta =
-            cq_level < hq_level
-                ? 0.25 * (double)(hq_level - cq_level) / hq_level
-                : 3.333 * (double)(cq_level - hq_level) / (MAXQ - hq_level);
-        } else { // SSIM and others
-          delta =
-            cq_level < hq_level
-                ? 0.5 * (double)(hq_level - cq_level) / hq_level
-                : 10.0 * (double)(cq_level - hq_level) / (MAXQ - hq_level);
-        }
-        if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI) {
-          var = var / pow(num_of_var, 2.);
-          var = 67.035434 * sqrt((1 - exp(-0.0021489 * pow(var, 2.)))) + 17.492222;
-          //printf("var: %f", var);
-        } else {
-          // Curve fitting with an exponential model on user rating dataset.
-          var = exp(var_log / num_of_var);
-          var = 39.126 * (1 - exp(-0.0009413 * var)) + 1.236 + delta;
-        }
+    }
+    if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY ||
+    cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+    cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH ||
+    cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST ||
+    cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI) {
+      int cq_level = cpi->oxcf.rc_cfg.cq_level;
+      double hq_level = 30 * 4;
+      double delta;
+      if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH ||
+      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST) { // Sharper RD to mix with Butteraugli
+        cq_level = *xd->qindex;
+        delta =
+          cq_level < hq_level
+              ? 0.25 * (double)(hq_level - cq_level) / hq_level
+              : 3.333 * (double)(cq_level - hq_level) / (MAXQ - hq_level);
+      } else { // SSIM and others
+        delta =
+          cq_level < hq_level
+              ? 0.5 * (double)(hq_level - cq_level) / hq_level
+              : 10.0 * (double)(cq_level - hq_level) / (MAXQ - hq_level);
+      }
+      if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI) {
+        var = var / pow(num_of_var, 2.);
+        var = 67.035434 * sqrt((1 - exp(-0.0021489 * pow(var, 2.)))) + 17.492222;
+        //printf("var: %f", var);
       } else {
-        var = var / num_of_var;
-        // Curve fitting with an exponential model on all 16x16 blocks from the
-        // midres dataset.
-        var = 67.035434 * (1 - exp(-0.0021489 * var)) + 17.492222;
-        // As per the above computation, var will be in the range of
-        // [17.492222, 84.527656], assuming the data type is of infinite
-        // precision. The following assert conservatively checks if var is in the
-        // range of [17.0, 85.0] to avoid any issues due to the precision of the
-        // relevant data type.
-        assert(var > 17.0 && var < 85.0);
+        // Curve fitting with an exponential model on user rating dataset.
+        var = exp(var_log / num_of_var);
+        var = 39.126 * (1 - exp(-0.0009413 * var)) + 1.236 + delta;
       }
-      cpi->ssim_rdmult_scaling_factors[index] = var;
-      log_sum += log(var);
+    } else {
+      var = var / num_of_var;
+      // Curve fitting with an exponential model on all 16x16 blocks from the
+      // midres dataset.
+      var = 67.035434 * (1 - exp(-0.0021489 * var)) + 17.492222;
+      // As per the above computation, var will be in the range of
+      // [17.492222, 84.527656], assuming the data type is of infinite
+      // precision. The following assert conservatively checks if var is in the
+      // range of [17.0, 85.0] to avoid any issues due to the precision of the
+      // relevant data type.
+      assert(var > 17.0 && var < 85.0);
     }
+    cpi->ssim_rdmult_scaling_factors[index] = var;
+  }
+}
+
+void av1_set_mb_ssim_rdmult_scaling(AV1_COMP *cpi) {
+  const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+  const MultiThreadInfo *const mt_info = &cpi->mt_info;
+  const int block_size = BLOCK_16X16;
+
+  const int num_mi_w = mi_size_wide[block_size];
+  const int num_mi_h = mi_size_high[block_size];
+  const int num_cols = (mi_params->mi_cols + num_mi_w - 1) / num_mi_w;
+  const int num_rows = (mi_params->mi_rows + num_mi_h - 1) / num_mi_h;
+  const int num_workers = AOMMIN(
+      AOMMIN(mt_info->num_mod_workers[MOD_ENC], mt_info->num_workers),
+      num_rows);
+
+  if (num_workers > 1) {
+    av1_set_mb_ssim_rdmult_scaling_mt(cpi, num_workers);
+  } else {
+    for (int row = 0; row < num_rows; ++row)
+      av1_set_mb_ssim_rdmult_scaling_row(cpi, row);
   }
+
+  // The normalisation needs the factors of the whole frame (or superblock),
+  // so it runs once all rows are done.
+  double log_sum = 0.0;
+  for (int index = 0; index < num_rows * num_cols; ++index)
+    log_sum += log(cpi->ssim_rdmult_scaling_factors[index]);
+
   if ((cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY &&
       cpi->oxcf.q_cfg.deltaq_mode != NO_DELTA_Q) ||
       (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
@@ -1092,6 +1092,10 @@ int av1_is_integer_mv(const YV12_BUFFER_CONFIG *cur_picture,
                       const YV12_BUFFER_CONFIG *last_picture,
                       ForceIntegerMVInfo *const force_intpel_info);
 
+// Computes the SSIM rdmult scaling factors of one row of 16x16 blocks, before
+// the frame-level normalisation done by av1_set_mb_ssim_rdmult_scaling().
+void av1_set_mb_ssim_rdmult_scaling_row(const AV1_COMP *cpi, int row);
+
 void av1_set_mb_ssim_rdmult_scaling(AV1_COMP *cpi);
 
 void av1_save_all_coding_context(AV1_COMP *cpi);
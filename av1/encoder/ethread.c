@@ -18,7 +18,11 @@
 #include "av1/encoder/encoder.h"
 #include "av1/encoder/encoder_alloc.h"
 #include "av1/encoder/encodeframe_utils.h"
+#include "av1/encoder/encoder_utils.h"
 #include "av1/encoder/ethread.h"
+#if CONFIG_SALIENCY_MAP
+#include "av1/encoder/saliency_map.h"
+#endif
 #if !CONFIG_REALTIME_ONLY
 #include "av1/encoder/firstpass.h"
 #endif
@@ -1591,6 +1595,109 @@ int av1_fp_compute_num_enc_workers(AV1_COMP *cpi) {
   return AOMMIN(cpi->oxcf.max_threads, total_num_threads_row_mt);
 }
 
+static int lap_stage_worker_hook(void *arg1, void *unused) {
+  (void)unused;
+  AV1_PRIMARY *const ppi = (AV1_PRIMARY *)arg1;
+  struct aom_internal_error_info *const error = &ppi->lap_ppi->error;
+
+  // The jmp_buf is valid only for the duration of the function that calls
+  // setjmp(). Therefore, this function must reset the 'setjmp' field to 0
+  // before it returns.
+  if (setjmp(error->jmp)) {
+    error->setjmp = 0;
+    ppi->lap_status = error->error_code;
+    return 0;
+  }
+  error->setjmp = 1;
+  ppi->lap_status = av1_get_compressed_data(ppi->cpi_lap, &ppi->lap_data);
+  error->setjmp = 0;
+  return 1;
+}
+
+// Copies the primary state the LAP stage reads. The look ahead and the stats
+// buffer are shared through pointers, while the workers, sync objects and
+// buffers owned by 'ppi' stay with the encode stage.
+static void copy_lap_primary_state(AV1_PRIMARY *lap_ppi,
+                                   const AV1_PRIMARY *ppi) {
+  lap_ppi->lookahead = ppi->lookahead;
+  lap_ppi->output_pkt_list = ppi->output_pkt_list;
+  lap_ppi->seq_params_locked = ppi->seq_params_locked;
+  lap_ppi->lap_enabled = ppi->lap_enabled;
+  lap_ppi->use_svc = ppi->use_svc;
+  lap_ppi->number_spatial_layers = ppi->number_spatial_layers;
+  lap_ppi->number_temporal_layers = ppi->number_temporal_layers;
+  lap_ppi->seq_params = ppi->seq_params;
+  lap_ppi->gf_group = ppi->gf_group;
+  lap_ppi->p_rc = ppi->p_rc;
+  lap_ppi->twopass = ppi->twopass;
+  lap_ppi->rtc_ref = ppi->rtc_ref;
+  memcpy(lap_ppi->fn_ptr, ppi->fn_ptr, sizeof(lap_ppi->fn_ptr));
+#if CONFIG_FPMT_TEST
+  lap_ppi->fpmt_unit_test_cfg = ppi->fpmt_unit_test_cfg;
+#endif  // CONFIG_FPMT_TEST
+}
+
+void av1_launch_lap_stage(AV1_PRIMARY *ppi, int flush,
+                          const aom_rational64_t *timestamp_ratio) {
+  AV1_COMP *const cpi_lap = ppi->cpi_lap;
+  AVxWorker *const worker = &ppi->lap_worker;
+  const AVxWorkerInterface *const winterface = aom_get_worker_interface();
+
+  // The LAP stage takes its frame buffers from a pool of its own, so its
+  // reference counts never change under the encode stage.
+  assert(cpi_lap->common.buffer_pool != ppi->cpi->common.buffer_pool);
+  if (!winterface->reset(worker))
+    aom_internal_error(&ppi->error, AOM_CODEC_ERROR,
+                       "LAP stage thread creation failed");
+  if (ppi->lap_ppi == NULL) {
+    AOM_CHECK_MEM_ERROR(&ppi->error, ppi->lap_ppi,
+                        aom_memalign(32, sizeof(*ppi->lap_ppi)));
+    av1_zero(*ppi->lap_ppi);
+  }
+
+  // The LAP stage sees the primary state as left by the previous frames,
+  // exactly as when it runs ahead of the encode stage on this thread.
+  copy_lap_primary_state(ppi->lap_ppi, ppi);
+  cpi_lap->ppi = ppi->lap_ppi;
+  cpi_lap->common.seq_params = &ppi->lap_ppi->seq_params;
+
+  // The frame workers belong to the encode stage, so the first pass of the
+  // LAP stage runs on this thread alone.
+  cpi_lap->mt_info.num_workers = 1;
+  for (int i = MOD_FP; i < NUM_MT_MODULES; i++)
+    cpi_lap->mt_info.num_mod_workers[i] = 1;
+
+  av1_zero(ppi->lap_data);
+  ppi->lap_data.flush = flush;
+  ppi->lap_data.timestamp_ratio = timestamp_ratio;
+  cpi_lap->defer_fp_stats = 1;
+
+  worker->hook = lap_stage_worker_hook;
+  worker->data1 = ppi;
+  worker->data2 = NULL;
+  winterface->launch(worker);
+  ppi->lap_running = 1;
+}
+
+int av1_finish_lap_stage(AV1_PRIMARY *ppi) {
+  AV1_COMP *const cpi_lap = ppi->cpi_lap;
+  if (!ppi->lap_running) return AOM_CODEC_OK;
+
+  aom_get_worker_interface()->sync(&ppi->lap_worker);
+  ppi->lap_running = 0;
+  cpi_lap->ppi = ppi;
+  cpi_lap->common.seq_params = &ppi->seq_params;
+  cpi_lap->defer_fp_stats = 0;
+  ppi->twopass.first_pass_done |= ppi->lap_ppi->twopass.first_pass_done;
+  // -1 means the lookahead had no frame for the LAP stage yet.
+  if (ppi->lap_status != -1 && ppi->lap_status != AOM_CODEC_OK)
+    return ppi->lap_status;
+
+  av1_push_deferred_fp_stats(cpi_lap);
+  av1_post_encode_updates(cpi_lap, &ppi->lap_data);
+  return AOM_CODEC_OK;
+}
+
 // Computes the maximum number of mb_rows for row multi-threading of firstpass
 // stage
 static AOM_INLINE int fp_compute_max_mb_rows(const AV1_COMMON *cm,
@@ -1931,6 +2038,10 @@ void av1_tpl_dealloc(AV1TplRowMultiThreadSync *tpl_sync) {
       pthread_cond_destroy(&tpl_sync->cond_[i]);
     aom_free(tpl_sync->cond_);
   }
+  if (tpl_sync->frame_mutex_ != NULL) {
+    pthread_mutex_destroy(tpl_sync->frame_mutex_);
+    aom_free(tpl_sync->frame_mutex_);
+  }
 #endif  // CONFIG_MULTITHREAD
 
   aom_free(tpl_sync->num_finished_cols);
@@ -2046,6 +2157,67 @@ void av1_mc_flow_dispenser_mt(AV1_COMP *cpi) {
   tpl_accumulate_txfm_stats(&cpi->td, &cpi->mt_info, num_workers);
 }
 
+// Checks if a frame is left for the tpl motion search. If so, populates
+// frame_idx and returns 1, else returns 0.
+static AOM_INLINE int tpl_get_next_mv_search_frame(
+    AV1TplRowMultiThreadSync *tpl_sync, int *frame_idx) {
+  int do_next_frame = 0;
+#if CONFIG_MULTITHREAD
+  pthread_mutex_t *frame_mutex_ = tpl_sync->frame_mutex_;
+  pthread_mutex_lock(frame_mutex_);
+#endif
+  if (tpl_sync->next_mv_search_frame < tpl_sync->num_mv_search_frames) {
+    *frame_idx = tpl_sync->mv_search_frames[tpl_sync->next_mv_search_frame];
+    tpl_sync->next_mv_search_frame++;
+    do_next_frame = 1;
+  }
+#if CONFIG_MULTITHREAD
+  pthread_mutex_unlock(frame_mutex_);
+#endif
+  return do_next_frame;
+}
+
+// Each worker calls tpl_mv_search_worker_hook() and runs the single reference
+// motion search of whole frames.
+static int tpl_mv_search_worker_hook(void *arg1, void *unused) {
+  (void)unused;
+  EncWorkerData *thread_data = (EncWorkerData *)arg1;
+  AV1_COMP *cpi = thread_data->cpi;
+  AV1TplRowMultiThreadSync *tpl_sync = &cpi->ppi->tpl_data.tpl_mt_sync;
+  int frame_idx = -1;
+
+  while (tpl_get_next_mv_search_frame(tpl_sync, &frame_idx))
+    av1_tpl_search_frame_mvs(cpi, &thread_data->td->mb, frame_idx);
+  return 1;
+}
+
+// Implements frame level multi-threading for the tpl motion search.
+void av1_tpl_search_mvs_mt(AV1_COMP *cpi, const int *frames, int num_frames) {
+  AV1_COMMON *cm = &cpi->common;
+  MultiThreadInfo *mt_info = &cpi->mt_info;
+  AV1TplRowMultiThreadSync *tpl_sync = &cpi->ppi->tpl_data.tpl_mt_sync;
+  int num_workers = AOMMIN(
+      AOMMIN(mt_info->num_mod_workers[MOD_TPL], mt_info->num_workers),
+      num_frames);
+
+#if CONFIG_MULTITHREAD
+  if (tpl_sync->frame_mutex_ == NULL) {
+    CHECK_MEM_ERROR(cm, tpl_sync->frame_mutex_,
+                    aom_malloc(sizeof(*tpl_sync->frame_mutex_)));
+    if (tpl_sync->frame_mutex_)
+      pthread_mutex_init(tpl_sync->frame_mutex_, NULL);
+  }
+#endif  // CONFIG_MULTITHREAD
+  tpl_sync->mv_search_frames = frames;
+  tpl_sync->num_mv_search_frames = num_frames;
+  tpl_sync->next_mv_search_frame = 0;
+
+  prepare_tpl_workers(cpi, tpl_mv_search_worker_hook, num_workers);
+  launch_workers(mt_info, num_workers);
+  sync_enc_workers(mt_info, cm, num_workers);
+  tpl_sync->mv_search_frames = NULL;
+}
+
 // Deallocate memory for temporal filter multi-thread synchronization.
 void av1_tf_mt_dealloc(AV1TemporalFilterSync *tf_sync) {
   assert(tf_sync != NULL);
@@ -2055,21 +2227,22 @@ void av1_tf_mt_dealloc(AV1TemporalFilterSync *tf_sync) {
     aom_free(tf_sync->mutex_);
   }
 #endif  // CONFIG_MULTITHREAD
-  tf_sync->next_tf_row = 0;
+  av1_zero(tf_sync->next_tf_row);
 }
 
-// Checks if a job is available. If job is available,
+// Checks if a job is available for frame 'frame_idx'. If job is available,
 // populates next_tf_row and returns 1, else returns 0.
 static AOM_INLINE int tf_get_next_job(AV1TemporalFilterSync *tf_mt_sync,
-                                      int *current_mb_row, int mb_rows) {
+                                      int frame_idx, int *current_mb_row,
+                                      int mb_rows) {
   int do_next_row = 0;
 #if CONFIG_MULTITHREAD
   pthread_mutex_t *tf_mutex_ = tf_mt_sync->mutex_;
   pthread_mutex_lock(tf_mutex_);
 #endif
-  if (tf_mt_sync->next_tf_row < mb_rows) {
-    *current_mb_row = tf_mt_sync->next_tf_row;
-    tf_mt_sync->next_tf_row++;
+  if (tf_mt_sync->next_tf_row[frame_idx] < mb_rows) {
+    *current_mb_row = tf_mt_sync->next_tf_row[frame_idx];
+    tf_mt_sync->next_tf_row[frame_idx]++;
     do_next_row = 1;
   }
 #if CONFIG_MULTITHREAD
@@ -2084,9 +2257,10 @@ static int tf_worker_hook(void *arg1, void *unused) {
   EncWorkerData *thread_data = (EncWorkerData *)arg1;
   AV1_COMP *cpi = thread_data->cpi;
   ThreadData *td = thread_data->td;
-  TemporalFilterCtx *tf_ctx = &cpi->tf_ctx;
   AV1TemporalFilterSync *tf_sync = &cpi->mt_info.tf_sync;
-  const struct scale_factors *scale = &cpi->tf_ctx.sf;
+  const int frame_idx = thread_data->thread_id % tf_sync->num_frames;
+  const TemporalFilterCtx *tf_ctx = &tf_sync->tf_ctxs[frame_idx];
+  const struct scale_factors *scale = &tf_ctx->sf;
   const int num_planes = av1_num_planes(&cpi->common);
   assert(num_planes >= 1 && num_planes <= MAX_MB_PLANE);
 
@@ -2098,8 +2272,9 @@ static int tf_worker_hook(void *arg1, void *unused) {
 
   int current_mb_row = -1;
 
-  while (tf_get_next_job(tf_sync, &current_mb_row, tf_ctx->mb_rows))
-    av1_tf_do_filtering_row(cpi, td, current_mb_row);
+  while (tf_get_next_job(tf_sync, frame_idx, &current_mb_row,
+                         tf_ctx->mb_rows))
+    av1_tf_do_filtering_row(cpi, td, tf_ctx, current_mb_row);
 
   tf_restore_state(mbd, input_mb_mode_info, input_buffer, num_planes);
 
@@ -2108,9 +2283,10 @@ static int tf_worker_hook(void *arg1, void *unused) {
 
 // Assigns temporal filter hook function and thread data to each worker.
 static void prepare_tf_workers(AV1_COMP *cpi, AVxWorkerHook hook,
-                               int num_workers, int is_highbitdepth) {
+                               int num_workers) {
   MultiThreadInfo *mt_info = &cpi->mt_info;
-  mt_info->tf_sync.next_tf_row = 0;
+  AV1TemporalFilterSync *tf_sync = &mt_info->tf_sync;
+  av1_zero(tf_sync->next_tf_row);
   for (int i = num_workers - 1; i >= 0; i--) {
     AVxWorker *worker = &mt_info->workers[i];
     EncWorkerData *thread_data = &mt_info->tile_thr_data[i];
@@ -2136,8 +2312,10 @@ static void prepare_tf_workers(AV1_COMP *cpi, AVxWorkerHook hook,
       // OBMC buffers are used only to init MS params and remain unused when
       // called from tf, hence set the buffers to defaults.
       av1_init_obmc_buffer(&thread_data->td->mb.obmc_buffer);
+      const TemporalFilterCtx *tf_ctx =
+          &tf_sync->tf_ctxs[i % tf_sync->num_frames];
       if (!tf_alloc_and_reset_data(&thread_data->td->tf_data,
-                                   cpi->tf_ctx.num_pels, is_highbitdepth)) {
+                                   tf_ctx->num_pels, tf_ctx->is_highbitdepth)) {
         aom_internal_error(cpi->common.error, AOM_CODEC_MEM_ERROR,
                            "Error allocating temporal filter data");
       }
@@ -2145,46 +2323,49 @@ static void prepare_tf_workers(AV1_COMP *cpi, AVxWorkerHook hook,
   }
 }
 
-// Deallocate thread specific data for temporal filter.
-static void tf_dealloc_thread_data(AV1_COMP *cpi, int num_workers,
-                                   int is_highbitdepth) {
-  MultiThreadInfo *mt_info = &cpi->mt_info;
-  for (int i = num_workers - 1; i >= 0; i--) {
-    EncWorkerData *thread_data = &mt_info->tile_thr_data[i];
-    ThreadData *td = thread_data->td;
-    if (td != &cpi->td) tf_dealloc_data(&td->tf_data, is_highbitdepth);
-  }
-}
-
-// Accumulate sse and sum after temporal filtering.
-static void tf_accumulate_frame_diff(AV1_COMP *cpi, int num_workers) {
-  FRAME_DIFF *total_diff = &cpi->td.tf_data.diff;
+// Accumulate sse and sum of each frame after temporal filtering.
+static void tf_accumulate_frame_diff(AV1_COMP *cpi, int num_workers,
+                                     FRAME_DIFF *frame_diffs) {
+  const int num_frames = cpi->mt_info.tf_sync.num_frames;
+  FRAME_DIFF total_diffs[TF_INFO_BUF_COUNT];
+  memset(total_diffs, 0, sizeof(total_diffs));
   for (int i = num_workers - 1; i >= 0; i--) {
     AVxWorker *const worker = &cpi->mt_info.workers[i];
     EncWorkerData *const thread_data = (EncWorkerData *)worker->data1;
-    ThreadData *td = thread_data->td;
-    FRAME_DIFF *diff = &td->tf_data.diff;
-    if (td != &cpi->td) {
-      total_diff->sse += diff->sse;
-      total_diff->sum += diff->sum;
-    }
+    const FRAME_DIFF *diff = &thread_data->td->tf_data.diff;
+    FRAME_DIFF *total_diff = &total_diffs[i % num_frames];
+    total_diff->sse += diff->sse;
+    total_diff->sum += diff->sum;
   }
+  memcpy(frame_diffs, total_diffs, num_frames * sizeof(*frame_diffs));
 }
 
 // Implements multi-threading for temporal filter.
 void av1_tf_do_filtering_mt(AV1_COMP *cpi) {
+  av1_tf_do_filtering_frames_mt(cpi, &cpi->tf_ctx, 1, &cpi->td.tf_data.diff);
+}
+
+// Filters several frames concurrently. The workers are split evenly between
+// the frames, and worker 0 runs on the main thread data.
+void av1_tf_do_filtering_frames_mt(AV1_COMP *cpi, TemporalFilterCtx *tf_ctxs,
+                                   int num_frames, FRAME_DIFF *frame_diffs) {
   AV1_COMMON *cm = &cpi->common;
   MultiThreadInfo *mt_info = &cpi->mt_info;
-  const int is_highbitdepth = cpi->tf_ctx.is_highbitdepth;
+  AV1TemporalFilterSync *tf_sync = &mt_info->tf_sync;
 
   int num_workers =
       AOMMIN(mt_info->num_mod_workers[MOD_TF], mt_info->num_workers);
+  assert(num_frames >= 1 && num_frames <= TF_INFO_BUF_COUNT);
+  assert(num_workers >= num_frames);
 
-  prepare_tf_workers(cpi, tf_worker_hook, num_workers, is_highbitdepth);
+  tf_sync->tf_ctxs = tf_ctxs;
+  tf_sync->num_frames = num_frames;
+  prepare_tf_workers(cpi, tf_worker_hook, num_workers);
   launch_workers(mt_info, num_workers);
   sync_enc_workers(mt_info, cm, num_workers);
-  tf_accumulate_frame_diff(cpi, num_workers);
-  tf_dealloc_thread_data(cpi, num_workers, is_highbitdepth);
+  tf_accumulate_frame_diff(cpi, num_workers, frame_diffs);
+  tf_sync->tf_ctxs = NULL;
+  tf_sync->num_frames = 0;
 }
 
 // Checks if a job is available in the current direction. If a job is available,
@@ -2529,6 +2710,117 @@ void av1_calc_mb_wiener_var_mt(AV1_COMP *cpi, int num_workers,
   row_mt_sync_mem_dealloc(intra_row_mt_sync);
 }
 
+static int ssim_rdmult_scaling_hook(void *arg1, void *arg2) {
+  EncWorkerData *const thread_data = (EncWorkerData *)arg1;
+  const int num_workers = *(const int *)arg2;
+  const AV1_COMP *const cpi = thread_data->cpi;
+  const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+  const int num_mi_h = mi_size_high[BLOCK_16X16];
+  const int num_rows = (mi_params->mi_rows + num_mi_h - 1) / num_mi_h;
+
+  // Rows cost about the same, so they are dealt out round-robin.
+  for (int row = thread_data->start; row < num_rows; row += num_workers)
+    av1_set_mb_ssim_rdmult_scaling_row(cpi, row);
+  return 1;
+}
+
+// Computes the SSIM rdmult scaling factors of the 16x16 rows in parallel. This
+// runs before the frame is encoded, so all available workers are used.
+void av1_set_mb_ssim_rdmult_scaling_mt(AV1_COMP *cpi, int num_workers) {
+  MultiThreadInfo *const mt_info = &cpi->mt_info;
+
+  for (int i = num_workers - 1; i >= 0; i--) {
+    AVxWorker *const worker = &mt_info->workers[i];
+    EncWorkerData *const thread_data = &mt_info->tile_thr_data[i];
+
+    worker->hook = ssim_rdmult_scaling_hook;
+    worker->data1 = thread_data;
+    worker->data2 = &num_workers;
+
+    thread_data->thread_id = i;
+    thread_data->start = i;
+    thread_data->cpi = cpi;
+  }
+
+  launch_workers(mt_info, num_workers);
+  sync_enc_workers(mt_info, &cpi->common, num_workers);
+}
+
+static int ur_variance_hook(void *arg1, void *arg2) {
+  EncWorkerData *const thread_data = (EncWorkerData *)arg1;
+  const int num_workers = *(const int *)arg2;
+  AV1_COMP *const cpi = thread_data->cpi;
+  const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+  const int num_mi_h = mi_size_high[cpi->common.seq_params->sb_size];
+  const int num_rows = (mi_params->mi_rows + num_mi_h - 1) / num_mi_h;
+
+  for (int row = thread_data->start; row < num_rows; row += num_workers) {
+    if (!av1_set_mb_ur_variance_row(cpi, thread_data->thread_id, row)) {
+      cpi->ur_deltaq.error = 1;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Predicts the delta q of the superblock rows of delta-q mode 4 in parallel.
+// Each worker feeds its rows to its own interpreter.
+void av1_set_mb_ur_variance_mt(AV1_COMP *cpi, int num_workers) {
+  MultiThreadInfo *const mt_info = &cpi->mt_info;
+
+  for (int i = num_workers - 1; i >= 0; i--) {
+    AVxWorker *const worker = &mt_info->workers[i];
+    EncWorkerData *const thread_data = &mt_info->tile_thr_data[i];
+
+    worker->hook = ur_variance_hook;
+    worker->data1 = thread_data;
+    worker->data2 = &num_workers;
+
+    thread_data->thread_id = i;
+    thread_data->start = i;
+    thread_data->cpi = cpi;
+  }
+
+  launch_workers(mt_info, num_workers);
+  sync_enc_workers(mt_info, &cpi->common, num_workers);
+}
+
+#if CONFIG_SALIENCY_MAP
+static int saliency_map_hook(void *arg1, void *arg2) {
+  EncWorkerData *const thread_data = (EncWorkerData *)arg1;
+  const int num_workers = *(const int *)arg2;
+  AV1_COMP *const cpi = thread_data->cpi;
+
+  av1_set_saliency_map_stage_jobs(cpi, cpi->saliency_bufs.stage,
+                                  thread_data->start, num_workers);
+  return 1;
+}
+
+// Runs one stage of the saliency map computation. The jobs of a stage are
+// bands of about the same cost, so they are dealt out round-robin.
+void av1_set_saliency_map_stage_mt(AV1_COMP *cpi, int stage,
+                                   int num_workers) {
+  MultiThreadInfo *const mt_info = &cpi->mt_info;
+
+  cpi->saliency_bufs.stage = stage;
+  for (int i = num_workers - 1; i >= 0; i--) {
+    AVxWorker *const worker = &mt_info->workers[i];
+    EncWorkerData *const thread_data = &mt_info->tile_thr_data[i];
+
+    worker->hook = saliency_map_hook;
+    worker->data1 = thread_data;
+    worker->data2 = &num_workers;
+
+    thread_data->thread_id = i;
+    thread_data->start = i;
+    thread_data->cpi = cpi;
+  }
+
+  launch_workers(mt_info, num_workers);
+  sync_enc_workers(mt_info, &cpi->common, num_workers);
+}
+#endif  // CONFIG_SALIENCY_MAP
+
 // Compare and order tiles based on absolute sum of tx coeffs.
 static int compare_tile_order(const void *a, const void *b) {
   const PackBSTileOrder *const tile_a = (const PackBSTileOrder *)a;
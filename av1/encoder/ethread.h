@@ -45,6 +45,15 @@ void av1_encode_tiles_row_mt(struct AV1_COMP *cpi);
 void av1_fp_encode_tiles_row_mt(AV1_COMP *cpi);
 
 int av1_fp_compute_num_enc_workers(AV1_COMP *cpi);
+
+// Starts the LAP stage call for the next frame on ppi->lap_worker. The stats
+// of the frame are kept back until av1_finish_lap_stage().
+void av1_launch_lap_stage(AV1_PRIMARY *ppi, int flush,
+                          const aom_rational64_t *timestamp_ratio);
+
+// Waits for the LAP stage started by av1_launch_lap_stage(), adds the stats
+// of its frame to the stats buffer and returns the status of the call.
+int av1_finish_lap_stage(AV1_PRIMARY *ppi);
 #endif
 
 void av1_accumulate_frame_counts(struct FRAME_COUNTS *acc_counts,
@@ -69,6 +78,8 @@ void av1_tpl_row_mt_sync_write(AV1TplRowMultiThreadSync *tpl_mt_sync, int r,
 
 void av1_mc_flow_dispenser_mt(AV1_COMP *cpi);
 
+void av1_tpl_search_mvs_mt(AV1_COMP *cpi, const int *frames, int num_frames);
+
 void av1_tpl_dealloc(AV1TplRowMultiThreadSync *tpl_sync);
 
 #endif  // !CONFIG_REALTIME_ONLY
@@ -79,6 +90,17 @@ void av1_calc_mb_wiener_var_mt(AV1_COMP *cpi, int num_workers,
 
 void av1_tf_do_filtering_mt(AV1_COMP *cpi);
 
+void av1_tf_do_filtering_frames_mt(AV1_COMP *cpi, TemporalFilterCtx *tf_ctxs,
+                                   int num_frames, FRAME_DIFF *frame_diffs);
+
+void av1_set_mb_ssim_rdmult_scaling_mt(AV1_COMP *cpi, int num_workers);
+
+void av1_set_mb_ur_variance_mt(AV1_COMP *cpi, int num_workers);
+
+#if CONFIG_SALIENCY_MAP
+void av1_set_saliency_map_stage_mt(AV1_COMP *cpi, int stage, int num_workers);
+#endif
+
 void av1_tf_mt_dealloc(AV1TemporalFilterSync *tf_sync);
 
 void av1_compute_num_workers_for_mt(AV1_COMP *cpi);
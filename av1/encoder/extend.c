@@ -32,7 +32,9 @@ static void copy_and_extend_plane(const uint8_t *src, int src_pitch,
 
   for (i = 0; i < h; i++) {
     memset(dst_ptr1, src_ptr1[0], extend_left);
-    if (chroma_step == 1) {
+    if (dst == src) {
+      // Extending in place, the rows are already there.
+    } else if (chroma_step == 1) {
       memcpy(dst_ptr1 + extend_left, src_ptr1, w);
     } else {
       for (int j = 0; j < w; j++) {
@@ -82,7 +84,9 @@ static void highbd_copy_and_extend_plane(const uint8_t *src8, int src_pitch,
 
   for (i = 0; i < h; i++) {
     aom_memset16(dst_ptr1, src_ptr1[0], extend_left);
-    memcpy(dst_ptr1 + extend_left, src_ptr1, w * sizeof(src_ptr1[0]));
+    if (dst != src) {
+      memcpy(dst_ptr1 + extend_left, src_ptr1, w * sizeof(src_ptr1[0]));
+    }
     aom_memset16(dst_ptr2, src_ptr2[0], extend_right);
     src_ptr1 += src_pitch;
     src_ptr2 += src_pitch;
@@ -110,17 +114,13 @@ static void highbd_copy_and_extend_plane(const uint8_t *src8, int src_pitch,
   }
 }
 
-void av1_copy_and_extend_frame(const YV12_BUFFER_CONFIG *src,
-                               YV12_BUFFER_CONFIG *dst) {
+static void copy_and_extend_frame(const YV12_BUFFER_CONFIG *src,
+                                  const YV12_BUFFER_CONFIG *dst, int border) {
   // Extend src frame in buffer
-  const int et_y = dst->border;
-  const int el_y = dst->border;
-  const int er_y =
-      AOMMAX(src->y_width + dst->border, ALIGN_POWER_OF_TWO(src->y_width, 6)) -
-      src->y_crop_width;
-  const int eb_y = AOMMAX(src->y_height + dst->border,
-                          ALIGN_POWER_OF_TWO(src->y_height, 6)) -
-                   src->y_crop_height;
+  const int et_y = border;
+  const int el_y = border;
+  const int er_y = av1_get_extend_right(src, border);
+  const int eb_y = av1_get_extend_bottom(src, border);
   const int uv_width_subsampling = src->subsampling_x;
   const int uv_height_subsampling = src->subsampling_y;
   const int et_uv = et_y >> uv_height_subsampling;
@@ -161,3 +161,12 @@ void av1_copy_and_extend_frame(const YV12_BUFFER_CONFIG *src,
                           chroma_step);
   }
 }
+
+void av1_copy_and_extend_frame(const YV12_BUFFER_CONFIG *src,
+                               YV12_BUFFER_CONFIG *dst) {
+  copy_and_extend_frame(src, dst, dst->border);
+}
+
+void av1_extend_frame_in_place(const YV12_BUFFER_CONFIG *frame, int border) {
+  copy_and_extend_frame(frame, frame, border);
+}
@@ -12,6 +12,8 @@
 #ifndef AOM_AV1_ENCODER_EXTEND_H_
 #define AOM_AV1_ENCODER_EXTEND_H_
 
+#include "aom_dsp/aom_dsp_common.h"
+#include "aom_ports/mem.h"
 #include "aom_scale/yv12config.h"
 #include "aom/aom_integer.h"
 
@@ -19,9 +21,27 @@
 extern "C" {
 #endif
 
+// Columns written right of the luma crop width, and rows below its crop
+// height, when 'src' is extended by 'border' pixels.
+static INLINE int av1_get_extend_right(const YV12_BUFFER_CONFIG *src,
+                                       int border) {
+  return AOMMAX(src->y_width + border, ALIGN_POWER_OF_TWO(src->y_width, 6)) -
+         src->y_crop_width;
+}
+
+static INLINE int av1_get_extend_bottom(const YV12_BUFFER_CONFIG *src,
+                                        int border) {
+  return AOMMAX(src->y_height + border, ALIGN_POWER_OF_TWO(src->y_height, 6)) -
+         src->y_crop_height;
+}
+
 void av1_copy_and_extend_frame(const YV12_BUFFER_CONFIG *src,
                                YV12_BUFFER_CONFIG *dst);
 
+// Extends 'frame' by 'border' pixels the way av1_copy_and_extend_frame()
+// extends its copy, writing into the frame's own border.
+void av1_extend_frame_in_place(const YV12_BUFFER_CONFIG *frame, int border);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -842,6 +842,41 @@ static void normalize_firstpass_stats(FIRSTPASS_STATS *fps,
   fps->new_mv_count /= num_mbs_16x16;
 }
 
+// Returns where the first pass stats of the current frame are written.
+static FIRSTPASS_STATS *get_frame_stats_buf(AV1_COMP *cpi) {
+  return cpi->defer_fp_stats ? &cpi->deferred_fp_stats
+                             : cpi->ppi->twopass.stats_buf_ctx->stats_in_end;
+}
+
+// Adds the stats at stats_in_end to the stats buffer: outputs them, or pushes
+// them to the LAP stats, accumulates the totals and moves stats_in_end on.
+static void push_frame_stats(AV1_COMP *cpi) {
+  TWO_PASS *twopass = &cpi->ppi->twopass;
+  FIRSTPASS_STATS *this_frame_stats = twopass->stats_buf_ctx->stats_in_end;
+  if (!cpi->ppi->lap_enabled) {
+    output_stats(this_frame_stats, cpi->ppi->output_pkt_list);
+  } else {
+    av1_firstpass_info_push(&twopass->firstpass_info, this_frame_stats);
+  }
+  if (cpi->ppi->twopass.stats_buf_ctx->total_stats != NULL) {
+    av1_accumulate_stats(cpi->ppi->twopass.stats_buf_ctx->total_stats,
+                         this_frame_stats);
+  }
+  twopass->stats_buf_ctx->stats_in_end++;
+  // When ducky encode is on, we always use linear buffer for stats_buf_ctx.
+  if (cpi->use_ducky_encode == 0) {
+    // TODO(angiebird): Figure out why first pass uses circular buffer.
+    /* In the case of two pass, first pass uses it as a circular buffer,
+     * when LAP is enabled it is used as a linear buffer*/
+    if ((cpi->oxcf.pass == AOM_RC_FIRST_PASS) &&
+        (twopass->stats_buf_ctx->stats_in_end >=
+         twopass->stats_buf_ctx->stats_in_buf_end)) {
+      twopass->stats_buf_ctx->stats_in_end =
+          twopass->stats_buf_ctx->stats_in_start;
+    }
+  }
+}
+
 // Updates the first pass stats of this frame.
 // Input:
 //   cpi: the encoder setting. Only a few params in it will be used.
@@ -856,16 +891,16 @@ static void normalize_firstpass_stats(FIRSTPASS_STATS *fps,
 //   twopass->stats_buf_ctx->stats_in_end: the pointer to the current stats,
 //                                         update its value and its position
 //                                         in the buffer.
+//   Or, when cpi->defer_fp_stats is set, only cpi->deferred_fp_stats.
 static void update_firstpass_stats(AV1_COMP *cpi,
                                    const FRAME_STATS *const stats,
                                    const double raw_err_stdev,
                                    const int frame_number,
                                    const int64_t ts_duration,
                                    const BLOCK_SIZE fp_block_size) {
-  TWO_PASS *twopass = &cpi->ppi->twopass;
   AV1_COMMON *const cm = &cpi->common;
   const CommonModeInfoParams *const mi_params = &cm->mi_params;
-  FIRSTPASS_STATS *this_frame_stats = twopass->stats_buf_ctx->stats_in_end;
+  FIRSTPASS_STATS *this_frame_stats = get_frame_stats_buf(cpi);
   FIRSTPASS_STATS fps;
   // The minimum error here insures some bit allocation to frames even
   // in static regions. The allocation per MB declines for larger formats
@@ -936,27 +971,18 @@ static void update_firstpass_stats(AV1_COMP *cpi,
   // We will store the stats inside the persistent twopass struct (and NOT the
   // local variable 'fps'), and then cpi->output_pkt_list will point to it.
   *this_frame_stats = fps;
-  if (!cpi->ppi->lap_enabled) {
-    output_stats(this_frame_stats, cpi->ppi->output_pkt_list);
-  } else {
-    av1_firstpass_info_push(&twopass->firstpass_info, this_frame_stats);
-  }
-  if (cpi->ppi->twopass.stats_buf_ctx->total_stats != NULL) {
-    av1_accumulate_stats(cpi->ppi->twopass.stats_buf_ctx->total_stats, &fps);
-  }
-  twopass->stats_buf_ctx->stats_in_end++;
-  // When ducky encode is on, we always use linear buffer for stats_buf_ctx.
-  if (cpi->use_ducky_encode == 0) {
-    // TODO(angiebird): Figure out why first pass uses circular buffer.
-    /* In the case of two pass, first pass uses it as a circular buffer,
-     * when LAP is enabled it is used as a linear buffer*/
-    if ((cpi->oxcf.pass == AOM_RC_FIRST_PASS) &&
-        (twopass->stats_buf_ctx->stats_in_end >=
-         twopass->stats_buf_ctx->stats_in_buf_end)) {
-      twopass->stats_buf_ctx->stats_in_end =
-          twopass->stats_buf_ctx->stats_in_start;
-    }
+  if (cpi->defer_fp_stats) {
+    cpi->has_deferred_fp_stats = 1;
+    return;
   }
+  push_frame_stats(cpi);
+}
+
+void av1_push_deferred_fp_stats(AV1_COMP *cpi) {
+  if (!cpi->has_deferred_fp_stats) return;
+  *cpi->ppi->twopass.stats_buf_ctx->stats_in_end = cpi->deferred_fp_stats;
+  cpi->has_deferred_fp_stats = 0;
+  push_frame_stats(cpi);
 }
 
 static void print_reconstruction_frame(
@@ -1389,7 +1415,7 @@ void av1_first_pass(AV1_COMP *cpi, const int64_t ts_duration) {
   const int num_mbs = get_num_mbs(fp_block_size, num_mbs_16X16);
   stats.intra_factor = stats.intra_factor / (double)num_mbs;
   stats.brightness_factor = stats.brightness_factor / (double)num_mbs;
-  FIRSTPASS_STATS *this_frame_stats = twopass->stats_buf_ctx->stats_in_end;
+  FIRSTPASS_STATS *this_frame_stats = get_frame_stats_buf(cpi);
   update_firstpass_stats(cpi, &stats, raw_err_stdev,
                          current_frame->frame_number, ts_duration,
                          fp_block_size);
@@ -1469,6 +1495,16 @@ aom_codec_err_t av1_firstpass_info_init(FIRSTPASS_INFO *firstpass_info,
   return AOM_CODEC_OK;
 }
 
+aom_codec_err_t av1_firstpass_info_init_ring(FIRSTPASS_INFO *firstpass_info,
+                                             FIRSTPASS_STATS *ring_buf,
+                                             int ring_buf_size) {
+  if (ring_buf == NULL || ring_buf_size <= 0) return AOM_CODEC_ERROR;
+  av1_firstpass_info_init(firstpass_info, NULL, 0);
+  firstpass_info->stats_buf = ring_buf;
+  firstpass_info->stats_buf_size = ring_buf_size;
+  return AOM_CODEC_OK;
+}
+
 aom_codec_err_t av1_firstpass_info_move_cur_index(
     FIRSTPASS_INFO *firstpass_info) {
   assert(firstpass_info->future_stats_count +
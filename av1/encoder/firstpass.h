@@ -274,6 +274,21 @@ aom_codec_err_t av1_firstpass_info_move_cur_index(
  */
 aom_codec_err_t av1_firstpass_info_pop(FIRSTPASS_INFO *firstpass_info);
 
+/*!\brief Init firstpass_info with no stats and a ring buffer of the given
+ * size, for look ahead windows longer than static_stats_buf holds.
+ *
+ * The buffer needs to stay available during encoding process.
+ *
+ * \ingroup rate_control
+ * \param[out]   firstpass_info      struct of firstpass_info.
+ * \param[in]    ring_buf            buffer the stats are pushed into.
+ * \param[in]    ring_buf_size       number of stats ring_buf holds.
+ * \return status
+ */
+aom_codec_err_t av1_firstpass_info_init_ring(FIRSTPASS_INFO *firstpass_info,
+                                             FIRSTPASS_STATS *ring_buf,
+                                             int ring_buf_size);
+
 /*!\brief Move cur_index by 1 and pop a stats from firstpass_info
  *
  * \ingroup rate_control
@@ -434,7 +449,7 @@ typedef struct {
   // Circular queue of first pass stats stored for most recent frames.
   // cpi->output_pkt_list[i].data.twopass_stats.buf points to actual data stored
   // here.
-  FIRSTPASS_STATS *frame_stats_arr[MAX_LAP_BUFFERS + 1];
+  FIRSTPASS_STATS *frame_stats_arr[MAX_LAP_WINDOW + 1];
   int frame_stats_next_idx;  // Index to next unused element in frame_stats_arr.
   STATS_BUFFER_CTX *stats_buf_ctx;
   FIRSTPASS_INFO firstpass_info;  // This is the first pass data structure
@@ -569,6 +584,10 @@ void av1_first_pass_row(struct AV1_COMP *cpi, struct ThreadData *td,
                         const BLOCK_SIZE fp_block_size);
 void av1_end_first_pass(struct AV1_COMP *cpi);
 
+// Adds the stats kept back while cpi->defer_fp_stats was set to the stats
+// buffer.
+void av1_push_deferred_fp_stats(struct AV1_COMP *cpi);
+
 void av1_twopass_zero_stats(FIRSTPASS_STATS *section);
 void av1_accumulate_stats(FIRSTPASS_STATS *section,
                           const FIRSTPASS_STATS *frame);
@@ -358,38 +358,47 @@ static AOM_INLINE void update_valid_ref_frames_for_gm(
   }
 }
 
-// Deallocates segment_map and inliers.
-static AOM_INLINE void dealloc_global_motion_data(MotionModel *motion_models,
-                                                  uint8_t *segment_map) {
-  aom_free(segment_map);
+// Frees the inliers and segment_map used by single-threaded global motion.
+void av1_dealloc_global_motion_data(AV1_COMP *cpi) {
+  GlobalMotionInfo *const gm_info = &cpi->gm_info;
+  GlobalMotionThreadData *const thread_data = &gm_info->thread_data;
 
+  aom_free(thread_data->segment_map);
+  thread_data->segment_map = NULL;
   for (int m = 0; m < RANSAC_NUM_MOTIONS; m++) {
-    aom_free(motion_models[m].inliers);
+    aom_free(thread_data->motion_models[m].inliers);
+    thread_data->motion_models[m].inliers = NULL;
   }
+  gm_info->allocated_width = 0;
+  gm_info->allocated_height = 0;
 }
 
-// Allocates and initializes memory for segment_map and MotionModel.
-static AOM_INLINE bool alloc_global_motion_data(MotionModel *motion_models,
-                                                uint8_t **segment_map,
-                                                const int segment_map_w,
-                                                const int segment_map_h) {
-  av1_zero_array(motion_models, RANSAC_NUM_MOTIONS);
-  for (int m = 0; m < RANSAC_NUM_MOTIONS; m++) {
-    motion_models[m].inliers =
-        aom_malloc(sizeof(*(motion_models[m].inliers)) * 2 * MAX_CORNERS);
-    if (!motion_models[m].inliers) {
-      dealloc_global_motion_data(motion_models, NULL);
-      return false;
-    }
-  }
+// Allocates memory for segment_map and inliers, unless the buffers from a
+// previous frame of the same size can be reused.
+static AOM_INLINE void alloc_global_motion_data(AV1_COMP *cpi) {
+  AV1_COMMON *const cm = &cpi->common;
+  GlobalMotionInfo *const gm_info = &cpi->gm_info;
+  GlobalMotionThreadData *const thread_data = &gm_info->thread_data;
+
+  if (thread_data->segment_map != NULL &&
+      cpi->source->y_width == gm_info->allocated_width &&
+      cpi->source->y_height == gm_info->allocated_height)
+    return;
+
+  av1_dealloc_global_motion_data(cpi);
+  gm_info->allocated_width = cpi->source->y_width;
+  gm_info->allocated_height = cpi->source->y_height;
 
-  *segment_map = (uint8_t *)aom_calloc(segment_map_w * segment_map_h,
-                                       sizeof(*segment_map));
-  if (!*segment_map) {
-    dealloc_global_motion_data(motion_models, NULL);
-    return false;
+  for (int m = 0; m < RANSAC_NUM_MOTIONS; m++) {
+    CHECK_MEM_ERROR(
+        cm, thread_data->motion_models[m].inliers,
+        aom_malloc(sizeof(*thread_data->motion_models[m].inliers) * 2 *
+                   MAX_CORNERS));
   }
-  return true;
+  CHECK_MEM_ERROR(
+      cm, thread_data->segment_map,
+      aom_malloc(sizeof(*thread_data->segment_map) * gm_info->segment_map_w *
+                 gm_info->segment_map_h));
 }
 
 // Initializes parameters used for computing global motion.
@@ -424,11 +433,9 @@ static AOM_INLINE void setup_global_motion_info_params(AV1_COMP *cpi) {
 // Computes global motion w.r.t. valid reference frames.
 static AOM_INLINE void global_motion_estimation(AV1_COMP *cpi) {
   GlobalMotionInfo *const gm_info = &cpi->gm_info;
-  MotionModel motion_models[RANSAC_NUM_MOTIONS];
-  uint8_t *segment_map = NULL;
+  GlobalMotionThreadData *const thread_data = &gm_info->thread_data;
 
-  alloc_global_motion_data(motion_models, &segment_map, gm_info->segment_map_w,
-                           gm_info->segment_map_h);
+  alloc_global_motion_data(cpi);
 
   // Compute global motion w.r.t. past reference frames and future reference
   // frames
@@ -436,11 +443,10 @@ static AOM_INLINE void global_motion_estimation(AV1_COMP *cpi) {
     if (gm_info->num_ref_frames[dir] > 0)
       compute_global_motion_for_references(
           cpi, gm_info->ref_buf, gm_info->reference_frames[dir],
-          gm_info->num_ref_frames[dir], motion_models, segment_map,
-          gm_info->segment_map_w, gm_info->segment_map_h);
+          gm_info->num_ref_frames[dir], thread_data->motion_models,
+          thread_data->segment_map, gm_info->segment_map_w,
+          gm_info->segment_map_h);
   }
-
-  dealloc_global_motion_data(motion_models, segment_map);
 }
 
 // Global motion estimation for the current frame is computed.This computation
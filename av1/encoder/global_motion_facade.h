@@ -23,6 +23,7 @@ void av1_compute_gm_for_valid_ref_frames(
     MotionModel *motion_models, uint8_t *segment_map, int segment_map_w,
     int segment_map_h);
 void av1_compute_global_motion_facade(struct AV1_COMP *cpi);
+void av1_dealloc_global_motion_data(struct AV1_COMP *cpi);
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -13,6 +13,7 @@
 
 #include "config/aom_config.h"
 
+#include "aom_dsp/pyramid.h"
 #include "aom_scale/yv12config.h"
 #include "av1/common/common.h"
 #include "av1/encoder/encoder.h"
@@ -30,12 +31,59 @@ static struct lookahead_entry *pop(struct lookahead_ctx *ctx, int *idx) {
   return buf;
 }
 
+// Returns the caller's frame referenced by 'buf', if any, to its owner and
+// points the entry back at its own buffer.
+static void release_external_frame(struct lookahead_entry *buf) {
+  if (buf->external.frame == NULL) return;
+  aom_metadata_array_t *const metadata = buf->img.metadata;
+  buf->img = buf->own_img;
+  buf->img.metadata = metadata;
+  buf->external.release_cb(buf->external.cb_priv, buf->external.frame);
+  buf->external.frame = NULL;
+}
+
+static void release_frame(const LookaheadFrameRelease *release) {
+  if (release != NULL) release->release_cb(release->cb_priv, release->frame);
+}
+
+// Returns whether the planes of 'src' can be queued in place of the entry's
+// own buffer 'img'. Motion search in the lookahead assumes all the queued
+// frames share one stride, and the border extension needs the room around
+// the planes. src->border is the border the caller allocated around every
+// plane. Monochrome frames are always copied.
+static int can_reference_frame(const YV12_BUFFER_CONFIG *src,
+                               const YV12_BUFFER_CONFIG *img) {
+  const int border = img->border;
+  if (src->monochrome || src->border < border ||
+      src->y_stride != img->y_stride || src->uv_stride != img->uv_stride ||
+      (src->flags & YV12_FLAG_HIGHBITDEPTH) !=
+          (img->flags & YV12_FLAG_HIGHBITDEPTH)) {
+    return 0;
+  }
+  const int extend_right = av1_get_extend_right(src, border);
+  const int extend_bottom = av1_get_extend_bottom(src, border);
+  if (src->y_stride - src->border - src->y_crop_width < extend_right ||
+      src->y_height + src->border - src->y_crop_height < extend_bottom) {
+    return 0;
+  }
+  if (src->u_buffer == NULL || src->v_buffer == NULL) return 0;
+  const int ss_x = src->subsampling_x;
+  const int ss_y = src->subsampling_y;
+  return src->uv_stride - (src->border >> ss_x) - src->uv_crop_width >=
+             extend_right >> ss_x &&
+         src->uv_height + (src->border >> ss_y) - src->uv_crop_height >=
+             extend_bottom >> ss_y;
+}
+
 void av1_lookahead_destroy(struct lookahead_ctx *ctx) {
   if (ctx) {
     if (ctx->buf) {
       int i;
 
-      for (i = 0; i < ctx->max_sz; i++) aom_free_frame_buffer(&ctx->buf[i].img);
+      for (i = 0; i < ctx->max_sz; i++) {
+        release_external_frame(&ctx->buf[i]);
+        aom_free_frame_buffer(&ctx->buf[i].img);
+      }
       free(ctx->buf);
     }
     free(ctx);
@@ -58,7 +106,7 @@ struct lookahead_ctx *av1_lookahead_init(
 
   // Add the lags to depth and clamp
   depth += num_lap_buffers;
-  depth = clamp(depth, 1, MAX_TOTAL_BUFFERS);
+  depth = clamp(depth, 1, AOMMAX(MAX_TOTAL_BUFFERS, MAX_LAP_WINDOW));
 
   // Allocate memory to keep previous source frames available.
   depth += max_pre_frames;
@@ -100,7 +148,8 @@ int av1_lookahead_full(const struct lookahead_ctx *ctx) {
 
 int av1_lookahead_push(struct lookahead_ctx *ctx, const YV12_BUFFER_CONFIG *src,
                        int64_t ts_start, int64_t ts_end, int use_highbitdepth,
-                       int num_pyramid_levels, aom_enc_frame_flags_t flags) {
+                       int num_pyramid_levels, aom_enc_frame_flags_t flags,
+                       const LookaheadFrameRelease *release) {
   int width = src->y_crop_width;
   int height = src->y_crop_height;
   int uv_width = src->uv_crop_width;
@@ -110,8 +159,10 @@ int av1_lookahead_push(struct lookahead_ctx *ctx, const YV12_BUFFER_CONFIG *src,
   int larger_dimensions, new_dimensions;
 
   assert(ctx->read_ctxs[ENCODE_STAGE].valid == 1);
-  if (ctx->read_ctxs[ENCODE_STAGE].sz + ctx->max_pre_frames > ctx->max_sz)
+  if (ctx->read_ctxs[ENCODE_STAGE].sz + ctx->max_pre_frames > ctx->max_sz) {
+    release_frame(release);
     return 1;
+  }
 
   ctx->read_ctxs[ENCODE_STAGE].sz++;
   if (ctx->read_ctxs[LAP_STAGE].valid) {
@@ -119,6 +170,7 @@ int av1_lookahead_push(struct lookahead_ctx *ctx, const YV12_BUFFER_CONFIG *src,
   }
 
   struct lookahead_entry *buf = pop(ctx, &ctx->write_idx);
+  release_external_frame(buf);
 
   new_dimensions = width != buf->img.y_crop_width ||
                    height != buf->img.y_crop_height ||
@@ -129,13 +181,27 @@ int av1_lookahead_push(struct lookahead_ctx *ctx, const YV12_BUFFER_CONFIG *src,
                       uv_height > buf->img.uv_height;
   assert(!larger_dimensions || new_dimensions);
 
-  if (larger_dimensions) {
+  if (release != NULL && !new_dimensions &&
+      can_reference_frame(src, &buf->img)) {
+    // Reference the caller's planes. The entry keeps its own geometry and
+    // image pyramid, which match the frame.
+    buf->own_img = buf->img;
+    for (int i = 0; i < 3; ++i) buf->img.buffers[i] = src->buffers[i];
+    buf->img.y_stride = src->y_stride;
+    buf->img.uv_stride = src->uv_stride;
+    buf->img.flags = src->flags;
+    buf->external = *release;
+    av1_extend_frame_in_place(src, buf->img.border);
+    release = NULL;
+  } else if (larger_dimensions) {
     YV12_BUFFER_CONFIG new_img;
     memset(&new_img, 0, sizeof(new_img));
     if (aom_alloc_frame_buffer(&new_img, width, height, subsampling_x,
                                subsampling_y, use_highbitdepth,
-                               AOM_BORDER_IN_PIXELS, 0, num_pyramid_levels, 0))
+                               AOM_BORDER_IN_PIXELS, 0, num_pyramid_levels, 0)) {
+      release_frame(release);
       return 1;
+    }
     aom_free_frame_buffer(&buf->img);
     buf->img = new_img;
   } else if (new_dimensions) {
@@ -146,8 +212,14 @@ int av1_lookahead_push(struct lookahead_ctx *ctx, const YV12_BUFFER_CONFIG *src,
     buf->img.subsampling_x = src->subsampling_x;
     buf->img.subsampling_y = src->subsampling_y;
   }
-  // Partial copy not implemented yet
-  av1_copy_and_extend_frame(src, &buf->img);
+  if (buf->external.frame == NULL) {
+    // Partial copy not implemented yet
+    av1_copy_and_extend_frame(src, &buf->img);
+    release_frame(release);
+  }
+
+  // The pyramid cached with the entry belongs to the previous frame.
+  aom_invalidate_pyramid(buf->img.y_pyramid);
 
   buf->ts_start = ts_start;
   buf->ts_end = ts_end;
@@ -27,15 +27,31 @@ extern "C" {
 /*!\cond */
 #define MAX_LAG_BUFFERS 128
 #define MAX_LAP_BUFFERS 128
+// Largest LAP stats window that can be set apart from lag_in_frames.
+#define MAX_LAP_WINDOW 1024
 #define MAX_TOTAL_BUFFERS (MAX_LAG_BUFFERS + MAX_LAP_BUFFERS)
 #define LAP_LAG_IN_FRAMES 25
 
+// Hands a frame pushed without a copy back to its owner.
+typedef void (*lookahead_release_cb_fn_t)(void *cb_priv, void *frame);
+
+typedef struct {
+  lookahead_release_cb_fn_t release_cb;
+  void *cb_priv;
+  void *frame;
+} LookaheadFrameRelease;
+
 struct lookahead_entry {
   YV12_BUFFER_CONFIG img;
   int64_t ts_start;
   int64_t ts_end;
   int display_idx;
   aom_enc_frame_flags_t flags;
+  // Set while 'img' points at the planes of a caller's frame rather than at
+  // the entry's own buffer, which is kept in 'own_img'. The frame is released
+  // when the entry is reused.
+  LookaheadFrameRelease external;
+  YV12_BUFFER_CONFIG own_img;
 };
 
 // The max of past frames we want to keep in the queue.
@@ -85,6 +101,12 @@ int av1_lookahead_full(const struct lookahead_ctx *ctx);
  * This function will copy the source image into a new framebuffer with
  * the expected stride/border.
  *
+ * When \p release is not NULL the caller hands over the source image. If its
+ * planes have room for the border and it has the size of the queued frames,
+ * it is queued in place, with only its border extended, and released once
+ * its entry is reused or the queue is destroyed. Otherwise it is copied and
+ * released right away.
+ *
  * \param[in] ctx         Pointer to the lookahead context
  * \param[in] src         Pointer to the image to enqueue
  * \param[in] ts_start    Timestamp for the start of this frame
@@ -93,10 +115,12 @@ int av1_lookahead_full(const struct lookahead_ctx *ctx);
  * \param[in] num_pyramid_levels Number of pyramid levels to allocate
                           for each frame buffer
  * \param[in] flags       Flags set on this frame
+ * \param[in] release     Release callback of a handed over image, or NULL
  */
 int av1_lookahead_push(struct lookahead_ctx *ctx, const YV12_BUFFER_CONFIG *src,
                        int64_t ts_start, int64_t ts_end, int use_highbitdepth,
-                       int num_pyramid_levels, aom_enc_frame_flags_t flags);
+                       int num_pyramid_levels, aom_enc_frame_flags_t flags,
+                       const LookaheadFrameRelease *release);
 
 /**\brief Get the next source buffer to encode
  *
@@ -17,6 +17,7 @@
 #include "config/aom_dsp_rtcd.h"
 
 #include "aom_dsp/aom_dsp_common.h"
+#include "aom_dsp/pyramid.h"
 #include "aom_mem/aom_mem.h"
 #include "aom_ports/mem.h"
 
@@ -1894,6 +1895,124 @@ int av1_full_pixel_search(const FULLPEL_MV start_mv,
   return var;
 }
 
+// Returns the block size of a w x h search window, or BLOCK_INVALID if there
+// is none.
+static BLOCK_SIZE get_window_bsize(int w, int h) {
+  for (BLOCK_SIZE bsize = BLOCK_4X4; bsize < BLOCK_SIZES_ALL; ++bsize) {
+    if (block_size_wide[bsize] == w && block_size_high[bsize] == h)
+      return bsize;
+  }
+  return BLOCK_INVALID;
+}
+
+// Searches the mvs within 'range' of 'center' for the window of block size
+// 'bsize' at (x, y) on one pyramid level, and updates best_mv and best_sad.
+static void pyramid_level_search(const aom_variance_fn_ptr_t *fn_ptr,
+                                 const PyramidLayer *src,
+                                 const PyramidLayer *ref, int x, int y,
+                                 BLOCK_SIZE bsize, const FullMvLimits *limits,
+                                 FULLPEL_MV center, int range,
+                                 FULLPEL_MV *best_mv, unsigned int *best_sad) {
+  const uint8_t *const src_buf = src->buffer + y * src->stride + x;
+  const uint8_t *const ref_buf = ref->buffer + y * ref->stride + x;
+  const int row_min = AOMMAX(center.row - range, limits->row_min);
+  const int row_max = AOMMIN(center.row + range, limits->row_max);
+  const int col_min = AOMMAX(center.col - range, limits->col_min);
+  const int col_max = AOMMIN(center.col + range, limits->col_max);
+  for (int row = row_min; row <= row_max; ++row) {
+    for (int col = col_min; col <= col_max; ++col) {
+      const unsigned int sad =
+          fn_ptr[bsize].sdf(src_buf, src->stride,
+                            ref_buf + row * ref->stride + col, ref->stride);
+      if (sad < *best_sad) {
+        *best_sad = sad;
+        best_mv->row = row;
+        best_mv->col = col;
+      }
+    }
+  }
+}
+
+int av1_pyramid_full_pixel_search(const aom_variance_fn_ptr_t *fn_ptr,
+                                  const ImagePyramid *src_pyr,
+                                  const ImagePyramid *ref_pyr, int x, int y,
+                                  int bw, int bh, int num_levels,
+                                  FULLPEL_MV start_mv,
+                                  const FullMvLimits *mv_limits,
+                                  FULLPEL_MV *best_mv) {
+  // Use the levels that both pyramids have at the same size, and that fit the
+  // search window, which keeps some context around small blocks on the
+  // coarse levels.
+  num_levels = AOMMIN(AOMMIN(num_levels, PYRAMID_SEARCH_LEVELS),
+                      AOMMIN(src_pyr->n_levels, ref_pyr->n_levels));
+  BLOCK_SIZE window_bsize[PYRAMID_SEARCH_LEVELS];
+  for (int level = 1; level < num_levels; ++level) {
+    const PyramidLayer *src = &src_pyr->layers[level];
+    const int w = AOMMAX(bw >> level, PYRAMID_SEARCH_MIN_WINDOW);
+    const int h = AOMMAX(bh >> level, PYRAMID_SEARCH_MIN_WINDOW);
+    window_bsize[level] = get_window_bsize(w, h);
+    if (src->width != ref_pyr->layers[level].width ||
+        src->height != ref_pyr->layers[level].height || w > src->width ||
+        h > src->height || window_bsize[level] == BLOCK_INVALID) {
+      num_levels = level;
+      break;
+    }
+  }
+  if (num_levels <= 1) return 0;
+
+  const int center_x = x + (bw >> 1);
+  const int center_y = y + (bh >> 1);
+  FULLPEL_MV level_mv = kZeroFullMv;
+  for (int level = num_levels - 1; level >= 1; --level) {
+    const PyramidLayer *src = &src_pyr->layers[level];
+    const PyramidLayer *ref = &ref_pyr->layers[level];
+    const BLOCK_SIZE bsize = window_bsize[level];
+    const int w = block_size_wide[bsize];
+    const int h = block_size_high[bsize];
+    const int win_x = clamp((center_x >> level) - (w >> 1), 0, src->width - w);
+    const int win_y = clamp((center_y >> level) - (h >> 1), 0, src->height - h);
+    // Scale the mv limits down, and keep the reference window in the padded
+    // layer.
+    FullMvLimits limits;
+    limits.col_min = AOMMAX(-((-mv_limits->col_min) >> level),
+                            -PYRAMID_PADDING - win_x);
+    limits.col_max = AOMMIN(mv_limits->col_max >> level,
+                            ref->width + PYRAMID_PADDING - w - win_x);
+    limits.row_min = AOMMAX(-((-mv_limits->row_min) >> level),
+                            -PYRAMID_PADDING - win_y);
+    limits.row_max = AOMMIN(mv_limits->row_max >> level,
+                            ref->height + PYRAMID_PADDING - h - win_y);
+    if (limits.col_min > limits.col_max || limits.row_min > limits.row_max)
+      return 0;
+
+    unsigned int best_sad = UINT_MAX;
+    if (level == num_levels - 1) {
+      // Pick the better of the start mv and the zero mv, and search the full
+      // range around it.
+      FULLPEL_MV center = { start_mv.row >> level, start_mv.col >> level };
+      clamp_fullmv(&center, &limits);
+      pyramid_level_search(fn_ptr, src, ref, win_x, win_y, bsize, &limits,
+                           center, 0, &level_mv, &best_sad);
+      pyramid_level_search(fn_ptr, src, ref, win_x, win_y, bsize, &limits,
+                           kZeroFullMv, 0, &level_mv, &best_sad);
+      pyramid_level_search(fn_ptr, src, ref, win_x, win_y, bsize, &limits,
+                           level_mv, PYRAMID_SEARCH_RANGE, &level_mv,
+                           &best_sad);
+    } else {
+      // Refine the mv of the coarser level.
+      FULLPEL_MV center = { level_mv.row * 2, level_mv.col * 2 };
+      clamp_fullmv(&center, &limits);
+      pyramid_level_search(fn_ptr, src, ref, win_x, win_y, bsize, &limits,
+                           center, 1, &level_mv, &best_sad);
+    }
+  }
+
+  best_mv->row = level_mv.row * 2;
+  best_mv->col = level_mv.col * 2;
+  clamp_fullmv(best_mv, mv_limits);
+  return 1;
+}
+
 int av1_intrabc_hash_search(const AV1_COMP *cpi, const MACROBLOCKD *xd,
                             const FULLPEL_MOTION_SEARCH_PARAMS *ms_params,
                             IntraBCHashInfo *intrabc_hash_info,
@@ -24,6 +24,7 @@ extern "C" {
 
 struct AV1_COMP;
 struct SPEED_FEATURES;
+struct image_pyramid;
 
 // =============================================================================
 //  Cost functions
@@ -274,6 +275,33 @@ int av1_full_pixel_search(const FULLPEL_MV start_mv,
                           const int step_param, int *cost_list,
                           FULLPEL_MV *best_mv, FULLPEL_MV *second_best_mv);
 
+// Number of image pyramid levels kept for av1_pyramid_full_pixel_search().
+#define PYRAMID_SEARCH_LEVELS 4
+// Search radius on the coarsest level of av1_pyramid_full_pixel_search().
+#define PYRAMID_SEARCH_RANGE 4
+// Minimum width and height of the window searched on each pyramid level.
+#define PYRAMID_SEARCH_MIN_WINDOW 8
+// Full resolution search range around the mv av1_pyramid_full_pixel_search()
+// returns, which covers the rounding of its finest level.
+#define PYRAMID_SEARCH_REFINE_RANGE 4
+
+// Searches the full pixel mv of the bw x bh block at (x, y) coarse to fine in
+// the image pyramids of the source and reference frames, which must already
+// be computed. The search covers PYRAMID_SEARCH_RANGE around the better of
+// start_mv and the zero mv on level num_levels - 1, and refines the mv on
+// each finer level down to level 1. The mv in best_mv is meant to be refined
+// by av1_full_pixel_search() within PYRAMID_SEARCH_REFINE_RANGE. Returns 0,
+// leaving best_mv untouched, if the pyramids have too few levels in common.
+// The windows are compared with the sdf functions of 'fn_ptr', which must be
+// the 8-bit ones as the pyramids are 8-bit.
+int av1_pyramid_full_pixel_search(const aom_variance_fn_ptr_t *fn_ptr,
+                                  const struct image_pyramid *src_pyr,
+                                  const struct image_pyramid *ref_pyr, int x,
+                                  int y, int bw, int bh, int num_levels,
+                                  FULLPEL_MV start_mv,
+                                  const FullMvLimits *mv_limits,
+                                  FULLPEL_MV *best_mv);
+
 int av1_intrabc_hash_search(const struct AV1_COMP *cpi, const MACROBLOCKD *xd,
                             const FULLPEL_MOTION_SEARCH_PARAMS *ms_params,
                             IntraBCHashInfo *intrabc_hash_info,
@@ -30,6 +30,7 @@
 #include "av1/encoder/nonrd_opt.h"
 #include "av1/encoder/partition_search.h"
 #include "av1/encoder/partition_strategy.h"
+#include "av1/encoder/perceptual_map.h"
 #include "av1/encoder/reconinter_enc.h"
 #include "av1/encoder/tokenize.h"
 #include "av1/encoder/var_based_part.h"
@@ -580,6 +581,34 @@ static void encode_superblock(const AV1_COMP *const cpi, TileDataEnc *tile_data,
   }
 }
 
+// Scales x->rdmult by the luma bias, which favors dark or bright blocks
+// depending on their average luma.
+static void set_luma_bias_rdmult(const AV1_COMP *const cpi,
+                                 MACROBLOCK *const x, BLOCK_SIZE bsize,
+                                 int mi_row, int mi_col) {
+  if (cpi->oxcf.luma_bias != 0 || (cpi->oxcf.tune_cfg.content == AOM_CONTENT_PSY && cpi->oxcf.luma_bias_override == 0)) {
+    int avg_brightness;
+    BitDepthInfo bd_info = get_bit_depth_info(&x->e_mbd);
+    avg_brightness = av1_get_block_luma_avg(cpi, x, mi_row, mi_col, bsize);
+    if (bd_info.use_highbitdepth_buf) {
+      // We bitshift if the bitdepth is > 8 to normalize the results to 0-255
+      avg_brightness >>= bd_info.bit_depth - 8;
+    }
+    double luma_adjustment = 0;
+    if (cpi->oxcf.luma_bias_override == 0 && cpi->oxcf.tune_cfg.content == AOM_CONTENT_PSY) { // If user hasn't set a luma-bias and we're using content=psy
+      //Equivalent to luma_bias = 15, with user-changable strength = 10, midpoint = 40
+      luma_adjustment = (1 - ((100. - 15.) / 100.)) / (1 + exp(-(cpi->oxcf.luma_bias_strength * (avg_brightness - cpi->oxcf.luma_bias_midpoint)) / 255.));
+      luma_adjustment += (cpi->oxcf.invert_luma_bias == 0) ? ((100. - 15.) / 100.) : 1.; // If not inverted, add 1.0 - strength/100, otherwise add 1
+    } else {
+      //luma_adjustment = cos( pow(((double)avg_brightness - 255.0) / (5100.0 / (10. + ((double)cpi->oxcf.luma_bias) / 8.) ), cpi->oxcf.luma_bias_power)); //Old method
+      luma_adjustment = (1 - ((100. - (double)cpi->oxcf.luma_bias) / 100.)) / (1 + exp(-(cpi->oxcf.luma_bias_strength * (avg_brightness - cpi->oxcf.luma_bias_midpoint)) / 255.)); // Sigmoid curve for modifying rdmult, with a max of 1.0 (by default), with user-adjustable variables.
+      luma_adjustment += (cpi->oxcf.invert_luma_bias == 0) ? ((100. - (double)cpi->oxcf.luma_bias) / 100.) : 1.;
+    }
+    //luma_adjustment = 1.0 - ((double) avg_brightness / (5100.0 / (double) cpi->oxcf.luma_bias)); Old method
+    x->rdmult = (int) ((double) x->rdmult * luma_adjustment);
+  }
+}
+
 static void setup_block_rdmult(const AV1_COMP *const cpi, MACROBLOCK *const x,
                                int mi_row, int mi_col, BLOCK_SIZE bsize,
                                AQ_MODE aq_mode, MB_MODE_INFO *mbmi) {
@@ -610,96 +639,11 @@ static void setup_block_rdmult(const AV1_COMP *const cpi, MACROBLOCK *const x,
     x->rdmult = av1_get_cb_rdmult(cpi, x, bsize, mi_row, mi_col);
   }
 #endif  // !CONFIG_REALTIME_ONLY
-  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_SSIM ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
-      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST) {
-    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,
-                        &x->rdmult);
-  }
-#if CONFIG_SALIENCY_MAP
-  else if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_SALIENCY_MAP) {
-    av1_set_saliency_map_vmaf_rdmult(cpi, &x->errorperbit,
-                                     cpi->common.seq_params->sb_size, mi_row,
-                                     mi_col, &x->rdmult);
-  }
-#endif
-#if CONFIG_TUNE_VMAF
-  else if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_WITHOUT_PREPROCESSING ||
-           cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_MAX_GAIN ||
-           cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_NEG_MAX_GAIN) {
-    av1_set_vmaf_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
-  }
-#endif
-  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI) { // SSIM tuning in euclidean space(?)
-    // Operate in long space since we get NaN or negative values otherwise due to the sheer size of the numbers.
-    long int pow_original_rdmult = (long int)powl((long double)x->rdmult, 2); // Square the original rdmult
-    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,  // Omni tuning, SSIM-like but calculated by squaring the variance result
-                        &x->rdmult);                                  // and then acquiring the square root of the resulting weight.
-    long int ssim_rdmult = (long int)powl((long double)x->rdmult, 2); // Square the rdmult post-ssim tuning.
-    x->rdmult = (int)((sqrtl(ssim_rdmult + pow_original_rdmult)) / sqrt(2) + 0.5);
-    x->rdmult = AOMMAX(x->rdmult, 0);
-    av1_set_error_per_bit(&x->errorperbit, x->rdmult);
-    // Should this method be done in weight-space rather than rdmult-space? Maybe.
-  }
-#if CONFIG_TUNE_BUTTERAUGLI
-  else if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_BUTTERAUGLI) {
-    av1_set_butteraugli_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
-  }
-
-  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH) {
-    int lavish_rdmult = x->rdmult;
-    av1_set_butteraugli_rdmult(cpi, x, bsize, mi_row, mi_col, &lavish_rdmult);
-    int ssim_rdmult = x->rdmult;
-    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,
-                        &ssim_rdmult);
-
-    x->rdmult = (int) (((int64_t)(lavish_rdmult * 2.5) + (int64_t)(ssim_rdmult)) / 3.5);
-  }
-#endif
-#if CONFIG_TUNE_VMAF
-  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD) {
-    int vmaf_rdmult = x->rdmult;
-    av1_set_vmaf_rdmult(cpi, x, bsize, mi_row, mi_col, &vmaf_rdmult);
-    int ssim_rdmult = x->rdmult;
-    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,
-                        &ssim_rdmult);
-
-    x->rdmult = (int) (((int64_t)(vmaf_rdmult * 2.5) + (int64_t)(ssim_rdmult)) / 3.5);
-  }
-
-#if CONFIG_TUNE_BUTTERAUGLI
-  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL) {
-    av1_set_butteraugli_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
-  }
-#endif
-#endif
+  av1_set_perceptual_rdmult(cpi, x, bsize, mi_row, mi_col);
   if (cpi->oxcf.mode == ALLINTRA || cpi->oxcf.tune_cfg.content == AOM_CONTENT_PSY) {
     x->rdmult = (int)(((int64_t)x->rdmult * x->intra_sb_rdmult_modifier) >> 7);
   }
-
-  if (cpi->oxcf.luma_bias != 0 || (cpi->oxcf.tune_cfg.content == AOM_CONTENT_PSY && cpi->oxcf.luma_bias_override == 0)) {
-    int avg_brightness;
-    BitDepthInfo bd_info = get_bit_depth_info(&x->e_mbd);
-    if (bd_info.use_highbitdepth_buf) {
-      // We bitshift if the bitdepth is > 8 to normalize the results to 0-255
-      avg_brightness = av1_log_block_avg_hbd(x, bsize) >> (bd_info.bit_depth - 8);
-    } else {
-      avg_brightness = av1_log_block_avg(x, bsize);
-    }
-    double luma_adjustment = 0;
-    if (cpi->oxcf.luma_bias_override == 0 && cpi->oxcf.tune_cfg.content == AOM_CONTENT_PSY) { // If user hasn't set a luma-bias and we're using content=psy
-      //Equivalent to luma_bias = 15, with user-changable strength = 10, midpoint = 40
-      luma_adjustment = (1 - ((100. - 15.) / 100.)) / (1 + exp(-(cpi->oxcf.luma_bias_strength * (avg_brightness - cpi->oxcf.luma_bias_midpoint)) / 255.));
-      luma_adjustment += (cpi->oxcf.invert_luma_bias == 0) ? ((100. - 15.) / 100.) : 1.; // If not inverted, add 1.0 - strength/100, otherwise add 1
-    } else {
-      //luma_adjustment = cos( pow(((double)avg_brightness - 255.0) / (5100.0 / (10. + ((double)cpi->oxcf.luma_bias) / 8.) ), cpi->oxcf.luma_bias_power)); //Old method
-      luma_adjustment = (1 - ((100. - (double)cpi->oxcf.luma_bias) / 100.)) / (1 + exp(-(cpi->oxcf.luma_bias_strength * (avg_brightness - cpi->oxcf.luma_bias_midpoint)) / 255.)); // Sigmoid curve for modifying rdmult, with a max of 1.0 (by default), with user-adjustable variables.
-      luma_adjustment += (cpi->oxcf.invert_luma_bias == 0) ? ((100. - (double)cpi->oxcf.luma_bias) / 100.) : 1.;
-    }
-    //luma_adjustment = 1.0 - ((double) avg_brightness / (5100.0 / (double) cpi->oxcf.luma_bias)); Old method
-    x->rdmult = (int) ((double) x->rdmult * luma_adjustment);
-  }
+  set_luma_bias_rdmult(cpi, x, bsize, mi_row, mi_col);
 
   // Check to make sure that the adjustments above have not caused the
   // rd multiplier to be truncated to 0.
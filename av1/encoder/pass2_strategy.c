@@ -27,6 +27,7 @@
 #include "aom/aom_codec.h"
 #include "aom/aom_encoder.h"
 
+#include "av1/common/alloccommon.h"
 #include "av1/common/av1_common_int.h"
 
 #include "av1/encoder/encoder.h"
@@ -2843,6 +2844,42 @@ static int test_candidate_kf(const FIRSTPASS_INFO *firstpass_info,
   return is_viable_kf;
 }
 
+int av1_find_scene_cuts(const AV1EncoderConfig *oxcf,
+                        const FIRSTPASS_STATS *stats, int num_stats, int *cuts,
+                        int max_cuts) {
+  const KeyFrameCfg *const kf_cfg = &oxcf->kf_cfg;
+  const int num_mbs =
+      av1_get_MBs(oxcf->frm_dim_cfg.width, oxcf->frm_dim_cfg.height);
+  FIRSTPASS_INFO firstpass_info;
+  if (num_stats < 2 ||
+      av1_firstpass_info_init(&firstpass_info, (FIRSTPASS_STATS *)stats,
+                              num_stats) != AOM_CODEC_OK) {
+    return 0;
+  }
+
+  int num_cuts = 0;
+  int frames_since_key = 0;
+  for (int i = 1; i < num_stats; ++i) {
+    av1_firstpass_info_move_cur_index(&firstpass_info);
+    ++frames_since_key;
+    // Cut where the encoder would force a key frame, or at a scene cut.
+    int is_cut =
+        kf_cfg->key_freq_max > 0 && frames_since_key >= kf_cfg->key_freq_max;
+    if (!is_cut && kf_cfg->auto_key &&
+        frames_since_key >= kf_cfg->key_freq_min) {
+      is_cut = test_candidate_kf(&firstpass_info, 0, frames_since_key,
+                                 oxcf->rc_cfg.mode, ENABLE_SCENECUT_MODE_2,
+                                 num_mbs);
+    }
+    if (is_cut) {
+      if (num_cuts < max_cuts) cuts[num_cuts] = i;
+      ++num_cuts;
+      frames_since_key = 0;
+    }
+  }
+  return num_cuts;
+}
+
 #define FRAMES_TO_CHECK_DECAY 8
 #define KF_MIN_FRAME_BOOST 80.0
 #define KF_MAX_FRAME_BOOST 128.0
@@ -3977,6 +4014,13 @@ void av1_init_second_pass(AV1_COMP *cpi) {
   stats = twopass->stats_buf_ctx->total_stats;
 
   *stats = *twopass->stats_buf_ctx->stats_in_end;
+  // A zeroed total packet follows stats taken from part of a first pass.
+  if (stats->count == 0.0) {
+    for (const FIRSTPASS_STATS *s = twopass->stats_buf_ctx->stats_in_start;
+         s < twopass->stats_buf_ctx->stats_in_end; ++s) {
+      av1_accumulate_stats(stats, s);
+    }
+  }
   *twopass->stats_buf_ctx->total_left_stats = *stats;
 
   frame_rate = 10000000.0 * stats->count / stats->duration;
@@ -4170,7 +4214,8 @@ void av1_twopass_postencode_update(AV1_COMP *cpi) {
       if (cpi->vmaf_info.original_qindex != -1 &&
           ((cpi->oxcf.tune_cfg.tuning >= AOM_TUNE_VMAF_WITH_PREPROCESSING &&
            cpi->oxcf.tune_cfg.tuning <= AOM_TUNE_VMAF_NEG_MAX_GAIN) ||
-           cpi->oxcf.tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+           (cpi->oxcf.tune_cfg.tuning >= AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP &&
+            cpi->oxcf.tune_cfg.tuning <= AOM_TUNE_FAST_VMAF_PSY_QP) ||
            cpi->oxcf.vmaf_quantization == 1)) {
         p_rc->active_best_quality[i] = cpi->vmaf_info.original_qindex;
       }
@@ -148,6 +148,14 @@ void av1_identify_regions(const FIRSTPASS_STATS *const stats_start,
                           int total_frames, int offset, REGIONS *regions,
                           int *total_regions);
 
+// Finds the key frames of a whole sequence from its first pass stats, with
+// the scene cut detection of the second pass and the key frame distances of
+// 'oxcf'. Writes up to 'max_cuts' frame indices to 'cuts', and returns the
+// number of key frames after the first one.
+int av1_find_scene_cuts(const AV1EncoderConfig *oxcf,
+                        const FIRSTPASS_STATS *stats, int num_stats, int *cuts,
+                        int max_cuts);
+
 void av1_mark_flashes(FIRSTPASS_STATS *first_stats,
                       FIRSTPASS_STATS *last_stats);
 void av1_estimate_noise(FIRSTPASS_STATS *first_stats,
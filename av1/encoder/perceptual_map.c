@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <float.h>
+#include <math.h>
+
+#include "aom_mem/aom_mem.h"
+#include "av1/encoder/encodeframe_utils.h"
+#include "av1/encoder/perceptual_map.h"
+#include "av1/encoder/rd.h"
+
+int av1_build_perceptual_map_plane(PerceptualMapPlane *plane,
+                                   const double *factors, int mi_rows,
+                                   int mi_cols, int unit_mi_log2) {
+  const int unit = 1 << unit_mi_log2;
+  const int rows = (mi_rows + unit - 1) >> unit_mi_log2;
+  const int cols = (mi_cols + unit - 1) >> unit_mi_log2;
+  const int stride = cols + 1;
+  const int size = (rows + 1) * stride;
+
+  plane->valid = 0;
+  if (size > plane->alloc_size) {
+    aom_free(plane->log_sum);
+    plane->alloc_size = 0;
+    plane->log_sum = (double *)aom_malloc(size * sizeof(*plane->log_sum));
+    if (plane->log_sum == NULL) return 0;
+    plane->alloc_size = size;
+  }
+  plane->rows = rows;
+  plane->cols = cols;
+  plane->unit_mi_log2 = unit_mi_log2;
+
+  double *const log_sum = plane->log_sum;
+  memset(log_sum, 0, stride * sizeof(*log_sum));
+  for (int r = 0; r < rows; ++r) {
+    const double *const above = log_sum + r * stride;
+    double *const cur = log_sum + (r + 1) * stride;
+    const double *const row_factors = factors + r * cols;
+    double row_sum = 0.0;
+    cur[0] = 0.0;
+    for (int c = 0; c < cols; ++c) {
+      // A zero factor stays a (huge) finite negative log, so differences of
+      // the sums remain defined.
+      row_sum += log(AOMMAX(row_factors[c], DBL_MIN));
+      cur[c + 1] = above[c + 1] + row_sum;
+    }
+  }
+  plane->valid = 1;
+  return 1;
+}
+
+double av1_perceptual_map_log_sum(const PerceptualMapPlane *plane,
+                                  BLOCK_SIZE bsize, int mi_row, int mi_col,
+                                  int *count) {
+  assert(plane->valid);
+  const int unit_mi_log2 = plane->unit_mi_log2;
+  const int unit = 1 << unit_mi_log2;
+  const int row0 = mi_row >> unit_mi_log2;
+  const int col0 = mi_col >> unit_mi_log2;
+  const int row1 = AOMMIN(
+      plane->rows, row0 + ((mi_size_high[bsize] + unit - 1) >> unit_mi_log2));
+  const int col1 = AOMMIN(
+      plane->cols, col0 + ((mi_size_wide[bsize] + unit - 1) >> unit_mi_log2));
+  assert(row0 < row1 && col0 < col1);
+
+  const int stride = plane->cols + 1;
+  const double *const top = plane->log_sum + row0 * stride;
+  const double *const bottom = plane->log_sum + row1 * stride;
+  *count = (row1 - row0) * (col1 - col0);
+  return bottom[col1] - bottom[col0] - top[col1] + top[col0];
+}
+
+static int uses_ssim_map(const AV1EncoderConfig *oxcf) {
+  const aom_tune_metric tuning = oxcf->tune_cfg.tuning;
+  return tuning == AOM_TUNE_SSIM ||
+         tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY ||
+         tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+         tuning == AOM_TUNE_LAVISH || tuning == AOM_TUNE_LAVISH_FAST ||
+         tuning == AOM_TUNE_OMNI || tuning == AOM_TUNE_LAVISH_VMAF_RD;
+}
+
+static void setup_plane(AV1_COMP *cpi, int map, const double *factors,
+                        BLOCK_SIZE unit_bsize) {
+  AV1_COMMON *const cm = &cpi->common;
+  if (!av1_build_perceptual_map_plane(
+          &cpi->perceptual_maps[map], factors, cm->mi_params.mi_rows,
+          cm->mi_params.mi_cols, mi_size_wide_log2[unit_bsize])) {
+    aom_internal_error(cm->error, AOM_CODEC_MEM_ERROR,
+                       "Failed to allocate perceptual map");
+  }
+}
+
+void av1_setup_perceptual_maps(AV1_COMP *cpi) {
+  const AV1EncoderConfig *const oxcf = &cpi->oxcf;
+  const aom_tune_metric tuning = oxcf->tune_cfg.tuning;
+
+  for (int map = 0; map < PERCEPTUAL_MAPS; ++map) {
+    cpi->perceptual_maps[map].valid = 0;
+  }
+
+  if (uses_ssim_map(oxcf)) {
+#ifndef NDEBUG
+    const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+    const int unit = mi_size_wide[BLOCK_16X16];
+    const int num_units = ((mi_params->mi_rows + unit - 1) / unit) *
+                          ((mi_params->mi_cols + unit - 1) / unit);
+    for (int i = 0; i < num_units; ++i) {
+      assert(cpi->ssim_rdmult_scaling_factors[i] != 0.0);
+    }
+#endif
+    setup_plane(cpi, PERCEPTUAL_MAP_SSIM, cpi->ssim_rdmult_scaling_factors,
+                BLOCK_16X16);
+  }
+#if CONFIG_TUNE_VMAF
+  if (tuning == AOM_TUNE_VMAF_WITHOUT_PREPROCESSING ||
+      tuning == AOM_TUNE_VMAF_MAX_GAIN ||
+      tuning == AOM_TUNE_VMAF_NEG_MAX_GAIN ||
+      tuning == AOM_TUNE_LAVISH_VMAF_RD) {
+    setup_plane(cpi, PERCEPTUAL_MAP_VMAF,
+                cpi->vmaf_info.rdmult_scaling_factors, BLOCK_64X64);
+  }
+#endif
+#if CONFIG_TUNE_BUTTERAUGLI
+  if ((tuning == AOM_TUNE_BUTTERAUGLI || tuning == AOM_TUNE_LAVISH ||
+       tuning == AOM_TUNE_EXPERIMENTAL) &&
+      cpi->butteraugli_info.recon_set) {
+    setup_plane(cpi, PERCEPTUAL_MAP_BUTTERAUGLI,
+                cpi->butteraugli_info.rdmult_scaling_factors, BLOCK_32X32);
+  }
+#endif
+  if (tuning == AOM_TUNE_SSIMULACRA2 && cpi->ssimulacra2_info.recon_set) {
+    const TuneSsimulacra2Info *const info = &cpi->ssimulacra2_info;
+    const CommonModeInfoParams *const mi_params = &cpi->common.mi_params;
+    const int unit = mi_size_wide[SSIMULACRA2_RDO_BSIZE];
+    // The factors may have been derived at another frame size.
+    if (info->num_rows == (mi_params->mi_rows + unit - 1) / unit &&
+        info->num_cols == (mi_params->mi_cols + unit - 1) / unit) {
+      setup_plane(cpi, PERCEPTUAL_MAP_SSIMULACRA2,
+                  info->rdmult_scaling_factors, SSIMULACRA2_RDO_BSIZE);
+    }
+  }
+}
+
+void av1_free_perceptual_maps(PerceptualMapPlane *planes) {
+  for (int map = 0; map < PERCEPTUAL_MAPS; ++map) {
+    aom_free(planes[map].log_sum);
+    av1_zero(planes[map]);
+  }
+}
+
+void av1_set_perceptual_rdmult(const AV1_COMP *cpi, MACROBLOCK *x,
+                               BLOCK_SIZE bsize, int mi_row, int mi_col) {
+  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_SSIM ||
+      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY ||
+      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_IMAGE_PERCEPTUAL_QUALITY_VMAF_PSY_QP ||
+      cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_FAST) {
+    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,
+                        &x->rdmult);
+  }
+#if CONFIG_SALIENCY_MAP
+  else if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_SALIENCY_MAP) {
+    av1_set_saliency_map_vmaf_rdmult(cpi, &x->errorperbit,
+                                     cpi->common.seq_params->sb_size, mi_row,
+                                     mi_col, &x->rdmult);
+  }
+#endif
+#if CONFIG_TUNE_VMAF
+  else if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_WITHOUT_PREPROCESSING ||
+           cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_MAX_GAIN ||
+           cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_NEG_MAX_GAIN) {
+    av1_set_vmaf_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
+  }
+#endif
+  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_OMNI) { // SSIM tuning in euclidean space(?)
+    // Operate in long space since we get NaN or negative values otherwise due to the sheer size of the numbers.
+    long int pow_original_rdmult = (long int)powl((long double)x->rdmult, 2); // Square the original rdmult
+    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,  // Omni tuning, SSIM-like but calculated by squaring the variance result
+                        &x->rdmult);                                  // and then acquiring the square root of the resulting weight.
+    long int ssim_rdmult = (long int)powl((long double)x->rdmult, 2); // Square the rdmult post-ssim tuning.
+    x->rdmult = (int)((sqrtl(ssim_rdmult + pow_original_rdmult)) / sqrt(2) + 0.5);
+    x->rdmult = AOMMAX(x->rdmult, 0);
+    av1_set_error_per_bit(&x->errorperbit, x->rdmult);
+    // Should this method be done in weight-space rather than rdmult-space? Maybe.
+  }
+#if CONFIG_TUNE_BUTTERAUGLI
+  else if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_BUTTERAUGLI) {
+    av1_set_butteraugli_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
+  }
+
+  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH) {
+    int lavish_rdmult = x->rdmult;
+    av1_set_butteraugli_rdmult(cpi, x, bsize, mi_row, mi_col, &lavish_rdmult);
+    int ssim_rdmult = x->rdmult;
+    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,
+                        &ssim_rdmult);
+
+    x->rdmult = (int) (((int64_t)(lavish_rdmult * 2.5) + (int64_t)(ssim_rdmult)) / 3.5);
+  }
+#endif
+#if CONFIG_TUNE_VMAF
+  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH_VMAF_RD) {
+    int vmaf_rdmult = x->rdmult;
+    av1_set_vmaf_rdmult(cpi, x, bsize, mi_row, mi_col, &vmaf_rdmult);
+    int ssim_rdmult = x->rdmult;
+    av1_set_ssim_rdmult(cpi, &x->errorperbit, bsize, mi_row, mi_col,
+                        &ssim_rdmult);
+
+    x->rdmult = (int) (((int64_t)(vmaf_rdmult * 2.5) + (int64_t)(ssim_rdmult)) / 3.5);
+  }
+
+#if CONFIG_TUNE_BUTTERAUGLI
+  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL) {
+    av1_set_butteraugli_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
+  }
+#endif
+#endif
+  if (cpi->oxcf.tune_cfg.tuning == AOM_TUNE_SSIMULACRA2) {
+    av1_set_ssimulacra2_rdmult(cpi, x, bsize, mi_row, mi_col, &x->rdmult);
+  }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#ifndef AOM_AV1_ENCODER_PERCEPTUAL_MAP_H_
+#define AOM_AV1_ENCODER_PERCEPTUAL_MAP_H_
+
+#include "av1/encoder/encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fills 'plane' from the per-unit scaling factors 'factors' of a frame of
+// mi_rows x mi_cols, in units of (1 << unit_mi_log2) mi. Returns 0 when out of
+// memory.
+int av1_build_perceptual_map_plane(PerceptualMapPlane *plane,
+                                   const double *factors, int mi_rows,
+                                   int mi_cols, int unit_mi_log2);
+
+// Returns the sum of the log factors of the map units covered by the block at
+// (mi_row, mi_col), and their number in 'count'.
+double av1_perceptual_map_log_sum(const PerceptualMapPlane *plane,
+                                  BLOCK_SIZE bsize, int mi_row, int mi_col,
+                                  int *count);
+
+// Builds cpi->perceptual_maps from the scaling factors of the maps the tune
+// uses. Called once the factors are final, before the frame is encoded.
+void av1_setup_perceptual_maps(AV1_COMP *cpi);
+
+void av1_free_perceptual_maps(PerceptualMapPlane *planes);
+
+// Applies the perceptual maps of the tune to x->rdmult.
+void av1_set_perceptual_rdmult(const AV1_COMP *cpi, MACROBLOCK *x,
+                               BLOCK_SIZE bsize, int mi_row, int mi_col);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // AOM_AV1_ENCODER_PERCEPTUAL_MAP_H_
@@ -12,8 +12,11 @@
 #include <float.h>
 #include <string.h>
 
+#include "config/av1_rtcd.h"
+
 #include "av1/encoder/encoder.h"
 #include "av1/encoder/encoder_utils.h"
+#include "av1/encoder/ethread.h"
 #include "av1/encoder/firstpass.h"
 #include "av1/encoder/rdopt.h"
 #include "av1/encoder/saliency_map.h"
@@ -25,1242 +28,719 @@
 // lambda1 = 1
 // gamma=0.8
 // phi =0
-static const double kGaborFilter[4][9][9] = {  // [angle: 0, 45, 90, 135
-                                               // degree][ksize][ksize]
-  { { 2.0047323e-06, 6.6387620e-05, 8.0876675e-04, 3.6246411e-03, 5.9760227e-03,
-      3.6246411e-03, 8.0876675e-04, 6.6387620e-05, 2.0047323e-06 },
-    { 1.8831115e-05, 6.2360091e-04, 7.5970138e-03, 3.4047455e-02, 5.6134764e-02,
-      3.4047455e-02, 7.5970138e-03, 6.2360091e-04, 1.8831115e-05 },
-    { 9.3271126e-05, 3.0887155e-03, 3.7628256e-02, 1.6863814e-01, 2.7803731e-01,
-      1.6863814e-01, 3.7628256e-02, 3.0887155e-03, 9.3271126e-05 },
-    { 2.4359586e-04, 8.0667874e-03, 9.8273583e-02, 4.4043165e-01, 7.2614902e-01,
-      4.4043165e-01, 9.8273583e-02, 8.0667874e-03, 2.4359586e-04 },
-    { 3.3546262e-04, 1.1108996e-02, 1.3533528e-01, 6.0653067e-01, 1.0000000e+00,
-      6.0653067e-01, 1.3533528e-01, 1.1108996e-02, 3.3546262e-04 },
-    { 2.4359586e-04, 8.0667874e-03, 9.8273583e-02, 4.4043165e-01, 7.2614902e-01,
-      4.4043165e-01, 9.8273583e-02, 8.0667874e-03, 2.4359586e-04 },
-    { 9.3271126e-05, 3.0887155e-03, 3.7628256e-02, 1.6863814e-01, 2.7803731e-01,
-      1.6863814e-01, 3.7628256e-02, 3.0887155e-03, 9.3271126e-05 },
-    { 1.8831115e-05, 6.2360091e-04, 7.5970138e-03, 3.4047455e-02, 5.6134764e-02,
-      3.4047455e-02, 7.5970138e-03, 6.2360091e-04, 1.8831115e-05 },
-    { 2.0047323e-06, 6.6387620e-05, 8.0876675e-04, 3.6246411e-03, 5.9760227e-03,
-      3.6246411e-03, 8.0876675e-04, 6.6387620e-05, 2.0047323e-06 } },
-
-  { { -6.2165498e-08, 3.8760313e-06, 3.0079011e-06, -4.4602581e-04,
-      6.6981313e-04, 1.3962291e-03, -9.9486928e-04, -8.1631159e-05,
-      3.5712848e-05 },
-    { 3.8760313e-06, 5.7044272e-06, -1.6041942e-03, 4.5687673e-03,
-      1.8061366e-02, -2.4406660e-02, -3.7979286e-03, 3.1511115e-03,
-      -8.1631159e-05 },
-    { 3.0079011e-06, -1.6041942e-03, 8.6645801e-03, 6.4960226e-02,
-      -1.6647682e-01, -4.9129307e-02, 7.7304743e-02, -3.7979286e-03,
-      -9.9486928e-04 },
-    { -4.4602581e-04, 4.5687673e-03, 6.4960226e-02, -3.1572008e-01,
-      -1.7670043e-01, 5.2729243e-01, -4.9129307e-02, -2.4406660e-02,
-      1.3962291e-03 },
-    { 6.6981313e-04, 1.8061366e-02, -1.6647682e-01, -1.7670043e-01,
-      1.0000000e+00, -1.7670043e-01, -1.6647682e-01, 1.8061366e-02,
-      6.6981313e-04 },
-    { 1.3962291e-03, -2.4406660e-02, -4.9129307e-02, 5.2729243e-01,
-      -1.7670043e-01, -3.1572008e-01, 6.4960226e-02, 4.5687673e-03,
-      -4.4602581e-04 },
-    { -9.9486928e-04, -3.7979286e-03, 7.7304743e-02, -4.9129307e-02,
-      -1.6647682e-01, 6.4960226e-02, 8.6645801e-03, -1.6041942e-03,
-      3.0079011e-06 },
-    { -8.1631159e-05, 3.1511115e-03, -3.7979286e-03, -2.4406660e-02,
-      1.8061366e-02, 4.5687673e-03, -1.6041942e-03, 5.7044272e-06,
-      3.8760313e-06 },
-    { 3.5712848e-05, -8.1631159e-05, -9.9486928e-04, 1.3962291e-03,
-      6.6981313e-04, -4.4602581e-04, 3.0079011e-06, 3.8760313e-06,
-      -6.2165498e-08 } },
-
-  { { 2.0047323e-06, 1.8831115e-05, 9.3271126e-05, 2.4359586e-04, 3.3546262e-04,
-      2.4359586e-04, 9.3271126e-05, 1.8831115e-05, 2.0047323e-06 },
-    { 6.6387620e-05, 6.2360091e-04, 3.0887155e-03, 8.0667874e-03, 1.1108996e-02,
-      8.0667874e-03, 3.0887155e-03, 6.2360091e-04, 6.6387620e-05 },
-    { 8.0876675e-04, 7.5970138e-03, 3.7628256e-02, 9.8273583e-02, 1.3533528e-01,
-      9.8273583e-02, 3.7628256e-02, 7.5970138e-03, 8.0876675e-04 },
-    { 3.6246411e-03, 3.4047455e-02, 1.6863814e-01, 4.4043165e-01, 6.0653067e-01,
-      4.4043165e-01, 1.6863814e-01, 3.4047455e-02, 3.6246411e-03 },
-    { 5.9760227e-03, 5.6134764e-02, 2.7803731e-01, 7.2614902e-01, 1.0000000e+00,
-      7.2614902e-01, 2.7803731e-01, 5.6134764e-02, 5.9760227e-03 },
-    { 3.6246411e-03, 3.4047455e-02, 1.6863814e-01, 4.4043165e-01, 6.0653067e-01,
-      4.4043165e-01, 1.6863814e-01, 3.4047455e-02, 3.6246411e-03 },
-    { 8.0876675e-04, 7.5970138e-03, 3.7628256e-02, 9.8273583e-02, 1.3533528e-01,
-      9.8273583e-02, 3.7628256e-02, 7.5970138e-03, 8.0876675e-04 },
-    { 6.6387620e-05, 6.2360091e-04, 3.0887155e-03, 8.0667874e-03, 1.1108996e-02,
-      8.0667874e-03, 3.0887155e-03, 6.2360091e-04, 6.6387620e-05 },
-    { 2.0047323e-06, 1.8831115e-05, 9.3271126e-05, 2.4359586e-04, 3.3546262e-04,
-      2.4359586e-04, 9.3271126e-05, 1.8831115e-05, 2.0047323e-06 } },
-
-  { { 3.5712848e-05, -8.1631159e-05, -9.9486928e-04, 1.3962291e-03,
-      6.6981313e-04, -4.4602581e-04, 3.0079011e-06, 3.8760313e-06,
-      -6.2165498e-08 },
-    { -8.1631159e-05, 3.1511115e-03, -3.7979286e-03, -2.4406660e-02,
-      1.8061366e-02, 4.5687673e-03, -1.6041942e-03, 5.7044272e-06,
-      3.8760313e-06 },
-    { -9.9486928e-04, -3.7979286e-03, 7.7304743e-02, -4.9129307e-02,
-      -1.6647682e-01, 6.4960226e-02, 8.6645801e-03, -1.6041942e-03,
-      3.0079011e-06 },
-    { 1.3962291e-03, -2.4406660e-02, -4.9129307e-02, 5.2729243e-01,
-      -1.7670043e-01, -3.1572008e-01, 6.4960226e-02, 4.5687673e-03,
-      -4.4602581e-04 },
-    { 6.6981313e-04, 1.8061366e-02, -1.6647682e-01, -1.7670043e-01,
-      1.0000000e+00, -1.7670043e-01, -1.6647682e-01, 1.8061366e-02,
-      6.6981313e-04 },
-    { -4.4602581e-04, 4.5687673e-03, 6.4960226e-02, -3.1572008e-01,
-      -1.7670043e-01, 5.2729243e-01, -4.9129307e-02, -2.4406660e-02,
-      1.3962291e-03 },
-    { 3.0079011e-06, -1.6041942e-03, 8.6645801e-03, 6.4960226e-02,
-      -1.6647682e-01, -4.9129307e-02, 7.7304743e-02, -3.7979286e-03,
-      -9.9486928e-04 },
-    { 3.8760313e-06, 5.7044272e-06, -1.6041942e-03, 4.5687673e-03,
-      1.8061366e-02, -2.4406660e-02, -3.7979286e-03, 3.1511115e-03,
-      -8.1631159e-05 },
-    { -6.2165498e-08, 3.8760313e-06, 3.0079011e-06, -4.4602581e-04,
-      6.6981313e-04, 1.3962291e-03, -9.9486928e-04, -8.1631159e-05,
-      3.5712848e-05 } }
+static const float kGaborFilter[SALIENCY_ANGLES][SALIENCY_GABOR_TAPS]
+                                [SALIENCY_GABOR_TAPS] = {
+  { { 2.0047323e-06f, 6.6387620e-05f, 8.0876675e-04f, 3.6246411e-03f,
+      5.9760227e-03f, 3.6246411e-03f, 8.0876675e-04f, 6.6387620e-05f,
+      2.0047323e-06f },
+    { 1.8831115e-05f, 6.2360091e-04f, 7.5970138e-03f, 3.4047455e-02f,
+      5.6134764e-02f, 3.4047455e-02f, 7.5970138e-03f, 6.2360091e-04f,
+      1.8831115e-05f },
+    { 9.3271126e-05f, 3.0887155e-03f, 3.7628256e-02f, 1.6863814e-01f,
+      2.7803731e-01f, 1.6863814e-01f, 3.7628256e-02f, 3.0887155e-03f,
+      9.3271126e-05f },
+    { 2.4359586e-04f, 8.0667874e-03f, 9.8273583e-02f, 4.4043165e-01f,
+      7.2614902e-01f, 4.4043165e-01f, 9.8273583e-02f, 8.0667874e-03f,
+      2.4359586e-04f },
+    { 3.3546262e-04f, 1.1108996e-02f, 1.3533528e-01f, 6.0653067e-01f,
+      1.0000000e+00f, 6.0653067e-01f, 1.3533528e-01f, 1.1108996e-02f,
+      3.3546262e-04f },
+    { 2.4359586e-04f, 8.0667874e-03f, 9.8273583e-02f, 4.4043165e-01f,
+      7.2614902e-01f, 4.4043165e-01f, 9.8273583e-02f, 8.0667874e-03f,
+      2.4359586e-04f },
+    { 9.3271126e-05f, 3.0887155e-03f, 3.7628256e-02f, 1.6863814e-01f,
+      2.7803731e-01f, 1.6863814e-01f, 3.7628256e-02f, 3.0887155e-03f,
+      9.3271126e-05f },
+    { 1.8831115e-05f, 6.2360091e-04f, 7.5970138e-03f, 3.4047455e-02f,
+      5.6134764e-02f, 3.4047455e-02f, 7.5970138e-03f, 6.2360091e-04f,
+      1.8831115e-05f },
+    { 2.0047323e-06f, 6.6387620e-05f, 8.0876675e-04f, 3.6246411e-03f,
+      5.9760227e-03f, 3.6246411e-03f, 8.0876675e-04f, 6.6387620e-05f,
+      2.0047323e-06f } },
+  { { -6.2165498e-08f, 3.8760313e-06f, 3.0079011e-06f, -4.4602581e-04f,
+      6.6981313e-04f, 1.3962291e-03f, -9.9486928e-04f, -8.1631159e-05f,
+      3.5712848e-05f },
+    { 3.8760313e-06f, 5.7044272e-06f, -1.6041942e-03f, 4.5687673e-03f,
+      1.8061366e-02f, -2.4406660e-02f, -3.7979286e-03f, 3.1511115e-03f,
+      -8.1631159e-05f },
+    { 3.0079011e-06f, -1.6041942e-03f, 8.6645801e-03f, 6.4960226e-02f,
+      -1.6647682e-01f, -4.9129307e-02f, 7.7304743e-02f, -3.7979286e-03f,
+      -9.9486928e-04f },
+    { -4.4602581e-04f, 4.5687673e-03f, 6.4960226e-02f, -3.1572008e-01f,
+      -1.7670043e-01f, 5.2729243e-01f, -4.9129307e-02f, -2.4406660e-02f,
+      1.3962291e-03f },
+    { 6.6981313e-04f, 1.8061366e-02f, -1.6647682e-01f, -1.7670043e-01f,
+      1.0000000e+00f, -1.7670043e-01f, -1.6647682e-01f, 1.8061366e-02f,
+      6.6981313e-04f },
+    { 1.3962291e-03f, -2.4406660e-02f, -4.9129307e-02f, 5.2729243e-01f,
+      -1.7670043e-01f, -3.1572008e-01f, 6.4960226e-02f, 4.5687673e-03f,
+      -4.4602581e-04f },
+    { -9.9486928e-04f, -3.7979286e-03f, 7.7304743e-02f, -4.9129307e-02f,
+      -1.6647682e-01f, 6.4960226e-02f, 8.6645801e-03f, -1.6041942e-03f,
+      3.0079011e-06f },
+    { -8.1631159e-05f, 3.1511115e-03f, -3.7979286e-03f, -2.4406660e-02f,
+      1.8061366e-02f, 4.5687673e-03f, -1.6041942e-03f, 5.7044272e-06f,
+      3.8760313e-06f },
+    { 3.5712848e-05f, -8.1631159e-05f, -9.9486928e-04f, 1.3962291e-03f,
+      6.6981313e-04f, -4.4602581e-04f, 3.0079011e-06f, 3.8760313e-06f,
+      -6.2165498e-08f } },
+  { { 2.0047323e-06f, 1.8831115e-05f, 9.3271126e-05f, 2.4359586e-04f,
+      3.3546262e-04f, 2.4359586e-04f, 9.3271126e-05f, 1.8831115e-05f,
+      2.0047323e-06f },
+    { 6.6387620e-05f, 6.2360091e-04f, 3.0887155e-03f, 8.0667874e-03f,
+      1.1108996e-02f, 8.0667874e-03f, 3.0887155e-03f, 6.2360091e-04f,
+      6.6387620e-05f },
+    { 8.0876675e-04f, 7.5970138e-03f, 3.7628256e-02f, 9.8273583e-02f,
+      1.3533528e-01f, 9.8273583e-02f, 3.7628256e-02f, 7.5970138e-03f,
+      8.0876675e-04f },
+    { 3.6246411e-03f, 3.4047455e-02f, 1.6863814e-01f, 4.4043165e-01f,
+      6.0653067e-01f, 4.4043165e-01f, 1.6863814e-01f, 3.4047455e-02f,
+      3.6246411e-03f },
+    { 5.9760227e-03f, 5.6134764e-02f, 2.7803731e-01f, 7.2614902e-01f,
+      1.0000000e+00f, 7.2614902e-01f, 2.7803731e-01f, 5.6134764e-02f,
+      5.9760227e-03f },
+    { 3.6246411e-03f, 3.4047455e-02f, 1.6863814e-01f, 4.4043165e-01f,
+      6.0653067e-01f, 4.4043165e-01f, 1.6863814e-01f, 3.4047455e-02f,
+      3.6246411e-03f },
+    { 8.0876675e-04f, 7.5970138e-03f, 3.7628256e-02f, 9.8273583e-02f,
+      1.3533528e-01f, 9.8273583e-02f, 3.7628256e-02f, 7.5970138e-03f,
+      8.0876675e-04f },
+    { 6.6387620e-05f, 6.2360091e-04f, 3.0887155e-03f, 8.0667874e-03f,
+      1.1108996e-02f, 8.0667874e-03f, 3.0887155e-03f, 6.2360091e-04f,
+      6.6387620e-05f },
+    { 2.0047323e-06f, 1.8831115e-05f, 9.3271126e-05f, 2.4359586e-04f,
+      3.3546262e-04f, 2.4359586e-04f, 9.3271126e-05f, 1.8831115e-05f,
+      2.0047323e-06f } },
+  { { 3.5712848e-05f, -8.1631159e-05f, -9.9486928e-04f, 1.3962291e-03f,
+      6.6981313e-04f, -4.4602581e-04f, 3.0079011e-06f, 3.8760313e-06f,
+      -6.2165498e-08f },
+    { -8.1631159e-05f, 3.1511115e-03f, -3.7979286e-03f, -2.4406660e-02f,
+      1.8061366e-02f, 4.5687673e-03f, -1.6041942e-03f, 5.7044272e-06f,
+      3.8760313e-06f },
+    { -9.9486928e-04f, -3.7979286e-03f, 7.7304743e-02f, -4.9129307e-02f,
+      -1.6647682e-01f, 6.4960226e-02f, 8.6645801e-03f, -1.6041942e-03f,
+      3.0079011e-06f },
+    { 1.3962291e-03f, -2.4406660e-02f, -4.9129307e-02f, 5.2729243e-01f,
+      -1.7670043e-01f, -3.1572008e-01f, 6.4960226e-02f, 4.5687673e-03f,
+      -4.4602581e-04f },
+    { 6.6981313e-04f, 1.8061366e-02f, -1.6647682e-01f, -1.7670043e-01f,
+      1.0000000e+00f, -1.7670043e-01f, -1.6647682e-01f, 1.8061366e-02f,
+      6.6981313e-04f },
+    { -4.4602581e-04f, 4.5687673e-03f, 6.4960226e-02f, -3.1572008e-01f,
+      -1.7670043e-01f, 5.2729243e-01f, -4.9129307e-02f, -2.4406660e-02f,
+      1.3962291e-03f },
+    { 3.0079011e-06f, -1.6041942e-03f, 8.6645801e-03f, 6.4960226e-02f,
+      -1.6647682e-01f, -4.9129307e-02f, 7.7304743e-02f, -3.7979286e-03f,
+      -9.9486928e-04f },
+    { 3.8760313e-06f, 5.7044272e-06f, -1.6041942e-03f, 4.5687673e-03f,
+      1.8061366e-02f, -2.4406660e-02f, -3.7979286e-03f, 3.1511115e-03f,
+      -8.1631159e-05f },
+    { -6.2165498e-08f, 3.8760313e-06f, 3.0079011e-06f, -4.4602581e-04f,
+      6.6981313e-04f, 1.3962291e-03f, -9.9486928e-04f, -8.1631159e-05f,
+      3.5712848e-05f } },
 };
 
-// This function is to extract red/green/blue channels, and calculate intensity
-// = (r+g+b)/3. Note that it only handles 8bits case now.
-// TODO(linzhen): add high bitdepth support.
-static void get_color_intensity(const YV12_BUFFER_CONFIG *src,
-                                int subsampling_x, int subsampling_y,
-                                double *cr, double *cg, double *cb,
-                                double *intensity) {
-  const uint8_t *y = src->buffers[0];
-  const uint8_t *u = src->buffers[1];
-  const uint8_t *v = src->buffers[2];
-
-  const int y_height = src->crop_heights[0];
-  const int y_width = src->crop_widths[0];
-  const int y_stride = src->strides[0];
-  const int c_stride = src->strides[1];
-
-  for (int i = 0; i < y_height; ++i) {
-    for (int j = 0; j < y_width; ++j) {
-      cr[i * y_width + j] =
-          fclamp((double)y[i * y_stride + j] +
-                     1.370 * (double)(v[(i >> subsampling_y) * c_stride +
-                                        (j >> subsampling_x)] -
-                                      128),
-                 0, 255);
-      cg[i * y_width + j] =
-          fclamp((double)y[i * y_stride + j] -
-                     0.698 * (double)(u[(i >> subsampling_y) * c_stride +
-                                        (j >> subsampling_x)] -
-                                      128) -
-                     0.337 * (double)(v[(i >> subsampling_y) * c_stride +
-                                        (j >> subsampling_x)] -
-                                      128),
-                 0, 255);
-      cb[i * y_width + j] =
-          fclamp((double)y[i * y_stride + j] +
-                     1.732 * (double)(u[(i >> subsampling_y) * c_stride +
-                                        (j >> subsampling_x)] -
-                                      128),
-                 0, 255);
-
-      intensity[i * y_width + j] =
-          (cr[i * y_width + j] + cg[i * y_width + j] + cb[i * y_width + j]) /
-          3.0;
-      assert(intensity[i * y_width + j] >= 0 &&
-             intensity[i * y_width + j] <= 255);
-
-      intensity[i * y_width + j] /= 256;
-      cr[i * y_width + j] /= 256;
-      cg[i * y_width + j] /= 256;
-      cb[i * y_width + j] /= 256;
-    }
-  }
-}
 
-static INLINE double convolve_map(const double *filter, const double *map,
-                                  const int size) {
-  double result = 0;
-  for (int i = 0; i < size; ++i) {
-    result += filter[i] * map[i];  // symmetric filter is used
-  }
-  return result;
-}
+// Separable 5-tap gaussian of the pyramid decimation. The 5x5 filter is the
+// outer product of these taps.
+static const float kDecimateFilter[5] = { 1.0f / 16, 4.0f / 16, 6.0f / 16,
+                                          4.0f / 16, 1.0f / 16 };
 
-// This function is to decimate the map by half, and apply Gaussian filter on
-// top of the downsampled map.
-static INLINE void decimate_map(const double *map, int height, int width,
-                                int stride, double *downsampled_map) {
-  const int new_width = width / 2;
-  const int window_size = 5;
-  const double gaussian_filter[25] = {
-    1. / 256, 1.0 / 64, 3. / 128, 1. / 64,  1. / 256, 1. / 64, 1. / 16,
-    3. / 32,  1. / 16,  1. / 64,  3. / 128, 3. / 32,  9. / 64, 3. / 32,
-    3. / 128, 1. / 64,  1. / 16,  3. / 32,  1. / 16,  1. / 64, 1. / 256,
-    1. / 64,  3. / 128, 1. / 64,  1. / 256
-  };
+// The conspicuity maps are level 2 maps, so a band of SALIENCY_BAND_ROWS
+// frame rows covers this many of their rows.
+#define LEVEL2_BAND_ROWS (SALIENCY_BAND_ROWS >> 2)
 
-  double map_region[25];
-  for (int y = 0; y < height - 1; y += 2) {
-    for (int x = 0; x < width - 1; x += 2) {
-      int i = 0;
-      for (int yy = y - window_size / 2; yy <= y + window_size / 2; ++yy) {
-        for (int xx = x - window_size / 2; xx <= x + window_size / 2; ++xx) {
-          int yvalue = clamp(yy, 0, height - 1);
-          int xvalue = clamp(xx, 0, width - 1);
-          map_region[i++] = map[yvalue * stride + xvalue];
-        }
-      }
-      downsampled_map[(y / 2) * new_width + (x / 2)] =
-          convolve_map(gaussian_filter, map_region, window_size * window_size);
-    }
-  }
+static INLINE int num_bands(int rows, int band_rows) {
+  return (rows + band_rows - 1) / band_rows;
 }
 
-// This function is to upscale the map from in_level size to out_level size.
-// Note that the map at "level-1" will upscale the map at "level" by x2.
-static INLINE int upscale_map(const double *input, int in_level, int out_level,
-                              int height[9], int width[9], double *output) {
-  for (int level = in_level; level > out_level; level--) {
-    const int cur_width = width[level];
-    const int cur_height = height[level];
-    const int cur_stride = width[level];
-
-    double *original = (level == in_level) ? (double *)input : output;
-
-    assert(level > 0);
-
-    const int h_upscale = height[level - 1];
-    const int w_upscale = width[level - 1];
-    const int s_upscale = width[level - 1];
-
-    double *upscale = aom_malloc(h_upscale * w_upscale * sizeof(*upscale));
-
-    if (!upscale) {
-      return 0;
-    }
-
-    for (int i = 0; i < h_upscale; ++i) {
-      for (int j = 0; j < w_upscale; ++j) {
-        const int ii = clamp((i >> 1), 0, cur_height - 1);
-        const int jj = clamp((j >> 1), 0, cur_width - 1);
-        upscale[j + i * s_upscale] = (double)original[jj + ii * cur_stride];
-      }
-    }
-    memcpy(output, upscale, h_upscale * w_upscale * sizeof(double));
-    aom_free(upscale);
-  }
-
-  return 1;
+// Number of blocks of the normalization operator along a map dimension. As
+// in the original algorithm, blocks start strictly below size - block size.
+static INLINE int num_local_blocks(int size) {
+  return size > SALIENCY_BAND_ROWS ? (size - 1) / SALIENCY_BAND_ROWS : 0;
 }
 
-// This function calculates the differences between a fine scale c and a
-// coarser scale s yielding the feature maps. c \in {2, 3, 4}, and s = c +
-// delta, where delta \in {3, 4}.
-static int center_surround_diff(const double *input[9], int height[9],
-                                int width[9], saliency_feature_map *output[6]) {
-  int j = 0;
-  for (int k = 2; k < 5; ++k) {
-    int cur_height = height[k];
-    int cur_width = width[k];
-
-    if (upscale_map(input[k + 3], k + 3, k, height, width, output[j]->buf) ==
-        0) {
-      return 0;
-    }
-
-    for (int r = 0; r < cur_height; ++r) {
-      for (int c = 0; c < cur_width; ++c) {
-        output[j]->buf[r * cur_width + c] =
-            fabs((double)(input[k][r * cur_width + c] -
-                          output[j]->buf[r * cur_width + c]));
-      }
-    }
-
-    if (upscale_map(input[k + 4], k + 4, k, height, width,
-                    output[j + 1]->buf) == 0) {
-      return 0;
-    }
-
-    for (int r = 0; r < cur_height; ++r) {
-      for (int c = 0; c < cur_width; ++c) {
-        output[j + 1]->buf[r * cur_width + c] =
-            fabs(input[k][r * cur_width + c] -
-                 output[j + 1]->buf[r * cur_width + c]);
-      }
-    }
-
-    j += 2;
-  }
-  return 1;
+// Pyramid level of the center scale of a feature map.
+static INLINE int feature_level(int map) {
+  return 2 + (map % SALIENCY_CS_MAPS) / 2;
 }
 
-// For color channels, the differences is calculated based on "color
-// double-opponency". For example, the RG feature map is constructed between a
-// fine scale c of R-G component and a coarser scale s of G-R component.
-static int center_surround_diff_rgb(const double *input_1[9],
-                                    const double *input_2[9], int height[9],
-                                    int width[9],
-                                    saliency_feature_map *output[6]) {
-  int j = 0;
-  for (int k = 2; k < 5; ++k) {
-    int cur_height = height[k];
-    int cur_width = width[k];
-
-    if (upscale_map(input_2[k + 3], k + 3, k, height, width, output[j]->buf) ==
-        0) {
-      return 0;
-    }
-
-    for (int r = 0; r < cur_height; ++r) {
-      for (int c = 0; c < cur_width; ++c) {
-        output[j]->buf[r * cur_width + c] =
-            fabs((double)(input_1[k][r * cur_width + c] -
-                          output[j]->buf[r * cur_width + c]));
-      }
-    }
-
-    if (upscale_map(input_2[k + 4], k + 4, k, height, width,
-                    output[j + 1]->buf) == 0) {
-      return 0;
-    }
-
-    for (int r = 0; r < cur_height; ++r) {
-      for (int c = 0; c < cur_width; ++c) {
-        output[j + 1]->buf[r * cur_width + c] =
-            fabs(input_1[k][r * cur_width + c] -
-                 output[j + 1]->buf[r * cur_width + c]);
-      }
-    }
-
-    j += 2;
+static INLINE void extend_row(float *row, int width) {
+  for (int i = 1; i <= SALIENCY_BORDER; ++i) {
+    row[-i] = row[0];
+    row[width - 1 + i] = row[width - 1];
   }
-  return 1;
 }
 
-// This function is to generate Gaussian pyramid images with indexes from 0 to
-// 8, and construct the feature maps from calculating the center-surround
-// differences.
-static int gaussian_pyramid(const double *src, int width[9], int height[9],
-                            saliency_feature_map *dst[6]) {
-  double *gaussian_map[9];  // scale = 9
-  gaussian_map[0] =
-      (double *)aom_malloc(width[0] * height[0] * sizeof(*gaussian_map[0]));
-  if (!gaussian_map[0]) {
-    return 0;
+// rows[] point at column -2 of the five input rows, and tmp holds width + 4
+// floats.
+void av1_saliency_decimate_row_c(const float *const *rows, int width,
+                                 float *tmp, float *dst) {
+  const float *const k = kDecimateFilter;
+  for (int x = 0; x < width + 4; ++x) {
+    tmp[x] = k[0] * rows[0][x] + k[1] * rows[1][x] + k[2] * rows[2][x] +
+             k[3] * rows[3][x] + k[4] * rows[4][x];
   }
-
-  memcpy(gaussian_map[0], src, width[0] * height[0] * sizeof(double));
-
-  for (int i = 1; i < 9; ++i) {
-    int stride = width[i - 1];
-    int new_width = width[i];
-    int new_height = height[i];
-
-    gaussian_map[i] =
-        (double *)aom_malloc(new_width * new_height * sizeof(*gaussian_map[i]));
-
-    if (!gaussian_map[i]) {
-      for (int l = 0; l < i; ++l) {
-        aom_free(gaussian_map[l]);
-      }
-      return 0;
-    }
-
-    memset(gaussian_map[i], 0, new_width * new_height * sizeof(double));
-
-    decimate_map(gaussian_map[i - 1], height[i - 1], width[i - 1], stride,
-                 gaussian_map[i]);
-  }
-
-  if (center_surround_diff((const double **)gaussian_map, height, width, dst) ==
-      0) {
-    for (int l = 0; l < 9; ++l) {
-      aom_free(gaussian_map[l]);
-    }
-    return 0;
-  }
-
-  for (int i = 0; i < 9; ++i) {
-    aom_free(gaussian_map[i]);
+  for (int x = 0; x < width / 2; ++x) {
+    const float *const t = tmp + 2 * x;
+    dst[x] = k[0] * t[0] + k[1] * t[1] + k[2] * t[2] + k[3] * t[3] +
+             k[4] * t[4];
   }
-  return 1;
 }
 
-static int gaussian_pyramid_rgb(double *src_1, double *src_2, int width[9],
-                                int height[9], saliency_feature_map *dst[6]) {
-  double *gaussian_map[2][9];  // scale = 9
-  double *src[2];
-
-  src[0] = src_1;
-  src[1] = src_2;
-
-  for (int k = 0; k < 2; ++k) {
-    gaussian_map[k][0] = (double *)aom_malloc(width[0] * height[0] *
-                                              sizeof(*gaussian_map[k][0]));
-    if (!gaussian_map[k][0]) {
-      for (int l = 0; l < k; ++l) {
-        aom_free(gaussian_map[l][0]);
+// rows[] point at column -SALIENCY_BORDER of the input rows.
+void av1_saliency_gabor_row_c(const float *const *rows, int width,
+                              const float *kernel, float *dst) {
+  for (int x = 0; x < width; ++x) {
+    float sum = 0.0f;
+    for (int k = 0; k < SALIENCY_GABOR_TAPS; ++k) {
+      for (int l = 0; l < SALIENCY_GABOR_TAPS; ++l) {
+        sum += kernel[k * SALIENCY_GABOR_TAPS + l] * rows[k][x + l];
       }
-      return 0;
-    }
-    memcpy(gaussian_map[k][0], src[k], width[0] * height[0] * sizeof(double));
-
-    for (int i = 1; i < 9; ++i) {
-      int stride = width[i - 1];
-      int new_width = width[i];
-      int new_height = height[i];
-
-      gaussian_map[k][i] = (double *)aom_malloc(new_width * new_height *
-                                                sizeof(*gaussian_map[k][i]));
-      if (!gaussian_map[k][i]) {
-        for (int l = 0; l < k; ++l) {
-          aom_free(gaussian_map[l][i]);
-        }
-        return 0;
-      }
-      memset(gaussian_map[k][i], 0, new_width * new_height * sizeof(double));
-      decimate_map(gaussian_map[k][i - 1], height[i - 1], width[i - 1], stride,
-                   gaussian_map[k][i]);
     }
+    dst[x] = sum;
   }
-
-  if (center_surround_diff_rgb((const double **)gaussian_map[0],
-                               (const double **)gaussian_map[1], height, width,
-                               dst) == 0) {
-    for (int l = 0; l < 2; ++l) {
-      for (int i = 0; i < 9; ++i) {
-        aom_free(gaussian_map[l][i]);
-      }
-    }
-    return 0;
-  }
-
-  for (int l = 0; l < 2; ++l) {
-    for (int i = 0; i < 9; ++i) {
-      aom_free(gaussian_map[l][i]);
-    }
-  }
-  return 1;
 }
 
-static int get_feature_map_intensity(double *intensity, int width[9],
-                                     int height[9],
-                                     saliency_feature_map *i_map[6]) {
-  if (gaussian_pyramid(intensity, width, height, i_map) == 0) {
-    return 0;
+// Extracts the intensity = (r + g + b) / 3 and the red-green and blue-yellow
+// opponent channels of one band. Note that it only handles 8 bits now.
+// TODO(linzhen): add high bitdepth support.
+static void color_band(const AV1_COMP *cpi, SaliencyMapBuffers *bufs,
+                       int band) {
+  const YV12_BUFFER_CONFIG *const src = cpi->source;
+  const int ss_x = cpi->common.seq_params->subsampling_x;
+  const int ss_y = cpi->common.seq_params->subsampling_y;
+  const int width = bufs->width;
+  const int stride = bufs->pyr_stride[0];
+  const int y_end = AOMMIN((band + 1) * SALIENCY_BAND_ROWS, bufs->height);
+
+  for (int i = band * SALIENCY_BAND_ROWS; i < y_end; ++i) {
+    const uint8_t *const y = src->y_buffer + i * src->y_stride;
+    const uint8_t *const u = src->u_buffer + (i >> ss_y) * src->uv_stride;
+    const uint8_t *const v = src->v_buffer + (i >> ss_y) * src->uv_stride;
+    float *const intensity =
+        bufs->pyramid[SALIENCY_PYR_INTENSITY][0] + i * stride;
+    float *const rg = bufs->pyramid[SALIENCY_PYR_RG][0] + i * stride;
+    float *const by = bufs->pyramid[SALIENCY_PYR_BY][0] + i * stride;
+
+    for (int j = 0; j < width; ++j) {
+      const float luma = y[j];
+      const float cu = u[j >> ss_x] - 128.0f;
+      const float cv = v[j >> ss_x] - 128.0f;
+      const float cr =
+          AOMMIN(AOMMAX(luma + 1.370f * cv, 0.0f), 255.0f) * (1.0f / 256);
+      const float cg =
+          AOMMIN(AOMMAX(luma - 0.698f * cu - 0.337f * cv, 0.0f), 255.0f) *
+          (1.0f / 256);
+      const float cb =
+          AOMMIN(AOMMAX(luma + 1.732f * cu, 0.0f), 255.0f) * (1.0f / 256);
+
+      const float r = AOMMAX(0.0f, cr - (cg + cb) / 2);
+      const float g = AOMMAX(0.0f, cg - (cr + cb) / 2);
+      const float b = AOMMAX(0.0f, cb - (cr + cg) / 2);
+      const float yl = AOMMAX(0.0f, (cr + cg) / 2 - fabsf(cr - cg) / 2 - cb);
+
+      intensity[j] = (cr + cg + cb) / 3;
+      rg[j] = r - g;
+      by[j] = b - yl;
+    }
+    extend_row(intensity, width);
+    extend_row(rg, width);
+    extend_row(by, width);
   }
-  return 1;
 }
 
-static int get_feature_map_rgb(double *cr, double *cg, double *cb, int width[9],
-                               int height[9], saliency_feature_map *rg_map[6],
-                               saliency_feature_map *by_map[6]) {
-  double *rg_mat = aom_malloc(height[0] * width[0] * sizeof(*rg_mat));
-  double *by_mat = aom_malloc(height[0] * width[0] * sizeof(*by_mat));
-  double *gr_mat = aom_malloc(height[0] * width[0] * sizeof(*gr_mat));
-  double *yb_mat = aom_malloc(height[0] * width[0] * sizeof(*yb_mat));
-
-  if (!rg_mat || !by_mat || !gr_mat || !yb_mat) {
-    aom_free(rg_mat);
-    aom_free(by_mat);
-    aom_free(gr_mat);
-    aom_free(yb_mat);
-    return 0;
+// Decimates one band of a pyramid level by half, with a gaussian filter.
+static void pyramid_band(SaliencyMapBuffers *bufs, int pyr, int level,
+                         int band, float *scratch) {
+  const int in_height = bufs->pyr_height[level - 1];
+  const int in_stride = bufs->pyr_stride[level - 1];
+  const float *const in = bufs->pyramid[pyr][level - 1];
+  const int out_stride = bufs->pyr_stride[level];
+  float *const out = bufs->pyramid[pyr][level];
+  const int y_end =
+      AOMMIN((band + 1) * SALIENCY_BAND_ROWS, bufs->pyr_height[level]);
+  const float *rows[5];
+
+  for (int y = band * SALIENCY_BAND_ROWS; y < y_end; ++y) {
+    for (int k = 0; k < 5; ++k) {
+      rows[k] = in + clamp(2 * y + k - 2, 0, in_height - 1) * in_stride - 2;
+    }
+    av1_saliency_decimate_row(rows, bufs->pyr_width[level - 1], scratch,
+                              out + y * out_stride);
+    extend_row(out + y * out_stride, bufs->pyr_width[level]);
   }
-
-  double r, g, b, y;
-  for (int i = 0; i < height[0]; ++i) {
-    for (int j = 0; j < width[0]; ++j) {
-      r = AOMMAX(0, cr[i * width[0] + j] -
-                        (cg[i * width[0] + j] + cb[i * width[0] + j]) / 2);
-      g = AOMMAX(0, cg[i * width[0] + j] -
-                        (cr[i * width[0] + j] + cb[i * width[0] + j]) / 2);
-      b = AOMMAX(0, cb[i * width[0] + j] -
-                        (cr[i * width[0] + j] + cg[i * width[0] + j]) / 2);
-      y = AOMMAX(0, (cr[i * width[0] + j] + cg[i * width[0] + j]) / 2 -
-                        fabs(cr[i * width[0] + j] - cg[i * width[0] + j]) / 2 -
-                        cb[i * width[0] + j]);
-
-      rg_mat[i * width[0] + j] = r - g;
-      by_mat[i * width[0] + j] = b - y;
-      gr_mat[i * width[0] + j] = g - r;
-      yb_mat[i * width[0] + j] = y - b;
-    }
-  }
-
-  if (gaussian_pyramid_rgb(rg_mat, gr_mat, width, height, rg_map) == 0 ||
-      gaussian_pyramid_rgb(by_mat, yb_mat, width, height, by_map) == 0) {
-    aom_free(rg_mat);
-    aom_free(by_mat);
-    aom_free(gr_mat);
-    aom_free(yb_mat);
-    return 0;
-  }
-
-  aom_free(rg_mat);
-  aom_free(by_mat);
-  aom_free(gr_mat);
-  aom_free(yb_mat);
-  return 1;
 }
 
-static INLINE void filter2d(const double *input, const double kernel[9][9],
-                            int width, int height, double *output) {
-  const int window_size = 9;
-  double map_section[81];
-  for (int y = 0; y <= height - 1; ++y) {
-    for (int x = 0; x <= width - 1; ++x) {
-      int i = 0;
-      for (int yy = y - window_size / 2; yy <= y + window_size / 2; ++yy) {
-        for (int xx = x - window_size / 2; xx <= x + window_size / 2; ++xx) {
-          int yvalue = clamp(yy, 0, height - 1);
-          int xvalue = clamp(xx, 0, width - 1);
-          map_section[i++] = input[yvalue * width + xvalue];
-        }
-      }
+// Applies the four Gabor filters to one band of an intensity pyramid level.
+static void gabor_band(SaliencyMapBuffers *bufs, int level, int band) {
+  const int width = bufs->pyr_width[level];
+  const int height = bufs->pyr_height[level];
+  const int stride = bufs->pyr_stride[level];
+  const float *const in = bufs->pyramid[SALIENCY_PYR_INTENSITY][level];
+  const int y_end = AOMMIN((band + 1) * SALIENCY_BAND_ROWS, height);
+  const float *rows[SALIENCY_GABOR_TAPS];
 
-      output[y * width + x] = 0;
-      for (int k = 0; k < window_size; ++k) {
-        for (int l = 0; l < window_size; ++l) {
-          output[y * width + x] +=
-              kernel[k][l] * map_section[k * window_size + l];
-        }
-      }
+  for (int y = band * SALIENCY_BAND_ROWS; y < y_end; ++y) {
+    for (int k = 0; k < SALIENCY_GABOR_TAPS; ++k) {
+      rows[k] = in + clamp(y + k - SALIENCY_BORDER, 0, height - 1) * stride -
+                SALIENCY_BORDER;
     }
-  }
-}
-
-static int get_feature_map_orientation(const double *intensity, int width[9],
-                                       int height[9],
-                                       saliency_feature_map *dst[24]) {
-  double *gaussian_map[9];
-
-  gaussian_map[0] =
-      (double *)aom_malloc(width[0] * height[0] * sizeof(*gaussian_map[0]));
-  if (!gaussian_map[0]) {
-    return 0;
-  }
-  memcpy(gaussian_map[0], intensity, width[0] * height[0] * sizeof(double));
-
-  for (int i = 1; i < 9; ++i) {
-    int stride = width[i - 1];
-    int new_width = width[i];
-    int new_height = height[i];
-
-    gaussian_map[i] =
-        (double *)aom_malloc(new_width * new_height * sizeof(*gaussian_map[i]));
-    if (!gaussian_map[i]) {
-      for (int l = 0; l < i; ++l) {
-        aom_free(gaussian_map[l]);
-      }
-      return 0;
-    }
-    memset(gaussian_map[i], 0, new_width * new_height * sizeof(double));
-    decimate_map(gaussian_map[i - 1], height[i - 1], width[i - 1], stride,
-                 gaussian_map[i]);
-  }
-
-  double *tempGaborOutput[4][9];  //[angle: 0, 45, 90, 135 degree][filter_size]
-
-  for (int i = 2; i < 9; ++i) {
-    const int cur_height = height[i];
-    const int cur_width = width[i];
-    for (int j = 0; j < 4; ++j) {
-      tempGaborOutput[j][i] = (double *)aom_malloc(
-          cur_height * cur_width * sizeof(*tempGaborOutput[j][i]));
-      if (!tempGaborOutput[j][i]) {
-        for (int l = 0; l < 9; ++l) {
-          aom_free(gaussian_map[l]);
-        }
-        for (int h = 0; h < 4; ++h) {
-          for (int g = 2; g < 9; ++g) {
-            aom_free(tempGaborOutput[h][g]);
-          }
-        }
-        return 0;
-      }
-      filter2d(gaussian_map[i], kGaborFilter[j], cur_width, cur_height,
-               tempGaborOutput[j][i]);
+    for (int angle = 0; angle < SALIENCY_ANGLES; ++angle) {
+      av1_saliency_gabor_row(rows, width, &kGaborFilter[angle][0][0],
+                             bufs->gabor[angle][level] + y * width);
     }
   }
+}
 
-  for (int i = 0; i < 9; ++i) {
-    aom_free(gaussian_map[i]);
-  }
-
-  saliency_feature_map
-      *tmp[4][6];  //[angle: 0, 45, 90, 135 degree][filter_size]
-
-  for (int i = 0; i < 6; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      tmp[j][i] = dst[j * 6 + i];
+// Gathers the range of a band of a map, and the maxima of its normalization
+// blocks if the band holds a row of them. The blocks are block_size wide in
+// the map.
+static void get_band_stats(const float *map, int width, int rows,
+                           int block_size, int num_blocks,
+                           SaliencyBandStats *stats) {
+  float min_value = FLT_MAX;
+  float max_value = 0.0f;
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < width; ++j) {
+      min_value = AOMMIN(min_value, map[i * width + j]);
+      max_value = AOMMAX(max_value, map[i * width + j]);
     }
   }
+  stats->min_value = min_value;
+  stats->max_value = max_value;
+  stats->local_max_sum = 0.0;
+  stats->local_max_count = num_blocks;
 
-  for (int j = 0; j < 4; ++j) {
-    if (center_surround_diff((const double **)tempGaborOutput[j], height, width,
-                             tmp[j]) == 0) {
-      for (int h = 0; h < 4; ++h) {
-        for (int g = 2; g < 9; ++g) {
-          aom_free(tempGaborOutput[h][g]);
-        }
+  for (int b = 0; b < num_blocks; ++b) {
+    const int x_end = AOMMIN((b + 1) * block_size, width);
+    float local_max = 0.0f;
+    for (int i = 0; i < rows; ++i) {
+      for (int j = b * block_size; j < x_end; ++j) {
+        local_max = AOMMAX(local_max, map[i * width + j]);
       }
-      return 0;
-    }
-  }
-
-  for (int i = 2; i < 9; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      aom_free(tempGaborOutput[j][i]);
     }
+    stats->local_max_sum += local_max;
   }
-
-  return 1;
 }
 
-static INLINE void find_min_max(const saliency_feature_map *input,
-                                double *max_value, double *min_value) {
-  assert(input && input->buf);
-  *min_value = DBL_MAX;
-  *max_value = 0.0;
-
-  for (int i = 0; i < input->height; ++i) {
-    for (int j = 0; j < input->width; ++j) {
-      assert(input->buf[i * input->width + j] >= 0.0);
-      *min_value = fmin(input->buf[i * input->width + j], *min_value);
-      *max_value = fmax(input->buf[i * input->width + j], *max_value);
-    }
+// Intensity, red-green and blue-yellow channels are pyramids, the others are
+// the Gabor filtered intensity pyramid.
+static const float *get_channel_map(const SaliencyMapBuffers *bufs,
+                                    int channel, int level, int *stride) {
+  if (channel < SALIENCY_PYRAMIDS) {
+    *stride = bufs->pyr_stride[level];
+    return bufs->pyramid[channel][level];
   }
+  *stride = bufs->pyr_width[level];
+  return bufs->gabor[channel - SALIENCY_PYRAMIDS][level];
 }
 
-static INLINE double average_local_max(const saliency_feature_map *input,
-                                       int stepsize) {
-  int numlocal = 0;
-  double lmaxmean = 0, lmax = 0, dummy = 0;
-  saliency_feature_map local_map;
-  local_map.height = stepsize;
-  local_map.width = stepsize;
-  local_map.buf =
-      (double *)aom_malloc(stepsize * stepsize * sizeof(*local_map.buf));
-
-  if (!local_map.buf) {
-    return -1;
-  }
-
-  for (int y = 0; y < input->height - stepsize; y += stepsize) {
-    for (int x = 0; x < input->width - stepsize; x += stepsize) {
-      for (int i = 0; i < stepsize; ++i) {
-        for (int j = 0; j < stepsize; ++j) {
-          local_map.buf[i * stepsize + j] =
-              input->buf[(y + i) * input->width + x + j];
-        }
-      }
-
-      find_min_max(&local_map, &lmax, &dummy);
-      lmaxmean += lmax;
-      numlocal++;
-    }
-  }
+// Calculates one band of the difference between a fine scale c and a coarser
+// scale s of a channel, where c \in {2, 3, 4} and s = c + delta, delta \in
+// {3, 4}. For color channels, the difference is based on "color
+// double-opponency": the red-green map is constructed between the fine scale
+// of R-G and the coarse scale of G-R, i.e. the negated R-G pyramid.
+static void feature_band(SaliencyMapBuffers *bufs, int map, int band,
+                         SaliencyBandStats *stats) {
+  const int channel = map / SALIENCY_CS_MAPS;
+  const int c = feature_level(map);
+  const int s = c + 3 + (map & 1);
+  const int shift = s - c;
+  const float sign =
+      (channel == SALIENCY_PYR_RG || channel == SALIENCY_PYR_BY) ? 1.0f
+                                                                 : -1.0f;
+  int center_stride, surround_stride;
+  const float *const center = get_channel_map(bufs, channel, c, &center_stride);
+  const float *const surround =
+      get_channel_map(bufs, channel, s, &surround_stride);
+  const int width = bufs->pyr_width[c];
+  const int height = bufs->pyr_height[c];
+  const int s_width = bufs->pyr_width[s];
+  const int s_height = bufs->pyr_height[s];
+  const int y_start = band * SALIENCY_BAND_ROWS;
+  const int y_end = AOMMIN(y_start + SALIENCY_BAND_ROWS, height);
+  float *const out = bufs->feature[map];
+
+  // The coarse scale is upscaled by nearest neighbor, clamped to its size.
+  for (int y = y_start; y < y_end; ++y) {
+    const float *const c_row = center + y * center_stride;
+    const float *const s_row =
+        surround + AOMMIN(y >> shift, s_height - 1) * surround_stride;
+    float *const o = out + y * width;
+    for (int x = 0; x < width; ++x) {
+      o[x] = fabsf(c_row[x] + sign * s_row[AOMMIN(x >> shift, s_width - 1)]);
+    }
+  }
+
+  get_band_stats(out + y_start * width, width, y_end - y_start,
+                 SALIENCY_BAND_ROWS,
+                 band < num_local_blocks(height) ? num_local_blocks(width) : 0,
+                 stats);
+}
 
-  aom_free(local_map.buf);
+// Adds up one band of the normalized feature maps of a channel. The sum is
+// computed at level 2, the finest feature map scale; the frame size map is
+// its nearest neighbor upscale.
+static void conspicuity_band(SaliencyMapBuffers *bufs, int map, int band,
+                             SaliencyBandStats *stats) {
+  const int width = bufs->pyr_width[2];
+  const int height = bufs->pyr_height[2];
+  const int y_start = band * LEVEL2_BAND_ROWS;
+  const int y_end = AOMMIN(y_start + LEVEL2_BAND_ROWS, height);
+  float *const out = bufs->conspicuity[map];
+
+  for (int y = y_start; y < y_end; ++y) {
+    float *const o = out + y * width;
+    memset(o, 0, width * sizeof(*o));
+    for (int i = 0; i < SALIENCY_CS_MAPS; ++i) {
+      const int f = map * SALIENCY_CS_MAPS + i;
+      const int level = feature_level(f);
+      const int shift = level - 2;
+      const int f_width = bufs->pyr_width[level];
+      const int f_height = bufs->pyr_height[level];
+      const SaliencyNorm norm = bufs->feature_norm[f];
+      const float *const f_row =
+          bufs->feature[f] + AOMMIN(y >> shift, f_height - 1) * f_width;
+      for (int x = 0; x < width; ++x) {
+        o[x] += norm.scale * (f_row[AOMMIN(x >> shift, f_width - 1)] -
+                              norm.offset);
+      }
+    }
+  }
+
+  // The normalization blocks are 8x8 blocks of the frame size map.
+  get_band_stats(out + y_start * width, width, y_end - y_start,
+                 LEVEL2_BAND_ROWS,
+                 band < num_local_blocks(bufs->height)
+                     ? num_local_blocks(bufs->width)
+                     : 0,
+                 stats);
+}
 
-  return lmaxmean / numlocal;
+// Merges one band of the normalized red-green and blue-yellow maps into the
+// color map (map 0), or of the four orientation maps into the orientation map
+// (map 1). The result overwrites the first input map.
+static void combine_band(SaliencyMapBuffers *bufs, int map, int band,
+                         SaliencyBandStats *stats) {
+  const int first = map == 0 ? SALIENCY_PYR_RG : SALIENCY_PYRAMIDS;
+  const int count = map == 0 ? 2 : SALIENCY_ANGLES;
+  const int width = bufs->pyr_width[2];
+  const int height = bufs->pyr_height[2];
+  const int y_start = band * LEVEL2_BAND_ROWS;
+  const int y_end = AOMMIN(y_start + LEVEL2_BAND_ROWS, height);
+
+  for (int y = y_start; y < y_end; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float sum = 0.0f;
+      for (int i = first; i < first + count; ++i) {
+        const SaliencyNorm norm = bufs->conspicuity_norm[i];
+        sum += norm.scale * (bufs->conspicuity[i][y * width + x] - norm.offset);
+      }
+      bufs->conspicuity[first][y * width + x] = sum;
+    }
+  }
+
+  get_band_stats(bufs->conspicuity[first] + y_start * width, width,
+                 y_end - y_start, LEVEL2_BAND_ROWS,
+                 band < num_local_blocks(bufs->height)
+                     ? num_local_blocks(bufs->width)
+                     : 0,
+                 stats);
 }
 
-// Linear normalization the values in the map to [0,1].
-static void minmax_normalize(saliency_feature_map *input) {
-  double max_value, min_value;
-  find_min_max(input, &max_value, &min_value);
-
-  for (int i = 0; i < input->height; ++i) {
-    for (int j = 0; j < input->width; ++j) {
-      if (max_value != min_value) {
-        input->buf[i * input->width + j] =
-            input->buf[i * input->width + j] / (max_value - min_value) +
-            min_value / (min_value - max_value);
-      } else {
-        input->buf[i * input->width + j] -= min_value;
+// Writes one band of the pixel level saliency map, the average of the
+// normalized intensity, color and orientation maps.
+static void output_band(AV1_COMP *cpi, const SaliencyMapBuffers *bufs,
+                        int band) {
+  const int width = bufs->width;
+  const int l2_width = bufs->pyr_width[2];
+  const int l2_height = bufs->pyr_height[2];
+  const float *const maps[3] = { bufs->conspicuity[SALIENCY_PYR_INTENSITY],
+                                 bufs->conspicuity[SALIENCY_PYR_RG],
+                                 bufs->conspicuity[SALIENCY_PYRAMIDS] };
+  const SaliencyNorm norms[3] = {
+    bufs->conspicuity_norm[SALIENCY_PYR_INTENSITY], bufs->combined_norm[0],
+    bufs->combined_norm[1]
+  };
+  const float weight = 1.0f / 3;
+  const int y_end = AOMMIN((band + 1) * SALIENCY_BAND_ROWS, bufs->height);
+
+  for (int y = band * SALIENCY_BAND_ROWS; y < y_end; ++y) {
+    const int offset = AOMMIN(y >> 2, l2_height - 1) * l2_width;
+    uint8_t *const dst = cpi->saliency_map + y * width;
+    for (int x = 0; x < width; ++x) {
+      const int index = offset + AOMMIN(x >> 2, l2_width - 1);
+      float value = 0.0f;
+      for (int i = 0; i < 3; ++i) {
+        value += weight * norms[i].scale * (maps[i][index] - norms[i].offset);
       }
+      dst[x] = (uint8_t)AOMMIN(value * 255, 255.0f);
     }
   }
 }
 
-// This function is to promote meaningful “activation spots” in the map and
-// ignores homogeneous areas.
-static int nomalization_operator(saliency_feature_map *input, int stepsize) {
-  minmax_normalize(input);
-  double lmaxmean = average_local_max(input, stepsize);
-  if (lmaxmean < 0) {
-    return 0;
+static int get_num_jobs(const SaliencyMapBuffers *bufs, int stage) {
+  if (stage == SALIENCY_STAGE_COLOR || stage == SALIENCY_STAGE_OUTPUT) {
+    return num_bands(bufs->height, SALIENCY_BAND_ROWS);
   }
-  double normCoeff = (1 - lmaxmean) * (1 - lmaxmean);
-
-  for (int i = 0; i < input->height; ++i) {
-    for (int j = 0; j < input->width; ++j) {
-      input->buf[i * input->width + j] *= normCoeff;
-    }
+  if (stage < SALIENCY_STAGE_GABOR) {
+    const int level = stage - SALIENCY_STAGE_PYRAMID + 1;
+    return SALIENCY_PYRAMIDS *
+           num_bands(bufs->pyr_height[level], SALIENCY_BAND_ROWS);
   }
-
-  return 1;
-}
-
-// Normalize the values in feature maps to [0,1], and then upscale all maps to
-// the original frame size.
-static int normalize_fm(saliency_feature_map *input[6], int width[9],
-                        int height[9], int num_fm,
-                        saliency_feature_map *output[6]) {
-  // Feature maps (FM) are generated by function "center_surround_diff()". The
-  // difference is between a fine scale c and a coarser scale s, where c \in {2,
-  // 3, 4}, and s = c + delta, where delta \in {3, 4}, and the FM size is scale
-  // c. Specifically, i=0: c=2 and s=5, i=1: c=2 and s=6, i=2: c=3 and s=6, i=3:
-  // c=3 and s=7, i=4: c=4 and s=7, i=5: c=4 and s=8.
-  for (int i = 0; i < num_fm; ++i) {
-    if (nomalization_operator(input[i], 8) == 0) {
-      return 0;
+  int num_jobs = 0;
+  if (stage == SALIENCY_STAGE_GABOR) {
+    for (int level = 2; level < SALIENCY_LEVELS; ++level) {
+      num_jobs += num_bands(bufs->pyr_height[level], SALIENCY_BAND_ROWS);
     }
-
-    // Upscale FM to original frame size
-    if (upscale_map(input[i]->buf, (i / 2) + 2, 0, height, width,
-                    output[i]->buf) == 0) {
-      return 0;
+  } else if (stage == SALIENCY_STAGE_FEATURE) {
+    for (int map = 0; map < SALIENCY_FEATURE_MAPS; ++map) {
+      num_jobs +=
+          num_bands(bufs->pyr_height[feature_level(map)], SALIENCY_BAND_ROWS);
     }
+  } else {
+    const int num_maps =
+        stage == SALIENCY_STAGE_CONSPICUITY ? SALIENCY_CONSPICUITY_MAPS : 2;
+    num_jobs = num_maps * num_bands(bufs->pyr_height[2], LEVEL2_BAND_ROWS);
   }
-  return 1;
+  return num_jobs;
 }
 
-// Combine feature maps with the same category (intensity, color, or
-// orientation) into one conspicuity map.
-static int normalized_map(saliency_feature_map *input[6], int width[9],
-                          int height[9], saliency_feature_map *output) {
-  int num_fm = 6;
-
-  saliency_feature_map *n_input[6];
-  for (int i = 0; i < 6; ++i) {
-    n_input[i] = (saliency_feature_map *)aom_malloc(sizeof(*n_input[i]));
-    if (!n_input[i]) {
-      return 0;
-    }
-    n_input[i]->buf =
-        (double *)aom_malloc(width[0] * height[0] * sizeof(*n_input[i]->buf));
-    if (!n_input[i]->buf) {
-      aom_free(n_input[i]);
-      return 0;
+// Runs the jobs start, start + step, start + 2 * step, ... of a stage. Band
+// statistics are stored by job index, so the normalization does not depend
+// on how the jobs were split.
+void av1_set_saliency_map_stage_jobs(AV1_COMP *cpi, int stage, int start,
+                                     int step) {
+  SaliencyMapBuffers *const bufs = &cpi->saliency_bufs;
+  const int num_jobs = get_num_jobs(bufs, stage);
+
+  if (stage == SALIENCY_STAGE_COLOR) {
+    for (int job = start; job < num_jobs; job += step)
+      color_band(cpi, bufs, job);
+  } else if (stage < SALIENCY_STAGE_GABOR) {
+    const int level = stage - SALIENCY_STAGE_PYRAMID + 1;
+    const int bands = num_jobs / SALIENCY_PYRAMIDS;
+    float *const scratch = bufs->scratch + start * bufs->scratch_stride;
+    for (int job = start; job < num_jobs; job += step)
+      pyramid_band(bufs, job / bands, level, job % bands, scratch);
+  } else if (stage == SALIENCY_STAGE_GABOR) {
+    int job = 0;
+    for (int level = 2; level < SALIENCY_LEVELS; ++level) {
+      const int bands = num_bands(bufs->pyr_height[level], SALIENCY_BAND_ROWS);
+      for (int band = 0; band < bands; ++band, ++job) {
+        if (job % step == start) gabor_band(bufs, level, band);
+      }
+    }
+  } else if (stage == SALIENCY_STAGE_FEATURE) {
+    int job = 0;
+    for (int map = 0; map < SALIENCY_FEATURE_MAPS; ++map) {
+      const int bands =
+          num_bands(bufs->pyr_height[feature_level(map)], SALIENCY_BAND_ROWS);
+      for (int band = 0; band < bands; ++band, ++job) {
+        if (job % step == start)
+          feature_band(bufs, map, band, &bufs->stats[job]);
+      }
+    }
+  } else if (stage == SALIENCY_STAGE_OUTPUT) {
+    for (int job = start; job < num_jobs; job += step)
+      output_band(cpi, bufs, job);
+  } else {
+    const int bands = num_bands(bufs->pyr_height[2], LEVEL2_BAND_ROWS);
+    for (int job = start; job < num_jobs; job += step) {
+      if (stage == SALIENCY_STAGE_CONSPICUITY)
+        conspicuity_band(bufs, job / bands, job % bands, &bufs->stats[job]);
+      else
+        combine_band(bufs, job / bands, job % bands, &bufs->stats[job]);
     }
-    n_input[i]->height = height[0];
-    n_input[i]->width = width[0];
   }
+}
 
-  if (normalize_fm(input, width, height, num_fm, n_input) == 0) {
-    for (int i = 0; i < num_fm; ++i) {
-      aom_free(n_input[i]->buf);
-      aom_free(n_input[i]);
-    }
-    return 0;
-  }
+// This is the operator that promotes meaningful "activation spots" in a map
+// and ignores homogeneous areas: a linear normalization to [0, 1], scaled by
+// (1 - m)^2 where m is the average of the normalized local maxima.
+static SaliencyNorm get_norm(const SaliencyBandStats *stats, int num_bands) {
+  float min_value = FLT_MAX;
+  float max_value = 0.0f;
+  double local_max_sum = 0.0;
+  int local_max_count = 0;
+  for (int i = 0; i < num_bands; ++i) {
+    min_value = AOMMIN(min_value, stats[i].min_value);
+    max_value = AOMMAX(max_value, stats[i].max_value);
+    local_max_sum += stats[i].local_max_sum;
+    local_max_count += stats[i].local_max_count;
+  }
+
+  SaliencyNorm norm = { 0.0f, min_value };
+  if (max_value > min_value) {
+    const double range = max_value - min_value;
+    const double local_max_mean =
+        local_max_count > 0
+            ? (local_max_sum / local_max_count - min_value) / range
+            : 0.0;
+    norm.scale =
+        (float)((1 - local_max_mean) * (1 - local_max_mean) / range);
+  }
+  return norm;
+}
 
-  // Add up all normalized feature maps with the same category into one map.
-  for (int i = 0; i < num_fm; ++i) {
-    for (int r = 0; r < height[0]; ++r) {
-      for (int c = 0; c < width[0]; ++c) {
-        output->buf[r * width[0] + c] += n_input[i]->buf[r * width[0] + c];
-      }
+static void set_norms(SaliencyMapBuffers *bufs, int stage) {
+  const SaliencyBandStats *stats = bufs->stats;
+  if (stage == SALIENCY_STAGE_FEATURE) {
+    for (int map = 0; map < SALIENCY_FEATURE_MAPS; ++map) {
+      const int bands =
+          num_bands(bufs->pyr_height[feature_level(map)], SALIENCY_BAND_ROWS);
+      bufs->feature_norm[map] = get_norm(stats, bands);
+      stats += bands;
+    }
+  } else {
+    const int bands = num_bands(bufs->pyr_height[2], LEVEL2_BAND_ROWS);
+    const int num_maps =
+        stage == SALIENCY_STAGE_CONSPICUITY ? SALIENCY_CONSPICUITY_MAPS : 2;
+    SaliencyNorm *const norms = stage == SALIENCY_STAGE_CONSPICUITY
+                                    ? bufs->conspicuity_norm
+                                    : bufs->combined_norm;
+    for (int map = 0; map < num_maps; ++map) {
+      norms[map] = get_norm(stats + map * bands, bands);
     }
   }
-
-  for (int i = 0; i < num_fm; ++i) {
-    aom_free(n_input[i]->buf);
-    aom_free(n_input[i]);
-  }
-
-  nomalization_operator(output, 8);
-  return 1;
 }
 
-static int normalized_map_rgb(saliency_feature_map *rg_map[6],
-                              saliency_feature_map *by_map[6], int width[9],
-                              int height[9], saliency_feature_map *output) {
-  saliency_feature_map *color_cm[2];  // 0: color_cm_rg, 1: color_cm_by
-  for (int i = 0; i < 2; ++i) {
-    color_cm[i] = aom_malloc(sizeof(*color_cm[i]));
-    if (!color_cm[i]) {
-      return 0;
-    }
-    color_cm[i]->buf =
-        (double *)aom_malloc(width[0] * height[0] * sizeof(*color_cm[i]->buf));
-    if (!color_cm[i]->buf) {
-      for (int l = 0; l < i; ++l) {
-        aom_free(color_cm[l]->buf);
-      }
-      aom_free(color_cm[i]);
-      return 0;
-    }
-
-    color_cm[i]->width = width[0];
-    color_cm[i]->height = height[0];
-    memset(color_cm[i]->buf, 0,
-           width[0] * height[0] * sizeof(*color_cm[i]->buf));
-  }
+void av1_free_saliency_map_buffers(SaliencyMapBuffers *bufs) {
+  aom_free(bufs->buf);
+  aom_free(bufs->stats);
+  memset(bufs, 0, sizeof(*bufs));
+}
 
-  if (normalized_map(rg_map, width, height, color_cm[0]) == 0 ||
-      normalized_map(by_map, width, height, color_cm[1]) == 0) {
-    for (int i = 0; i < 2; ++i) {
-      aom_free(color_cm[i]->buf);
-      aom_free(color_cm[i]);
-    }
+static int alloc_saliency_map_buffers(SaliencyMapBuffers *bufs, int width,
+                                      int height, int num_workers) {
+  if (bufs->buf != NULL && bufs->width == width && bufs->height == height &&
+      bufs->num_workers >= num_workers) {
+    return 1;
+  }
+  av1_free_saliency_map_buffers(bufs);
+
+  bufs->width = width;
+  bufs->height = height;
+  bufs->num_workers = num_workers;
+  for (int level = 0; level < SALIENCY_LEVELS; ++level) {
+    bufs->pyr_width[level] = width >> level;
+    bufs->pyr_height[level] = height >> level;
+    bufs->pyr_stride[level] = bufs->pyr_width[level] + 2 * SALIENCY_BORDER;
+  }
+  bufs->scratch_stride = width + 2 * SALIENCY_BORDER;
+
+  const size_t l2_size = (size_t)bufs->pyr_width[2] * bufs->pyr_height[2];
+  size_t size = (size_t)num_workers * bufs->scratch_stride +
+                SALIENCY_CONSPICUITY_MAPS * l2_size;
+  for (int level = 0; level < SALIENCY_LEVELS; ++level) {
+    size += SALIENCY_PYRAMIDS * (size_t)bufs->pyr_stride[level] *
+            bufs->pyr_height[level];
+    if (level >= 2) {
+      size += SALIENCY_ANGLES * (size_t)bufs->pyr_width[level] *
+              bufs->pyr_height[level];
+    }
+  }
+  for (int map = 0; map < SALIENCY_FEATURE_MAPS; ++map) {
+    const int level = feature_level(map);
+    size += (size_t)bufs->pyr_width[level] * bufs->pyr_height[level];
+  }
+  const int num_stats = AOMMAX(get_num_jobs(bufs, SALIENCY_STAGE_FEATURE),
+                               get_num_jobs(bufs, SALIENCY_STAGE_CONSPICUITY));
+
+  bufs->buf = (float *)aom_malloc(size * sizeof(*bufs->buf));
+  bufs->stats =
+      (SaliencyBandStats *)aom_malloc(num_stats * sizeof(*bufs->stats));
+  if (!bufs->buf || !bufs->stats) {
+    av1_free_saliency_map_buffers(bufs);
     return 0;
   }
 
-  for (int r = 0; r < height[0]; ++r) {
-    for (int c = 0; c < width[0]; ++c) {
-      output->buf[r * width[0] + c] = color_cm[0]->buf[r * width[0] + c] +
-                                      color_cm[1]->buf[r * width[0] + c];
+  float *buf = bufs->buf;
+  for (int pyr = 0; pyr < SALIENCY_PYRAMIDS; ++pyr) {
+    for (int level = 0; level < SALIENCY_LEVELS; ++level) {
+      bufs->pyramid[pyr][level] = buf + SALIENCY_BORDER;
+      buf += (size_t)bufs->pyr_stride[level] * bufs->pyr_height[level];
     }
   }
-
-  for (int i = 0; i < 2; ++i) {
-    aom_free(color_cm[i]->buf);
-    aom_free(color_cm[i]);
-  }
-
-  nomalization_operator(output, 8);
-  return 1;
-}
-
-static int normalized_map_orientation(saliency_feature_map *orientation_map[24],
-                                      int width[9], int height[9],
-                                      saliency_feature_map *output) {
-  int num_fms_per_angle = 6;
-
-  saliency_feature_map *ofm[4][6];
-  for (int i = 0; i < num_fms_per_angle; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      ofm[j][i] = orientation_map[j * num_fms_per_angle + i];
+  for (int angle = 0; angle < SALIENCY_ANGLES; ++angle) {
+    for (int level = 2; level < SALIENCY_LEVELS; ++level) {
+      bufs->gabor[angle][level] = buf;
+      buf += (size_t)bufs->pyr_width[level] * bufs->pyr_height[level];
     }
   }
-
-  // extract conspicuity map for each angle
-  saliency_feature_map *nofm = aom_malloc(sizeof(*nofm));
-  if (!nofm) {
-    return 0;
+  for (int map = 0; map < SALIENCY_FEATURE_MAPS; ++map) {
+    const int level = feature_level(map);
+    bufs->feature[map] = buf;
+    buf += (size_t)bufs->pyr_width[level] * bufs->pyr_height[level];
   }
-  nofm->buf = (double *)aom_malloc(width[0] * height[0] * sizeof(*nofm->buf));
-  if (!nofm->buf) {
-    aom_free(nofm);
-    return 0;
+  for (int map = 0; map < SALIENCY_CONSPICUITY_MAPS; ++map) {
+    bufs->conspicuity[map] = buf;
+    buf += l2_size;
   }
-  nofm->height = height[0];
-  nofm->width = width[0];
-
-  for (int i = 0; i < 4; ++i) {
-    memset(nofm->buf, 0, width[0] * height[0] * sizeof(*nofm->buf));
-    if (normalized_map(ofm[i], width, height, nofm) == 0) {
-      aom_free(nofm->buf);
-      aom_free(nofm);
-      return 0;
-    }
-
-    for (int r = 0; r < height[0]; ++r) {
-      for (int c = 0; c < width[0]; ++c) {
-        output->buf[r * width[0] + c] += nofm->buf[r * width[0] + c];
-      }
-    }
-  }
-
-  aom_free(nofm->buf);
-  aom_free(nofm);
-
-  nomalization_operator(output, 8);
+  bufs->scratch = buf;
   return 1;
 }
 
 // Set pixel level saliency mask based on Itti-Koch algorithm
 int av1_set_saliency_map(AV1_COMP *cpi) {
   AV1_COMMON *const cm = &cpi->common;
+  const MultiThreadInfo *const mt_info = &cpi->mt_info;
+  SaliencyMapBuffers *const bufs = &cpi->saliency_bufs;
 
-  int frm_width = cm->width;
-  int frm_height = cm->height;
-
-  int pyr_height[9];
-  int pyr_width[9];
-
-  pyr_height[0] = frm_height;
-  pyr_width[0] = frm_width;
-
-  for (int i = 1; i < 9; ++i) {
-    pyr_width[i] = pyr_width[i - 1] / 2;
-    pyr_height[i] = pyr_height[i - 1] / 2;
+  // The coarsest pyramid level would be empty, so nothing stands out.
+  if ((cm->width >> (SALIENCY_LEVELS - 1)) == 0 ||
+      (cm->height >> (SALIENCY_LEVELS - 1)) == 0) {
+    memset(cpi->saliency_map, 0,
+           cm->width * cm->height * sizeof(*cpi->saliency_map));
+    return 1;
   }
 
-  double *cr = aom_malloc(frm_width * frm_height * sizeof(*cr));
-  double *cg = aom_malloc(frm_width * frm_height * sizeof(*cg));
-  double *cb = aom_malloc(frm_width * frm_height * sizeof(*cb));
-  double *intensity = aom_malloc(frm_width * frm_height * sizeof(*intensity));
-
-  if (!cr || !cg || !cb || !intensity) {
-    aom_free(cr);
-    aom_free(cg);
-    aom_free(cb);
-    aom_free(intensity);
+  const int max_workers = AOMMAX(
+      1, AOMMIN(mt_info->num_mod_workers[MOD_ENC], mt_info->num_workers));
+  if (!alloc_saliency_map_buffers(bufs, cm->width, cm->height, max_workers)) {
     return 0;
   }
 
-  // Extract red / green / blue channels and intensity component
-  get_color_intensity(cpi->source, cm->seq_params->subsampling_x,
-                      cm->seq_params->subsampling_y, cr, cg, cb, intensity);
-
-  // Feature Map Extraction
-  // intensity map
-  saliency_feature_map *i_map[6];
-  for (int i = 0; i < 6; ++i) {
-    int cur_height = pyr_height[(i / 2) + 2];
-    int cur_width = pyr_width[(i / 2) + 2];
-
-    i_map[i] = (saliency_feature_map *)aom_malloc(sizeof(*i_map[i]));
-    if (!i_map[i]) {
-      aom_free(cr);
-      aom_free(cg);
-      aom_free(cb);
-      aom_free(intensity);
-      for (int l = 0; l < i; ++l) {
-        aom_free(i_map[l]);
-      }
-      return 0;
-    }
-    i_map[i]->buf =
-        (double *)aom_malloc(cur_height * cur_width * sizeof(*i_map[i]->buf));
-    if (!i_map[i]->buf) {
-      aom_free(cr);
-      aom_free(cg);
-      aom_free(cb);
-      aom_free(intensity);
-      for (int l = 0; l < i; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(i_map[l]);
-      }
-      return 0;
-    }
-    i_map[i]->height = cur_height;
-    i_map[i]->width = cur_width;
-  }
-
-  if (get_feature_map_intensity(intensity, pyr_width, pyr_height, i_map) == 0) {
-    aom_free(cr);
-    aom_free(cg);
-    aom_free(cb);
-    aom_free(intensity);
-    for (int l = 0; l < 6; ++l) {
-      aom_free(i_map[l]->buf);
-      aom_free(i_map[l]);
-    }
-    return 0;
-  }
-
-  // RGB map
-  saliency_feature_map *rg_map[6], *by_map[6];
-  for (int i = 0; i < 6; ++i) {
-    int cur_height = pyr_height[(i / 2) + 2];
-    int cur_width = pyr_width[(i / 2) + 2];
-    rg_map[i] = (saliency_feature_map *)aom_malloc(sizeof(*rg_map[i]));
-    by_map[i] = (saliency_feature_map *)aom_malloc(sizeof(*by_map[i]));
-    if (!rg_map[i] || !by_map[i]) {
-      aom_free(cr);
-      aom_free(cg);
-      aom_free(cb);
-      aom_free(intensity);
-      for (int l = 0; l < 6; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(i_map[l]);
-        aom_free(rg_map[l]);
-        aom_free(by_map[l]);
-      }
-      return 0;
-    }
-    rg_map[i]->buf =
-        (double *)aom_malloc(cur_height * cur_width * sizeof(*rg_map[i]->buf));
-    by_map[i]->buf =
-        (double *)aom_malloc(cur_height * cur_width * sizeof(*by_map[i]->buf));
-    if (!by_map[i]->buf || !rg_map[i]->buf) {
-      aom_free(cr);
-      aom_free(cg);
-      aom_free(cb);
-      aom_free(intensity);
-      for (int l = 0; l < 6; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(i_map[l]);
-      }
-      for (int l = 0; l < i; ++l) {
-        aom_free(rg_map[l]->buf);
-        aom_free(by_map[l]->buf);
-        aom_free(rg_map[l]);
-        aom_free(by_map[l]);
-      }
-      return 0;
-    }
-    rg_map[i]->height = cur_height;
-    rg_map[i]->width = cur_width;
-    by_map[i]->height = cur_height;
-    by_map[i]->width = cur_width;
-  }
+  for (int stage = 0; stage < SALIENCY_STAGES; ++stage) {
+    const int num_workers = AOMMIN(max_workers, get_num_jobs(bufs, stage));
+    if (num_workers > 1)
+      av1_set_saliency_map_stage_mt(cpi, stage, num_workers);
+    else
+      av1_set_saliency_map_stage_jobs(cpi, stage, 0, 1);
 
-  if (get_feature_map_rgb(cr, cg, cb, pyr_width, pyr_height, rg_map, by_map) ==
-      0) {
-    aom_free(cr);
-    aom_free(cg);
-    aom_free(cb);
-    aom_free(intensity);
-    for (int l = 0; l < 6; ++l) {
-      aom_free(i_map[l]->buf);
-      aom_free(rg_map[l]->buf);
-      aom_free(by_map[l]->buf);
-      aom_free(i_map[l]);
-      aom_free(rg_map[l]);
-      aom_free(by_map[l]);
+    if (stage >= SALIENCY_STAGE_FEATURE && stage <= SALIENCY_STAGE_COMBINE) {
+      set_norms(bufs, stage);
     }
-    return 0;
   }
 
-  // Orientation map
-  saliency_feature_map *orientation_map[24];
-  for (int i = 0; i < 24; ++i) {
-    int cur_height = pyr_height[((i % 6) / 2) + 2];
-    int cur_width = pyr_width[((i % 6) / 2) + 2];
-
-    orientation_map[i] =
-        (saliency_feature_map *)aom_malloc(sizeof(*orientation_map[i]));
-    if (!orientation_map[i]) {
-      aom_free(cr);
-      aom_free(cg);
-      aom_free(cb);
-      aom_free(intensity);
-      for (int l = 0; l < 6; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(rg_map[l]->buf);
-        aom_free(by_map[l]->buf);
-        aom_free(i_map[l]);
-        aom_free(rg_map[l]);
-        aom_free(by_map[l]);
-      }
-      for (int h = 0; h < i; ++h) {
-        aom_free(orientation_map[h]);
-      }
-      return 0;
-    }
-
-    orientation_map[i]->buf = (double *)aom_malloc(
-        cur_height * cur_width * sizeof(*orientation_map[i]->buf));
-    if (!orientation_map[i]->buf) {
-      aom_free(cr);
-      aom_free(cg);
-      aom_free(cb);
-      aom_free(intensity);
-      for (int l = 0; l < 6; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(rg_map[l]->buf);
-        aom_free(by_map[l]->buf);
-        aom_free(i_map[l]);
-        aom_free(rg_map[l]);
-        aom_free(by_map[l]);
-      }
-
-      for (int h = 0; h < i; ++h) {
-        aom_free(orientation_map[h]->buf);
-        aom_free(orientation_map[h]->buf);
-        aom_free(orientation_map[h]);
-        aom_free(orientation_map[h]);
-      }
-      return 0;
-    }
-
-    orientation_map[i]->height = cur_height;
-    orientation_map[i]->width = cur_width;
-  }
-
-  if (get_feature_map_orientation(intensity, pyr_width, pyr_height,
-                                  orientation_map) == 0) {
-    aom_free(cr);
-    aom_free(cg);
-    aom_free(cb);
-    aom_free(intensity);
-    for (int l = 0; l < 6; ++l) {
-      aom_free(i_map[l]->buf);
-      aom_free(rg_map[l]->buf);
-      aom_free(by_map[l]->buf);
-      aom_free(i_map[l]);
-      aom_free(rg_map[l]);
-      aom_free(by_map[l]);
-    }
-    for (int h = 0; h < 24; ++h) {
-      aom_free(orientation_map[h]->buf);
-      aom_free(orientation_map[h]);
-    }
-    return 0;
-  }
-
-  aom_free(cr);
-  aom_free(cg);
-  aom_free(cb);
-  aom_free(intensity);
-
-  saliency_feature_map
-      *normalized_maps[3];  // 0: intensity, 1: color, 2: orientation
-
-  for (int i = 0; i < 3; ++i) {
-    normalized_maps[i] = aom_malloc(sizeof(*normalized_maps[i]));
-    if (!normalized_maps[i]) {
-      for (int l = 0; l < 6; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(rg_map[l]->buf);
-        aom_free(by_map[l]->buf);
-        aom_free(i_map[l]);
-        aom_free(rg_map[l]);
-        aom_free(by_map[l]);
-      }
-
-      for (int h = 0; h < 24; ++h) {
-        aom_free(orientation_map[h]->buf);
-        aom_free(orientation_map[h]);
-      }
-
-      for (int l = 0; l < i; ++l) {
-        aom_free(normalized_maps[l]);
-      }
-      return 0;
-    }
-    normalized_maps[i]->buf = (double *)aom_malloc(
-        frm_width * frm_height * sizeof(*normalized_maps[i]->buf));
-    if (!normalized_maps[i]->buf) {
-      for (int l = 0; l < 6; ++l) {
-        aom_free(i_map[l]->buf);
-        aom_free(rg_map[l]->buf);
-        aom_free(by_map[l]->buf);
-        aom_free(i_map[l]);
-        aom_free(rg_map[l]);
-        aom_free(by_map[l]);
-      }
-      for (int h = 0; h < 24; ++h) {
-        aom_free(orientation_map[h]->buf);
-        aom_free(orientation_map[h]);
-      }
-      for (int l = 0; l < i; ++l) {
-        aom_free(normalized_maps[l]->buf);
-        aom_free(normalized_maps[l]);
-      }
-      return 0;
-    }
-    normalized_maps[i]->width = frm_width;
-    normalized_maps[i]->height = frm_height;
-    memset(normalized_maps[i]->buf, 0,
-           frm_width * frm_height * sizeof(*normalized_maps[i]->buf));
-  }
-
-  // Conspicuity map generation
-  if (normalized_map(i_map, pyr_width, pyr_height, normalized_maps[0]) == 0 ||
-      normalized_map_rgb(rg_map, by_map, pyr_width, pyr_height,
-                         normalized_maps[1]) == 0 ||
-      normalized_map_orientation(orientation_map, pyr_width, pyr_height,
-                                 normalized_maps[2]) == 0) {
-    for (int i = 0; i < 6; ++i) {
-      aom_free(i_map[i]->buf);
-      aom_free(rg_map[i]->buf);
-      aom_free(by_map[i]->buf);
-      aom_free(i_map[i]);
-      aom_free(rg_map[i]);
-      aom_free(by_map[i]);
-    }
-
-    for (int i = 0; i < 24; ++i) {
-      aom_free(orientation_map[i]->buf);
-      aom_free(orientation_map[i]);
-    }
-
-    for (int i = 0; i < 3; ++i) {
-      aom_free(normalized_maps[i]->buf);
-      aom_free(normalized_maps[i]);
-    }
-    return 0;
-  }
-
-  for (int i = 0; i < 6; ++i) {
-    aom_free(i_map[i]->buf);
-    aom_free(rg_map[i]->buf);
-    aom_free(by_map[i]->buf);
-    aom_free(i_map[i]);
-    aom_free(rg_map[i]);
-    aom_free(by_map[i]);
-  }
-
-  for (int i = 0; i < 24; ++i) {
-    aom_free(orientation_map[i]->buf);
-    aom_free(orientation_map[i]);
-  }
-
-  // Pixel level saliency map
-  saliency_feature_map *combined_saliency_map =
-      aom_malloc(sizeof(*combined_saliency_map));
-  if (!combined_saliency_map) {
-    for (int i = 0; i < 3; ++i) {
-      aom_free(normalized_maps[i]->buf);
-      aom_free(normalized_maps[i]);
-    }
-    return 0;
-  }
-
-  combined_saliency_map->buf = (double *)aom_malloc(
-      frm_width * frm_height * sizeof(*combined_saliency_map->buf));
-  if (!combined_saliency_map->buf) {
-    for (int i = 0; i < 3; ++i) {
-      aom_free(normalized_maps[i]->buf);
-      aom_free(normalized_maps[i]);
-    }
-
-    aom_free(combined_saliency_map);
-    return 0;
-  }
-  combined_saliency_map->height = frm_height;
-  combined_saliency_map->width = frm_width;
-
-  double w_intensity, w_color, w_orient;
-
-  w_intensity = w_color = w_orient = (double)1 / 3;
+  return 1;
+}
 
-  for (int r = 0; r < frm_height; ++r) {
-    for (int c = 0; c < frm_width; ++c) {
-      combined_saliency_map->buf[r * frm_width + c] =
-          (w_intensity * normalized_maps[0]->buf[r * frm_width + c] +
-           w_color * normalized_maps[1]->buf[r * frm_width + c] +
-           w_orient * normalized_maps[2]->buf[r * frm_width + c]);
-    }
+// Linear normalization the values in the map to [0,1].
+static void minmax_normalize(double *map, int size) {
+  double min_value = DBL_MAX;
+  double max_value = 0.0;
+  for (int i = 0; i < size; ++i) {
+    assert(map[i] >= 0.0);
+    min_value = fmin(map[i], min_value);
+    max_value = fmax(map[i], max_value);
   }
 
-  for (int r = 0; r < frm_height; ++r) {
-    for (int c = 0; c < frm_width; ++c) {
-      int index = r * frm_width + c;
-      cpi->saliency_map[index] =
-          (uint8_t)(combined_saliency_map->buf[index] * 255);
+  for (int i = 0; i < size; ++i) {
+    if (max_value != min_value) {
+      map[i] = map[i] / (max_value - min_value) +
+               min_value / (min_value - max_value);
+    } else {
+      map[i] -= min_value;
     }
   }
-
-  for (int i = 0; i < 3; ++i) {
-    aom_free(normalized_maps[i]->buf);
-    aom_free(normalized_maps[i]);
-  }
-
-  aom_free(combined_saliency_map->buf);
-  aom_free(combined_saliency_map);
-
-  return 1;
 }
 
 // Set superblock level saliency mask for rdmult scaling
 int av1_setup_sm_rdmult_scaling_factor(AV1_COMP *cpi, double motion_ratio) {
   AV1_COMMON *cm = &cpi->common;
 
-  saliency_feature_map *sb_saliency_map =
-      aom_malloc(sizeof(saliency_feature_map));
-
-  if (sb_saliency_map == NULL) {
-    return 0;
-  }
-
   const int bsize = cm->seq_params->sb_size;
   const int num_mi_w = mi_size_wide[bsize];
   const int num_mi_h = mi_size_high[bsize];
@@ -1269,13 +749,10 @@ int av1_setup_sm_rdmult_scaling_factor(AV1_COMP *cpi, double motion_ratio) {
   const int num_sb_cols = (cm->mi_params.mi_cols + num_mi_w - 1) / num_mi_w;
   const int num_sb_rows = (cm->mi_params.mi_rows + num_mi_h - 1) / num_mi_h;
 
-  sb_saliency_map->height = num_sb_rows;
-  sb_saliency_map->width = num_sb_cols;
-  sb_saliency_map->buf = (double *)aom_malloc(num_sb_rows * num_sb_cols *
-                                              sizeof(*sb_saliency_map->buf));
+  double *sb_saliency_map = (double *)aom_malloc(
+      num_sb_rows * num_sb_cols * sizeof(*sb_saliency_map));
 
-  if (sb_saliency_map->buf == NULL) {
-    aom_free(sb_saliency_map);
+  if (sb_saliency_map == NULL) {
     return 0;
   }
 
@@ -1301,18 +778,18 @@ int av1_setup_sm_rdmult_scaling_factor(AV1_COMP *cpi, double motion_ratio) {
 
       // Calculate the superblock level saliency map from pixel level saliency
       // map
-      sb_saliency_map->buf[index] = total_weight / total_pixel;
+      sb_saliency_map[index] = total_weight / total_pixel;
 
       // Further lower the superblock saliency score for boundary superblocks.
       if (row < 1 || row > num_sb_rows - 2 || col < 1 ||
           col > num_sb_cols - 2) {
-        sb_saliency_map->buf[index] /= 5;
+        sb_saliency_map[index] /= 5;
       }
     }
   }
 
   // superblock level saliency map finalization
-  minmax_normalize(sb_saliency_map);
+  minmax_normalize(sb_saliency_map, num_sb_rows * num_sb_cols);
 
   double log_sum = 0.0;
   double sum = 0.0;
@@ -1323,7 +800,7 @@ int av1_setup_sm_rdmult_scaling_factor(AV1_COMP *cpi, double motion_ratio) {
   for (int row = 0; row < num_sb_rows; ++row) {
     for (int col = 0; col < num_sb_cols; ++col) {
       const int index = row * num_sb_cols + col;
-      const double saliency = sb_saliency_map->buf[index];
+      const double saliency = sb_saliency_map[index];
 
       cpi->sm_scaling_factor[index] = 1 - saliency;
       sum += cpi->sm_scaling_factor[index];
@@ -1359,7 +836,6 @@ int av1_setup_sm_rdmult_scaling_factor(AV1_COMP *cpi, double motion_ratio) {
     }
   }
 
-  aom_free(sb_saliency_map->buf);
   aom_free(sb_saliency_map);
   return 1;
 }
@@ -11,18 +11,102 @@
 
 #ifndef AOM_AV1_ENCODER_SALIENCY_MAP_H_
 #define AOM_AV1_ENCODER_SALIENCY_MAP_H_
-#include "av1/encoder/encoder.h"
 
-typedef struct saliency_feature_map {
-  double *buf;  // stores values of the map in 1D array
-  int height;
+#include "config/aom_config.h"
+
+// Number of gaussian pyramid levels.
+#define SALIENCY_LEVELS 9
+// Center-surround feature maps per channel: c \in {2, 3, 4}, s = c + {3, 4}.
+#define SALIENCY_CS_MAPS 6
+// Gabor orientations: 0, 45, 90 and 135 degree.
+#define SALIENCY_ANGLES 4
+// Feature maps: intensity, red-green, blue-yellow and one per orientation.
+#define SALIENCY_FEATURE_MAPS ((3 + SALIENCY_ANGLES) * SALIENCY_CS_MAPS)
+// Conspicuity maps before the color and orientation ones are merged.
+#define SALIENCY_CONSPICUITY_MAPS (3 + SALIENCY_ANGLES)
+// Rows per job, also the block size of the local maxima normalization.
+#define SALIENCY_BAND_ROWS 8
+#define SALIENCY_GABOR_TAPS 9
+// Border of the pyramid levels, enough for the Gabor filter.
+#define SALIENCY_BORDER (SALIENCY_GABOR_TAPS / 2)
+
+// Gaussian pyramids. Green-red and yellow-blue are the negated red-green and
+// blue-yellow pyramids, so they are not stored.
+enum {
+  SALIENCY_PYR_INTENSITY,
+  SALIENCY_PYR_RG,
+  SALIENCY_PYR_BY,
+  SALIENCY_PYRAMIDS
+};
+
+// The saliency map is built in stages. Each stage is split into jobs of
+// SALIENCY_BAND_ROWS rows that only depend on earlier stages.
+enum {
+  SALIENCY_STAGE_COLOR,
+  // One stage per pyramid level from 1 to SALIENCY_LEVELS - 1.
+  SALIENCY_STAGE_PYRAMID,
+  SALIENCY_STAGE_GABOR = SALIENCY_STAGE_PYRAMID + SALIENCY_LEVELS - 1,
+  SALIENCY_STAGE_FEATURE,
+  SALIENCY_STAGE_CONSPICUITY,
+  SALIENCY_STAGE_COMBINE,
+  SALIENCY_STAGE_OUTPUT,
+  SALIENCY_STAGES
+};
+
+// Statistics of one band of a map, used by the normalization operator.
+typedef struct {
+  float min_value;
+  float max_value;
+  double local_max_sum;
+  int local_max_count;
+} SaliencyBandStats;
+
+// A map is normalized to scale * (value - offset).
+typedef struct {
+  float scale;
+  float offset;
+} SaliencyNorm;
+
+// Buffers of av1_set_saliency_map(), kept across frames and reallocated only
+// when the frame size or the number of workers grows.
+typedef struct {
   int width;
-} saliency_feature_map;
+  int height;
+  int num_workers;
+  int pyr_width[SALIENCY_LEVELS];
+  int pyr_height[SALIENCY_LEVELS];
+  int pyr_stride[SALIENCY_LEVELS];
+  // Pyramid levels, pointing at pixel (0, 0) inside a SALIENCY_BORDER border.
+  float *pyramid[SALIENCY_PYRAMIDS][SALIENCY_LEVELS];
+  // Gabor filtered intensity pyramid, levels 2 and up.
+  float *gabor[SALIENCY_ANGLES][SALIENCY_LEVELS];
+  float *feature[SALIENCY_FEATURE_MAPS];
+  // Conspicuity maps, stored at pyramid level 2. The full resolution maps
+  // are their nearest neighbor upscales.
+  float *conspicuity[SALIENCY_CONSPICUITY_MAPS];
+  // Per worker row of the pyramid decimation.
+  float *scratch;
+  int scratch_stride;
+  float *buf;
+  SaliencyBandStats *stats;
+  SaliencyNorm feature_norm[SALIENCY_FEATURE_MAPS];
+  SaliencyNorm conspicuity_norm[SALIENCY_CONSPICUITY_MAPS];
+  // Normalization of the merged color and orientation maps.
+  SaliencyNorm combined_norm[2];
+  // Stage run by the workers of av1_set_saliency_map_stage_mt().
+  int stage;
+} SaliencyMapBuffers;
+
+struct AV1_COMP;
 
-int av1_set_saliency_map(AV1_COMP *cpi);
+int av1_set_saliency_map(struct AV1_COMP *cpi);
+void av1_set_saliency_map_stage_jobs(struct AV1_COMP *cpi, int stage,
+                                     int start, int step);
+void av1_free_saliency_map_buffers(SaliencyMapBuffers *bufs);
 #if !CONFIG_REALTIME_ONLY
-double av1_setup_motion_ratio(AV1_COMP *cpi);
+double av1_setup_motion_ratio(struct AV1_COMP *cpi);
 #endif
-int av1_setup_sm_rdmult_scaling_factor(AV1_COMP *cpi, double motion_ratio);
+int av1_setup_sm_rdmult_scaling_factor(struct AV1_COMP *cpi,
+                                       double motion_ratio);
 
 #endif  // AOM_AV1_ENCODER_SALIENCY_MAP_H_
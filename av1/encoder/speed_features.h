@@ -529,6 +529,11 @@ typedef struct TPL_SPEED_FEATURES {
 
   // Calculate rate and distortion based on Y plane only.
   int use_y_only_rate_distortion;
+
+  // Start the motion search from the motion vector the temporal filter found
+  // for the same pair of frames, and refine it within this full-pel range.
+  // If set to 0, the motion vectors of the temporal filter are not used.
+  int tf_mv_refine_range;
 } TPL_SPEED_FEATURES;
 
 typedef struct GLOBAL_MOTION_SPEED_FEATURES {
@@ -837,6 +842,12 @@ typedef struct MV_SPEED_FEATURES {
 
   // Maximum number of iterations in WARPED_CAUSAL refinement search
   int warp_search_iters;
+
+  // Number of image pyramid levels the motion search of the temporal filter
+  // and tpl starts from, before refining the mv at full resolution in a small
+  // range. 0 and 1 search at full resolution only. The image pyramids of the
+  // lookahead frames are only allocated when this is above 1.
+  int pyramid_search_levels;
 } MV_SPEED_FEATURES;
 
 typedef struct INTER_MODE_SPEED_FEATURES {
@@ -18,6 +18,7 @@
 #include "aom_dsp/aom_dsp_common.h"
 #include "aom_dsp/mathutils.h"
 #include "aom_dsp/odintrin.h"
+#include "aom_dsp/pyramid.h"
 #include "aom_mem/aom_mem.h"
 #include "aom_ports/aom_timer.h"
 #include "aom_ports/mem.h"
@@ -110,7 +111,7 @@ static void tf_motion_search(AV1_COMP *cpi, MACROBLOCK *mb,
   // Parameters used for motion search.
   FULLPEL_MOTION_SEARCH_PARAMS full_ms_params;
   SUBPEL_MOTION_SEARCH_PARAMS ms_params;
-  const int step_param = av1_init_search_range(
+  int step_param = av1_init_search_range(
       AOMMAX(frame_to_filter->y_crop_width, frame_to_filter->y_crop_height));
   const SUBPEL_SEARCH_TYPE subpel_search_type = USE_8_TAPS;
   const int force_integer_mv = cpi->common.features.cur_frame_force_integer_mv;
@@ -121,6 +122,18 @@ static void tf_motion_search(AV1_COMP *cpi, MACROBLOCK *mb,
 
   // Starting position for motion search.
   FULLPEL_MV start_mv = get_fullmv_from_mv(ref_mv);
+  // When the image pyramids are there, the motion is found on the coarse
+  // levels first, so only a small range is left to search here.
+  const int pyramid_levels = cpi->sf.mv_sf.pyramid_search_levels;
+  if (pyramid_levels > 1 && frame_to_filter->y_pyramid &&
+      ref_frame->y_pyramid &&
+      av1_pyramid_full_pixel_search(
+          cpi->ppi->fn_ptr, frame_to_filter->y_pyramid, ref_frame->y_pyramid,
+          mb_col * mb_width, mb_row * mb_height, mb_width, mb_height,
+          pyramid_levels, start_mv, &mb->mv_limits, &start_mv)) {
+    step_param =
+        MAX_MVSEARCH_STEPS - 1 - get_msb(PYRAMID_SEARCH_REFINE_RANGE);
+  }
   // Baseline position for motion search (used for rate distortion comparison).
   const MV baseline_mv = kZeroMv;
 
@@ -801,9 +814,9 @@ int av1_get_q(const AV1_COMP *cpi) {
   return q;
 }
 
-void av1_tf_do_filtering_row(AV1_COMP *cpi, ThreadData *td, int mb_row) {
-  TemporalFilterCtx *tf_ctx = &cpi->tf_ctx;
-  YV12_BUFFER_CONFIG **frames = tf_ctx->frames;
+void av1_tf_do_filtering_row(AV1_COMP *cpi, ThreadData *td,
+                             const TemporalFilterCtx *tf_ctx, int mb_row) {
+  YV12_BUFFER_CONFIG *const *frames = tf_ctx->frames;
   const int num_frames = tf_ctx->num_frames;
   const int filter_frame_idx = tf_ctx->filter_frame_idx;
   const int compute_frame_diff = tf_ctx->compute_frame_diff;
@@ -871,6 +884,15 @@ void av1_tf_do_filtering_row(AV1_COMP *cpi, ThreadData *td, int mb_row) {
       } else {  // Other reference frames.
         tf_motion_search(cpi, mb, frame_to_filter, frames[frame], block_size,
                          mb_row, mb_col, &ref_mv, subblock_mvs, subblock_mses);
+        TF_MV_FIELD *const mv_field = tf_ctx->mv_fields[frame];
+        if (mv_field != NULL) {
+          int_mv *mvs =
+              &mv_field->mvs[2 * mb_row * mv_field->cols + 2 * mb_col];
+          mvs[0].as_mv = subblock_mvs[0];
+          mvs[1].as_mv = subblock_mvs[1];
+          mvs[mv_field->cols].as_mv = subblock_mvs[2];
+          mvs[mv_field->cols + 1].as_mv = subblock_mvs[3];
+        }
       }
 
       // Perform weighted averaging.
@@ -965,11 +987,58 @@ static void tf_do_filtering(AV1_COMP *cpi) {
 
   // Perform temporal filtering for each row.
   for (int mb_row = 0; mb_row < tf_ctx->mb_rows; mb_row++)
-    av1_tf_do_filtering_row(cpi, td, mb_row);
+    av1_tf_do_filtering_row(cpi, td, tf_ctx, mb_row);
 
   tf_restore_state(mbd, input_mb_mode_info, input_buffer, num_planes);
 }
 
+// Returns the field the temporal filter keeps the motion vectors from
+// 'to_filter_buf' to the frame with display index 'ref_display_idx' in. The
+// field is taken from the ones kept for the same pair of frames, or else the
+// oldest one is replaced.
+static TF_MV_FIELD *tf_info_get_mv_field(
+    TEMPORAL_FILTER_INFO *tf_info, const struct lookahead_entry *to_filter_buf,
+    int ref_display_idx, struct aom_internal_error_info *error) {
+  const YV12_BUFFER_CONFIG *frame = &to_filter_buf->img;
+  const BLOCK_SIZE bsize = av1_ss_size_lookup[TF_BLOCK_SIZE][1][1];
+  const int rows = 2 * get_num_blocks(frame->y_crop_height,
+                                      block_size_high[TF_BLOCK_SIZE]);
+  const int cols = 2 * get_num_blocks(frame->y_crop_width,
+                                      block_size_wide[TF_BLOCK_SIZE]);
+  TF_MV_FIELD *field = NULL;
+  for (int i = 0; i < TF_INFO_MV_FIELD_COUNT; ++i) {
+    TF_MV_FIELD *this_field = &tf_info->mv_fields[i];
+    if (this_field->src_display_idx == to_filter_buf->display_idx &&
+        this_field->ref_display_idx == ref_display_idx &&
+        this_field->alloc_size > 0) {
+      field = this_field;
+      break;
+    }
+  }
+  if (field == NULL) {
+    field = &tf_info->mv_fields[tf_info->next_mv_field];
+    tf_info->next_mv_field =
+        (tf_info->next_mv_field + 1) % TF_INFO_MV_FIELD_COUNT;
+  }
+
+  field->valid = 0;
+  if (rows * cols > field->alloc_size) {
+    aom_free(field->mvs);
+    field->alloc_size = 0;
+    AOM_CHECK_MEM_ERROR(error, field->mvs,
+                        aom_malloc(rows * cols * sizeof(*field->mvs)));
+    field->alloc_size = rows * cols;
+  }
+  field->bsize = bsize;
+  field->rows = rows;
+  field->cols = cols;
+  field->width = frame->y_crop_width;
+  field->height = frame->y_crop_height;
+  field->src_display_idx = to_filter_buf->display_idx;
+  field->ref_display_idx = ref_display_idx;
+  return field;
+}
+
 /*!\brief Setups the frame buffer for temporal filtering. This fuction
  * determines how many frames will be used for temporal filtering and then
  * groups them into a buffer. This function will also estimate the noise level
@@ -977,14 +1046,15 @@ static void tf_do_filtering(AV1_COMP *cpi) {
  *
  * \ingroup src_frame_proc
  * \param[in]   cpi             Top level encoder instance structure
+ * \param[in]   tf_ctx          Temporal filter context to set up
  * \param[in]   filter_frame_lookahead_idx  The index of the to-filter frame
  *                              in the lookahead buffer cpi->lookahead
  * \param[in]   gf_frame_index  GOP index
  *
  * \remark Nothing will be returned. But the fields `frames`, `num_frames`,
- *         `filter_frame_idx` and `noise_levels` will be updated in cpi->tf_ctx.
+ *         `filter_frame_idx` and `noise_levels` will be updated in tf_ctx.
  */
-static void tf_setup_filtering_buffer(AV1_COMP *cpi,
+static void tf_setup_filtering_buffer(AV1_COMP *cpi, TemporalFilterCtx *tf_ctx,
                                       int filter_frame_lookahead_idx,
                                       int gf_frame_index) {
   const GF_GROUP *gf_group = &cpi->ppi->gf_group;
@@ -993,7 +1063,6 @@ static void tf_setup_filtering_buffer(AV1_COMP *cpi,
   const int is_forward_keyframe =
       av1_gop_check_forward_keyframe(gf_group, gf_frame_index);
 
-  TemporalFilterCtx *tf_ctx = &cpi->tf_ctx;
   YV12_BUFFER_CONFIG **frames = tf_ctx->frames;
   // Number of frames used for filtering. Set `arnr_max_frames` as 1 to disable
   // temporal filtering.
@@ -1131,6 +1200,10 @@ static void tf_setup_filtering_buffer(AV1_COMP *cpi,
   }
   num_frames = num_before + 1 + num_after;
 
+  // Keep the motion vectors for tpl when it can make use of them.
+  const int keep_mvs = cpi->oxcf.algo_cfg.enable_tpl_model &&
+                       cpi->sf.tpl_sf.tf_mv_refine_range > 0;
+
   // Setup the frame buffer.
   for (int frame = 0; frame < num_frames; ++frame) {
     const int lookahead_idx = frame - num_before + filter_frame_lookahead_idx;
@@ -1138,6 +1211,11 @@ static void tf_setup_filtering_buffer(AV1_COMP *cpi,
         cpi->ppi->lookahead, lookahead_idx, cpi->compressor_stage);
     assert(buf != NULL);
     frames[frame] = &buf->img;
+    tf_ctx->mv_fields[frame] =
+        keep_mvs && frame != num_before
+            ? tf_info_get_mv_field(&cpi->ppi->tf_info, to_filter_buf,
+                                   buf->display_idx, cpi->common.error)
+            : NULL;
   }
   tf_ctx->num_frames = num_frames;
   tf_ctx->filter_frame_idx = num_before;
@@ -1204,26 +1282,41 @@ double av1_estimate_noise_from_single_plane(const YV12_BUFFER_CONFIG *frame,
 // Initializes the members of TemporalFilterCtx
 // Inputs:
 //   cpi: Top level encoder instance structure
+//   tf_ctx: Temporal filter context to initialize.
 //   check_show_existing: If 1, check whether the filtered frame is similar
 //                        to the original frame.
 //   filter_frame_lookahead_idx: The index of the frame to be filtered in the
 //                               lookahead buffer cpi->lookahead.
 // Returns:
-//   Nothing will be returned. But the contents of cpi->tf_ctx will be modified.
-static void init_tf_ctx(AV1_COMP *cpi, int filter_frame_lookahead_idx,
-                        int gf_frame_index, int compute_frame_diff,
+//   Nothing will be returned. But the contents of tf_ctx will be modified.
+static void init_tf_ctx(AV1_COMP *cpi, TemporalFilterCtx *tf_ctx,
+                        int filter_frame_lookahead_idx, int gf_frame_index,
+                        int compute_frame_diff,
                         YV12_BUFFER_CONFIG *output_frame) {
-  TemporalFilterCtx *tf_ctx = &cpi->tf_ctx;
   // Setup frame buffer for filtering.
   YV12_BUFFER_CONFIG **frames = tf_ctx->frames;
   tf_ctx->num_frames = 0;
   tf_ctx->filter_frame_idx = -1;
   tf_ctx->output_frame = output_frame;
   tf_ctx->compute_frame_diff = compute_frame_diff;
-  tf_setup_filtering_buffer(cpi, filter_frame_lookahead_idx, gf_frame_index);
+  tf_setup_filtering_buffer(cpi, tf_ctx, filter_frame_lookahead_idx,
+                            gf_frame_index);
   assert(tf_ctx->num_frames > 0);
   assert(tf_ctx->filter_frame_idx < tf_ctx->num_frames);
 
+  // The output frame is rewritten, so its cached pyramid goes stale. The
+  // pyramids of the frames to search are computed here, before the workers
+  // share them.
+  aom_invalidate_pyramid(output_frame->y_pyramid);
+  if (cpi->sf.mv_sf.pyramid_search_levels > 1) {
+    for (int frame = 0; frame < tf_ctx->num_frames; ++frame) {
+      if (frames[frame] != NULL && frames[frame]->y_pyramid) {
+        aom_compute_pyramid(frames[frame], cpi->common.seq_params->bit_depth,
+                            frames[frame]->y_pyramid);
+      }
+    }
+  }
+
   // Setup scaling factors. Scaling on each of the arnr frames is not
   // supported.
   // ARF is produced at the native frame size and resized when coded.
@@ -1296,10 +1389,11 @@ void av1_temporal_filter(AV1_COMP *cpi, const int filter_frame_lookahead_idx,
   assert(cpi->ppi->gf_group.frame_parallel_level[gf_frame_index] == 0);
 
   // Initialize temporal filter context structure.
-  init_tf_ctx(cpi, filter_frame_lookahead_idx, gf_frame_index,
+  init_tf_ctx(cpi, tf_ctx, filter_frame_lookahead_idx, gf_frame_index,
               compute_frame_diff, output_frame);
 
-  // Allocate and reset temporal filter buffers.
+  // Allocate and reset temporal filter buffers. The buffers are kept for the
+  // next call and freed with the encoder.
   const int is_highbitdepth = tf_ctx->is_highbitdepth;
   if (!tf_alloc_and_reset_data(tf_data, tf_ctx->num_pels, is_highbitdepth)) {
     aom_internal_error(cpi->common.error, AOM_CODEC_MEM_ERROR,
@@ -1312,11 +1406,13 @@ void av1_temporal_filter(AV1_COMP *cpi, const int filter_frame_lookahead_idx,
   else
     tf_do_filtering(cpi);
 
+  for (int frame = 0; frame < tf_ctx->num_frames; ++frame) {
+    if (tf_ctx->mv_fields[frame] != NULL) tf_ctx->mv_fields[frame]->valid = 1;
+  }
+
   if (compute_frame_diff) {
     *frame_diff = tf_data->diff;
   }
-  // Deallocate temporal filter buffers.
-  tf_dealloc_data(tf_data, is_highbitdepth);
 }
 
 int av1_is_temporal_filter_on(const AV1EncoderConfig *oxcf) {
@@ -1346,6 +1442,11 @@ void av1_tf_info_alloc(TEMPORAL_FILTER_INFO *tf_info, const AV1_COMP *cpi) {
 }
 
 void av1_tf_info_free(TEMPORAL_FILTER_INFO *tf_info) {
+  for (int i = 0; i < TF_INFO_MV_FIELD_COUNT; ++i) {
+    aom_free(tf_info->mv_fields[i].mvs);
+  }
+  av1_zero(tf_info->mv_fields);
+  tf_info->next_mv_field = 0;
   if (tf_info->is_temporal_filter_on == 0) return;
   for (int i = 0; i < TF_INFO_BUF_COUNT; ++i) {
     aom_free_frame_buffer(&tf_info->tf_buf[i]);
@@ -1359,10 +1460,45 @@ void av1_tf_info_reset(TEMPORAL_FILTER_INFO *tf_info) {
   av1_zero(tf_info->tf_buf_display_index_offset);
 }
 
+// Filters the key frame and the ARF of a GOP at the same time, each with its
+// own share of the workers. A single frame at low resolution has too few rows
+// to keep all the workers busy.
+static void tf_info_filter_frames_mt(TEMPORAL_FILTER_INFO *tf_info,
+                                     AV1_COMP *cpi, const int *gf_index,
+                                     const int *lookahead_idx) {
+  TemporalFilterCtx tf_ctxs[TF_INFO_BUF_COUNT];
+  FRAME_DIFF frame_diffs[TF_INFO_BUF_COUNT];
+  for (int i = 0; i < TF_INFO_BUF_COUNT; ++i) {
+    assert(cpi->ppi->gf_group.frame_parallel_level[gf_index[i]] == 0);
+    init_tf_ctx(cpi, &tf_ctxs[i], lookahead_idx[i], gf_index[i], 1,
+                &tf_info->tf_buf[i]);
+  }
+
+  // The main thread filters the first frame.
+  if (!tf_alloc_and_reset_data(&cpi->td.tf_data, tf_ctxs[0].num_pels,
+                               tf_ctxs[0].is_highbitdepth)) {
+    aom_internal_error(cpi->common.error, AOM_CODEC_MEM_ERROR,
+                       "Error allocating temporal filter data");
+  }
+  av1_tf_do_filtering_frames_mt(cpi, tf_ctxs, TF_INFO_BUF_COUNT, frame_diffs);
+
+  for (int i = 0; i < TF_INFO_BUF_COUNT; ++i) {
+    for (int frame = 0; frame < tf_ctxs[i].num_frames; ++frame) {
+      if (tf_ctxs[i].mv_fields[frame] != NULL)
+        tf_ctxs[i].mv_fields[frame]->valid = 1;
+    }
+    tf_info->frame_diff[i] = frame_diffs[i];
+  }
+}
+
 void av1_tf_info_filtering(TEMPORAL_FILTER_INFO *tf_info, AV1_COMP *cpi,
                            const GF_GROUP *gf_group) {
   if (tf_info->is_temporal_filter_on == 0) return;
   const AV1_COMMON *const cm = &cpi->common;
+  const MultiThreadInfo *const mt_info = &cpi->mt_info;
+  int pending[TF_INFO_BUF_COUNT] = { 0 };
+  int pending_gf_index[TF_INFO_BUF_COUNT];
+  int pending_lookahead_idx[TF_INFO_BUF_COUNT];
   for (int gf_index = 0; gf_index < gf_group->size; ++gf_index) {
     int update_type = gf_group->update_type[gf_index];
     if (update_type == KF_UPDATE || update_type == ARF_UPDATE) {
@@ -1374,16 +1510,65 @@ void av1_tf_info_filtering(TEMPORAL_FILTER_INFO *tf_info, AV1_COMP *cpi,
       // not exist yet.
       if (tf_info->tf_buf_valid[buf_idx] == 0 ||
           tf_info->tf_buf_display_index_offset[buf_idx] != lookahead_idx) {
-        YV12_BUFFER_CONFIG *out_buf = &tf_info->tf_buf[buf_idx];
-        av1_temporal_filter(cpi, lookahead_idx, gf_index,
-                            &tf_info->frame_diff[buf_idx], out_buf);
-        aom_extend_frame_borders(out_buf, av1_num_planes(cm));
-        tf_info->tf_buf_gf_index[buf_idx] = gf_index;
-        tf_info->tf_buf_display_index_offset[buf_idx] = lookahead_idx;
-        tf_info->tf_buf_valid[buf_idx] = 1;
+        pending[buf_idx] = 1;
+        pending_gf_index[buf_idx] = gf_index;
+        pending_lookahead_idx[buf_idx] = lookahead_idx;
       }
     }
   }
+
+  // The key frame and the ARF do not depend on each other, so they are
+  // filtered concurrently when there are workers enough for both.
+  const int num_workers =
+      AOMMIN(mt_info->num_mod_workers[MOD_TF], mt_info->num_workers);
+  const int filter_concurrently =
+      pending[0] && pending[1] && num_workers >= TF_INFO_BUF_COUNT;
+  if (filter_concurrently) {
+    tf_info_filter_frames_mt(tf_info, cpi, pending_gf_index,
+                             pending_lookahead_idx);
+  }
+
+  for (int buf_idx = 0; buf_idx < TF_INFO_BUF_COUNT; ++buf_idx) {
+    if (!pending[buf_idx]) continue;
+    YV12_BUFFER_CONFIG *out_buf = &tf_info->tf_buf[buf_idx];
+    if (!filter_concurrently) {
+      av1_temporal_filter(cpi, pending_lookahead_idx[buf_idx],
+                          pending_gf_index[buf_idx],
+                          &tf_info->frame_diff[buf_idx], out_buf);
+    }
+    aom_extend_frame_borders(out_buf, av1_num_planes(cm));
+    tf_info->tf_buf_gf_index[buf_idx] = pending_gf_index[buf_idx];
+    tf_info->tf_buf_display_index_offset[buf_idx] =
+        pending_lookahead_idx[buf_idx];
+    tf_info->tf_buf_valid[buf_idx] = 1;
+  }
+}
+
+int av1_tf_info_get_mv(const TEMPORAL_FILTER_INFO *tf_info,
+                       int src_display_idx, int ref_display_idx, int width,
+                       int height, int x, int y, MV *mv) {
+  for (int i = 0; i < TF_INFO_MV_FIELD_COUNT; ++i) {
+    const TF_MV_FIELD *field = &tf_info->mv_fields[i];
+    if (!field->valid || field->width != width || field->height != height)
+      continue;
+    int sign;
+    if (field->src_display_idx == src_display_idx &&
+        field->ref_display_idx == ref_display_idx) {
+      sign = 1;
+    } else if (field->src_display_idx == ref_display_idx &&
+               field->ref_display_idx == src_display_idx) {
+      sign = -1;
+    } else {
+      continue;
+    }
+    const int row = AOMMIN(y / block_size_high[field->bsize], field->rows - 1);
+    const int col = AOMMIN(x / block_size_wide[field->bsize], field->cols - 1);
+    const MV field_mv = field->mvs[row * field->cols + col].as_mv;
+    mv->row = sign * field_mv.row;
+    mv->col = sign * field_mv.col;
+    return 1;
+  }
+  return 0;
 }
 
 YV12_BUFFER_CONFIG *av1_tf_info_get_filtered_buf(TEMPORAL_FILTER_INFO *tf_info,
@@ -87,6 +87,41 @@ typedef struct {
 
 /*!\endcond */
 
+/*!
+ * \brief Motion vectors found by the temporal filter between two source frames.
+ */
+typedef struct {
+  /*!
+   * Motion vector of each block in raster order, pointing from the block in
+   * the source frame to its match in the reference frame.
+   */
+  int_mv *mvs;
+  /*!
+   * Number of allocated entries in mvs.
+   */
+  int alloc_size;
+  /*!
+   * Size of the blocks the motion vectors belong to.
+   */
+  BLOCK_SIZE bsize;
+  /*!
+   * Number of block rows and columns.
+   */
+  int rows, cols;
+  /*!
+   * Dimensions of the frames that were searched.
+   */
+  int width, height;
+  /*!
+   * Display indices of the source and reference frames in the lookahead.
+   */
+  int src_display_idx, ref_display_idx;
+  /*!
+   * Whether all the motion vectors were written.
+   */
+  int valid;
+} TF_MV_FIELD;
+
 /*!
  * \brief Parameters related to temporal filtering.
  */
@@ -99,6 +134,10 @@ typedef struct {
    * Number of frames in the frame buffer.
    */
   int num_frames;
+  /*!
+   * Fields the motion vectors of each frame are kept in, or NULL.
+   */
+  TF_MV_FIELD *mv_fields[MAX_LAG_BUFFERS];
 
   /*!
    * Output filtered frame
@@ -150,6 +189,13 @@ typedef struct {
  */
 #define TF_INFO_BUF_COUNT 2
 
+/*!
+ * Number of motion vector fields kept in TEMPORAL_FILTER_INFO. It covers the
+ * references of all the frames filtered concurrently, so that a field is not
+ * replaced while it is being written.
+ */
+#define TF_INFO_MV_FIELD_COUNT (16 * TF_INFO_BUF_COUNT)
+
 /*!
  * \brief Temporal filter info for a gop
  */
@@ -189,6 +235,16 @@ typedef struct TEMPORAL_FILTER_INFO {
    * whether the buf is valid or not.
    */
   int tf_buf_valid[TF_INFO_BUF_COUNT];
+
+  /*!
+   * Motion vectors found while filtering, which tpl uses to seed its motion
+   * search. The oldest field is replaced when all of them are in use.
+   */
+  TF_MV_FIELD mv_fields[TF_INFO_MV_FIELD_COUNT];
+  /*!
+   * Index of the next field to be replaced in mv_fields.
+   */
+  int next_mv_field;
 } TEMPORAL_FILTER_INFO;
 
 /*!\brief Check whether we should apply temporal filter at all.
@@ -233,6 +289,28 @@ YV12_BUFFER_CONFIG *av1_tf_info_get_filtered_buf(TEMPORAL_FILTER_INFO *tf_info,
                                                  int gf_index,
                                                  FRAME_DIFF *frame_diff);
 
+/*!\brief Get a motion vector found by the temporal filter
+ *
+ * Looks for the motion vector of the block covering (x, y) in the source frame
+ * 'src_display_idx' that points into the reference frame 'ref_display_idx'.
+ * When only the opposite direction was searched, the negated motion vector of
+ * the co-located block is returned instead.
+ *
+ * \param[in]       tf_info           Temporal filter info for a gop
+ * \param[in]       src_display_idx   Display index of the source frame
+ * \param[in]       ref_display_idx   Display index of the reference frame
+ * \param[in]       width             Width of the frames
+ * \param[in]       height            Height of the frames
+ * \param[in]       x                 Column of the pixel in the source frame
+ * \param[in]       y                 Row of the pixel in the source frame
+ * \param[out]      mv                The motion vector
+ *
+ * \return 1 if a motion vector was found, 0 otherwise.
+ */
+int av1_tf_info_get_mv(const TEMPORAL_FILTER_INFO *tf_info,
+                       int src_display_idx, int ref_display_idx, int width,
+                       int height, int x, int y, MV *mv);
+
 /*!\cond */
 
 // Data related to temporal filtering.
@@ -248,6 +326,11 @@ typedef struct {
   uint16_t *count;
   // Pointer to predictor used in temporal filtering process.
   uint8_t *pred;
+  // Number of pixels the buffers above are allocated for, 0 if they are not
+  // allocated.
+  int alloc_num_pels;
+  // Whether pred is allocated for high bit depth.
+  int alloc_is_high_bitdepth;
 } TemporalFilterData;
 
 // Data related to temporal filter multi-thread synchronization.
@@ -256,8 +339,12 @@ typedef struct {
   // Mutex lock used for dispatching jobs.
   pthread_mutex_t *mutex_;
 #endif  // CONFIG_MULTITHREAD
-  // Next temporal filter block row to be filtered.
-  int next_tf_row;
+  // Frames being filtered. Worker i filters frame (i % num_frames).
+  TemporalFilterCtx *tf_ctxs;
+  // Number of frames being filtered.
+  int num_frames;
+  // Next temporal filter block row to be filtered for each frame.
+  int next_tf_row[TF_INFO_BUF_COUNT];
 } AV1TemporalFilterSync;
 
 // Estimates noise level from a given frame using a single plane (Y, U, or V).
@@ -284,6 +371,7 @@ double av1_estimate_noise_from_single_plane(const YV12_BUFFER_CONFIG *frame,
 * \ingroup src_frame_proc
 * \param[in]   cpi                   Top level encoder instance structure
 * \param[in]   td                    Pointer to thread data
+* \param[in]   tf_ctx                Context of the frame being filtered
 * \param[in]   mb_row                Macroblock row to be filtered
 filtering
 *
@@ -291,7 +379,7 @@ filtering
 modified.
 */
 void av1_tf_do_filtering_row(struct AV1_COMP *cpi, struct ThreadData *td,
-                             int mb_row);
+                             const TemporalFilterCtx *tf_ctx, int mb_row);
 
 /*!\brief Performs temporal filtering if needed on a source frame.
  * For example to create a filtered alternate reference frame (ARF)
@@ -344,7 +432,29 @@ int av1_check_show_filtered_frame(const YV12_BUFFER_CONFIG *frame,
 // Helper function to get `q` used for encoding.
 int av1_get_q(const struct AV1_COMP *cpi);
 
-// Allocates memory for members of TemporalFilterData.
+// Deallocates the memory allocated for members of TemporalFilterData.
+// Inputs:
+//   tf_data: Pointer to the structure containing temporal filter related data.
+// Returns:
+//   Nothing will be returned.
+static AOM_INLINE void tf_dealloc_data(TemporalFilterData *tf_data) {
+  if (tf_data->alloc_is_high_bitdepth)
+    tf_data->pred = (uint8_t *)CONVERT_TO_SHORTPTR(tf_data->pred);
+  free(tf_data->tmp_mbmi);
+  aom_free(tf_data->accum);
+  aom_free(tf_data->count);
+  aom_free(tf_data->pred);
+  tf_data->tmp_mbmi = NULL;
+  tf_data->accum = NULL;
+  tf_data->count = NULL;
+  tf_data->pred = NULL;
+  tf_data->alloc_num_pels = 0;
+  tf_data->alloc_is_high_bitdepth = 0;
+}
+
+// Allocates memory for members of TemporalFilterData and resets them. The
+// buffers are kept across frames and are only reallocated when the block size
+// or the bit depth changes.
 // Inputs:
 //   tf_data: Pointer to the structure containing temporal filter related data.
 //   num_pels: Number of pixels in the block across all planes.
@@ -354,25 +464,33 @@ int av1_get_q(const struct AV1_COMP *cpi);
 static AOM_INLINE bool tf_alloc_and_reset_data(TemporalFilterData *tf_data,
                                                int num_pels,
                                                int is_high_bitdepth) {
+  memset(&tf_data->diff, 0, sizeof(tf_data->diff));
+  if (tf_data->alloc_num_pels == num_pels &&
+      tf_data->alloc_is_high_bitdepth == is_high_bitdepth) {
+    memset(tf_data->tmp_mbmi, 0, sizeof(*tf_data->tmp_mbmi));
+    return true;
+  }
+
+  tf_dealloc_data(tf_data);
   tf_data->tmp_mbmi = (MB_MODE_INFO *)malloc(sizeof(*tf_data->tmp_mbmi));
-  memset(tf_data->tmp_mbmi, 0, sizeof(*tf_data->tmp_mbmi));
   tf_data->accum =
       (uint32_t *)aom_memalign(16, num_pels * sizeof(*tf_data->accum));
   tf_data->count =
       (uint16_t *)aom_memalign(16, num_pels * sizeof(*tf_data->count));
-  memset(&tf_data->diff, 0, sizeof(tf_data->diff));
   if (is_high_bitdepth)
     tf_data->pred = CONVERT_TO_BYTEPTR(
         aom_memalign(32, num_pels * 2 * sizeof(*tf_data->pred)));
   else
     tf_data->pred =
         (uint8_t *)aom_memalign(32, num_pels * sizeof(*tf_data->pred));
-  if (!(tf_data->accum && tf_data->count && tf_data->pred)) {
-    aom_free(tf_data->accum);
-    aom_free(tf_data->count);
-    aom_free(tf_data->pred);
+  tf_data->alloc_is_high_bitdepth = is_high_bitdepth;
+  if (!(tf_data->tmp_mbmi && tf_data->accum && tf_data->count &&
+        tf_data->pred)) {
+    tf_dealloc_data(tf_data);
     return false;
   }
+  memset(tf_data->tmp_mbmi, 0, sizeof(*tf_data->tmp_mbmi));
+  tf_data->alloc_num_pels = num_pels;
   return true;
 }
 
@@ -392,22 +510,6 @@ static AOM_INLINE void tf_setup_macroblockd(MACROBLOCKD *mbd,
   mbd->mi[0]->motion_mode = SIMPLE_TRANSLATION;
 }
 
-// Deallocates the memory allocated for members of TemporalFilterData.
-// Inputs:
-//   tf_data: Pointer to the structure containing temporal filter related data.
-//   is_high_bitdepth: Whether the frame is high-bitdepth or not.
-// Returns:
-//   Nothing will be returned.
-static AOM_INLINE void tf_dealloc_data(TemporalFilterData *tf_data,
-                                       int is_high_bitdepth) {
-  if (is_high_bitdepth)
-    tf_data->pred = (uint8_t *)CONVERT_TO_SHORTPTR(tf_data->pred);
-  free(tf_data->tmp_mbmi);
-  aom_free(tf_data->accum);
-  aom_free(tf_data->count);
-  aom_free(tf_data->pred);
-}
-
 // Saves the state prior to temporal filter process.
 // Inputs:
 //   mbd: Pointer to the block for filtering.
@@ -19,6 +19,7 @@
 #include "config/aom_scale_rtcd.h"
 
 #include "aom/aom_codec.h"
+#include "aom_dsp/pyramid.h"
 
 #include "av1/common/av1_common_int.h"
 #include "av1/common/enums.h"
@@ -164,6 +165,7 @@ void av1_setup_tpl_buffers(AV1_PRIMARY *const ppi,
         ALIGN_POWER_OF_TWO(mi_params->mi_rows, MAX_MIB_SIZE_LOG2);
     TplDepFrame *tpl_frame = &tpl_data->tpl_stats_buffer[frame];
     tpl_frame->is_valid = 0;
+    tpl_frame->mvs_searched = 0;
     tpl_frame->width = mi_cols >> block_mis_log2;
     tpl_frame->height = mi_rows >> block_mis_log2;
     tpl_frame->stride = tpl_data->tpl_stats_buffer[frame].width;
@@ -250,11 +252,11 @@ static uint32_t motion_estimation(AV1_COMP *cpi, MACROBLOCK *x,
                                   uint8_t *cur_frame_buf,
                                   uint8_t *ref_frame_buf, int stride,
                                   int stride_ref, BLOCK_SIZE bsize,
-                                  MV center_mv, int_mv *best_mv) {
+                                  MV center_mv, int step_param,
+                                  int_mv *best_mv) {
   AV1_COMMON *cm = &cpi->common;
   MACROBLOCKD *const xd = &x->e_mbd;
   TPL_SPEED_FEATURES *tpl_sf = &cpi->sf.tpl_sf;
-  int step_param;
   uint32_t bestsme = UINT_MAX;
   int distortion;
   uint32_t sse;
@@ -267,7 +269,6 @@ static uint32_t motion_estimation(AV1_COMP *cpi, MACROBLOCK *x,
   xd->plane[0].pre[0].buf = ref_frame_buf;
   xd->plane[0].pre[0].stride = stride_ref;
 
-  step_param = tpl_sf->reduce_first_step_size;
   step_param = AOMMIN(step_param, MAX_MVSEARCH_STEPS - 2);
 
   const search_site_config *search_site_cfg =
@@ -437,6 +438,261 @@ static void get_rate_distortion(
   }
 }
 
+// Collects the starting mvs of the motion search of the block at
+// (mi_row, mi_col) in the reference frame 'rf_idx' from the mvs of the
+// neighbouring blocks, and returns the number of them.
+static int get_tpl_center_mvs(AV1_COMP *cpi, MACROBLOCK *x, int frame_idx,
+                              int rf_idx, int mi_row, int mi_col,
+                              BLOCK_SIZE bsize, const uint8_t *src_mb_buffer,
+                              int src_stride, const uint8_t *ref_mb,
+                              int ref_stride, center_mv_t center_mvs[4]) {
+  AV1_COMMON *cm = &cpi->common;
+  const GF_GROUP *gf_group = &cpi->ppi->gf_group;
+  MACROBLOCKD *xd = &x->e_mbd;
+  TplParams *tpl_data = &cpi->ppi->tpl_data;
+  const TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
+  const uint8_t block_mis_log2 = tpl_data->tpl_stats_block_mis_log2;
+  const int mi_width = mi_size_wide[bsize];
+  const int mi_height = mi_size_high[bsize];
+  const int frame_offset = frame_idx - cpi->gf_frame_index;
+  int refmv_count = 1;
+  int idx;
+
+  if (xd->up_available) {
+    TplDepStats *ref_tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
+        mi_row - mi_height, mi_col, tpl_frame->stride, block_mis_log2)];
+    if (!is_alike_mv(ref_tpl_stats->mv[rf_idx], center_mvs, refmv_count,
+                     cpi->sf.tpl_sf.skip_alike_starting_mv)) {
+      center_mvs[refmv_count].mv.as_int = ref_tpl_stats->mv[rf_idx].as_int;
+      ++refmv_count;
+    }
+  }
+
+  if (xd->left_available) {
+    TplDepStats *ref_tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
+        mi_row, mi_col - mi_width, tpl_frame->stride, block_mis_log2)];
+    if (!is_alike_mv(ref_tpl_stats->mv[rf_idx], center_mvs, refmv_count,
+                     cpi->sf.tpl_sf.skip_alike_starting_mv)) {
+      center_mvs[refmv_count].mv.as_int = ref_tpl_stats->mv[rf_idx].as_int;
+      ++refmv_count;
+    }
+  }
+
+  if (xd->up_available && mi_col + mi_width < xd->tile.mi_col_end) {
+    TplDepStats *ref_tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
+        mi_row - mi_height, mi_col + mi_width, tpl_frame->stride,
+        block_mis_log2)];
+    if (!is_alike_mv(ref_tpl_stats->mv[rf_idx], center_mvs, refmv_count,
+                     cpi->sf.tpl_sf.skip_alike_starting_mv)) {
+      center_mvs[refmv_count].mv.as_int = ref_tpl_stats->mv[rf_idx].as_int;
+      ++refmv_count;
+    }
+  }
+
+  if (cpi->third_pass_ctx &&
+      frame_offset < cpi->third_pass_ctx->frame_info_count &&
+      frame_idx < gf_group->size) {
+    double ratio_h, ratio_w;
+    av1_get_third_pass_ratio(cpi->third_pass_ctx, frame_offset, cm->height,
+                             cm->width, &ratio_h, &ratio_w);
+    THIRD_PASS_MI_INFO *this_mi = av1_get_third_pass_mi(
+        cpi->third_pass_ctx, frame_offset, mi_row, mi_col, ratio_h, ratio_w);
+
+    int_mv tp_mv = av1_get_third_pass_adjusted_mv(this_mi, ratio_h, ratio_w,
+                                                  rf_idx + LAST_FRAME);
+    if (tp_mv.as_int != INVALID_MV &&
+        !is_alike_mv(tp_mv, center_mvs + 1, refmv_count - 1,
+                     cpi->sf.tpl_sf.skip_alike_starting_mv)) {
+      center_mvs[0].mv = tp_mv;
+    }
+  }
+
+  // Prune starting mvs
+  if (cpi->sf.tpl_sf.prune_starting_mv) {
+    // Get each center mv's sad.
+    for (idx = 0; idx < refmv_count; ++idx) {
+      FULLPEL_MV mv = get_fullmv_from_mv(&center_mvs[idx].mv.as_mv);
+      clamp_fullmv(&mv, &x->mv_limits);
+      center_mvs[idx].sad = (int)cpi->ppi->fn_ptr[bsize].sdf(
+          src_mb_buffer, src_stride, &ref_mb[mv.row * ref_stride + mv.col],
+          ref_stride);
+    }
+
+    // Rank center_mv using sad.
+    if (refmv_count > 1) {
+      qsort(center_mvs, refmv_count, sizeof(center_mvs[0]), compare_sad);
+    }
+    refmv_count = AOMMIN(4 - cpi->sf.tpl_sf.prune_starting_mv, refmv_count);
+    // Further reduce number of refmv based on sad difference.
+    if (refmv_count > 1) {
+      int last_sad = center_mvs[refmv_count - 1].sad;
+      int second_to_last_sad = center_mvs[refmv_count - 2].sad;
+      if ((last_sad - second_to_last_sad) * 5 > second_to_last_sad)
+        refmv_count--;
+    }
+  }
+
+  return refmv_count;
+}
+
+// Looks up the mv the temporal filter found for the block at (mi_row, mi_col)
+// of the tpl frame 'frame_idx' in the tpl frame 'ref_frame_idx'.
+static int get_tf_mv(const AV1_COMP *cpi, int frame_idx, int ref_frame_idx,
+                     int mi_row, int mi_col, BLOCK_SIZE bsize, MV *mv) {
+  const AV1_COMMON *cm = &cpi->common;
+  const TplParams *tpl_data = &cpi->ppi->tpl_data;
+  const TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
+  const TplDepFrame *ref_tpl_frame = &tpl_data->tpl_frame[ref_frame_idx];
+  if (tpl_frame->gf_picture == NULL || ref_tpl_frame->gf_picture == NULL)
+    return 0;
+  // The tpl display indices count from the current frame number, while the
+  // temporal filter uses the display indices of the lookahead.
+  const int display_offset = (int)cpi->frame_index_set.show_frame_count -
+                             (int)cm->current_frame.frame_number;
+  const int x = mi_col * MI_SIZE + (block_size_wide[bsize] >> 1);
+  const int y = mi_row * MI_SIZE + (block_size_high[bsize] >> 1);
+  return av1_tf_info_get_mv(
+      &cpi->ppi->tf_info, tpl_frame->frame_display_index + display_offset,
+      ref_tpl_frame->frame_display_index + display_offset,
+      tpl_frame->gf_picture->y_crop_width, tpl_frame->gf_picture->y_crop_height,
+      x, y, mv);
+}
+
+// Returns whether the motion search of the tpl frame 'src' in 'ref' starts
+// with the coarse to fine search in their image pyramids.
+static INLINE int use_pyramid_search(const AV1_COMP *cpi,
+                                     const YV12_BUFFER_CONFIG *src,
+                                     const YV12_BUFFER_CONFIG *ref) {
+  return cpi->sf.mv_sf.pyramid_search_levels > 1 && src->y_pyramid != NULL &&
+         ref->y_pyramid != NULL;
+}
+
+// Computes the image pyramids of the tpl frame 'src' and its reference frames
+// for the motion search, unless they are already cached with the frames.
+static AOM_INLINE void tpl_compute_pyramids(
+    const AV1_COMP *cpi, const YV12_BUFFER_CONFIG *src,
+    const YV12_BUFFER_CONFIG *const ref_frames[INTER_REFS_PER_FRAME],
+    const YV12_BUFFER_CONFIG *const src_ref_frames[INTER_REFS_PER_FRAME]) {
+  const int bit_depth = cpi->common.seq_params->bit_depth;
+  for (int rf_idx = 0; rf_idx < INTER_REFS_PER_FRAME; ++rf_idx) {
+    const YV12_BUFFER_CONFIG *ref = src_ref_frames[rf_idx];
+    if (ref_frames[rf_idx] == NULL || ref == NULL ||
+        !use_pyramid_search(cpi, src, ref))
+      continue;
+    aom_compute_pyramid(src, bit_depth, src->y_pyramid);
+    aom_compute_pyramid(ref, bit_depth, ref->y_pyramid);
+  }
+}
+
+// Runs the single reference motion search of the block at (mi_row, mi_col) in
+// the tpl frame 'frame_idx'. The search only reads the source frames, and the
+// best mv and the SATD cost of its prediction in each reference frame are
+// returned in single_mv and single_inter_cost.
+static AOM_INLINE void single_ref_motion_search(
+    AV1_COMP *cpi, MACROBLOCK *x, int frame_idx,
+    const YV12_BUFFER_CONFIG *const ref_frames[INTER_REFS_PER_FRAME],
+    const YV12_BUFFER_CONFIG *const src_ref_frames[INTER_REFS_PER_FRAME],
+    int mi_row, int mi_col, BLOCK_SIZE bsize, TX_SIZE tx_size,
+    uint8_t *predictor, int16_t *src_diff, tran_low_t *coeff,
+    int_mv single_mv[INTER_REFS_PER_FRAME],
+    int32_t single_inter_cost[INTER_REFS_PER_FRAME]) {
+  MACROBLOCKD *xd = &x->e_mbd;
+  const BitDepthInfo bd_info = get_bit_depth_info(xd);
+  TplParams *tpl_data = &cpi->ppi->tpl_data;
+  const TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
+  const int bw = 4 << mi_size_wide_log2[bsize];
+  const int bh = 4 << mi_size_high_log2[bsize];
+  const int_interpfilters kernel =
+      av1_broadcast_interp_filter(EIGHTTAP_REGULAR);
+
+  int mb_y_offset = mi_row * MI_SIZE * xd->cur_buf->y_stride + mi_col * MI_SIZE;
+  uint8_t *src_mb_buffer = xd->cur_buf->y_buffer + mb_y_offset;
+  int src_stride = xd->cur_buf->y_stride;
+
+  for (int rf_idx = 0; rf_idx < INTER_REFS_PER_FRAME; ++rf_idx) {
+    single_mv[rf_idx].as_int = INVALID_MV;
+    single_inter_cost[rf_idx] = INT32_MAX;
+    if (ref_frames[rf_idx] == NULL || src_ref_frames[rf_idx] == NULL) continue;
+
+    const YV12_BUFFER_CONFIG *ref_frame_ptr = src_ref_frames[rf_idx];
+    int ref_mb_offset =
+        mi_row * MI_SIZE * ref_frame_ptr->y_stride + mi_col * MI_SIZE;
+    uint8_t *ref_mb = ref_frame_ptr->y_buffer + ref_mb_offset;
+    int ref_stride = ref_frame_ptr->y_stride;
+
+    int_mv best_rfidx_mv = { 0 };
+    uint32_t bestsme = UINT32_MAX;
+
+    center_mv_t center_mvs[4] = { { { 0 }, INT_MAX },
+                                  { { 0 }, INT_MAX },
+                                  { { 0 }, INT_MAX },
+                                  { { 0 }, INT_MAX } };
+    int refmv_count;
+    int step_param = cpi->sf.tpl_sf.reduce_first_step_size;
+    MV tf_mv;
+    FULLPEL_MV pyramid_mv;
+    if (cpi->sf.tpl_sf.tf_mv_refine_range > 0 &&
+        get_tf_mv(cpi, frame_idx, tpl_frame->ref_map_index[rf_idx], mi_row,
+                  mi_col, bsize, &tf_mv)) {
+      // The temporal filter has already searched this pair of frames, so its
+      // mv is the only starting point and is refined within a small range.
+      center_mvs[0].mv.as_mv = tf_mv;
+      refmv_count = 1;
+      step_param = MAX_MVSEARCH_STEPS - 1 -
+                   get_msb(cpi->sf.tpl_sf.tf_mv_refine_range);
+    } else if (use_pyramid_search(cpi, xd->cur_buf, ref_frame_ptr) &&
+               av1_pyramid_full_pixel_search(
+                   cpi->ppi->fn_ptr, xd->cur_buf->y_pyramid,
+                   ref_frame_ptr->y_pyramid, mi_col * MI_SIZE,
+                   mi_row * MI_SIZE, bw, bh,
+                   cpi->sf.mv_sf.pyramid_search_levels, kZeroFullMv,
+                   &x->mv_limits, &pyramid_mv)) {
+      // The coarse to fine search in the image pyramids gives the only
+      // starting point, which is refined within a small range.
+      center_mvs[0].mv.as_mv = get_mv_from_fullmv(&pyramid_mv);
+      refmv_count = 1;
+      step_param =
+          MAX_MVSEARCH_STEPS - 1 - get_msb(PYRAMID_SEARCH_REFINE_RANGE);
+    } else {
+      refmv_count = get_tpl_center_mvs(cpi, x, frame_idx, rf_idx, mi_row,
+                                       mi_col, bsize, src_mb_buffer,
+                                       src_stride, ref_mb, ref_stride,
+                                       center_mvs);
+    }
+
+    for (int idx = 0; idx < refmv_count; ++idx) {
+      int_mv this_mv;
+      uint32_t thissme = motion_estimation(cpi, x, src_mb_buffer, ref_mb,
+                                           src_stride, ref_stride, bsize,
+                                           center_mvs[idx].mv.as_mv, step_param,
+                                           &this_mv);
+
+      if (thissme < bestsme) {
+        bestsme = thissme;
+        best_rfidx_mv = this_mv;
+      }
+    }
+
+    single_mv[rf_idx] = best_rfidx_mv;
+
+    struct buf_2d ref_buf = { NULL, ref_frame_ptr->y_buffer,
+                              ref_frame_ptr->y_width, ref_frame_ptr->y_height,
+                              ref_frame_ptr->y_stride };
+    InterPredParams inter_pred_params;
+    av1_init_inter_params(&inter_pred_params, bw, bh, mi_row * MI_SIZE,
+                          mi_col * MI_SIZE, 0, 0, xd->bd, is_cur_buf_hbd(xd), 0,
+                          &tpl_data->sf, &ref_buf, kernel);
+    inter_pred_params.conv_params = get_conv_params(0, 0, xd->bd);
+
+    av1_enc_build_one_inter_predictor(predictor, bw, &best_rfidx_mv.as_mv,
+                                      &inter_pred_params);
+
+    single_inter_cost[rf_idx] =
+        tpl_get_satd_cost(bd_info, src_diff, bw, src_mb_buffer, src_stride,
+                          predictor, bw, coeff, bw, bh, tx_size);
+  }
+}
+
 static AOM_INLINE void mode_estimation(AV1_COMP *cpi,
                                        TplTxfmStats *tpl_txfm_stats,
                                        MACROBLOCK *x, int mi_row, int mi_col,
@@ -625,138 +881,39 @@ static AOM_INLINE void mode_estimation(AV1_COMP *cpi,
   int32_t best_inter_cost = INT32_MAX;
   int rf_idx;
   int_mv single_mv[INTER_REFS_PER_FRAME];
+  int32_t single_inter_cost[INTER_REFS_PER_FRAME];
 
   best_mv[0].as_int = INVALID_MV;
   best_mv[1].as_int = INVALID_MV;
 
+  if (tpl_frame->mvs_searched) {
+    // The single reference motion search of this frame was done ahead by
+    // av1_tpl_search_frame_mvs().
+    const TplDepStats *searched_stats =
+        &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
+            mi_row, mi_col, tpl_frame->stride, block_mis_log2)];
+    for (rf_idx = 0; rf_idx < INTER_REFS_PER_FRAME; ++rf_idx) {
+      single_mv[rf_idx] = searched_stats->mv[rf_idx];
+      single_inter_cost[rf_idx] = (int32_t)searched_stats->pred_error[rf_idx];
+    }
+    // The compound search below expects the source block set up by the
+    // motion search.
+    x->plane[0].src.buf = src_mb_buffer;
+    x->plane[0].src.stride = src_stride;
+  } else {
+    single_ref_motion_search(cpi, x, tpl_data->frame_idx, tpl_data->ref_frame,
+                             tpl_data->src_ref_frame, mi_row, mi_col, bsize,
+                             tx_size, predictor, src_diff, coeff, single_mv,
+                             single_inter_cost);
+  }
+
   for (rf_idx = 0; rf_idx < INTER_REFS_PER_FRAME; ++rf_idx) {
-    single_mv[rf_idx].as_int = INVALID_MV;
+    tpl_stats->mv[rf_idx] = single_mv[rf_idx];
     if (tpl_data->ref_frame[rf_idx] == NULL ||
-        tpl_data->src_ref_frame[rf_idx] == NULL) {
-      tpl_stats->mv[rf_idx].as_int = INVALID_MV;
+        tpl_data->src_ref_frame[rf_idx] == NULL)
       continue;
-    }
-
-    const YV12_BUFFER_CONFIG *ref_frame_ptr = tpl_data->src_ref_frame[rf_idx];
-    int ref_mb_offset =
-        mi_row * MI_SIZE * ref_frame_ptr->y_stride + mi_col * MI_SIZE;
-    uint8_t *ref_mb = ref_frame_ptr->y_buffer + ref_mb_offset;
-    int ref_stride = ref_frame_ptr->y_stride;
-
-    int_mv best_rfidx_mv = { 0 };
-    uint32_t bestsme = UINT32_MAX;
-
-    center_mv_t center_mvs[4] = { { { 0 }, INT_MAX },
-                                  { { 0 }, INT_MAX },
-                                  { { 0 }, INT_MAX },
-                                  { { 0 }, INT_MAX } };
-    int refmv_count = 1;
-    int idx;
-
-    if (xd->up_available) {
-      TplDepStats *ref_tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
-          mi_row - mi_height, mi_col, tpl_frame->stride, block_mis_log2)];
-      if (!is_alike_mv(ref_tpl_stats->mv[rf_idx], center_mvs, refmv_count,
-                       cpi->sf.tpl_sf.skip_alike_starting_mv)) {
-        center_mvs[refmv_count].mv.as_int = ref_tpl_stats->mv[rf_idx].as_int;
-        ++refmv_count;
-      }
-    }
-
-    if (xd->left_available) {
-      TplDepStats *ref_tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
-          mi_row, mi_col - mi_width, tpl_frame->stride, block_mis_log2)];
-      if (!is_alike_mv(ref_tpl_stats->mv[rf_idx], center_mvs, refmv_count,
-                       cpi->sf.tpl_sf.skip_alike_starting_mv)) {
-        center_mvs[refmv_count].mv.as_int = ref_tpl_stats->mv[rf_idx].as_int;
-        ++refmv_count;
-      }
-    }
-
-    if (xd->up_available && mi_col + mi_width < xd->tile.mi_col_end) {
-      TplDepStats *ref_tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
-          mi_row - mi_height, mi_col + mi_width, tpl_frame->stride,
-          block_mis_log2)];
-      if (!is_alike_mv(ref_tpl_stats->mv[rf_idx], center_mvs, refmv_count,
-                       cpi->sf.tpl_sf.skip_alike_starting_mv)) {
-        center_mvs[refmv_count].mv.as_int = ref_tpl_stats->mv[rf_idx].as_int;
-        ++refmv_count;
-      }
-    }
-
-    if (cpi->third_pass_ctx &&
-        frame_offset < cpi->third_pass_ctx->frame_info_count &&
-        tpl_data->frame_idx < gf_group->size) {
-      double ratio_h, ratio_w;
-      av1_get_third_pass_ratio(cpi->third_pass_ctx, frame_offset, cm->height,
-                               cm->width, &ratio_h, &ratio_w);
-      THIRD_PASS_MI_INFO *this_mi = av1_get_third_pass_mi(
-          cpi->third_pass_ctx, frame_offset, mi_row, mi_col, ratio_h, ratio_w);
-
-      int_mv tp_mv = av1_get_third_pass_adjusted_mv(this_mi, ratio_h, ratio_w,
-                                                    rf_idx + LAST_FRAME);
-      if (tp_mv.as_int != INVALID_MV &&
-          !is_alike_mv(tp_mv, center_mvs + 1, refmv_count - 1,
-                       cpi->sf.tpl_sf.skip_alike_starting_mv)) {
-        center_mvs[0].mv = tp_mv;
-      }
-    }
-
-    // Prune starting mvs
-    if (cpi->sf.tpl_sf.prune_starting_mv) {
-      // Get each center mv's sad.
-      for (idx = 0; idx < refmv_count; ++idx) {
-        FULLPEL_MV mv = get_fullmv_from_mv(&center_mvs[idx].mv.as_mv);
-        clamp_fullmv(&mv, &x->mv_limits);
-        center_mvs[idx].sad = (int)cpi->ppi->fn_ptr[bsize].sdf(
-            src_mb_buffer, src_stride, &ref_mb[mv.row * ref_stride + mv.col],
-            ref_stride);
-      }
-
-      // Rank center_mv using sad.
-      if (refmv_count > 1) {
-        qsort(center_mvs, refmv_count, sizeof(center_mvs[0]), compare_sad);
-      }
-      refmv_count = AOMMIN(4 - cpi->sf.tpl_sf.prune_starting_mv, refmv_count);
-      // Further reduce number of refmv based on sad difference.
-      if (refmv_count > 1) {
-        int last_sad = center_mvs[refmv_count - 1].sad;
-        int second_to_last_sad = center_mvs[refmv_count - 2].sad;
-        if ((last_sad - second_to_last_sad) * 5 > second_to_last_sad)
-          refmv_count--;
-      }
-    }
-
-    for (idx = 0; idx < refmv_count; ++idx) {
-      int_mv this_mv;
-      uint32_t thissme = motion_estimation(cpi, x, src_mb_buffer, ref_mb,
-                                           src_stride, ref_stride, bsize,
-                                           center_mvs[idx].mv.as_mv, &this_mv);
-
-      if (thissme < bestsme) {
-        bestsme = thissme;
-        best_rfidx_mv = this_mv;
-      }
-    }
-
-    tpl_stats->mv[rf_idx].as_int = best_rfidx_mv.as_int;
-    single_mv[rf_idx] = best_rfidx_mv;
-
-    struct buf_2d ref_buf = { NULL, ref_frame_ptr->y_buffer,
-                              ref_frame_ptr->y_width, ref_frame_ptr->y_height,
-                              ref_frame_ptr->y_stride };
-    InterPredParams inter_pred_params;
-    av1_init_inter_params(&inter_pred_params, bw, bh, mi_row * MI_SIZE,
-                          mi_col * MI_SIZE, 0, 0, xd->bd, is_cur_buf_hbd(xd), 0,
-                          &tpl_data->sf, &ref_buf, kernel);
-    inter_pred_params.conv_params = get_conv_params(0, 0, xd->bd);
-
-    av1_enc_build_one_inter_predictor(predictor, bw, &best_rfidx_mv.as_mv,
-                                      &inter_pred_params);
 
-    inter_cost =
-        tpl_get_satd_cost(bd_info, src_diff, bw, src_mb_buffer, src_stride,
-                          predictor, bw, coeff, bw, bh, tx_size);
+    inter_cost = single_inter_cost[rf_idx];
     // Store inter cost for each ref frame
     tpl_stats->pred_error[rf_idx] = AOMMAX(1, inter_cost);
 
@@ -764,7 +921,7 @@ static AOM_INLINE void mode_estimation(AV1_COMP *cpi,
       best_rf_idx = rf_idx;
 
       best_inter_cost = inter_cost;
-      best_mv[0].as_int = best_rfidx_mv.as_int;
+      best_mv[0].as_int = single_mv[rf_idx].as_int;
     }
   }
 
@@ -1197,12 +1354,15 @@ static AOM_INLINE int get_gop_length(const GF_GROUP *gf_group) {
   return gop_length;
 }
 
-// Initialize the mc_flow parameters used in computing tpl data.
-static AOM_INLINE void init_mc_flow_dispenser(AV1_COMP *cpi, int frame_idx,
-                                              int pframe_qindex) {
-  TplParams *const tpl_data = &cpi->ppi->tpl_data;
-  TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
-  const YV12_BUFFER_CONFIG *this_frame = tpl_frame->gf_picture;
+// Sets up the reconstructed and source reference frames of the tpl frame
+// 'frame_idx'. The reference frames skipped by the motion search are set to
+// NULL in ref_frames.
+static AOM_INLINE void get_tpl_ref_frames(
+    AV1_COMP *cpi, int frame_idx,
+    const YV12_BUFFER_CONFIG *ref_frames[INTER_REFS_PER_FRAME],
+    const YV12_BUFFER_CONFIG *src_ref_frames[INTER_REFS_PER_FRAME]) {
+  const TplParams *const tpl_data = &cpi->ppi->tpl_data;
+  const TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
   const YV12_BUFFER_CONFIG *ref_frames_ordered[INTER_REFS_PER_FRAME];
   uint32_t ref_frame_display_indices[INTER_REFS_PER_FRAME];
   const GF_GROUP *gf_group = &cpi->ppi->gf_group;
@@ -1211,39 +1371,19 @@ static AOM_INLINE void init_mc_flow_dispenser(AV1_COMP *cpi, int frame_idx,
       cpi->sf.tpl_sf.prune_ref_frames_in_tpl, frame_idx);
   int gop_length = get_gop_length(gf_group);
   int ref_frame_flags;
-  AV1_COMMON *cm = &cpi->common;
-  int rdmult, idx;
-  ThreadData *td = &cpi->td;
-  MACROBLOCK *x = &td->mb;
-  MACROBLOCKD *xd = &x->e_mbd;
-  TplTxfmStats *tpl_txfm_stats = &td->tpl_txfm_stats;
-  tpl_data->frame_idx = frame_idx;
-  tpl_reset_src_ref_frames(tpl_data);
-  av1_tile_init(&xd->tile, cm, 0, 0);
-
-  const int boost_index = AOMMIN(15, (cpi->ppi->p_rc.gfu_boost / 100));
-  const int layer_depth = AOMMIN(gf_group->layer_depth[cpi->gf_frame_index], 6);
-  const FRAME_TYPE frame_type = cm->current_frame.frame_type;
-
-  // Setup scaling factor
-  av1_setup_scale_factors_for_frame(
-      &tpl_data->sf, this_frame->y_crop_width, this_frame->y_crop_height,
-      this_frame->y_crop_width, this_frame->y_crop_height);
-
-  xd->cur_buf = this_frame;
+  int idx;
 
   for (idx = 0; idx < INTER_REFS_PER_FRAME; ++idx) {
-    TplDepFrame *tpl_ref_frame =
+    const TplDepFrame *tpl_ref_frame =
         &tpl_data->tpl_frame[tpl_frame->ref_map_index[idx]];
-    tpl_data->ref_frame[idx] = tpl_ref_frame->rec_picture;
-    tpl_data->src_ref_frame[idx] = tpl_ref_frame->gf_picture;
+    ref_frames[idx] = tpl_ref_frame->rec_picture;
+    src_ref_frames[idx] = tpl_ref_frame->gf_picture;
     ref_frame_display_indices[idx] = tpl_ref_frame->frame_display_index;
   }
 
   // Store the reference frames based on priority order
   for (int i = 0; i < INTER_REFS_PER_FRAME; ++i) {
-    ref_frames_ordered[i] =
-        tpl_data->ref_frame[ref_frame_priority_order[i] - 1];
+    ref_frames_ordered[i] = ref_frames[ref_frame_priority_order[i] - 1];
   }
 
   // Work out which reference frame slots may be used.
@@ -1257,7 +1397,7 @@ static AOM_INLINE void init_mc_flow_dispenser(AV1_COMP *cpi, int frame_idx,
   // Prune reference frames
   for (idx = 0; idx < INTER_REFS_PER_FRAME; ++idx) {
     if ((ref_frame_flags & (1 << idx)) == 0) {
-      tpl_data->ref_frame[idx] = NULL;
+      ref_frames[idx] = NULL;
     }
   }
 
@@ -1271,10 +1411,44 @@ static AOM_INLINE void init_mc_flow_dispenser(AV1_COMP *cpi, int frame_idx,
       const MV_REFERENCE_FRAME refs[2] = { idx + 1, NONE_FRAME };
       if (prune_ref_by_selective_ref_frame(cpi, NULL, refs,
                                            ref_frame_display_indices)) {
-        tpl_data->ref_frame[idx] = NULL;
+        ref_frames[idx] = NULL;
       }
     }
   }
+}
+
+// Initialize the mc_flow parameters used in computing tpl data.
+static AOM_INLINE void init_mc_flow_dispenser(AV1_COMP *cpi, int frame_idx,
+                                              int pframe_qindex) {
+  TplParams *const tpl_data = &cpi->ppi->tpl_data;
+  TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
+  const YV12_BUFFER_CONFIG *this_frame = tpl_frame->gf_picture;
+  const GF_GROUP *gf_group = &cpi->ppi->gf_group;
+  AV1_COMMON *cm = &cpi->common;
+  int rdmult;
+  ThreadData *td = &cpi->td;
+  MACROBLOCK *x = &td->mb;
+  MACROBLOCKD *xd = &x->e_mbd;
+  TplTxfmStats *tpl_txfm_stats = &td->tpl_txfm_stats;
+  tpl_data->frame_idx = frame_idx;
+  tpl_reset_src_ref_frames(tpl_data);
+  av1_tile_init(&xd->tile, cm, 0, 0);
+
+  const int boost_index = AOMMIN(15, (cpi->ppi->p_rc.gfu_boost / 100));
+  const int layer_depth = AOMMIN(gf_group->layer_depth[cpi->gf_frame_index], 6);
+  const FRAME_TYPE frame_type = cm->current_frame.frame_type;
+
+  // Setup scaling factor
+  av1_setup_scale_factors_for_frame(
+      &tpl_data->sf, this_frame->y_crop_width, this_frame->y_crop_height,
+      this_frame->y_crop_width, this_frame->y_crop_height);
+
+  xd->cur_buf = this_frame;
+
+  get_tpl_ref_frames(cpi, frame_idx, tpl_data->ref_frame,
+                     tpl_data->src_ref_frame);
+  tpl_compute_pyramids(cpi, this_frame, tpl_data->ref_frame,
+                       tpl_data->src_ref_frame);
 
   // Make a temporary mbmi for tpl model
   MB_MODE_INFO mbmi;
@@ -1366,6 +1540,105 @@ void av1_mc_flow_dispenser_row(AV1_COMP *cpi, TplTxfmStats *tpl_txfm_stats,
   }
 }
 
+// Runs the single reference motion search of all the blocks of the tpl frame
+// 'frame_idx' and leaves the results in its tpl stats, to be picked up by
+// mode_estimation(). As the search only reads the source frames, this may be
+// done for several frames at the same time.
+void av1_tpl_search_frame_mvs(AV1_COMP *cpi, MACROBLOCK *x, int frame_idx) {
+  AV1_COMMON *const cm = &cpi->common;
+  const CommonModeInfoParams *const mi_params = &cm->mi_params;
+  TplParams *const tpl_data = &cpi->ppi->tpl_data;
+  TplDepFrame *tpl_frame = &tpl_data->tpl_frame[frame_idx];
+  MACROBLOCKD *xd = &x->e_mbd;
+  const BLOCK_SIZE bsize = convert_length_to_bsize(tpl_data->tpl_bsize_1d);
+  const TX_SIZE tx_size = max_txsize_lookup[bsize];
+  const int mi_height = mi_size_high[bsize];
+  const int mi_width = mi_size_wide[bsize];
+  const YV12_BUFFER_CONFIG *ref_frames[INTER_REFS_PER_FRAME];
+  const YV12_BUFFER_CONFIG *src_ref_frames[INTER_REFS_PER_FRAME];
+  int_mv single_mv[INTER_REFS_PER_FRAME];
+  int32_t single_inter_cost[INTER_REFS_PER_FRAME];
+
+  get_tpl_ref_frames(cpi, frame_idx, ref_frames, src_ref_frames);
+  xd->cur_buf = tpl_frame->gf_picture;
+  tpl_compute_pyramids(cpi, tpl_frame->gf_picture, ref_frames,
+                       src_ref_frames);
+
+  // Number of pixels in a tpl block
+  const int tpl_block_pels = tpl_data->tpl_bsize_1d * tpl_data->tpl_bsize_1d;
+  // Allocate temporary buffers used in motion estimation.
+  uint8_t *predictor8 = aom_memalign(32, tpl_block_pels * 2 * sizeof(uint8_t));
+  int16_t *src_diff = aom_memalign(32, tpl_block_pels * sizeof(int16_t));
+  tran_low_t *coeff = aom_memalign(32, tpl_block_pels * sizeof(tran_low_t));
+  uint8_t *predictor =
+      is_cur_buf_hbd(xd) ? CONVERT_TO_BYTEPTR(predictor8) : predictor8;
+
+  if (!(predictor8 && src_diff && coeff)) {
+    aom_free(predictor8);
+    aom_free(src_diff);
+    aom_free(coeff);
+    aom_internal_error(cm->error, AOM_CODEC_MEM_ERROR,
+                       "Error allocating tpl data");
+  }
+
+  // Make a temporary mbmi for tpl model. Unlike mode_estimation(), the search
+  // does not touch the frame level mode info grid, which may be in use by
+  // the other frames.
+  MB_MODE_INFO mbmi;
+  memset(&mbmi, 0, sizeof(mbmi));
+  MB_MODE_INFO *mbmi_ptr = &mbmi;
+  xd->mi = &mbmi_ptr;
+  mbmi.bsize = bsize;
+  mbmi.motion_mode = SIMPLE_TRANSLATION;
+  mbmi.ref_frame[0] = INTRA_FRAME;
+  mbmi.ref_frame[1] = NONE_FRAME;
+  mbmi.compound_idx = 1;
+  set_plane_n4(xd, mi_width, mi_height, av1_num_planes(cm));
+  xd->width = mi_width;
+  xd->height = mi_height;
+
+  for (int mi_row = 0; mi_row < mi_params->mi_rows; mi_row += mi_height) {
+    // Motion estimation row boundary, as set by tpl_worker_hook() for the row
+    // multi-threaded tpl this search is done ahead of.
+    av1_set_mv_row_limits(mi_params, &x->mv_limits, mi_row, mi_height,
+                          cpi->oxcf.border_in_pixels);
+    xd->mb_to_top_edge = -GET_MV_SUBPEL(mi_row * MI_SIZE);
+    xd->mb_to_bottom_edge =
+        GET_MV_SUBPEL((mi_params->mi_rows - mi_height - mi_row) * MI_SIZE);
+    // The remaining block position fields are set as set_mi_row_col() would.
+    xd->mi_row = mi_row;
+    xd->up_available = (mi_row > xd->tile.mi_row_start);
+    for (int mi_col = 0; mi_col < mi_params->mi_cols; mi_col += mi_width) {
+      // Motion estimation column boundary
+      av1_set_mv_col_limits(mi_params, &x->mv_limits, mi_col, mi_width,
+                            tpl_data->border_in_pixels);
+      xd->mb_to_left_edge = -GET_MV_SUBPEL(mi_col * MI_SIZE);
+      xd->mb_to_right_edge =
+          GET_MV_SUBPEL((mi_params->mi_cols - mi_width - mi_col) * MI_SIZE);
+      xd->mi_col = mi_col;
+      xd->left_available = (mi_col > xd->tile.mi_col_start);
+
+      single_ref_motion_search(cpi, x, frame_idx, ref_frames, src_ref_frames,
+                               mi_row, mi_col, bsize, tx_size, predictor,
+                               src_diff, coeff, single_mv, single_inter_cost);
+
+      TplDepStats *tpl_stats = &tpl_frame->tpl_stats_ptr[av1_tpl_ptr_pos(
+          mi_row, mi_col, tpl_frame->stride,
+          tpl_data->tpl_stats_block_mis_log2)];
+      for (int rf_idx = 0; rf_idx < INTER_REFS_PER_FRAME; ++rf_idx) {
+        tpl_stats->mv[rf_idx] = single_mv[rf_idx];
+        tpl_stats->pred_error[rf_idx] = single_inter_cost[rf_idx];
+      }
+    }
+  }
+  tpl_frame->mvs_searched = 1;
+
+  xd->mi = NULL;
+  aom_free(predictor8);
+  aom_free(src_diff);
+  aom_free(coeff);
+}
+
 static AOM_INLINE void mc_flow_dispenser(AV1_COMP *cpi) {
   AV1_COMMON *cm = &cpi->common;
   const CommonModeInfoParams *const mi_params = &cm->mi_params;
@@ -1461,7 +1734,10 @@ static AOM_INLINE void init_gop_frames_for_tpl(
 
     const struct lookahead_entry *buf = av1_lookahead_peek(
         cpi->ppi->lookahead, lookahead_index, cpi->compressor_stage);
-    if (buf == NULL) break;
+    // A LAP window longer than the lag keeps more frames in the look ahead
+    // than there are TPL buffers for.
+    if (buf == NULL || lookahead_index >= cpi->oxcf.gf_cfg.lag_in_frames)
+      break;
     tpl_frame->gf_picture = &buf->img;
 
     // Use filtered frame buffer if available. This will make tpl stats more
@@ -1544,7 +1820,8 @@ static AOM_INLINE void init_gop_frames_for_tpl(
     struct lookahead_entry *buf = av1_lookahead_peek(
         cpi->ppi->lookahead, lookahead_index, cpi->compressor_stage);
 
-    if (buf == NULL) break;
+    if (buf == NULL || lookahead_index >= cpi->oxcf.gf_cfg.lag_in_frames)
+      break;
 
     tpl_frame->gf_picture = &buf->img;
     tpl_frame->rec_picture = &tpl_data->tpl_rec_pool[process_frame_count];
@@ -1616,6 +1893,7 @@ void av1_init_tpl_stats(TplParams *const tpl_data) {
   for (int frame_idx = 0; frame_idx < MAX_LENGTH_TPL_FRAME_STATS; ++frame_idx) {
     TplDepFrame *tpl_frame = &tpl_data->tpl_stats_buffer[frame_idx];
     tpl_frame->is_valid = 0;
+    tpl_frame->mvs_searched = 0;
   }
   for (int frame_idx = 0; frame_idx < MAX_LAG_BUFFERS; ++frame_idx) {
     TplDepFrame *tpl_frame = &tpl_data->tpl_stats_buffer[frame_idx];
@@ -1678,6 +1956,22 @@ void av1_tpl_preload_rc_estimate(AV1_COMP *cpi,
   }
 }
 
+// Returns whether the tpl stats calculation is skipped for the frame
+// 'frame_idx'.
+static AOM_INLINE int skip_tpl_for_frame(const GF_GROUP *gf_group,
+                                         int frame_idx, int approx_gop_eval,
+                                         int num_arf_layers, int gop_length) {
+  if (gf_group->update_type[frame_idx] == INTNL_OVERLAY_UPDATE ||
+      gf_group->update_type[frame_idx] == OVERLAY_UPDATE)
+    return 1;
+
+  // When approx_gop_eval = 1, skip tpl stats calculation for higher layer
+  // frames and for frames beyond gop length.
+  return approx_gop_eval &&
+         (gf_group->layer_depth[frame_idx] > num_arf_layers ||
+          frame_idx >= gop_length);
+}
+
 int av1_tpl_setup_stats(AV1_COMP *cpi, int gop_eval,
                         const EncodeFrameParams *const frame_params) {
 #if CONFIG_COLLECT_COMPONENT_TIMING
@@ -1741,17 +2035,34 @@ int av1_tpl_setup_stats(AV1_COMP *cpi, int gop_eval,
   const int gop_length = get_gop_length(gf_group);
   const int num_planes =
       cpi->sf.tpl_sf.use_y_only_rate_distortion ? 1 : av1_num_planes(cm);
+
+  // The single reference motion search only reads the source frames, so it is
+  // run for all the frames at once, one frame per worker, leaving the rest of
+  // mode_estimation() to the row based multi-threading below.
+  const int num_tpl_workers =
+      AOMMIN(mt_info->num_mod_workers[MOD_TPL], mt_info->num_workers);
+  if (mt_info->num_workers > 1 && num_tpl_workers > 1 &&
+      !cpi->use_ducky_encode) {
+    int mv_search_frames[MAX_TPL_FRAME_IDX];
+    int num_mv_search_frames = 0;
+    for (int frame_idx = cpi->gf_frame_index; frame_idx < tpl_gf_group_frames;
+         ++frame_idx) {
+      if (skip_tpl_for_frame(gf_group, frame_idx, approx_gop_eval,
+                             num_arf_layers, gop_length))
+        continue;
+      mv_search_frames[num_mv_search_frames++] = frame_idx;
+    }
+    if (num_mv_search_frames > 1) {
+      init_mc_flow_dispenser(cpi, mv_search_frames[0], pframe_qindex);
+      av1_tpl_search_mvs_mt(cpi, mv_search_frames, num_mv_search_frames);
+    }
+  }
+
   // Backward propagation from tpl_group_frames to 1.
   for (int frame_idx = cpi->gf_frame_index; frame_idx < tpl_gf_group_frames;
        ++frame_idx) {
-    if (gf_group->update_type[frame_idx] == INTNL_OVERLAY_UPDATE ||
-        gf_group->update_type[frame_idx] == OVERLAY_UPDATE)
-      continue;
-
-    // When approx_gop_eval = 1, skip tpl stats calculation for higher layer
-    // frames and for frames beyond gop length.
-    if (approx_gop_eval && (gf_group->layer_depth[frame_idx] > num_arf_layers ||
-                            frame_idx >= gop_length))
+    if (skip_tpl_for_frame(gf_group, frame_idx, approx_gop_eval,
+                           num_arf_layers, gop_length))
       continue;
 
     init_mc_flow_dispenser(cpi, frame_idx, pframe_qindex);
@@ -1779,12 +2090,8 @@ int av1_tpl_setup_stats(AV1_COMP *cpi, int gop_eval,
 
   for (int frame_idx = tpl_gf_group_frames - 1;
        frame_idx >= cpi->gf_frame_index; --frame_idx) {
-    if (gf_group->update_type[frame_idx] == INTNL_OVERLAY_UPDATE ||
-        gf_group->update_type[frame_idx] == OVERLAY_UPDATE)
-      continue;
-
-    if (approx_gop_eval && (gf_group->layer_depth[frame_idx] > num_arf_layers ||
-                            frame_idx >= gop_length))
+    if (skip_tpl_for_frame(gf_group, frame_idx, approx_gop_eval,
+                           num_arf_layers, gop_length))
       continue;
 
     mc_flow_synthesizer(tpl_data, frame_idx, cm->mi_params.mi_rows,
@@ -54,6 +54,8 @@ typedef struct AV1TplRowMultiThreadSync {
   // Synchronization objects for top-right dependency.
   pthread_mutex_t *mutex_;
   pthread_cond_t *cond_;
+  // Mutex lock used while dispatching frames to the motion search workers.
+  pthread_mutex_t *frame_mutex_;
 #endif
   // Buffer to store the macroblock whose encoding is complete.
   // num_finished_cols[i] stores the number of macroblocks which finished
@@ -67,6 +69,11 @@ typedef struct AV1TplRowMultiThreadSync {
   int rows;
   // Number of threads processing the current tile.
   int num_threads_working;
+  // Frames whose single reference motion search is run in parallel, and the
+  // index of the next one in the list to be picked up by a worker.
+  const int *mv_search_frames;
+  int num_mv_search_frames;
+  int next_mv_search_frame;
 } AV1TplRowMultiThreadSync;
 
 typedef struct AV1TplRowMultiThreadInfo {
@@ -126,6 +133,7 @@ typedef struct TplDepStats {
 
 typedef struct TplDepFrame {
   uint8_t is_valid;
+  uint8_t mvs_searched;
   TplDepStats *tpl_stats_ptr;
   const YV12_BUFFER_CONFIG *gf_picture;
   YV12_BUFFER_CONFIG *rec_picture;
@@ -229,6 +237,39 @@ typedef struct TplParams {
 
 } TplParams;
 
+/*!\cond */
+// Sums of the tpl stats of a superblock used by the objective delta q modes.
+// They only depend on the tpl stats of the frame, so they are kept across the
+// recode iterations, which only change the base q index.
+typedef struct TplSbStats {
+  double intra_cost;
+  double mc_dep_cost;
+  double mc_dep_reg;
+  double cbcmp_base;
+  double srcrf_dist;
+  double srcrf_sse;
+  double srcrf_rate;
+  uint8_t valid;
+} TplSbStats;
+
+typedef struct TplSbCache {
+  // stats[i] stores the sums of the ith superblock in raster scan order.
+  TplSbStats *stats;
+  int alloc_size;
+  // Whether the cache is set up for the current frame. It is cleared before
+  // the tpl stats of each frame are processed.
+  int ready;
+  // The frame size the sums belong to. The cache is reset when any of these
+  // changes.
+  int superres_denom;
+  BLOCK_SIZE sb_size;
+  int mi_rows;
+  int mi_cols;
+  // Number of superblock columns.
+  int sb_cols;
+} TplSbCache;
+/*!\endcond */
+
 #if CONFIG_BITRATE_ACCURACY || CONFIG_RATECTRL_LOG
 #define VBR_RC_INFO_MAX_FRAMES 500
 #endif  //  CONFIG_BITRATE_ACCURACY || CONFIG_RATECTRL_LOG
@@ -427,6 +468,9 @@ void av1_mc_flow_dispenser_row(struct AV1_COMP *cpi,
                                TplTxfmStats *tpl_txfm_stats, MACROBLOCK *x,
                                int mi_row, BLOCK_SIZE bsize, TX_SIZE tx_size);
 
+void av1_tpl_search_frame_mvs(struct AV1_COMP *cpi, MACROBLOCK *x,
+                              int frame_idx);
+
 /*!\brief  Compute the entropy of an exponential probability distribution
  * function (pdf) subjected to uniform quantization.
  *
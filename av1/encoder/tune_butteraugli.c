@@ -17,12 +17,21 @@
 #include "av1/encoder/encodeframe.h"
 #include "av1/encoder/encoder_utils.h"
 #include "av1/encoder/extend.h"
+#include "av1/encoder/perceptual_map.h"
 #include "av1/encoder/var_based_part.h"
 #include "aom_ports/mem.h"
 #include "av1/encoder/rdopt.h"
 
 //static const int resize_factor = 2;
 
+static INLINE int get_butteraugli_resize_factor(const AV1_COMP *cpi) {
+  switch (cpi->oxcf.butteraugli_resize_factor) {
+    case 0: return 1;
+    case 2: return 4;
+    default: return 2;
+  }
+}
+
 static void set_mb_butteraugli_rdmult_scaling(AV1_COMP *cpi,
                                               const YV12_BUFFER_CONFIG *source,
                                               const YV12_BUFFER_CONFIG *recon,
@@ -419,55 +428,16 @@ void av1_set_butteraugli_rdmult(const AV1_COMP *cpi, MACROBLOCK *x,
                                 BLOCK_SIZE bsize, int mi_row, int mi_col,
                                 int *rdmult) {
   assert(cpi->oxcf.tune_cfg.tuning == AOM_TUNE_BUTTERAUGLI || cpi->oxcf.tune_cfg.tuning == AOM_TUNE_LAVISH || cpi->oxcf.tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL);
-  if (!cpi->butteraugli_info.recon_set) {
+  // The plane is only set up once the reconstruction has been measured.
+  const PerceptualMapPlane *const plane =
+      &cpi->perceptual_maps[PERCEPTUAL_MAP_BUTTERAUGLI];
+  if (!plane->valid) {
     return;
   }
-  const AV1_COMMON *const cm = &cpi->common;
-  const BLOCK_SIZE butteraugli_rdo_bsize = BLOCK_32X32;
 
-  const int num_mi_w = mi_size_wide[butteraugli_rdo_bsize];
-  const int num_mi_h = mi_size_high[butteraugli_rdo_bsize];
-  const int num_cols = (cm->mi_params.mi_cols + num_mi_w - 1) / num_mi_w;
-  const int num_rows = (cm->mi_params.mi_rows + num_mi_h - 1) / num_mi_h;
-  const int num_bcols = (mi_size_wide[bsize] + num_mi_w - 1) / num_mi_w;
-  const int num_brows = (mi_size_high[bsize] + num_mi_h - 1) / num_mi_h;
-  double num_of_mi = 0.0;
-  double geom_mean_of_scale = 0.0;
-  double quant_geom_mean_of_scale = 0.0;
-
-  for (int row = mi_row / num_mi_w;
-       row < num_rows && row < mi_row / num_mi_w + num_brows; ++row) {
-    for (int col = mi_col / num_mi_h;
-         col < num_cols && col < mi_col / num_mi_h + num_bcols; ++col) {
-      const int index = row * num_cols + col;
-      geom_mean_of_scale +=
-          log(cpi->butteraugli_info.rdmult_scaling_factors[index]);
-      quant_geom_mean_of_scale +=
-          log(cpi->butteraugli_info.quant_scaling_factors[index]);
-      num_of_mi += 1.0;
-    }
-  }
-  /*if (cpi->oxcf.butteraugli_quant_mult > 0 || cpi->oxcf.butteraugli_quant_mult_pos >= 0 || cpi->oxcf.butteraugli_quant_mult_neg >= 0) { // If butter quant is enabled in any form
-    double quant_multiplier = 1.0; // Setup multiplier variable
-    double generic_scale = exp(quant_geom_mean_of_scale / num_of_mi); // Get generic scale without multiplier for if/then usage, 0 = 1.0 scale
-    if ((cpi->oxcf.butteraugli_quant_mult_pos >= 0) && (generic_scale < 1.0)) { // If pos quant is enabled and qindex scale > 1
-      quant_multiplier = exp((quant_geom_mean_of_scale * cpi->oxcf.butteraugli_quant_mult_pos / 100.0) / num_of_mi);
-      //printf("quant_mult_pos: %f\n", quant_multiplier);
-    } else if ((cpi->oxcf.butteraugli_quant_mult_neg >= 0) && (generic_scale > 1.0)) { // If neg quant is enabled and qindex scale < 1
-      quant_multiplier = exp((quant_geom_mean_of_scale * cpi->oxcf.butteraugli_quant_mult_neg / 100.0) / num_of_mi);
-      //printf("quant_mult_neg: %f\n", quant_multiplier);
-    } else { // If scale = 1.0 or neg/pos quant isn't defined
-      quant_multiplier = exp((quant_geom_mean_of_scale * cpi->oxcf.butteraugli_quant_mult / 100.0) / num_of_mi);
-    }
-    //quant_multiplier = (1.0 - quant_multiplier) + (fast_tanhf((float)quant_multiplier - 1.0f) * 0.5) + 1.0; // Invert quant_multiplier across 1 (instead of 0), and smoothen the curve by a factor of 0.5 around 1.0
-    int new_qindex = av1_get_deltaq_offset(cm->seq_params->bit_depth, x->qindex, quant_multiplier);
-    //printf("new_qindex adjust: %d\n", new_qindex);
-    //printf("quant_multiplier: %f\n", quant_multiplier);
-    //printf("x->qindex: %d   multiplier: %f   adjustment: %d\n", x->qindex, quant_multiplier, new_qindex);
-    x->qindex = x->qindex + new_qindex; // Finally, update quantizer
-    new_qindex = AOMMIN(x->qindex, MAXQ); // Limit quantizer to video bounds
-    new_qindex = AOMMAX(x->qindex, MINQ);
-  }*/
+  int num_of_mi;
+  double geom_mean_of_scale =
+      av1_perceptual_map_log_sum(plane, bsize, mi_row, mi_col, &num_of_mi);
   geom_mean_of_scale = exp((geom_mean_of_scale * cpi->oxcf.butteraugli_rd_mult / 100.0) / num_of_mi);
   //printf("geom_mean_of_scale: %f\n", geom_mean_of_scale);
   *rdmult = (int)((double)(*rdmult) * geom_mean_of_scale + 0.5);
@@ -546,7 +516,9 @@ static void zero_img_highbd(YV12_BUFFER_CONFIG *dst) {
   zero_plane_highbd(CONVERT_TO_SHORTPTR(dst->v_buffer), dst->uv_stride, dst->uv_height);
 }
 
-void av1_setup_butteraugli_source(AV1_COMP *cpi) {
+// Saves a copy of the current source and a copy resized by the butteraugli
+// resize factor, leaving cpi->source untouched.
+static void setup_butteraugli_resized_source(AV1_COMP *cpi) {
   YV12_BUFFER_CONFIG *const dst = &cpi->butteraugli_info.source;
   AV1_COMMON *const cm = &cpi->common;
   const int width = cpi->source->y_crop_width;
@@ -554,13 +526,7 @@ void av1_setup_butteraugli_source(AV1_COMP *cpi) {
   const int bit_depth = cpi->td.mb.e_mbd.bd;
   const int ss_x = cpi->source->subsampling_x;
   const int ss_y = cpi->source->subsampling_y;
-  const int resize_factor = (cpi->oxcf.butteraugli_resize_factor == 0)
-                                ? 1
-                                : (cpi->oxcf.butteraugli_resize_factor == 1)
-                                      ? 2
-                                      : (cpi->oxcf.butteraugli_resize_factor == 2)
-                                        ? 4
-                                        : 2;
+  const int resize_factor = get_butteraugli_resize_factor(cpi);
   if (dst->buffer_alloc_sz == 0) {
     aom_alloc_frame_buffer(
         dst, width, height, ss_x, ss_y, cm->seq_params->use_highbitdepth,
@@ -577,6 +543,15 @@ void av1_setup_butteraugli_source(AV1_COMP *cpi) {
   }
   av1_resize_and_extend_frame_nonnormative(cpi->source, resized_dst, bit_depth,
                                            av1_num_planes(cm));
+}
+
+void av1_setup_butteraugli_source(AV1_COMP *cpi) {
+  AV1_COMMON *const cm = &cpi->common;
+  const int width = cpi->source->y_crop_width;
+  const int height = cpi->source->y_crop_height;
+  const int resize_factor = get_butteraugli_resize_factor(cpi);
+  YV12_BUFFER_CONFIG *const resized_dst = &cpi->butteraugli_info.resized_source;
+  setup_butteraugli_resized_source(cpi);
   if (cm->seq_params->use_highbitdepth) {
     zero_img_highbd(cpi->source);
     copy_img_highbd(resized_dst, cpi->source, width / resize_factor,
@@ -620,6 +595,96 @@ int av1_get_butteraugli_base_qindex(AV1_COMP *cpi, int current_qindex, int dista
   return qindex;
 }
 
+// Largest qindex step taken when extrapolating past all probes.
+#define BUTTERAUGLI_QSEARCH_MAX_STEP 64
+
+int av1_update_butteraugli_qsearch(AV1_COMP *cpi, ButteraugliQSearch *search,
+                                   int qindex, int current_qindex) {
+  const AV1_COMMON *const cm = &cpi->common;
+  const double target = cpi->oxcf.butteraugli_quant_mult / 10.0;
+  const double tolerance = cpi->oxcf.butteraugli_tolerance / 100.0;
+  const double distance = cpi->butteraugli_info.distance;
+
+  if (cm->current_frame.frame_number == 0 || cpi->oxcf.pass == 1) {
+    search->converged = 1;
+    return current_qindex;
+  }
+  if (search->num_probes < BUTTERAUGLI_MAX_QSEARCH_PROBES) {
+    search->qindex[search->num_probes] = qindex;
+    search->distance[search->num_probes] = (float)distance;
+    ++search->num_probes;
+  }
+  if (fabs(distance - target) <= tolerance) {
+    search->converged = 1;
+    return qindex;
+  }
+
+  // Distance grows with qindex: bracket the target between the highest
+  // qindex that meets it and the lowest one that does not.
+  int lo = -1, hi = -1;
+  for (int i = 0; i < search->num_probes; ++i) {
+    if (search->distance[i] <= target) {
+      if (lo < 0 || search->qindex[i] > search->qindex[lo]) lo = i;
+    } else {
+      if (hi < 0 || search->qindex[i] < search->qindex[hi]) hi = i;
+    }
+  }
+
+  int next_qindex;
+  if (lo >= 0 && hi >= 0) {
+    const int q_lo = search->qindex[lo];
+    const int q_hi = search->qindex[hi];
+    // Nothing left between the two, or the measurements are not monotonic:
+    // settle for the qindex known to meet the target.
+    if (q_hi - q_lo <= 1) {
+      search->converged = 1;
+      return q_lo;
+    }
+    // Secant step inside the bracket, which reduces to bisection when the
+    // step would land outside it.
+    const double d_lo = search->distance[lo];
+    const double d_hi = search->distance[hi];
+    next_qindex = (q_lo + q_hi) / 2;
+    if (d_hi > d_lo) {
+      next_qindex =
+          q_lo + (int)lrint((target - d_lo) * (q_hi - q_lo) / (d_hi - d_lo));
+    }
+    next_qindex = clamp(next_qindex, q_lo + 1, q_hi - 1);
+  } else if (search->num_probes >= 2 &&
+             search->qindex[search->num_probes - 1] !=
+                 search->qindex[search->num_probes - 2] &&
+             search->distance[search->num_probes - 1] !=
+                 search->distance[search->num_probes - 2]) {
+    // Target not bracketed yet: extrapolate from the last two probes.
+    const int q1 = search->qindex[search->num_probes - 2];
+    const int q2 = search->qindex[search->num_probes - 1];
+    const double d1 = search->distance[search->num_probes - 2];
+    const double d2 = search->distance[search->num_probes - 1];
+    const double slope = (d2 - d1) / (q2 - q1);
+    if (slope > 0) {
+      next_qindex = q2 + (int)lrint((target - d2) / slope);
+      next_qindex = clamp(next_qindex, q2 - BUTTERAUGLI_QSEARCH_MAX_STEP,
+                          q2 + BUTTERAUGLI_QSEARCH_MAX_STEP);
+    } else {
+      next_qindex = av1_get_butteraugli_base_qindex(
+          cpi, current_qindex, cpi->oxcf.butteraugli_quant_mult);
+    }
+  } else {
+    next_qindex = av1_get_butteraugli_base_qindex(
+        cpi, current_qindex, cpi->oxcf.butteraugli_quant_mult);
+  }
+  next_qindex = clamp(next_qindex, MINQ, MAXQ);
+
+  // A repeated qindex would only reproduce a known distance.
+  for (int i = 0; i < search->num_probes; ++i) {
+    if (search->qindex[i] == next_qindex) {
+      search->converged = 1;
+      break;
+    }
+  }
+  return next_qindex;
+}
+
 void av1_setup_butteraugli_rdmult_and_restore_source(AV1_COMP *cpi, double K) {
   av1_copy_and_extend_frame(&cpi->butteraugli_info.source, cpi->source);
   AV1_COMMON *const cm = &cpi->common;
@@ -627,13 +692,7 @@ void av1_setup_butteraugli_rdmult_and_restore_source(AV1_COMP *cpi, double K) {
   const int height = cpi->source->y_crop_height;
   const int ss_x = cpi->source->subsampling_x;
   const int ss_y = cpi->source->subsampling_y;
-  const int resize_factor = (cpi->oxcf.butteraugli_resize_factor == 0)
-                                ? 1
-                                : (cpi->oxcf.butteraugli_resize_factor == 1)
-                                      ? 2
-                                      : (cpi->oxcf.butteraugli_resize_factor == 2)
-                                        ? 4
-                                        : 2;
+  const int resize_factor = get_butteraugli_resize_factor(cpi);
 
   YV12_BUFFER_CONFIG resized_recon;
   memset(&resized_recon, 0, sizeof(resized_recon));
@@ -656,6 +715,70 @@ void av1_setup_butteraugli_rdmult_and_restore_source(AV1_COMP *cpi, double K) {
   aom_free_frame_buffer(&resized_recon);
 }
 
+static void copy_chroma_planes(const YV12_BUFFER_CONFIG *src,
+                               YV12_BUFFER_CONFIG *dst) {
+  const int bytes_per_pixel = (src->flags & YV12_FLAG_HIGHBITDEPTH) ? 2 : 1;
+  const int width_uv = src->uv_crop_width * bytes_per_pixel;
+  for (int plane = 1; plane < MAX_MB_PLANE; ++plane) {
+    const uint8_t *src_row = plane == 1 ? src->u_buffer : src->v_buffer;
+    uint8_t *dst_row = plane == 1 ? dst->u_buffer : dst->v_buffer;
+    if (bytes_per_pixel == 2) {
+      src_row = (const uint8_t *)CONVERT_TO_SHORTPTR(src_row);
+      dst_row = (uint8_t *)CONVERT_TO_SHORTPTR(dst_row);
+    }
+    for (int row = 0; row < src->uv_crop_height; ++row) {
+      memcpy(dst_row, src_row, width_uv);
+      src_row += src->uv_stride * bytes_per_pixel;
+      dst_row += dst->uv_stride * bytes_per_pixel;
+    }
+  }
+}
+
+int av1_setup_butteraugli_rdmult_from_tpl(AV1_COMP *cpi, double K) {
+  AV1_COMMON *const cm = &cpi->common;
+  const TplParams *const tpl_data = &cpi->ppi->tpl_data;
+  if (!av1_tpl_stats_ready(tpl_data, cpi->gf_frame_index)) return 0;
+
+  // The TPL reconstruction is built from TPL's own prediction + quantization
+  // pass at this frame's base qindex, so it already carries coding artifacts
+  // comparable to a real encode.
+  const YV12_BUFFER_CONFIG *const tpl_recon =
+      tpl_data->tpl_frame[cpi->gf_frame_index].rec_picture;
+  if (tpl_recon == NULL ||
+      tpl_recon->y_crop_width != cpi->source->y_crop_width ||
+      tpl_recon->y_crop_height != cpi->source->y_crop_height) {
+    return 0;
+  }
+
+  setup_butteraugli_resized_source(cpi);
+  const YV12_BUFFER_CONFIG *const resized_source =
+      &cpi->butteraugli_info.resized_source;
+
+  YV12_BUFFER_CONFIG resized_recon;
+  memset(&resized_recon, 0, sizeof(resized_recon));
+  if (aom_alloc_frame_buffer(
+          &resized_recon, resized_source->y_crop_width,
+          resized_source->y_crop_height, resized_source->subsampling_x,
+          resized_source->subsampling_y, cm->seq_params->use_highbitdepth,
+          cpi->oxcf.border_in_pixels, cm->features.byte_alignment, 0, 0)) {
+    aom_internal_error(cm->error, AOM_CODEC_MEM_ERROR,
+                       "Failed to allocate butteraugli proxy buffer");
+  }
+  av1_resize_and_extend_frame_nonnormative(tpl_recon, &resized_recon,
+                                           cpi->td.mb.e_mbd.bd,
+                                           av1_num_planes(cm));
+  // TPL leaves the chroma planes untouched when it only models luma, so
+  // take chroma from the source instead of reading stale pool contents.
+  if (cpi->sf.tpl_sf.use_y_only_rate_distortion) {
+    copy_chroma_planes(resized_source, &resized_recon);
+  }
+
+  set_mb_butteraugli_rdmult_scaling(cpi, resized_source, &resized_recon, K);
+  cpi->butteraugli_info.recon_set = true;
+  aom_free_frame_buffer(&resized_recon);
+  return 1;
+}
+
 void av1_setup_butteraugli_rdmult(AV1_COMP *cpi) {
   AV1_COMMON *const cm = &cpi->common;
   const AV1EncoderConfig *const oxcf = &cpi->oxcf;
@@ -677,6 +800,15 @@ void av1_setup_butteraugli_rdmult(AV1_COMP *cpi) {
         cpi->image_pyramid_levels);
   }
 
+  if (oxcf->butteraugli_proxy &&
+      av1_setup_butteraugli_rdmult_from_tpl(
+          cpi, (oxcf->tune_cfg.tuning == AOM_TUNE_LAVISH ||
+                oxcf->tune_cfg.tuning == AOM_TUNE_EXPERIMENTAL)
+                   ? 0.0
+                   : 0.3)) {
+    return;
+  }
+
   av1_setup_butteraugli_source(cpi);
   av1_setup_frame(cpi);
 
@@ -12,6 +12,7 @@
 #ifndef AOM_AV1_ENCODER_TUNE_BUTTERAUGLI_H_
 #define AOM_AV1_ENCODER_TUNE_BUTTERAUGLI_H_
 
+#include "aom_dsp/butteraugli.h"
 #include "aom_scale/yv12config.h"
 #include "av1/common/enums.h"
 #include "av1/encoder/ratectrl.h"
@@ -30,8 +31,24 @@ typedef struct {
   int original_qindex;
   float distance;
   double blk_count;
+  // Conversion buffers reused by aom_calc_butteraugli().
+  AomButteraugliBuffers buffers;
 } TuneButteraugliInfo;
 
+// Enough for the q=96 pass plus the maximum butteraugli-loop-count.
+#define BUTTERAUGLI_MAX_QSEARCH_PROBES 12
+
+// Qindex/distance pairs measured by the butteraugli quantization loop of
+// one frame, used to predict the qindex that meets the target distance.
+typedef struct {
+  int qindex[BUTTERAUGLI_MAX_QSEARCH_PROBES];
+  float distance[BUTTERAUGLI_MAX_QSEARCH_PROBES];
+  int num_probes;
+  // Set once the last probe was within tolerance of the target, or no probe
+  // can narrow the search further.
+  int converged;
+} ButteraugliQSearch;
+
 struct AV1_COMP;
 
 void av1_set_butteraugli_rdmult(const struct AV1_COMP *cpi, MACROBLOCK *x,
@@ -45,8 +62,22 @@ void av1_setup_butteraugli_source(struct AV1_COMP *cpi);
 void av1_setup_butteraugli_rdmult_and_restore_source(struct AV1_COMP *cpi,
                                                      double K);
 
+// Builds the butteraugli rdmult scaling map from the TPL reconstruction of
+// the current frame instead of a dedicated pre-encode. Returns 0 without
+// touching the scaling map when no usable TPL reconstruction exists.
+int av1_setup_butteraugli_rdmult_from_tpl(struct AV1_COMP *cpi, double K);
+
 int av1_get_butteraugli_base_qindex(struct AV1_COMP *cpi, int current_qindex, int strength);
 
 void av1_setup_butteraugli_rdmult(struct AV1_COMP *cpi);
 
+// Records the distance just measured by
+// av1_setup_butteraugli_rdmult_and_restore_source() for a frame encoded at
+// 'qindex' and returns the qindex to try next. 'current_qindex' is the base
+// the fixed formula of av1_get_butteraugli_base_qindex() starts from while
+// there are too few probes to interpolate.
+int av1_update_butteraugli_qsearch(struct AV1_COMP *cpi,
+                                   ButteraugliQSearch *search, int qindex,
+                                   int current_qindex);
+
 #endif  // AOM_AV1_ENCODER_TUNE_BUTTERAUGLI_H_
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include "av1/encoder/tune_ssimulacra2.h"
+
+#include "aom_dsp/ssimulacra2.h"
+#include "aom_mem/aom_mem.h"
+#include "aom_ports/mem.h"
+#include "av1/encoder/encoder.h"
+#include "av1/encoder/perceptual_map.h"
+#include "av1/encoder/rd.h"
+#include "av1/encoder/tpl_model.h"
+
+// Blocks whose MSE or SSIMULACRA2 distortion is below these keep a neutral
+// scaling factor.
+#define SSIMULACRA2_MIN_MSE 0.01
+#define SSIMULACRA2_MIN_DISTORTION 1e-6
+#define SSIMULACRA2_MIN_SCALE 0.25
+#define SSIMULACRA2_MAX_SCALE 4.0
+
+void av1_free_ssimulacra2_info(TuneSsimulacra2Info *info) {
+  aom_free(info->rdmult_scaling_factors);
+  aom_free(info->dist_map);
+  aom_free_ssimulacra2_buffers(&info->buffers);
+  info->rdmult_scaling_factors = NULL;
+  info->dist_map = NULL;
+  info->factors_alloc_size = 0;
+  info->dist_map_alloc_size = 0;
+  info->recon_set = false;
+}
+
+static INLINE int get_pixel(const uint8_t *buf, int stride, int x, int y,
+                            int highbd) {
+  return highbd ? CONVERT_TO_SHORTPTR(buf)[y * stride + x]
+                : buf[y * stride + x];
+}
+
+// Sum of squared differences over the pixels of one plane in
+// [x0, x1) x [y0, y1), at 8-bit scale.
+static double plane_sse(const uint8_t *src, int src_stride,
+                        const uint8_t *rec, int rec_stride, int x0, int x1,
+                        int y0, int y1, int highbd, int bit_depth) {
+  const double scale = 1.0 / (double)(1 << (bit_depth - 8));
+  double sse = 0.0;
+  for (int y = y0; y < y1; ++y) {
+    for (int x = x0; x < x1; ++x) {
+      const double diff = (get_pixel(src, src_stride, x, y, highbd) -
+                           get_pixel(rec, rec_stride, x, y, highbd)) *
+                          scale;
+      sse += diff * diff;
+    }
+  }
+  return sse;
+}
+
+// Blocks where the MSE is high relative to the SSIMULACRA2 distortion hide
+// their error well and get a larger rdmult; the factors are normalized to a
+// geometric mean of 1.
+static void set_mb_ssimulacra2_rdmult_scaling(AV1_COMP *cpi,
+                                              const YV12_BUFFER_CONFIG *source,
+                                              const YV12_BUFFER_CONFIG *recon) {
+  TuneSsimulacra2Info *const info = &cpi->ssimulacra2_info;
+  const int width = source->y_crop_width;
+  const int height = source->y_crop_height;
+  const int ss_x = source->subsampling_x;
+  const int ss_y = source->subsampling_y;
+  const int highbd = (source->flags & YV12_FLAG_HIGHBITDEPTH) != 0;
+  const int bit_depth = cpi->td.mb.e_mbd.bd;
+  const int has_chroma = !source->monochrome;
+  const int block_size = block_size_wide[SSIMULACRA2_RDO_BSIZE];
+  double log_sum = 0.0;
+  double blk_count = 0.0;
+
+  for (int row = 0; row < info->num_rows; ++row) {
+    for (int col = 0; col < info->num_cols; ++col) {
+      const int x0 = col * block_size;
+      const int y0 = row * block_size;
+      const int x1 = AOMMIN(x0 + block_size, width);
+      const int y1 = AOMMIN(y0 + block_size, height);
+      double *const weight =
+          &info->rdmult_scaling_factors[row * info->num_cols + col];
+      if (x0 >= x1 || y0 >= y1) {
+        *weight = -1.0;
+        continue;
+      }
+
+      double distortion = 0.0;
+      for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+          distortion += info->dist_map[y * width + x];
+        }
+      }
+      double sse = plane_sse(source->y_buffer, source->y_stride,
+                             recon->y_buffer, recon->y_stride, x0, x1, y0, y1,
+                             highbd, bit_depth);
+      double count = (double)(x1 - x0) * (y1 - y0);
+      distortion /= count;
+      if (has_chroma) {
+        const int uv_x0 = x0 >> ss_x;
+        const int uv_y0 = y0 >> ss_y;
+        const int uv_x1 = (x1 + ss_x) >> ss_x;
+        const int uv_y1 = (y1 + ss_y) >> ss_y;
+        sse += plane_sse(source->u_buffer, source->uv_stride, recon->u_buffer,
+                         recon->uv_stride, uv_x0, uv_x1, uv_y0, uv_y1, highbd,
+                         bit_depth);
+        sse += plane_sse(source->v_buffer, source->uv_stride, recon->v_buffer,
+                         recon->uv_stride, uv_x0, uv_x1, uv_y0, uv_y1, highbd,
+                         bit_depth);
+        count += 2.0 * (uv_x1 - uv_x0) * (uv_y1 - uv_y0);
+      }
+      const double mse = sse / count;
+
+      if (mse < SSIMULACRA2_MIN_MSE ||
+          distortion < SSIMULACRA2_MIN_DISTORTION) {
+        *weight = -1.0;
+      } else {
+        *weight = mse / distortion;
+        log_sum += log(*weight);
+        blk_count += 1.0;
+      }
+    }
+  }
+
+  const double geom_mean = blk_count > 0.0 ? exp(log_sum / blk_count) : 1.0;
+  const int num_blocks = info->num_rows * info->num_cols;
+  for (int i = 0; i < num_blocks; ++i) {
+    double *const weight = &info->rdmult_scaling_factors[i];
+    *weight = *weight <= 0.0 ? 1.0
+                             : fclamp(*weight / geom_mean, SSIMULACRA2_MIN_SCALE,
+                                      SSIMULACRA2_MAX_SCALE);
+  }
+}
+
+void av1_setup_ssimulacra2_rdmult(AV1_COMP *cpi,
+                                  const YV12_BUFFER_CONFIG *recon) {
+  AV1_COMMON *const cm = &cpi->common;
+  const SequenceHeader *const seq_params = cm->seq_params;
+  TuneSsimulacra2Info *const info = &cpi->ssimulacra2_info;
+  const YV12_BUFFER_CONFIG *const source = cpi->source;
+  info->recon_set = false;
+
+  const int num_mi_w = mi_size_wide[SSIMULACRA2_RDO_BSIZE];
+  const int num_mi_h = mi_size_high[SSIMULACRA2_RDO_BSIZE];
+  info->num_cols = (cm->mi_params.mi_cols + num_mi_w - 1) / num_mi_w;
+  info->num_rows = (cm->mi_params.mi_rows + num_mi_h - 1) / num_mi_h;
+  const int num_blocks = info->num_rows * info->num_cols;
+  if (num_blocks > info->factors_alloc_size) {
+    aom_free(info->rdmult_scaling_factors);
+    info->factors_alloc_size = 0;
+    CHECK_MEM_ERROR(cm, info->rdmult_scaling_factors,
+                    aom_malloc(num_blocks *
+                               sizeof(*info->rdmult_scaling_factors)));
+    info->factors_alloc_size = num_blocks;
+  }
+  const size_t map_size =
+      (size_t)source->y_crop_width * source->y_crop_height;
+  if (map_size > info->dist_map_alloc_size) {
+    aom_free(info->dist_map);
+    info->dist_map_alloc_size = 0;
+    CHECK_MEM_ERROR(cm, info->dist_map,
+                    aom_malloc(map_size * sizeof(*info->dist_map)));
+    info->dist_map_alloc_size = map_size;
+  }
+
+  const aom_color_range_t color_range =
+      seq_params->color_range != 0 ? AOM_CR_FULL_RANGE : AOM_CR_STUDIO_RANGE;
+  if (!aom_calc_ssimulacra2(source, recon, cpi->td.mb.e_mbd.bd,
+                            seq_params->matrix_coefficients, color_range,
+                            &info->buffers, &info->score, info->dist_map)) {
+    // Frames below 8x8 cannot be scored and keep the unscaled rdmult.
+    if (source->y_crop_width >= 8 && source->y_crop_height >= 8 &&
+        recon->y_crop_width == source->y_crop_width &&
+        recon->y_crop_height == source->y_crop_height) {
+      aom_internal_error(cm->error, AOM_CODEC_MEM_ERROR,
+                         "Failed to allocate SSIMULACRA2 buffers");
+    }
+    return;
+  }
+
+  set_mb_ssimulacra2_rdmult_scaling(cpi, source, recon);
+  info->recon_set = true;
+}
+
+int av1_setup_ssimulacra2_rdmult_from_tpl(AV1_COMP *cpi) {
+  const TplParams *const tpl_data = &cpi->ppi->tpl_data;
+  if (!av1_tpl_stats_ready(tpl_data, cpi->gf_frame_index)) return 0;
+  // TPL leaves the chroma planes untouched when it only models luma, and the
+  // metric is computed in RGB.
+  if (cpi->sf.tpl_sf.use_y_only_rate_distortion) return 0;
+
+  const YV12_BUFFER_CONFIG *const tpl_recon =
+      tpl_data->tpl_frame[cpi->gf_frame_index].rec_picture;
+  if (tpl_recon == NULL ||
+      tpl_recon->y_crop_width != cpi->source->y_crop_width ||
+      tpl_recon->y_crop_height != cpi->source->y_crop_height) {
+    return 0;
+  }
+
+  av1_setup_ssimulacra2_rdmult(cpi, tpl_recon);
+  return cpi->ssimulacra2_info.recon_set;
+}
+
+void av1_set_ssimulacra2_rdmult(const AV1_COMP *cpi, MACROBLOCK *x,
+                                BLOCK_SIZE bsize, int mi_row, int mi_col,
+                                int *rdmult) {
+  assert(cpi->oxcf.tune_cfg.tuning == AOM_TUNE_SSIMULACRA2);
+  // The plane is only set up once a reconstruction has been measured, and
+  // from factors of the current frame size. Until then the rdmult is kept.
+  const PerceptualMapPlane *const plane =
+      &cpi->perceptual_maps[PERCEPTUAL_MAP_SSIMULACRA2];
+  if (!plane->valid) return;
+
+  int num_of_mi;
+  const double log_sum =
+      av1_perceptual_map_log_sum(plane, bsize, mi_row, mi_col, &num_of_mi);
+  const double geom_mean_of_scale = exp(log_sum / num_of_mi);
+
+  *rdmult = (int)((double)(*rdmult) * geom_mean_of_scale + 0.5);
+  *rdmult = AOMMAX(*rdmult, 0);
+  av1_set_error_per_bit(&x->errorperbit, *rdmult);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#ifndef AOM_AV1_ENCODER_TUNE_SSIMULACRA2_H_
+#define AOM_AV1_ENCODER_TUNE_SSIMULACRA2_H_
+
+#include <stdbool.h>
+
+#include "aom_dsp/ssimulacra2.h"
+#include "aom_scale/yv12config.h"
+#include "av1/common/enums.h"
+#include "av1/encoder/block.h"
+
+// Block size of the rdmult scaling factors.
+#define SSIMULACRA2_RDO_BSIZE BLOCK_16X16
+
+typedef struct {
+  // Stores the scaling factors for rdmult when tuning for SSIMULACRA2.
+  // rdmult_scaling_factors[row * num_cols + col] stores the scaling factor of
+  // the 16x16 block at (row, col).
+  double *rdmult_scaling_factors;
+  int num_rows;
+  int num_cols;
+  int factors_alloc_size;
+  // Per pixel distortion map of the last measurement.
+  float *dist_map;
+  size_t dist_map_alloc_size;
+  bool recon_set;
+  // Score of the reconstruction the scaling factors were derived from.
+  double score;
+  // Float planes reused by aom_calc_ssimulacra2().
+  AomSsimulacra2Buffers buffers;
+} TuneSsimulacra2Info;
+
+struct AV1_COMP;
+
+void av1_set_ssimulacra2_rdmult(const struct AV1_COMP *cpi, MACROBLOCK *x,
+                                BLOCK_SIZE bsize, int mi_row, int mi_col,
+                                int *rdmult);
+
+// Measures 'recon' against the current source and derives the rdmult scaling
+// factors from the distortion map. recon_set stays false when the frame is
+// too small to be scored.
+void av1_setup_ssimulacra2_rdmult(struct AV1_COMP *cpi,
+                                  const YV12_BUFFER_CONFIG *recon);
+
+// As av1_setup_ssimulacra2_rdmult(), measuring the TPL reconstruction of the
+// current frame in place of a pre-encode. Returns 0 without touching the
+// scaling factors when no usable TPL reconstruction exists.
+int av1_setup_ssimulacra2_rdmult_from_tpl(struct AV1_COMP *cpi);
+
+void av1_free_ssimulacra2_info(TuneSsimulacra2Info *info);
+
+#endif  // AOM_AV1_ENCODER_TUNE_SSIMULACRA2_H_
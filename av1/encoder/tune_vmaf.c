@@ -12,9 +12,12 @@
 #include "av1/encoder/tune_vmaf.h"
 
 #include "aom_dsp/psnr.h"
+#include "aom_util/aom_thread.h"
 #include "av1/encoder/extend.h"
+#include "av1/encoder/perceptual_map.h"
 #include "av1/encoder/rdopt.h"
 #include "config/aom_scale_rtcd.h"
+#include "config/av1_rtcd.h"
 
 static const double kBaselineVmaf = 97.42773;
 
@@ -186,13 +189,10 @@ static double residual_frame_average_variance(AV1_COMP *cpi,
   return (double)variance / (double)(mb_rows * mb_cols);
 }
 
-// TODO(sdeng): Add the SIMD implementation.
-static AOM_INLINE void highbd_unsharp_rect(const uint16_t *source,
-                                           int source_stride,
-                                           const uint16_t *blurred,
-                                           int blurred_stride, uint16_t *dst,
-                                           int dst_stride, int w, int h,
-                                           double amount, int bit_depth) {
+void av1_highbd_unsharp_rect_c(const uint16_t *source, int source_stride,
+                               const uint16_t *blurred, int blurred_stride,
+                               uint16_t *dst, int dst_stride, int w, int h,
+                               double amount, int bit_depth) {
   const int max_value = (1 << bit_depth) - 1;
   for (int i = 0; i < h; ++i) {
     for (int j = 0; j < w; ++j) {
@@ -206,10 +206,10 @@ static AOM_INLINE void highbd_unsharp_rect(const uint16_t *source,
   }
 }
 
-static AOM_INLINE void unsharp_rect(const uint8_t *source, int source_stride,
-                                    const uint8_t *blurred, int blurred_stride,
-                                    uint8_t *dst, int dst_stride, int w, int h,
-                                    double amount) {
+void av1_unsharp_rect_c(const uint8_t *source, int source_stride,
+                        const uint8_t *blurred, int blurred_stride,
+                        uint8_t *dst, int dst_stride, int w, int h,
+                        double amount) {
   for (int i = 0; i < h; ++i) {
     for (int j = 0; j < w; ++j) {
       const double val =
@@ -231,15 +231,15 @@ static AOM_INLINE void unsharp(const AV1_COMP *const cpi,
     assert(source->flags & YV12_FLAG_HIGHBITDEPTH);
     assert(blurred->flags & YV12_FLAG_HIGHBITDEPTH);
     assert(dst->flags & YV12_FLAG_HIGHBITDEPTH);
-    highbd_unsharp_rect(CONVERT_TO_SHORTPTR(source->y_buffer), source->y_stride,
-                        CONVERT_TO_SHORTPTR(blurred->y_buffer),
-                        blurred->y_stride, CONVERT_TO_SHORTPTR(dst->y_buffer),
-                        dst->y_stride, source->y_width, source->y_height,
-                        amount, bit_depth);
+    av1_highbd_unsharp_rect(
+        CONVERT_TO_SHORTPTR(source->y_buffer), source->y_stride,
+        CONVERT_TO_SHORTPTR(blurred->y_buffer), blurred->y_stride,
+        CONVERT_TO_SHORTPTR(dst->y_buffer), dst->y_stride, source->y_width,
+        source->y_height, amount, bit_depth);
   } else {
-    unsharp_rect(source->y_buffer, source->y_stride, blurred->y_buffer,
-                 blurred->y_stride, dst->y_buffer, dst->y_stride,
-                 source->y_width, source->y_height, amount);
+    av1_unsharp_rect(source->y_buffer, source->y_stride, blurred->y_buffer,
+                     blurred->y_stride, dst->y_buffer, dst->y_stride,
+                     source->y_width, source->y_height, amount);
   }
 }
 
@@ -302,28 +302,93 @@ static AOM_INLINE double cal_approx_vmaf(const AV1_COMP *const cpi,
   return source_variance / sharpened_var * (new_vmaf - kBaselineVmaf);
 }
 
-static double find_best_frame_unsharp_amount_loop(
-    const AV1_COMP *const cpi, YV12_BUFFER_CONFIG *const source,
-    YV12_BUFFER_CONFIG *const blurred, YV12_BUFFER_CONFIG *const sharpened,
-    double best_vmaf, const double baseline_variance,
-    const double unsharp_amount_start, const double step_size,
-    const int max_loop_count, const double max_amount) {
+typedef double (*UnsharpScoreFunc)(void *ctx, double unsharp_amount);
+
+#define GOLDEN_RATIO 1.6180339887
+#define GOLDEN_SECTION 0.3819660113
+
+// Finds the unsharp amount in [0, max_amount] that maximizes 'score', given
+// two scored starting points. The search steps away from the better point in
+// its direction with growing steps until the score drops, then narrows the
+// resulting bracket with a golden-section search down to 'step_size'.
+// 'max_evals' bounds the number of additional score evaluations.
+static double search_unsharp_amount(UnsharpScoreFunc score, void *ctx,
+                                    double x0, double f0, double x1, double f1,
+                                    const double step_size, const int max_evals,
+                                    const double max_amount) {
   const double min_amount = 0.0;
-  int loop_count = 0;
-  double approx_vmaf = best_vmaf;
-  double unsharp_amount = unsharp_amount_start;
-  do {
-    best_vmaf = approx_vmaf;
-    unsharp_amount += step_size;
-    if (unsharp_amount > max_amount || unsharp_amount < min_amount) break;
-    unsharp(cpi, source, blurred, sharpened, unsharp_amount);
-    approx_vmaf = cal_approx_vmaf(cpi, baseline_variance, source, sharpened);
-
-    loop_count++;
-  } while (approx_vmaf > best_vmaf && loop_count < max_loop_count);
-  unsharp_amount =
-      approx_vmaf > best_vmaf ? unsharp_amount : unsharp_amount - step_size;
-  return AOMMIN(max_amount, AOMMAX(unsharp_amount, min_amount));
+  int evals = 0;
+  if (f0 > f1) {
+    double t = x0;
+    x0 = x1;
+    x1 = t;
+    t = f0;
+    f0 = f1;
+    f1 = t;
+  }
+
+  // Expand until the maximum is bracketed by [x0, x2].
+  const double dir = x1 >= x0 ? 1.0 : -1.0;
+  double step = AOMMAX(fabs(x1 - x0), step_size);
+  double x2;
+  for (;;) {
+    if (evals >= max_evals) return x1;
+    x2 = fclamp(x1 + dir * step * GOLDEN_RATIO, min_amount, max_amount);
+    if (fabs(x2 - x1) < 1e-9) return x1;
+    const double f2 = score(ctx, x2);
+    ++evals;
+    if (f2 <= f1) break;
+    const int at_limit = x2 <= min_amount || x2 >= max_amount;
+    x0 = x1;
+    f0 = f1;
+    x1 = x2;
+    f1 = f2;
+    // The best point is on the limit: the maximum lies in [x0, x1].
+    if (at_limit) break;
+    step *= GOLDEN_RATIO;
+  }
+
+  // Golden-section refinement around the best point x1.
+  double lo = AOMMIN(x0, x2);
+  double hi = AOMMAX(x0, x2);
+  while (hi - lo > 2 * step_size && evals < max_evals) {
+    const double x = (hi - x1 > x1 - lo) ? x1 + GOLDEN_SECTION * (hi - x1)
+                                         : x1 - GOLDEN_SECTION * (x1 - lo);
+    const double fx = score(ctx, x);
+    ++evals;
+    if (fx > f1) {
+      if (x > x1)
+        lo = x1;
+      else
+        hi = x1;
+      x1 = x;
+      f1 = fx;
+    } else {
+      if (x > x1)
+        hi = x;
+      else
+        lo = x;
+    }
+  }
+  return fclamp(x1, min_amount, max_amount);
+}
+
+typedef struct {
+  const AV1_COMP *cpi;
+  YV12_BUFFER_CONFIG *source;
+  YV12_BUFFER_CONFIG *blurred;
+  YV12_BUFFER_CONFIG *sharpened;
+  double baseline_variance;
+} FrameUnsharpSearch;
+
+// The blurred frame is computed once by the caller and reused by every
+// evaluation.
+static double frame_unsharp_score(void *ctx, double unsharp_amount) {
+  FrameUnsharpSearch *const search = (FrameUnsharpSearch *)ctx;
+  unsharp(search->cpi, search->source, search->blurred, search->sharpened,
+          unsharp_amount);
+  return cal_approx_vmaf(search->cpi, search->baseline_variance,
+                         search->source, search->sharpened);
 }
 
 static double find_best_frame_unsharp_amount(const AV1_COMP *const cpi,
@@ -343,29 +408,27 @@ static double find_best_frame_unsharp_amount(const AV1_COMP *const cpi,
       cm->seq_params->use_highbitdepth, cpi->oxcf.border_in_pixels,
       cm->features.byte_alignment, 0, 0);
 
-  const double baseline_variance = frame_average_variance(cpi, source);
+  FrameUnsharpSearch search = { cpi, source, blurred, &sharpened,
+                                frame_average_variance(cpi, source) };
   double unsharp_amount;
   if (unsharp_amount_start <= step_size) {
-    unsharp_amount = find_best_frame_unsharp_amount_loop(
-        cpi, source, blurred, &sharpened, 0.0, baseline_variance, 0.0,
-        step_size, max_loop_count, max_filter_amount);
+    // No sharpening scores 0 by definition.
+    const double a1 = AOMMIN(step_size, max_filter_amount);
+    unsharp_amount = search_unsharp_amount(
+        frame_unsharp_score, &search, 0.0, 0.0, a1,
+        frame_unsharp_score(&search, a1), step_size, max_loop_count - 1,
+        max_filter_amount);
   } else {
-    double a0 = unsharp_amount_start - step_size, a1 = unsharp_amount_start;
-    double v0, v1;
-    unsharp(cpi, source, blurred, &sharpened, a0);
-    v0 = cal_approx_vmaf(cpi, baseline_variance, source, &sharpened);
-    unsharp(cpi, source, blurred, &sharpened, a1);
-    v1 = cal_approx_vmaf(cpi, baseline_variance, source, &sharpened);
+    const double a0 = unsharp_amount_start - step_size;
+    const double a1 = unsharp_amount_start;
+    const double v0 = frame_unsharp_score(&search, a0);
+    const double v1 = frame_unsharp_score(&search, a1);
     if (fabs(v0 - v1) < 0.01) {
       unsharp_amount = a0;
-    } else if (v0 > v1) {
-      unsharp_amount = find_best_frame_unsharp_amount_loop(
-          cpi, source, blurred, &sharpened, v0, baseline_variance, a0,
-          -step_size, max_loop_count, max_filter_amount);
     } else {
-      unsharp_amount = find_best_frame_unsharp_amount_loop(
-          cpi, source, blurred, &sharpened, v1, baseline_variance, a1,
-          step_size, max_loop_count, max_filter_amount);
+      unsharp_amount =
+          search_unsharp_amount(frame_unsharp_score, &search, a0, v0, a1, v1,
+                                step_size, max_loop_count, max_filter_amount);
     }
   }
 
@@ -373,6 +436,52 @@ static double find_best_frame_unsharp_amount(const AV1_COMP *const cpi,
   return unsharp_amount;
 }
 
+// Same as find_best_frame_unsharp_amount(), but scores the candidates on a
+// copy of 'source' downscaled by the vmaf-probe-resize-factor. The blurred
+// frame is recomputed at the probe resolution.
+static double find_best_frame_unsharp_amount_probe(
+    const AV1_COMP *const cpi, YV12_BUFFER_CONFIG *const source,
+    YV12_BUFFER_CONFIG *const blurred, const double unsharp_amount_start,
+    const double step_size, const int max_loop_count,
+    const double max_filter_amount) {
+  const AV1_COMMON *const cm = &cpi->common;
+  const int bit_depth = cpi->td.mb.e_mbd.bd;
+  const int resize_factor = 1 << cpi->oxcf.vmaf_probe_resize_factor;
+  const int probe_width = source->y_crop_width / resize_factor;
+  const int probe_height = source->y_crop_height / resize_factor;
+  // Too small to leave a useful number of blocks for the variance model.
+  if (resize_factor == 1 || probe_width < 64 || probe_height < 64) {
+    return find_best_frame_unsharp_amount(cpi, source, blurred,
+                                          unsharp_amount_start, step_size,
+                                          max_loop_count, max_filter_amount);
+  }
+
+  YV12_BUFFER_CONFIG probe_source, probe_blurred;
+  memset(&probe_source, 0, sizeof(probe_source));
+  memset(&probe_blurred, 0, sizeof(probe_blurred));
+  aom_alloc_frame_buffer(&probe_source, probe_width, probe_height,
+                         source->subsampling_x, source->subsampling_y,
+                         cm->seq_params->use_highbitdepth,
+                         cpi->oxcf.border_in_pixels,
+                         cm->features.byte_alignment, 0, 0);
+  aom_alloc_frame_buffer(&probe_blurred, probe_width, probe_height,
+                         source->subsampling_x, source->subsampling_y,
+                         cm->seq_params->use_highbitdepth,
+                         cpi->oxcf.border_in_pixels,
+                         cm->features.byte_alignment, 0, 0);
+  av1_resize_and_extend_frame_nonnormative(source, &probe_source, bit_depth,
+                                           1);
+  gaussian_blur(bit_depth, &probe_source, &probe_blurred);
+
+  const double unsharp_amount = find_best_frame_unsharp_amount(
+      cpi, &probe_source, &probe_blurred, unsharp_amount_start, step_size,
+      max_loop_count, max_filter_amount);
+
+  aom_free_frame_buffer(&probe_source);
+  aom_free_frame_buffer(&probe_blurred);
+  return unsharp_amount;
+}
+
 void av1_vmaf_neg_preprocessing(AV1_COMP *const cpi,
                                 YV12_BUFFER_CONFIG *const source) {
   const AV1_COMMON *const cm = &cpi->common;
@@ -429,8 +538,10 @@ void av1_vmaf_frame_preprocessing(AV1_COMP *const cpi,
   const double last_frame_unsharp_amount =
       get_layer_value(cpi->vmaf_info.last_frame_unsharp_amount, layer_depth);
 
-  const double best_frame_unsharp_amount = find_best_frame_unsharp_amount(
-      cpi, source, &blurred, last_frame_unsharp_amount, 0.05, 20, 1.01);
+  const double best_frame_unsharp_amount =
+      find_best_frame_unsharp_amount_probe(cpi, source, &blurred,
+                                           last_frame_unsharp_amount, 0.05,
+                                           20, 1.01);
 
   cpi->vmaf_info.last_frame_unsharp_amount[layer_depth] =
       best_frame_unsharp_amount;
@@ -469,8 +580,10 @@ void av1_vmaf_blk_preprocessing(AV1_COMP *const cpi,
   const double last_frame_unsharp_amount =
       get_layer_value(cpi->vmaf_info.last_frame_unsharp_amount, layer_depth);
 
-  const double best_frame_unsharp_amount = find_best_frame_unsharp_amount(
-      cpi, source, &blurred, last_frame_unsharp_amount, 0.05, 20, 1.01);
+  const double best_frame_unsharp_amount =
+      find_best_frame_unsharp_amount_probe(cpi, source, &blurred,
+                                           last_frame_unsharp_amount, 0.05,
+                                           20, 1.01);
 
   cpi->vmaf_info.last_frame_unsharp_amount[layer_depth] =
       best_frame_unsharp_amount;
@@ -583,18 +696,19 @@ void av1_vmaf_blk_preprocessing(AV1_COMP *const cpi,
                             row_offset_y * source->y_stride + col_offset_y;
         uint16_t *blurred_buf = CONVERT_TO_SHORTPTR(blurred.y_buffer) +
                                 row_offset_y * blurred.y_stride + col_offset_y;
-        highbd_unsharp_rect(src_buf, source->y_stride, blurred_buf,
-                            blurred.y_stride, src_buf, source->y_stride,
-                            block_width, block_height,
-                            best_unsharp_amounts[index], bit_depth);
+        av1_highbd_unsharp_rect(src_buf, source->y_stride, blurred_buf,
+                                blurred.y_stride, src_buf, source->y_stride,
+                                block_width, block_height,
+                                best_unsharp_amounts[index], bit_depth);
       } else {
         uint8_t *src_buf =
             source->y_buffer + row_offset_y * source->y_stride + col_offset_y;
         uint8_t *blurred_buf =
             blurred.y_buffer + row_offset_y * blurred.y_stride + col_offset_y;
-        unsharp_rect(src_buf, source->y_stride, blurred_buf, blurred.y_stride,
-                     src_buf, source->y_stride, block_width, block_height,
-                     best_unsharp_amounts[index]);
+        av1_unsharp_rect(src_buf, source->y_stride, blurred_buf,
+                         blurred.y_stride, src_buf, source->y_stride,
+                         block_width, block_height,
+                         best_unsharp_amounts[index]);
       }
     }
   }
@@ -605,6 +719,115 @@ void av1_vmaf_blk_preprocessing(AV1_COMP *const cpi,
   aom_free(best_unsharp_amounts);
 }
 
+// Blocks prepared per worker before the pictures are handed to libvmaf.
+#define VMAF_BLOCKS_PER_WORKER 4
+
+typedef struct {
+  const AV1_COMP *cpi;
+  const YV12_BUFFER_CONFIG *source;
+  const YV12_BUFFER_CONFIG *blurred;
+  VmafPicture *refs;
+  VmafPicture *dists;
+  unsigned int *sses;
+  int num_cols;
+  int block_w;
+  int block_h;
+  int bit_depth;
+  int batch_start;
+  int batch_end;
+} VmafBlockBatch;
+
+typedef struct {
+  const VmafBlockBatch *batch;
+  int first_block;
+  int block_step;
+} VmafBlockWorkerData;
+
+// Builds the reference picture and a distorted picture in which only block
+// 'index' is replaced by its blurred version, and the SSE of that block.
+static void prepare_vmaf_block(const VmafBlockBatch *batch, int index) {
+  const AV1_COMP *const cpi = batch->cpi;
+  const YV12_BUFFER_CONFIG *const source = batch->source;
+  const YV12_BUFFER_CONFIG *const blurred = batch->blurred;
+  const int row_offset_y = (index / batch->num_cols) * batch->block_h;
+  const int col_offset_y = (index % batch->num_cols) * batch->block_w;
+  const BLOCK_SIZE block_size = cpi->oxcf.vmaf_rdo_bsize;
+
+  const uint8_t *const orig_buf =
+      source->y_buffer + row_offset_y * source->y_stride + col_offset_y;
+  const uint8_t *const blurred_buf =
+      blurred->y_buffer + row_offset_y * blurred->y_stride + col_offset_y;
+  cpi->ppi->fn_ptr[block_size].vf(orig_buf, source->y_stride, blurred_buf,
+                                  blurred->y_stride, &batch->sses[index]);
+
+  VmafPicture *const ref = &batch->refs[index - batch->batch_start];
+  VmafPicture *const dist = &batch->dists[index - batch->batch_start];
+  aom_alloc_vmaf_picture(ref, source, batch->bit_depth);
+  aom_alloc_vmaf_picture(dist, source, batch->bit_depth);
+
+  // Only the part of the block inside the picture is scored.
+  const int w = AOMMIN(batch->block_w, source->y_width - col_offset_y);
+  const int h = AOMMIN(batch->block_h, source->y_height - row_offset_y);
+  if (cpi->common.seq_params->use_highbitdepth) {
+    const uint16_t *src = CONVERT_TO_SHORTPTR(blurred_buf);
+    uint16_t *dst = (uint16_t *)dist->data[0] +
+                    row_offset_y * (dist->stride[0] / 2) + col_offset_y;
+    for (int i = 0; i < h; ++i) {
+      memcpy(dst, src, w * sizeof(*dst));
+      src += blurred->y_stride;
+      dst += dist->stride[0] / 2;
+    }
+  } else {
+    const uint8_t *src = blurred_buf;
+    uint8_t *dst =
+        (uint8_t *)dist->data[0] + row_offset_y * dist->stride[0] + col_offset_y;
+    for (int i = 0; i < h; ++i) {
+      memcpy(dst, src, w * sizeof(*dst));
+      src += blurred->y_stride;
+      dst += dist->stride[0];
+    }
+  }
+}
+
+static int prepare_vmaf_blocks_hook(void *arg1, void *arg2) {
+  (void)arg2;
+  const VmafBlockWorkerData *const data = (const VmafBlockWorkerData *)arg1;
+  const VmafBlockBatch *const batch = data->batch;
+  for (int index = batch->batch_start + data->first_block;
+       index < batch->batch_end; index += data->block_step) {
+    prepare_vmaf_block(batch, index);
+  }
+  return 1;
+}
+
+static void prepare_vmaf_blocks_mt(AV1_COMP *cpi, const VmafBlockBatch *batch,
+                                   VmafBlockWorkerData *worker_data,
+                                   int num_workers) {
+  for (int i = 0; i < num_workers; ++i) {
+    worker_data[i].batch = batch;
+    worker_data[i].first_block = i;
+    worker_data[i].block_step = num_workers;
+  }
+  if (num_workers <= 1) {
+    prepare_vmaf_blocks_hook(&worker_data[0], NULL);
+    return;
+  }
+  const AVxWorkerInterface *const winterface = aom_get_worker_interface();
+  for (int i = num_workers - 1; i >= 0; i--) {
+    AVxWorker *const worker = &cpi->mt_info.workers[i];
+    worker->hook = prepare_vmaf_blocks_hook;
+    worker->data1 = &worker_data[i];
+    worker->data2 = NULL;
+    if (i == 0)
+      winterface->execute(worker);
+    else
+      winterface->launch(worker);
+  }
+  for (int i = num_workers - 1; i > 0; i--) {
+    winterface->sync(&cpi->mt_info.workers[i]);
+  }
+}
+
 void av1_set_mb_vmaf_rdmult_scaling(AV1_COMP *cpi) {
   AV1_COMMON *cm = &cpi->common;
   const int y_width = cpi->source->y_width;
@@ -640,6 +863,7 @@ void av1_set_mb_vmaf_rdmult_scaling(AV1_COMP *cpi) {
       (resized_y_width + resized_block_w - 1) / resized_block_w;
   const int num_rows =
       (resized_y_height + resized_block_h - 1) / resized_block_h;
+  const int num_blocks = num_rows * num_cols;
 
   YV12_BUFFER_CONFIG blurred;
   memset(&blurred, 0, sizeof(blurred));
@@ -649,70 +873,50 @@ void av1_set_mb_vmaf_rdmult_scaling(AV1_COMP *cpi) {
                          cm->features.byte_alignment, 0, 0);
   gaussian_blur(bit_depth, &resized_source, &blurred);
 
-  YV12_BUFFER_CONFIG recon;
-  memset(&recon, 0, sizeof(recon));
-  aom_alloc_frame_buffer(&recon, resized_y_width, resized_y_height, ss_x, ss_y,
-                         cm->seq_params->use_highbitdepth,
-                         cpi->oxcf.border_in_pixels,
-                         cm->features.byte_alignment, 0, 0);
-  aom_yv12_copy_frame(&resized_source, &recon, 1);
+  const int num_workers =
+      AOMMAX(1, AOMMIN(cpi->mt_info.num_workers, MAX_NUM_THREADS));
+  const int max_batch =
+      AOMMIN(num_workers * VMAF_BLOCKS_PER_WORKER, num_blocks);
 
   VmafContext *vmaf_context;
   const bool cal_vmaf_neg =
       ((cpi->oxcf.tune_cfg.tuning == AOM_TUNE_VMAF_NEG_MAX_GAIN) && cpi->oxcf.override_preprocessing == 0) || cpi->oxcf.vmaf_preprocessing == 1;
-  aom_init_vmaf_context(&vmaf_context, cpi->vmaf_info.vmaf_model, cal_vmaf_neg);
-  unsigned int *sses = aom_calloc(num_rows * num_cols, sizeof(*sses));
-  if (!sses) {
+  aom_init_vmaf_context(&vmaf_context, cpi->vmaf_info.vmaf_model, cal_vmaf_neg,
+                        AOMMAX(num_workers, AOM_VMAF_DEFAULT_THREADS));
+  unsigned int *sses = aom_calloc(num_blocks, sizeof(*sses));
+  VmafPicture *refs = aom_calloc(max_batch, sizeof(*refs));
+  VmafPicture *dists = aom_calloc(max_batch, sizeof(*dists));
+  if (!sses || !refs || !dists) {
+    aom_free(sses);
+    aom_free(refs);
+    aom_free(dists);
     aom_internal_error(cm->error, AOM_CODEC_MEM_ERROR,
                        "Error allocating vmaf data");
   }
 
-  // Loop through each 'block_size' block.
-  for (int row = 0; row < num_rows; ++row) {
-    for (int col = 0; col < num_cols; ++col) {
-      const int index = row * num_cols + col;
-      const int row_offset_y = row * resized_block_h;
-      const int col_offset_y = col * resized_block_w;
-
-      uint8_t *const orig_buf = resized_source.y_buffer +
-                                row_offset_y * resized_source.y_stride +
-                                col_offset_y;
-      uint8_t *const blurred_buf =
-          blurred.y_buffer + row_offset_y * blurred.y_stride + col_offset_y;
-
-      cpi->ppi->fn_ptr[resized_block_size].vf(orig_buf, resized_source.y_stride,
-                                              blurred_buf, blurred.y_stride,
-                                              &sses[index]);
-
-      uint8_t *const recon_buf =
-          recon.y_buffer + row_offset_y * recon.y_stride + col_offset_y;
-      // Set recon buf
-      if (cpi->common.seq_params->use_highbitdepth) {
-        highbd_unsharp_rect(CONVERT_TO_SHORTPTR(blurred_buf), blurred.y_stride,
-                            CONVERT_TO_SHORTPTR(blurred_buf), blurred.y_stride,
-                            CONVERT_TO_SHORTPTR(recon_buf), recon.y_stride,
-                            resized_block_w, resized_block_h, 0.0, bit_depth);
-      } else {
-        unsharp_rect(blurred_buf, blurred.y_stride, blurred_buf,
-                     blurred.y_stride, recon_buf, recon.y_stride,
-                     resized_block_w, resized_block_h, 0.0);
-      }
-
-      aom_read_vmaf_image(vmaf_context, &resized_source, &recon, bit_depth,
-                          index);
-
-      // Restore recon buf
-      if (cpi->common.seq_params->use_highbitdepth) {
-        highbd_unsharp_rect(
-            CONVERT_TO_SHORTPTR(orig_buf), resized_source.y_stride,
-            CONVERT_TO_SHORTPTR(orig_buf), resized_source.y_stride,
-            CONVERT_TO_SHORTPTR(recon_buf), recon.y_stride, resized_block_w,
-            resized_block_h, 0.0, bit_depth);
-      } else {
-        unsharp_rect(orig_buf, resized_source.y_stride, orig_buf,
-                     resized_source.y_stride, recon_buf, recon.y_stride,
-                     resized_block_w, resized_block_h, 0.0);
-      }
+  // Each block is scored as its own picture: the source with only that block
+  // blurred. The workers build a batch of pictures while libvmaf's threads
+  // score the previous one.
+  VmafBlockBatch batch;
+  batch.cpi = cpi;
+  batch.source = &resized_source;
+  batch.blurred = &blurred;
+  batch.refs = refs;
+  batch.dists = dists;
+  batch.sses = sses;
+  batch.num_cols = num_cols;
+  batch.block_w = resized_block_w;
+  batch.block_h = resized_block_h;
+  batch.bit_depth = bit_depth;
+  VmafBlockWorkerData worker_data[MAX_NUM_THREADS];
+  for (int start = 0; start < num_blocks; start += max_batch) {
+    batch.batch_start = start;
+    batch.batch_end = AOMMIN(start + max_batch, num_blocks);
+    prepare_vmaf_blocks_mt(cpi, &batch, worker_data,
+                           AOMMIN(num_workers, batch.batch_end - start));
+    for (int index = start; index < batch.batch_end; ++index) {
+      aom_read_vmaf_pictures(vmaf_context, &refs[index - start],
+                             &dists[index - start], index);
     }
   }
   aom_flush_vmaf_context(vmaf_context);
@@ -743,34 +947,23 @@ void av1_set_mb_vmaf_rdmult_scaling(AV1_COMP *cpi) {
   aom_free_frame_buffer(&blurred);
   aom_close_vmaf_context(vmaf_context);
   aom_free(sses);
+  aom_free(refs);
+  aom_free(dists);
 }
 
 void av1_set_vmaf_rdmult(const AV1_COMP *const cpi, MACROBLOCK *const x,
                          const BLOCK_SIZE bsize, const int mi_row,
                          const int mi_col, int *const rdmult) {
-  const AV1_COMMON *const cm = &cpi->common;
-
-  const int bsize_base = BLOCK_64X64;
-  const int num_mi_w = mi_size_wide[bsize_base];
-  const int num_mi_h = mi_size_high[bsize_base];
-  const int num_cols = (cm->mi_params.mi_cols + num_mi_w - 1) / num_mi_w;
-  const int num_rows = (cm->mi_params.mi_rows + num_mi_h - 1) / num_mi_h;
-  const int num_bcols = (mi_size_wide[bsize] + num_mi_w - 1) / num_mi_w;
-  const int num_brows = (mi_size_high[bsize] + num_mi_h - 1) / num_mi_h;
-  int row, col;
-  double num_of_mi = 0.0;
-  double geom_mean_of_scale = 0.0;
+  const PerceptualMapPlane *const plane =
+      &cpi->perceptual_maps[PERCEPTUAL_MAP_VMAF];
+  // The VMAF map is set up for every frame of the VMAF rdmult tunes.
+  assert(plane->valid);
 
-  for (row = mi_row / num_mi_w;
-       row < num_rows && row < mi_row / num_mi_w + num_brows; ++row) {
-    for (col = mi_col / num_mi_h;
-         col < num_cols && col < mi_col / num_mi_h + num_bcols; ++col) {
-      const int index = row * num_cols + col;
-      geom_mean_of_scale += log(cpi->vmaf_info.rdmult_scaling_factors[index]);
-      num_of_mi += 1.0;
-    }
-  }
-  geom_mean_of_scale = exp((geom_mean_of_scale * cpi->oxcf.vmaf_rd_mult / 100.0) / num_of_mi);
+  int num_of_mi;
+  const double log_sum =
+      av1_perceptual_map_log_sum(plane, bsize, mi_row, mi_col, &num_of_mi);
+  const double geom_mean_of_scale =
+      exp((log_sum * cpi->oxcf.vmaf_rd_mult / 100.0) / num_of_mi);
 
   *rdmult = (int)((double)(*rdmult) * geom_mean_of_scale + 0.5);
   *rdmult = AOMMAX(*rdmult, 0);
@@ -967,37 +1160,32 @@ static AOM_INLINE double cal_approx_score(
   return src_variance / new_variance * (score - src_score);
 }
 
-static double find_best_frame_unsharp_amount_loop_neg(
-    AV1_COMP *const cpi, double src_variance, double base_score,
-    YV12_BUFFER_CONFIG *const src, YV12_BUFFER_CONFIG *const recon,
-    YV12_BUFFER_CONFIG *const ref, YV12_BUFFER_CONFIG *const src_blurred,
-    YV12_BUFFER_CONFIG *const recon_blurred,
-    YV12_BUFFER_CONFIG *const src_sharpened,
-    YV12_BUFFER_CONFIG *const recon_sharpened, FULLPEL_MV *mvs,
-    double best_score, const double unsharp_amount_start,
-    const double step_size, const int max_loop_count, const double max_amount) {
-  const double min_amount = 0.0;
-  int loop_count = 0;
-  double approx_score = best_score;
-  double unsharp_amount = unsharp_amount_start;
-
-  do {
-    best_score = approx_score;
-    unsharp_amount += step_size;
-    if (unsharp_amount > max_amount || unsharp_amount < min_amount) break;
-    unsharp(cpi, recon, recon_blurred, recon_sharpened, unsharp_amount);
-    unsharp(cpi, src, src_blurred, src_sharpened, unsharp_amount);
-    const double new_variance =
-        residual_frame_average_variance(cpi, src_sharpened, ref, mvs);
-    approx_score = cal_approx_score(cpi, src_variance, new_variance, base_score,
-                                    src, recon_sharpened);
-
-    loop_count++;
-  } while (approx_score > best_score && loop_count < max_loop_count);
-  unsharp_amount =
-      approx_score > best_score ? unsharp_amount : unsharp_amount - step_size;
-
-  return AOMMIN(max_amount, AOMMAX(unsharp_amount, min_amount));
+typedef struct {
+  AV1_COMP *cpi;
+  YV12_BUFFER_CONFIG *src;
+  YV12_BUFFER_CONFIG *recon;
+  YV12_BUFFER_CONFIG *ref;
+  YV12_BUFFER_CONFIG *src_blurred;
+  YV12_BUFFER_CONFIG *recon_blurred;
+  YV12_BUFFER_CONFIG *src_sharpened;
+  YV12_BUFFER_CONFIG *recon_sharpened;
+  FULLPEL_MV *mvs;
+  double src_variance;
+  double base_score;
+} NegUnsharpSearch;
+
+static double neg_unsharp_score(void *ctx, double unsharp_amount) {
+  NegUnsharpSearch *const search = (NegUnsharpSearch *)ctx;
+  AV1_COMP *const cpi = search->cpi;
+  unsharp(cpi, search->recon, search->recon_blurred, search->recon_sharpened,
+          unsharp_amount);
+  unsharp(cpi, search->src, search->src_blurred, search->src_sharpened,
+          unsharp_amount);
+  const double new_variance = residual_frame_average_variance(
+      cpi, search->src_sharpened, search->ref, search->mvs);
+  return cal_approx_score(cpi, search->src_variance, new_variance,
+                          search->base_score, search->src,
+                          search->recon_sharpened);
 }
 
 static double find_best_frame_unsharp_amount_neg(
@@ -1041,33 +1229,19 @@ static double find_best_frame_unsharp_amount_neg(
   gaussian_blur(bit_depth, recon, &recon_blurred);
   gaussian_blur(bit_depth, src, &src_blurred);
 
-  unsharp(cpi, recon, &recon_blurred, &recon_sharpened, unsharp_amount_start);
-  unsharp(cpi, src, &src_blurred, &src_sharpened, unsharp_amount_start);
-  const double variance_start =
-      residual_frame_average_variance(cpi, &src_sharpened, ref, mvs);
-  const double score_start = cal_approx_score(
-      cpi, src_variance, variance_start, base_score, src, &recon_sharpened);
-
+  NegUnsharpSearch search = { cpi,           src,
+                              recon,         ref,
+                              &src_blurred,  &recon_blurred,
+                              &src_sharpened, &recon_sharpened,
+                              mvs,           src_variance,
+                              base_score };
   const double unsharp_amount_next = unsharp_amount_start + step_size;
-  unsharp(cpi, recon, &recon_blurred, &recon_sharpened, unsharp_amount_next);
-  unsharp(cpi, src, &src_blurred, &src_sharpened, unsharp_amount_next);
-  const double variance_next =
-      residual_frame_average_variance(cpi, &src_sharpened, ref, mvs);
-  const double score_next = cal_approx_score(cpi, src_variance, variance_next,
-                                             base_score, src, &recon_sharpened);
-
-  double unsharp_amount;
-  if (score_next > score_start) {
-    unsharp_amount = find_best_frame_unsharp_amount_loop_neg(
-        cpi, src_variance, base_score, src, recon, ref, &src_blurred,
-        &recon_blurred, &src_sharpened, &recon_sharpened, mvs, score_next,
-        unsharp_amount_next, step_size, max_loop_count, max_filter_amount);
-  } else {
-    unsharp_amount = find_best_frame_unsharp_amount_loop_neg(
-        cpi, src_variance, base_score, src, recon, ref, &src_blurred,
-        &recon_blurred, &src_sharpened, &recon_sharpened, mvs, score_start,
-        unsharp_amount_start, -step_size, max_loop_count, max_filter_amount);
-  }
+  const double score_start = neg_unsharp_score(&search, unsharp_amount_start);
+  const double score_next = neg_unsharp_score(&search, unsharp_amount_next);
+  const double unsharp_amount = search_unsharp_amount(
+      neg_unsharp_score, &search, unsharp_amount_start, score_start,
+      unsharp_amount_next, score_next, step_size, max_loop_count,
+      max_filter_amount);
 
   aom_free_frame_buffer(&recon_sharpened);
   aom_free_frame_buffer(&src_sharpened);
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <immintrin.h>
+
+#include "config/av1_rtcd.h"
+
+#include "av1/encoder/saliency_map.h"
+
+// Loads the even and odd floats of p[0..15].
+static INLINE void load_deinterleave(const float *p, __m256 *even,
+                                     __m256 *odd) {
+  const __m256 a = _mm256_loadu_ps(p);
+  const __m256 b = _mm256_loadu_ps(p + 8);
+  // Per 128-bit lane: a0 a2 b0 b2 | a4 a6 b4 b6, then fix the lane order.
+  const __m256 e = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  const __m256 o = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+  *even = _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(e), _MM_SHUFFLE(3, 1, 2, 0)));
+  *odd = _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(o), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+// The filters multiply and add in the same order as the C code, so results
+// are bit-exact.
+void av1_saliency_decimate_row_avx2(const float *const *rows, int width,
+                                    float *tmp, float *dst) {
+  const float k[5] = { 1.0f / 16, 4.0f / 16, 6.0f / 16, 4.0f / 16,
+                       1.0f / 16 };
+  const __m256 k0 = _mm256_set1_ps(k[0]);
+  const __m256 k1 = _mm256_set1_ps(k[1]);
+  const __m256 k2 = _mm256_set1_ps(k[2]);
+  const __m256 k3 = _mm256_set1_ps(k[3]);
+  const __m256 k4 = _mm256_set1_ps(k[4]);
+  const int tmp_width = width + 4;
+  const int out_width = width / 2;
+
+  int x = 0;
+  for (; x + 8 <= tmp_width; x += 8) {
+    __m256 sum = _mm256_mul_ps(k0, _mm256_loadu_ps(rows[0] + x));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k1, _mm256_loadu_ps(rows[1] + x)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k2, _mm256_loadu_ps(rows[2] + x)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k3, _mm256_loadu_ps(rows[3] + x)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k4, _mm256_loadu_ps(rows[4] + x)));
+    _mm256_storeu_ps(tmp + x, sum);
+  }
+  for (; x < tmp_width; ++x) {
+    tmp[x] = k[0] * rows[0][x] + k[1] * rows[1][x] + k[2] * rows[2][x] +
+             k[3] * rows[3][x] + k[4] * rows[4][x];
+  }
+
+  // dst[x] filters tmp[2 * x .. 2 * x + 4]. The loads stay within the
+  // width + 4 floats of tmp.
+  for (x = 0; x + 8 <= out_width; x += 8) {
+    __m256 e0, o0, e2, o2, e4, o4;
+    load_deinterleave(tmp + 2 * x, &e0, &o0);
+    load_deinterleave(tmp + 2 * x + 2, &e2, &o2);
+    load_deinterleave(tmp + 2 * x + 4, &e4, &o4);
+    __m256 sum = _mm256_mul_ps(k0, e0);
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k1, o0));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k2, e2));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k3, o2));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(k4, e4));
+    _mm256_storeu_ps(dst + x, sum);
+  }
+  for (; x < out_width; ++x) {
+    const float *const t = tmp + 2 * x;
+    dst[x] = k[0] * t[0] + k[1] * t[1] + k[2] * t[2] + k[3] * t[3] +
+             k[4] * t[4];
+  }
+}
+
+void av1_saliency_gabor_row_avx2(const float *const *rows, int width,
+                                 const float *kernel, float *dst) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    for (int k = 0; k < SALIENCY_GABOR_TAPS; ++k) {
+      const float *const row = rows[k] + x;
+      const float *const kernel_row = kernel + k * SALIENCY_GABOR_TAPS;
+      for (int l = 0; l < SALIENCY_GABOR_TAPS; ++l) {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(kernel_row[l]),
+                                               _mm256_loadu_ps(row + l)));
+      }
+    }
+    _mm256_storeu_ps(dst + x, sum);
+  }
+  if (x < width) {
+    const float *tail[SALIENCY_GABOR_TAPS];
+    for (int k = 0; k < SALIENCY_GABOR_TAPS; ++k) tail[k] = rows[k] + x;
+    av1_saliency_gabor_row_c(tail, width - x, kernel, dst + x);
+  }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <immintrin.h>
+
+#include "config/av1_rtcd.h"
+
+// Computes (int)(src + amount * (src - blurred) + 0.5) for 8 pixels, with the
+// same double precision arithmetic as the C code so results are bit-exact.
+static INLINE void unsharp_8(__m256i src, __m256i blurred, __m256d amount,
+                             __m128i *lo, __m128i *hi) {
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d s_lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(src));
+  const __m256d s_hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(src, 1));
+  const __m256d b_lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(blurred));
+  const __m256d b_hi =
+      _mm256_cvtepi32_pd(_mm256_extracti128_si256(blurred, 1));
+  __m256d v_lo =
+      _mm256_add_pd(s_lo, _mm256_mul_pd(amount, _mm256_sub_pd(s_lo, b_lo)));
+  __m256d v_hi =
+      _mm256_add_pd(s_hi, _mm256_mul_pd(amount, _mm256_sub_pd(s_hi, b_hi)));
+  v_lo = _mm256_add_pd(v_lo, half);
+  v_hi = _mm256_add_pd(v_hi, half);
+  *lo = _mm256_cvttpd_epi32(v_lo);
+  *hi = _mm256_cvttpd_epi32(v_hi);
+}
+
+void av1_unsharp_rect_avx2(const uint8_t *source, int source_stride,
+                           const uint8_t *blurred, int blurred_stride,
+                           uint8_t *dst, int dst_stride, int w, int h,
+                           double amount) {
+  const int w16 = w & ~15;
+  const __m256d amount_pd = _mm256_set1_pd(amount);
+  const uint8_t *src_row = source;
+  const uint8_t *blurred_row = blurred;
+  uint8_t *dst_row = dst;
+  for (int i = 0; i < h; ++i) {
+    for (int j = 0; j < w16; j += 16) {
+      const __m128i s = _mm_loadu_si128((const __m128i *)(src_row + j));
+      const __m128i b = _mm_loadu_si128((const __m128i *)(blurred_row + j));
+      __m128i r0, r1, r2, r3;
+      unsharp_8(_mm256_cvtepu8_epi32(s), _mm256_cvtepu8_epi32(b), amount_pd,
+                &r0, &r1);
+      unsharp_8(_mm256_cvtepu8_epi32(_mm_srli_si128(s, 8)),
+                _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8)), amount_pd, &r2,
+                &r3);
+      const __m128i res = _mm_packus_epi16(_mm_packs_epi32(r0, r1),
+                                           _mm_packs_epi32(r2, r3));
+      _mm_storeu_si128((__m128i *)(dst_row + j), res);
+    }
+    src_row += source_stride;
+    blurred_row += blurred_stride;
+    dst_row += dst_stride;
+  }
+  if (w16 < w) {
+    av1_unsharp_rect_c(source + w16, source_stride, blurred + w16,
+                       blurred_stride, dst + w16, dst_stride, w - w16, h,
+                       amount);
+  }
+}
+
+void av1_highbd_unsharp_rect_avx2(const uint16_t *source, int source_stride,
+                                  const uint16_t *blurred, int blurred_stride,
+                                  uint16_t *dst, int dst_stride, int w, int h,
+                                  double amount, int bit_depth) {
+  const int w8 = w & ~7;
+  const __m256d amount_pd = _mm256_set1_pd(amount);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max_value = _mm_set1_epi32((1 << bit_depth) - 1);
+  const uint16_t *src_row = source;
+  const uint16_t *blurred_row = blurred;
+  uint16_t *dst_row = dst;
+  for (int i = 0; i < h; ++i) {
+    for (int j = 0; j < w8; j += 8) {
+      const __m128i s = _mm_loadu_si128((const __m128i *)(src_row + j));
+      const __m128i b = _mm_loadu_si128((const __m128i *)(blurred_row + j));
+      __m128i lo, hi;
+      unsharp_8(_mm256_cvtepu16_epi32(s), _mm256_cvtepu16_epi32(b), amount_pd,
+                &lo, &hi);
+      lo = _mm_min_epi32(_mm_max_epi32(lo, zero), max_value);
+      hi = _mm_min_epi32(_mm_max_epi32(hi, zero), max_value);
+      _mm_storeu_si128((__m128i *)(dst_row + j), _mm_packus_epi32(lo, hi));
+    }
+    src_row += source_stride;
+    blurred_row += blurred_stride;
+    dst_row += dst_stride;
+  }
+  if (w8 < w) {
+    av1_highbd_unsharp_rect_c(source + w8, source_stride, blurred + w8,
+                              blurred_stride, dst + w8, dst_stride, w - w8, h,
+                              amount, bit_depth);
+  }
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <smmintrin.h>
+
+#include "config/av1_rtcd.h"
+
+// Computes (int)(src + amount * (src - blurred) + 0.5) for 4 pixels, with the
+// same double precision arithmetic as the C code so results are bit-exact.
+static INLINE __m128i unsharp_4(__m128i src, __m128i blurred, __m128d amount) {
+  const __m128d half = _mm_set1_pd(0.5);
+  const __m128d s_lo = _mm_cvtepi32_pd(src);
+  const __m128d s_hi = _mm_cvtepi32_pd(_mm_srli_si128(src, 8));
+  const __m128d b_lo = _mm_cvtepi32_pd(blurred);
+  const __m128d b_hi = _mm_cvtepi32_pd(_mm_srli_si128(blurred, 8));
+  __m128d v_lo = _mm_add_pd(s_lo, _mm_mul_pd(amount, _mm_sub_pd(s_lo, b_lo)));
+  __m128d v_hi = _mm_add_pd(s_hi, _mm_mul_pd(amount, _mm_sub_pd(s_hi, b_hi)));
+  v_lo = _mm_add_pd(v_lo, half);
+  v_hi = _mm_add_pd(v_hi, half);
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(v_lo), _mm_cvttpd_epi32(v_hi));
+}
+
+void av1_unsharp_rect_sse4_1(const uint8_t *source, int source_stride,
+                             const uint8_t *blurred, int blurred_stride,
+                             uint8_t *dst, int dst_stride, int w, int h,
+                             double amount) {
+  const int w8 = w & ~7;
+  const __m128d amount_pd = _mm_set1_pd(amount);
+  const uint8_t *src_row = source;
+  const uint8_t *blurred_row = blurred;
+  uint8_t *dst_row = dst;
+  for (int i = 0; i < h; ++i) {
+    for (int j = 0; j < w8; j += 8) {
+      const __m128i s = _mm_loadl_epi64((const __m128i *)(src_row + j));
+      const __m128i b = _mm_loadl_epi64((const __m128i *)(blurred_row + j));
+      const __m128i lo =
+          unsharp_4(_mm_cvtepu8_epi32(s), _mm_cvtepu8_epi32(b), amount_pd);
+      const __m128i hi = unsharp_4(_mm_cvtepu8_epi32(_mm_srli_si128(s, 4)),
+                                   _mm_cvtepu8_epi32(_mm_srli_si128(b, 4)),
+                                   amount_pd);
+      const __m128i res = _mm_packus_epi16(_mm_packs_epi32(lo, hi), lo);
+      _mm_storel_epi64((__m128i *)(dst_row + j), res);
+    }
+    src_row += source_stride;
+    blurred_row += blurred_stride;
+    dst_row += dst_stride;
+  }
+  if (w8 < w) {
+    av1_unsharp_rect_c(source + w8, source_stride, blurred + w8,
+                       blurred_stride, dst + w8, dst_stride, w - w8, h, amount);
+  }
+}
+
+void av1_highbd_unsharp_rect_sse4_1(const uint16_t *source, int source_stride,
+                                    const uint16_t *blurred,
+                                    int blurred_stride, uint16_t *dst,
+                                    int dst_stride, int w, int h,
+                                    double amount, int bit_depth) {
+  const int w8 = w & ~7;
+  const __m128d amount_pd = _mm_set1_pd(amount);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max_value = _mm_set1_epi32((1 << bit_depth) - 1);
+  const uint16_t *src_row = source;
+  const uint16_t *blurred_row = blurred;
+  uint16_t *dst_row = dst;
+  for (int i = 0; i < h; ++i) {
+    for (int j = 0; j < w8; j += 8) {
+      const __m128i s = _mm_loadu_si128((const __m128i *)(src_row + j));
+      const __m128i b = _mm_loadu_si128((const __m128i *)(blurred_row + j));
+      __m128i lo =
+          unsharp_4(_mm_cvtepu16_epi32(s), _mm_cvtepu16_epi32(b), amount_pd);
+      __m128i hi = unsharp_4(_mm_cvtepu16_epi32(_mm_srli_si128(s, 8)),
+                             _mm_cvtepu16_epi32(_mm_srli_si128(b, 8)),
+                             amount_pd);
+      lo = _mm_min_epi32(_mm_max_epi32(lo, zero), max_value);
+      hi = _mm_min_epi32(_mm_max_epi32(hi, zero), max_value);
+      _mm_storeu_si128((__m128i *)(dst_row + j), _mm_packus_epi32(lo, hi));
+    }
+    src_row += source_stride;
+    blurred_row += blurred_stride;
+    dst_row += dst_stride;
+  }
+  if (w8 < w) {
+    av1_highbd_unsharp_rect_c(source + w8, source_stride, blurred + w8,
+                              blurred_stride, dst + w8, dst_stride, w - w8, h,
+                              amount, bit_depth);
+  }
+}
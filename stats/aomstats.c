@@ -9,6 +9,12 @@
  * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
  */
 
+// Enable GNU extensions in glibc so that we can call fileno().
+// This must be before any #include statements.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "stats/aomstats.h"
 
 #include <assert.h>
@@ -16,18 +22,73 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
 #include "aom_dsp/aom_dsp_common.h"
+#include "aom_ports/mem_ops.h"
 #include "common/tools_common.h"
 
+static void put_le64(uint8_t *mem, int64_t val) {
+  mem_put_le32(mem, (int)(uint32_t)val);
+  mem_put_le32(mem + 4, (int)(uint32_t)((uint64_t)val >> 32));
+}
+
+static int64_t get_le64(const uint8_t *mem) {
+  return (int64_t)((uint64_t)(uint32_t)mem_get_le32(mem) |
+                   (uint64_t)(uint32_t)mem_get_le32(mem + 4) << 32);
+}
+
+static int write_header(stats_io_t *stats, int64_t num_frames) {
+  uint8_t header[STATS_FILE_HEADER_SIZE] = { 0 };
+  memcpy(header, "AOMSTATS", 8);
+  mem_put_le32(header + 8, STATS_FILE_VERSION);
+  mem_put_le32(header + 12, STATS_FILE_HEADER_SIZE);
+  mem_put_le32(header + 16, (int)stats->record_size);
+  put_le64(header + 24, num_frames);
+  put_le64(header + 32, stats->first_frame);
+  return fwrite(header, 1, sizeof(header), stats->file) == sizeof(header);
+}
+
+// Reads the header of an indexed stats file of 'file_sz' bytes and returns
+// where the records start, or 0 for a file of plain records.
+static size_t read_header(stats_io_t *stats, FileOffset file_sz) {
+  uint8_t header[STATS_FILE_HEADER_SIZE];
+  if (file_sz < STATS_FILE_HEADER_SIZE ||
+      fread(header, 1, sizeof(header), stats->file) != sizeof(header) ||
+      memcmp(header, "AOMSTATS", 8)) {
+    rewind(stats->file);
+    return 0;
+  }
+  if (mem_get_le32(header + 8) > STATS_FILE_VERSION)
+    fatal("First-pass stats file has an unsupported version!");
+  const size_t header_sz = (uint32_t)mem_get_le32(header + 12);
+  stats->record_size = (uint32_t)mem_get_le32(header + 16);
+  const int64_t num_frames = get_le64(header + 24);
+  stats->first_frame = get_le64(header + 32);
+  if (header_sz < STATS_FILE_HEADER_SIZE || stats->record_size == 0 ||
+      num_frames < 0 ||
+      (uint64_t)file_sz !=
+          header_sz + (uint64_t)(num_frames + 1) * stats->record_size) {
+    fatal("First-pass stats file is truncated or corrupt!");
+  }
+  return header_sz;
+}
+
 int stats_open_file(stats_io_t *stats, const char *fpf, int pass) {
   int res;
   stats->pass = pass;
+  stats->map = NULL;
+  stats->is_range = 0;
 
   if (pass == 0) {
     stats->file = fopen(fpf, "wb");
     stats->buf.sz = 0;
     stats->buf.buf = NULL;
-    res = (stats->file != NULL);
+    stats->record_size = 0;
+    // The header is written again with the number of frames on close.
+    res = stats->file != NULL && write_header(stats, 0);
   } else {
     size_t nbytes;
 
@@ -35,11 +96,32 @@ int stats_open_file(stats_io_t *stats, const char *fpf, int pass) {
 
     if (stats->file == NULL) fatal("First-pass stats file does not exist!");
 
-    if (fseek(stats->file, 0, SEEK_END))
+    if (fseeko(stats->file, 0, SEEK_END))
       fatal("First-pass stats file must be seekable!");
 
-    stats->buf.sz = stats->buf_alloc_sz = ftell(stats->file);
+    const FileOffset file_sz = ftello(stats->file);
     rewind(stats->file);
+    stats->record_size = 0;
+    stats->first_frame = 0;
+    const size_t header_sz = read_header(stats, file_sz);
+    stats->buf.sz = stats->buf_alloc_sz = (size_t)file_sz - header_sz;
+
+#if !defined(_WIN32)
+    // Map indexed files, so only the records the encoder reads are loaded.
+    // The mapping is private because the encoder annotates the records.
+    if (header_sz) {
+      void *const map = mmap(NULL, (size_t)file_sz, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE, fileno(stats->file), 0);
+      if (map != MAP_FAILED) {
+        stats->map = map;
+        stats->map_sz = (size_t)file_sz;
+        stats->buf.buf = (uint8_t *)map + header_sz;
+        return 1;
+      }
+      if (fseeko(stats->file, header_sz, SEEK_SET))
+        fatal("First-pass stats file must be seekable!");
+    }
+#endif
 
     stats->buf.buf = malloc(stats->buf_alloc_sz);
 
@@ -57,11 +139,14 @@ int stats_open_file(stats_io_t *stats, const char *fpf, int pass) {
 int stats_open_mem(stats_io_t *stats, int pass) {
   int res;
   stats->pass = pass;
+  stats->map = NULL;
+  stats->is_range = 0;
 
   if (!pass) {
     stats->buf.sz = 0;
     stats->buf_alloc_sz = 64 * 1024;
     stats->buf.buf = malloc(stats->buf_alloc_sz);
+    stats->record_size = 0;
   }
 
   stats->buf_ptr = stats->buf.buf;
@@ -69,20 +154,71 @@ int stats_open_mem(stats_io_t *stats, int pass) {
   return res;
 }
 
+int stats_open_range(stats_io_t *range, const stats_io_t *stats, int64_t start,
+                     int64_t count) {
+  const int64_t num_frames = stats_num_frames(stats);
+  if (num_frames < 0 || start < 0 || count <= 0 || start + count > num_frames)
+    return 0;
+
+  memset(range, 0, sizeof(*range));
+  range->pass = stats->pass;
+  range->is_range = 1;
+  range->record_size = stats->record_size;
+  range->first_frame = stats->first_frame + start;
+  range->buf.sz = range->buf_alloc_sz = (size_t)(count + 1) * range->record_size;
+  range->buf.buf = malloc(range->buf_alloc_sz);
+  if (!range->buf.buf) return 0;
+  memcpy(range->buf.buf,
+         (const uint8_t *)stats->buf.buf + (size_t)start * stats->record_size,
+         (size_t)count * range->record_size);
+  memset((uint8_t *)range->buf.buf + (size_t)count * range->record_size, 0,
+         range->record_size);
+  range->buf_ptr = (char *)range->buf.buf + range->buf.sz;
+  return 1;
+}
+
+int64_t stats_num_frames(const stats_io_t *stats) {
+  if (!stats->record_size || stats->buf.sz < stats->record_size) return -1;
+  return (int64_t)(stats->buf.sz / stats->record_size) - 1;
+}
+
+static void free_buf(stats_io_t *stats) {
+#if !defined(_WIN32)
+  if (stats->map) {
+    munmap(stats->map, stats->map_sz);
+    stats->map = NULL;
+    return;
+  }
+#endif
+  free(stats->buf.buf);
+}
+
 void stats_close(stats_io_t *stats, int last_pass) {
   if (stats->file) {
+    if (stats->pass == 0) {
+      const FileOffset sz = ftello(stats->file);
+      const int64_t num_frames =
+          stats->record_size
+              ? (sz - STATS_FILE_HEADER_SIZE) / (int64_t)stats->record_size - 1
+              : 0;
+      if (fseeko(stats->file, 0, SEEK_SET) ||
+          !write_header(stats, AOMMAX(num_frames, 0))) {
+        fatal("Failed to write the first-pass stats file header");
+      }
+    }
     if (stats->pass == last_pass) {
-      free(stats->buf.buf);
+      free_buf(stats);
     }
 
     fclose(stats->file);
     stats->file = NULL;
   } else {
-    if (stats->pass == last_pass) free(stats->buf.buf);
+    if (stats->pass == last_pass || stats->is_range) free_buf(stats);
   }
 }
 
 void stats_write(stats_io_t *stats, const void *pkt, size_t len) {
+  if (!stats->record_size) stats->record_size = len;
   if (stats->file) {
     (void)fwrite(pkt, 1, len, stats->file);
     return;
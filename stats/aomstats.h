@@ -12,6 +12,7 @@
 #ifndef AOM_STATS_AOMSTATS_H_
 #define AOM_STATS_AOMSTATS_H_
 
+#include <stdint.h>
 #include <stdio.h>
 
 #include "aom/aom_encoder.h"
@@ -20,6 +21,25 @@
 extern "C" {
 #endif
 
+/* First pass statistics files start with a STATS_FILE_HEADER_SIZE byte
+ * header, followed by the records of the frames and a record with the
+ * totals, all record_size bytes long, so the record of any frame can be
+ * found from its number. Header fields are little endian:
+ *
+ *   0  magic "AOMSTATS"
+ *   8  version (32 bits)
+ *  12  header size (32 bits), where the records start
+ *  16  record size (32 bits)
+ *  20  reserved
+ *  24  number of frames, without the totals (64 bits)
+ *  32  input frame number of the first record (64 bits)
+ *  40  reserved up to the header size
+ *
+ * Files without the magic are read as the plain records of older versions.
+ */
+#define STATS_FILE_VERSION 1
+#define STATS_FILE_HEADER_SIZE 64
+
 /* This structure is used to abstract the different ways of handling
  * first pass statistics
  */
@@ -29,10 +49,28 @@ typedef struct {
   FILE *file;
   char *buf_ptr;
   size_t buf_alloc_sz;
+  /* Size of one record, 0 when unknown. */
+  size_t record_size;
+  /* Input frame number of the first record. */
+  int64_t first_frame;
+  /* Mapping of a stats file, which buf points into. */
+  void *map;
+  size_t map_sz;
+  /* Set for stores opened by stats_open_range(), freed on close. */
+  int is_range;
 } stats_io_t;
 
 int stats_open_file(stats_io_t *stats, const char *fpf, int pass);
 int stats_open_mem(stats_io_t *stats, int pass);
+/* Opens the stats of 'count' frames from frame 'start' of 'stats' as a
+ * store of their own, with a zeroed totals record that has the encoder
+ * accumulate the totals of the range. Only the records of the range are
+ * read.
+ */
+int stats_open_range(stats_io_t *range, const stats_io_t *stats, int64_t start,
+                     int64_t count);
+/* Returns the number of frames in the stats, or -1 when unknown. */
+int64_t stats_num_frames(const stats_io_t *stats);
 void stats_close(stats_io_t *stats, int last_pass);
 void stats_write(stats_io_t *stats, const void *pkt, size_t len);
 aom_fixed_buf_t stats_get(stats_io_t *stats);
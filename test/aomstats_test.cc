@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+#include "stats/aomstats.h"
+#include "test/video_source.h"
+
+namespace {
+
+const size_t kRecordSize = 24;
+
+// Returns a stats record of frame 'frame', whose bytes differ from those of
+// the other frames.
+std::string Record(int frame) {
+  std::string record(kRecordSize, '\0');
+  for (size_t i = 0; i < kRecordSize; ++i) {
+    record[i] = static_cast<char>(frame * 16 + i + 1);
+  }
+  return record;
+}
+
+std::string Records(int start, int count) {
+  std::string records;
+  for (int i = start; i < start + count; ++i) records += Record(i);
+  return records;
+}
+
+uint32_t GetLe32(const std::string &data, size_t offset) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(&data[offset]);
+  return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+int64_t GetLe64(const std::string &data, size_t offset) {
+  return static_cast<int64_t>(GetLe32(data, offset) |
+                              static_cast<uint64_t>(GetLe32(data, offset + 4))
+                                  << 32);
+}
+
+void PutLe32(std::string *data, size_t offset, uint32_t val) {
+  for (int i = 0; i < 4; ++i) (*data)[offset + i] = (char)(val >> (8 * i));
+}
+
+std::string ReadFile(const std::string &name) {
+  std::string data;
+  FILE *file = fopen(name.c_str(), "rb");
+  EXPECT_NE(file, nullptr);
+  if (file == nullptr) return data;
+  char buf[256];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), file)) > 0) data.append(buf, n);
+  fclose(file);
+  return data;
+}
+
+void WriteFile(const std::string &name, const std::string &data) {
+  FILE *file = fopen(name.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), file));
+  fclose(file);
+}
+
+class AomStatsTest : public ::testing::Test {
+ protected:
+  // Writes the first pass stats of 'num_frames' frames from input frame
+  // 'first_frame' and their totals, as the first pass does.
+  void WriteStats(int num_frames, int64_t first_frame) {
+    stats_io_t stats;
+    memset(&stats, 0, sizeof(stats));
+    ASSERT_TRUE(stats_open_file(&stats, name(), 0));
+    stats.first_frame = first_frame;
+    for (int i = 0; i <= num_frames; ++i) {
+      const std::string record = Record(i);
+      stats_write(&stats, record.data(), record.size());
+    }
+    stats_close(&stats, 1);
+  }
+
+  void OpenStats(stats_io_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    ASSERT_TRUE(stats_open_file(stats, name(), 1));
+  }
+
+  static std::string Buffer(const stats_io_t &stats) {
+    return std::string(static_cast<const char *>(stats.buf.buf), stats.buf.sz);
+  }
+
+  const char *name() { return file_.file_name().c_str(); }
+
+  libaom_test::TempOutFile file_;
+};
+
+TEST_F(AomStatsTest, Header) {
+  WriteStats(5, 7);
+  const std::string data = ReadFile(name());
+  ASSERT_EQ(STATS_FILE_HEADER_SIZE + 6 * kRecordSize, data.size());
+  EXPECT_EQ(0, memcmp(data.data(), "AOMSTATS", 8));
+  EXPECT_EQ(static_cast<uint32_t>(STATS_FILE_VERSION), GetLe32(data, 8));
+  EXPECT_EQ(static_cast<uint32_t>(STATS_FILE_HEADER_SIZE), GetLe32(data, 12));
+  EXPECT_EQ(kRecordSize, GetLe32(data, 16));
+  EXPECT_EQ(5, GetLe64(data, 24));
+  EXPECT_EQ(7, GetLe64(data, 32));
+  EXPECT_EQ(Records(0, 6), data.substr(STATS_FILE_HEADER_SIZE));
+}
+
+TEST_F(AomStatsTest, ReadIndexedFile) {
+  WriteStats(5, 7);
+  stats_io_t stats;
+  OpenStats(&stats);
+  EXPECT_EQ(kRecordSize, stats.record_size);
+  EXPECT_EQ(7, stats.first_frame);
+  EXPECT_EQ(5, stats_num_frames(&stats));
+  EXPECT_EQ(Records(0, 6), Buffer(stats));
+#if !defined(_WIN32)
+  // The records are read from a private mapping of the file, which the
+  // encoder may write to.
+  ASSERT_NE(stats.map, nullptr);
+  static_cast<char *>(stats.buf.buf)[0] = 0;
+#endif
+  stats_close(&stats, 1);
+  EXPECT_EQ(Records(0, 6), ReadFile(name()).substr(STATS_FILE_HEADER_SIZE));
+}
+
+TEST_F(AomStatsTest, ReadLegacyFile) {
+  // Files of older versions are only the records.
+  WriteFile(name(), Records(0, 6));
+  stats_io_t stats;
+  OpenStats(&stats);
+  EXPECT_EQ(nullptr, stats.map);
+  EXPECT_EQ(0u, stats.record_size);
+  EXPECT_EQ(0, stats.first_frame);
+  EXPECT_EQ(-1, stats_num_frames(&stats));
+  EXPECT_EQ(Records(0, 6), Buffer(stats));
+
+  // Their frame count is unknown, so no range can be taken.
+  stats_io_t range;
+  EXPECT_FALSE(stats_open_range(&range, &stats, 0, 1));
+  stats_close(&stats, 1);
+}
+
+TEST_F(AomStatsTest, Range) {
+  WriteStats(6, 10);
+  stats_io_t stats;
+  OpenStats(&stats);
+  stats_io_t range;
+  ASSERT_TRUE(stats_open_range(&range, &stats, 2, 3));
+  EXPECT_EQ(kRecordSize, range.record_size);
+  EXPECT_EQ(12, range.first_frame);
+  EXPECT_EQ(3, stats_num_frames(&range));
+  // The totals are zeroed, for the encoder to accumulate those of the range.
+  EXPECT_EQ(Records(2, 3) + std::string(kRecordSize, '\0'), Buffer(range));
+
+  // A range of a range counts from its first frame.
+  stats_io_t sub_range;
+  ASSERT_TRUE(stats_open_range(&sub_range, &range, 1, 2));
+  EXPECT_EQ(13, sub_range.first_frame);
+  EXPECT_EQ(Records(3, 2) + std::string(kRecordSize, '\0'), Buffer(sub_range));
+  stats_close(&sub_range, 1);
+  stats_close(&range, 1);
+
+  // Ranges must be within the frames of the stats.
+  EXPECT_TRUE(stats_open_range(&range, &stats, 0, 6));
+  stats_close(&range, 1);
+  EXPECT_FALSE(stats_open_range(&range, &stats, 1, 6));
+  EXPECT_FALSE(stats_open_range(&range, &stats, 6, 1));
+  EXPECT_FALSE(stats_open_range(&range, &stats, -1, 2));
+  EXPECT_FALSE(stats_open_range(&range, &stats, 2, 0));
+  stats_close(&stats, 1);
+}
+
+TEST_F(AomStatsTest, MemoryStore) {
+  stats_io_t stats;
+  memset(&stats, 0, sizeof(stats));
+  ASSERT_TRUE(stats_open_mem(&stats, 0));
+  EXPECT_EQ(-1, stats_num_frames(&stats));
+  // Enough records to grow the buffer.
+  const int kFrames = 64 * 1024 / kRecordSize;
+  for (int i = 0; i <= kFrames; ++i) {
+    const std::string record = Record(i);
+    stats_write(&stats, record.data(), record.size());
+  }
+  EXPECT_EQ(kRecordSize, stats.record_size);
+  EXPECT_EQ(kFrames, stats_num_frames(&stats));
+  const aom_fixed_buf_t buf = stats_get(&stats);
+  EXPECT_EQ(Records(0, kFrames + 1),
+            std::string(static_cast<const char *>(buf.buf), buf.sz));
+  stats_close(&stats, 0);
+}
+
+using AomStatsDeathTest = AomStatsTest;
+
+TEST_F(AomStatsDeathTest, Truncated) {
+  WriteStats(5, 0);
+  const std::string data = ReadFile(name());
+  WriteFile(name(), data.substr(0, data.size() - 1));
+  stats_io_t stats;
+  memset(&stats, 0, sizeof(stats));
+  EXPECT_EXIT(stats_open_file(&stats, name(), 1),
+              ::testing::ExitedWithCode(EXIT_FAILURE), "truncated or corrupt");
+}
+
+TEST_F(AomStatsDeathTest, RecordSize) {
+  WriteStats(5, 0);
+  std::string data = ReadFile(name());
+  PutLe32(&data, 16, kRecordSize + 1);
+  WriteFile(name(), data);
+  stats_io_t stats;
+  memset(&stats, 0, sizeof(stats));
+  EXPECT_EXIT(stats_open_file(&stats, name(), 1),
+              ::testing::ExitedWithCode(EXIT_FAILURE), "truncated or corrupt");
+}
+
+TEST_F(AomStatsDeathTest, Version) {
+  WriteStats(5, 0);
+  std::string data = ReadFile(name());
+  PutLe32(&data, 8, STATS_FILE_VERSION + 1);
+  WriteFile(name(), data);
+  stats_io_t stats;
+  memset(&stats, 0, sizeof(stats));
+  EXPECT_EXIT(stats_open_file(&stats, name(), 1),
+              ::testing::ExitedWithCode(EXIT_FAILURE), "unsupported version");
+}
+
+}  // namespace
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <memory>
+#include <new>
+
+#include "config/aom_dsp_rtcd.h"
+
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+#include "test/acm_random.h"
+#include "test/util.h"
+
+#include "aom_dsp/flow_estimation/disflow.h"
+#include "aom_ports/aom_timer.h"
+
+namespace {
+
+using libaom_test::ACMRandom;
+
+typedef void (*ComputeFlowAtPointFunc)(const uint8_t *src, const uint8_t *ref,
+                                       int x, int y, int width, int height,
+                                       int stride, double *u, double *v);
+
+const int kWidth = 128;
+const int kHeight = 128;
+// Large enough for the reads of compute_flow_error(), which clamps the patch
+// position to at most 9 pixels outside of the frame.
+const int kBorder = 32;
+const int kStride = kWidth + 2 * kBorder;
+
+// A random point to compute the flow at, and the flow to start from.
+struct FlowPoint {
+  int x, y;
+  double u0, v0;
+};
+
+class ComputeFlowTest
+    : public ::testing::TestWithParam<ComputeFlowAtPointFunc> {
+ public:
+  void SetUp() override {
+    rnd_.Reset(ACMRandom::DeterministicSeed());
+    target_func_ = GetParam();
+    const int buf_size = kStride * (kHeight + 2 * kBorder);
+    src_buf_.reset(new (std::nothrow) uint8_t[buf_size]);
+    ref_buf_.reset(new (std::nothrow) uint8_t[buf_size]);
+    ASSERT_NE(src_buf_, nullptr);
+    ASSERT_NE(ref_buf_, nullptr);
+    src_ = src_buf_.get() + kBorder * kStride + kBorder;
+    ref_ = ref_buf_.get() + kBorder * kStride + kBorder;
+  }
+
+ protected:
+  // Fill the reference with smoothed random data, and the source with a
+  // noisy, shifted copy of it, so that the flow search takes several steps.
+  void FillFrames() {
+    const int buf_height = kHeight + 2 * kBorder;
+    std::unique_ptr<int[]> noise(new (std::nothrow) int[kStride * buf_height]);
+    ASSERT_NE(noise, nullptr);
+    for (int i = 0; i < kStride * buf_height; ++i) noise[i] = rnd_.Rand8();
+    for (int i = 0; i < buf_height; ++i) {
+      for (int j = 0; j < kStride; ++j) {
+        int sum = 0;
+        for (int k = -2; k <= 2; ++k) {
+          for (int l = -2; l <= 2; ++l) {
+            const int r = clamp(i + k, 0, buf_height - 1);
+            const int c = clamp(j + l, 0, kStride - 1);
+            sum += noise[r * kStride + c];
+          }
+        }
+        ref_buf_[i * kStride + j] = sum / 25;
+      }
+    }
+    for (int i = 0; i < buf_height; ++i) {
+      for (int j = 0; j < kStride; ++j) {
+        const int r = AOMMIN(i + 3, buf_height - 1);
+        const int c = AOMMIN(j + 2, kStride - 1);
+        src_buf_[i * kStride + j] =
+            clamp(ref_buf_[r * kStride + c] + (rnd_.Rand8() & 7) - 4, 0, 255);
+      }
+    }
+  }
+
+  FlowPoint RandomPoint();
+  void RunCheckOutput();
+  void RunSpeedTest();
+
+  ACMRandom rnd_;
+  ComputeFlowAtPointFunc target_func_;
+  std::unique_ptr<uint8_t[]> src_buf_;
+  std::unique_ptr<uint8_t[]> ref_buf_;
+  uint8_t *src_;
+  uint8_t *ref_;
+};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(ComputeFlowTest);
+
+FlowPoint ComputeFlowTest::RandomPoint() {
+  FlowPoint p;
+  p.x = rnd_.PseudoUniform(kWidth - DISFLOW_PATCH_SIZE + 1);
+  p.y = rnd_.PseudoUniform(kHeight - DISFLOW_PATCH_SIZE + 1);
+  // Start from a random sub-pixel offset, sometimes far enough out that the
+  // reference patch gets clamped at the frame edges.
+  p.u0 = (rnd_.PseudoUniform(1 << 9) - (1 << 8)) / 16.0;
+  p.v0 = (rnd_.PseudoUniform(1 << 9) - (1 << 8)) / 16.0;
+  return p;
+}
+
+void ComputeFlowTest::RunCheckOutput() {
+  const int kNumIters = 1000;
+  FillFrames();
+
+  for (int i = 0; i < kNumIters; ++i) {
+    const FlowPoint p = RandomPoint();
+    double u_ref = p.u0, v_ref = p.v0;
+    double u_test = p.u0, v_test = p.v0;
+    aom_compute_flow_at_point_c(src_, ref_, p.x, p.y, kWidth, kHeight, kStride,
+                                &u_ref, &v_ref);
+    target_func_(src_, ref_, p.x, p.y, kWidth, kHeight, kStride, &u_test,
+                 &v_test);
+    ASSERT_EQ(u_ref, u_test) << "x=" << p.x << " y=" << p.y;
+    ASSERT_EQ(v_ref, v_test) << "x=" << p.x << " y=" << p.y;
+  }
+}
+
+void ComputeFlowTest::RunSpeedTest() {
+  const int kNumPoints = 64;
+  const int kNumRuns = 1000;
+  FillFrames();
+  FlowPoint points[kNumPoints];
+  for (FlowPoint &p : points) p = RandomPoint();
+
+  aom_usec_timer ref_timer, test_timer;
+  aom_usec_timer_start(&ref_timer);
+  for (int i = 0; i < kNumRuns; ++i) {
+    for (const FlowPoint &p : points) {
+      double u = p.u0, v = p.v0;
+      aom_compute_flow_at_point_c(src_, ref_, p.x, p.y, kWidth, kHeight,
+                                  kStride, &u, &v);
+    }
+  }
+  aom_usec_timer_mark(&ref_timer);
+  const int elapsed_time_c =
+      static_cast<int>(aom_usec_timer_elapsed(&ref_timer));
+
+  aom_usec_timer_start(&test_timer);
+  for (int i = 0; i < kNumRuns; ++i) {
+    for (const FlowPoint &p : points) {
+      double u = p.u0, v = p.v0;
+      target_func_(src_, ref_, p.x, p.y, kWidth, kHeight, kStride, &u, &v);
+    }
+  }
+  aom_usec_timer_mark(&test_timer);
+  const int elapsed_time_simd =
+      static_cast<int>(aom_usec_timer_elapsed(&test_timer));
+
+  printf("c_time=%d \t simd_time=%d \t gain=%f\n", elapsed_time_c,
+         elapsed_time_simd,
+         static_cast<double>(elapsed_time_c) / elapsed_time_simd);
+}
+
+TEST_P(ComputeFlowTest, CheckOutput) { RunCheckOutput(); }
+TEST_P(ComputeFlowTest, DISABLED_Speed) { RunSpeedTest(); }
+
+#if HAVE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE4_1, ComputeFlowTest,
+                         ::testing::Values(aom_compute_flow_at_point_sse4_1));
+#endif
+
+#if HAVE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, ComputeFlowTest,
+                         ::testing::Values(aom_compute_flow_at_point_avx2));
+#endif
+
+}  // namespace
@@ -9,7 +9,10 @@
  * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
  */
 
+#include <algorithm>
 #include <cstdlib>
+#include <string>
+#include <vector>
 
 #include "third_party/googletest/src/googletest/include/gtest/gtest.h"
 
@@ -156,4 +159,302 @@ TEST(EncodeAPI, AllIntraMode) {
 }
 #endif
 
+// Records the images handed back through AOME_SET_INPUT_RELEASE_CB.
+void RecordRelease(void *cb_priv, const aom_image_t *img) {
+  static_cast<std::vector<const aom_image_t *> *>(cb_priv)->push_back(img);
+}
+
+// Fills the I420 'img' with frame 'frame' of a moving gradient.
+void FillGradient(aom_image_t *img, int frame) {
+  for (int plane = 0; plane < 3; ++plane) {
+    const int w = plane ? (img->d_w + 1) / 2 : img->d_w;
+    const int h = plane ? (img->d_h + 1) / 2 : img->d_h;
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        img->planes[plane][y * img->stride[plane] + x] =
+            static_cast<unsigned char>(x * 2 + y + frame * 3 + plane * 40);
+      }
+    }
+  }
+}
+
+// Appends the frame and first pass stats packets of 'enc' to 'out' and
+// returns whether there were any.
+bool AppendPackets(aom_codec_ctx_t *enc, std::string *out) {
+  bool got_data = false;
+  aom_codec_iter_t iter = nullptr;
+  const aom_codec_cx_pkt_t *pkt;
+  while ((pkt = aom_codec_get_cx_data(enc, &iter)) != nullptr) {
+    if (pkt->kind == AOM_CODEC_CX_FRAME_PKT) {
+      out->append(static_cast<const char *>(pkt->data.frame.buf),
+                  pkt->data.frame.sz);
+      got_data = true;
+    } else if (pkt->kind == AOM_CODEC_STATS_PKT) {
+      out->append(static_cast<const char *>(pkt->data.twopass_stats.buf),
+                  pkt->data.twopass_stats.sz);
+      got_data = true;
+    }
+  }
+  return got_data;
+}
+
+// Flushes 'enc' and appends the remaining packets to 'out'.
+void FlushEncoder(aom_codec_ctx_t *enc, std::string *out) {
+  do {
+    EXPECT_EQ(AOM_CODEC_OK, aom_codec_encode(enc, nullptr, 0, 0, 0));
+  } while (AppendPackets(enc, out));
+}
+
+// Encodes a few frames of a moving gradient, allocated with 'border' pixels
+// around each plane, and returns the bitstream. The images are added to
+// 'all'. With 'released' they are handed over to the encoder, and
+// released_after[i] counts the images it had returned right after frame i
+// was passed in.
+std::string EncodeGradient(int border, std::vector<const aom_image_t *> *all,
+                           std::vector<const aom_image_t *> *released,
+                           std::vector<size_t> *released_after) {
+  const int kWidth = 96;
+  const int kHeight = 64;
+  const int kFrames = 8;
+  aom_codec_iface_t *iface = aom_codec_av1_cx();
+  aom_codec_enc_cfg_t cfg;
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_enc_config_default(iface, &cfg, kUsage));
+  cfg.g_w = kWidth;
+  cfg.g_h = kHeight;
+  cfg.g_lag_in_frames = 4;
+  aom_codec_ctx_t enc;
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_enc_init(&enc, iface, &cfg, 0));
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_control(&enc, AOME_SET_CPUUSED, 6));
+  aom_input_release_cb_t release_cb = { RecordRelease, released };
+  if (released != nullptr) {
+    EXPECT_EQ(AOM_CODEC_OK,
+              aom_codec_control(&enc, AOME_SET_INPUT_RELEASE_CB, &release_cb));
+  }
+
+  std::string stream;
+  for (int i = 0; i < kFrames; ++i) {
+    aom_image_t *img = aom_img_alloc_with_border(
+        nullptr, AOM_IMG_FMT_I420, kWidth, kHeight, 32, 1, border);
+    EXPECT_NE(img, nullptr);
+    if (img == nullptr) break;
+    FillGradient(img, i);
+    all->push_back(img);
+    EXPECT_EQ(AOM_CODEC_OK, aom_codec_encode(&enc, img, i, 1, 0));
+    if (released != nullptr) released_after->push_back(released->size());
+    AppendPackets(&enc, &stream);
+  }
+  FlushEncoder(&enc, &stream);
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_destroy(&enc));
+  return stream;
+}
+
+#if !CONFIG_REALTIME_ONLY
+TEST(EncodeAPI, InputReleaseCallback) {
+  std::vector<const aom_image_t *> copied;
+  const std::string reference = EncodeGradient(288, &copied, nullptr, nullptr);
+  ASSERT_FALSE(reference.empty());
+
+  for (const int border : { 0, 128, 288 }) {
+    std::vector<const aom_image_t *> all;
+    std::vector<const aom_image_t *> released;
+    std::vector<size_t> released_after;
+    const std::string stream =
+        EncodeGradient(border, &all, &released, &released_after);
+    // Queuing the images in place gives the same bitstream as copying them.
+    EXPECT_EQ(reference, stream) << "border " << border;
+    // Every image comes back exactly once.
+    ASSERT_EQ(all.size(), released.size());
+    for (const aom_image_t *img : all) {
+      EXPECT_EQ(1, std::count(released.begin(), released.end(), img));
+    }
+    // Images without a border are copied and returned at once; the others
+    // stay with the encoder.
+    if (border == 0) {
+      EXPECT_EQ(1u, released_after[0]);
+    } else {
+      EXPECT_EQ(0u, released_after[0]);
+    }
+    for (const aom_image_t *img : all) {
+      aom_img_free(const_cast<aom_image_t *>(img));
+    }
+  }
+  for (const aom_image_t *img : copied) {
+    aom_img_free(const_cast<aom_image_t *>(img));
+  }
+}
+
+TEST(EncodeAPI, InputReleaseCallbackRejectedImage) {
+  const int kWidth = 96;
+  const int kHeight = 64;
+  aom_codec_iface_t *iface = aom_codec_av1_cx();
+  aom_codec_enc_cfg_t cfg;
+  ASSERT_EQ(AOM_CODEC_OK, aom_codec_enc_config_default(iface, &cfg, kUsage));
+  cfg.g_w = kWidth;
+  cfg.g_h = kHeight;
+  aom_codec_ctx_t enc;
+  ASSERT_EQ(AOM_CODEC_OK, aom_codec_enc_init(&enc, iface, &cfg, 0));
+  std::vector<const aom_image_t *> released;
+  aom_input_release_cb_t release_cb = { RecordRelease, &released };
+  ASSERT_EQ(AOM_CODEC_OK,
+            aom_codec_control(&enc, AOME_SET_INPUT_RELEASE_CB, &release_cb));
+
+  // An image of the wrong size and one of an unsupported format are both
+  // rejected, and come back right away.
+  aom_image_t *wrong_size = aom_img_alloc_with_border(
+      nullptr, AOM_IMG_FMT_I420, kWidth / 2, kHeight, 32, 1, 128);
+  ASSERT_NE(wrong_size, nullptr);
+  EXPECT_EQ(AOM_CODEC_INVALID_PARAM,
+            aom_codec_encode(&enc, wrong_size, 0, 1, 0));
+  ASSERT_EQ(1u, released.size());
+  EXPECT_EQ(wrong_size, released[0]);
+
+  aom_image_t *wrong_format = aom_img_alloc_with_border(
+      nullptr, AOM_IMG_FMT_I444, kWidth, kHeight, 32, 1, 128);
+  ASSERT_NE(wrong_format, nullptr);
+  EXPECT_EQ(AOM_CODEC_INVALID_PARAM,
+            aom_codec_encode(&enc, wrong_format, 0, 1, 0));
+  ASSERT_EQ(2u, released.size());
+  EXPECT_EQ(wrong_format, released[1]);
+
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_destroy(&enc));
+  EXPECT_EQ(2u, released.size());
+  aom_img_free(wrong_size);
+  aom_img_free(wrong_format);
+}
+
+const int kPassWidth = 64;
+const int kPassHeight = 64;
+
+aom_codec_enc_cfg_t TwoPassConfig(int frames) {
+  aom_codec_enc_cfg_t cfg;
+  EXPECT_EQ(AOM_CODEC_OK,
+            aom_codec_enc_config_default(aom_codec_av1_cx(), &cfg, kUsage));
+  cfg.g_w = kPassWidth;
+  cfg.g_h = kPassHeight;
+  cfg.g_limit = frames;
+  return cfg;
+}
+
+// Encodes cfg.g_limit frames of a moving gradient in the pass of 'cfg' and
+// returns the stats packets of the first pass, or the bitstream of the
+// last one. 'first_output' is set to the index of the input frame after
+// which the first packet came out.
+std::string EncodePass(const aom_codec_enc_cfg_t &cfg,
+                       unsigned int lap_thread = 0, unsigned int lap_window = 0,
+                       int *first_output = nullptr) {
+  aom_codec_ctx_t enc;
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_enc_init(&enc, aom_codec_av1_cx(), &cfg, 0));
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_control(&enc, AOME_SET_CPUUSED, 6));
+  EXPECT_EQ(AOM_CODEC_OK,
+            aom_codec_control(&enc, AOME_SET_LAP_THREAD, lap_thread));
+  EXPECT_EQ(AOM_CODEC_OK,
+            aom_codec_control(&enc, AOME_SET_LAP_WINDOW, lap_window));
+  if (first_output != nullptr) *first_output = -1;
+  aom_image_t *img =
+      aom_img_alloc(nullptr, AOM_IMG_FMT_I420, kPassWidth, kPassHeight, 32);
+  EXPECT_NE(img, nullptr);
+  if (img == nullptr) return std::string();
+
+  std::string out;
+  for (unsigned int i = 0; i < cfg.g_limit; ++i) {
+    FillGradient(img, i);
+    EXPECT_EQ(AOM_CODEC_OK, aom_codec_encode(&enc, img, i, 1, 0));
+    if (AppendPackets(&enc, &out) && first_output != nullptr &&
+        *first_output < 0) {
+      *first_output = static_cast<int>(i);
+    }
+  }
+  FlushEncoder(&enc, &out);
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_destroy(&enc));
+  aom_img_free(img);
+  return out;
+}
+
+TEST(EncodeAPI, SceneCuts) {
+  aom_codec_enc_cfg_t cfg = TwoPassConfig(20);
+  cfg.kf_max_dist = 8;
+  cfg.g_pass = AOM_RC_FIRST_PASS;
+  aom_codec_ctx_t enc;
+  ASSERT_EQ(AOM_CODEC_OK, aom_codec_enc_init(&enc, aom_codec_av1_cx(), &cfg, 0));
+  int frames[4];
+  aom_scene_cuts_t cuts = { frames, 4, 0 };
+  // There are no first pass stats yet.
+  EXPECT_EQ(AOM_CODEC_INVALID_PARAM,
+            aom_codec_control(&enc, AOME_GET_SCENE_CUTS, &cuts));
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_destroy(&enc));
+  std::string stats = EncodePass(cfg);
+
+  // The smooth gradient only gets the key frames forced by kf_max_dist.
+  cfg.g_pass = AOM_RC_LAST_PASS;
+  cfg.rc_twopass_stats_in.buf = &stats[0];
+  cfg.rc_twopass_stats_in.sz = stats.size();
+  ASSERT_EQ(AOM_CODEC_OK, aom_codec_enc_init(&enc, aom_codec_av1_cx(), &cfg, 0));
+  ASSERT_EQ(AOM_CODEC_OK, aom_codec_control(&enc, AOME_GET_SCENE_CUTS, &cuts));
+  ASSERT_EQ(2, cuts.num_cuts);
+  EXPECT_EQ(8, frames[0]);
+  EXPECT_EQ(16, frames[1]);
+  // Cuts beyond max_cuts are counted but not written.
+  cuts.max_cuts = 1;
+  frames[1] = -1;
+  ASSERT_EQ(AOM_CODEC_OK, aom_codec_control(&enc, AOME_GET_SCENE_CUTS, &cuts));
+  EXPECT_EQ(2, cuts.num_cuts);
+  EXPECT_EQ(-1, frames[1]);
+  EXPECT_EQ(AOM_CODEC_OK, aom_codec_destroy(&enc));
+}
+
+TEST(EncodeAPI, ZeroedStatsTotals) {
+  aom_codec_enc_cfg_t cfg = TwoPassConfig(10);
+  cfg.g_pass = AOM_RC_FIRST_PASS;
+  std::string stats = EncodePass(cfg);
+  const size_t packet_sz = stats.size() / (cfg.g_limit + 1);
+  ASSERT_EQ(stats.size(), packet_sz * (cfg.g_limit + 1));
+
+  cfg.g_pass = AOM_RC_LAST_PASS;
+  cfg.rc_twopass_stats_in.buf = &stats[0];
+  cfg.rc_twopass_stats_in.sz = stats.size();
+  const std::string reference = EncodePass(cfg);
+  ASSERT_FALSE(reference.empty());
+
+  // The encoder accumulates the same totals itself.
+  std::string zeroed = stats;
+  std::fill(zeroed.end() - packet_sz, zeroed.end(), '\0');
+  cfg.rc_twopass_stats_in.buf = &zeroed[0];
+  EXPECT_EQ(reference, EncodePass(cfg));
+}
+
+TEST(EncodeAPI, LapThread) {
+  aom_codec_enc_cfg_t cfg = TwoPassConfig(24);
+  cfg.g_threads = 2;
+  cfg.kf_max_dist = 10;
+  for (const unsigned int lag : { 19u, 35u }) {
+    cfg.g_lag_in_frames = lag;
+    const std::string threaded = EncodePass(cfg, 1);
+    ASSERT_FALSE(threaded.empty());
+    // The stats of the look ahead stage are handed over at fixed points, so
+    // the output does not depend on the timing of its thread.
+    EXPECT_EQ(threaded, EncodePass(cfg, 1)) << "lag " << lag;
+  }
+}
+
+TEST(EncodeAPI, LapWindow) {
+  aom_codec_enc_cfg_t cfg = TwoPassConfig(60);
+  cfg.g_lag_in_frames = 10;
+  int lag_output;
+  const std::string reference = EncodePass(cfg, 0, 0, &lag_output);
+  ASSERT_FALSE(reference.empty());
+  ASSERT_GE(lag_output, 0);
+
+  // The look ahead stage holds the window before the encode starts, and the
+  // rate control gets to see its stats.
+  int window_output;
+  const std::string windowed = EncodePass(cfg, 0, 40, &window_output);
+  EXPECT_EQ(lag_output + 30, window_output);
+  EXPECT_NE(reference, windowed);
+  EXPECT_EQ(windowed, EncodePass(cfg, 1, 40));
+
+  // A window shorter than the lag leaves the encode as it is.
+  EXPECT_EQ(reference, EncodePass(cfg, 0, 5));
+}
+#endif  // !CONFIG_REALTIME_ONLY
+
 }  // namespace
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "av1/encoder/perceptual_map.h"
+#include "test/acm_random.h"
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+namespace {
+
+// Sums the log factors of the units covered by a block the way the per-tune
+// lookups did before the integral images.
+double BruteForceLogSum(const std::vector<double> &factors, int rows, int cols,
+                        int unit_mi_log2, BLOCK_SIZE bsize, int mi_row,
+                        int mi_col, int *count) {
+  const int unit = 1 << unit_mi_log2;
+  const int num_brows = (mi_size_high[bsize] + unit - 1) / unit;
+  const int num_bcols = (mi_size_wide[bsize] + unit - 1) / unit;
+  double sum = 0.0;
+  *count = 0;
+  for (int row = mi_row / unit; row < rows && row < mi_row / unit + num_brows;
+       ++row) {
+    for (int col = mi_col / unit;
+         col < cols && col < mi_col / unit + num_bcols; ++col) {
+      sum += log(factors[row * cols + col]);
+      ++*count;
+    }
+  }
+  return sum;
+}
+
+TEST(PerceptualMapTest, LogSumMatchesBruteForce) {
+  libaom_test::ACMRandom rnd(libaom_test::ACMRandom::DeterministicSeed());
+  // Frame sizes in mi that are not multiples of the units or superblocks.
+  const int kMiRows = 37;
+  const int kMiCols = 61;
+  PerceptualMapPlane planes[PERCEPTUAL_MAPS];
+  memset(planes, 0, sizeof(planes));
+  PerceptualMapPlane &plane = planes[PERCEPTUAL_MAP_SSIM];
+
+  for (int unit_mi_log2 = 2; unit_mi_log2 <= 4; ++unit_mi_log2) {
+    const int unit = 1 << unit_mi_log2;
+    const int rows = (kMiRows + unit - 1) / unit;
+    const int cols = (kMiCols + unit - 1) / unit;
+    std::vector<double> factors(rows * cols);
+    for (double &f : factors) f = 0.25 + rnd.Rand16() / 16384.0;
+    ASSERT_TRUE(av1_build_perceptual_map_plane(&plane, factors.data(), kMiRows,
+                                               kMiCols, unit_mi_log2));
+
+    for (int b = 0; b < BLOCK_SIZES_ALL; ++b) {
+      const BLOCK_SIZE bsize = static_cast<BLOCK_SIZE>(b);
+      const int bh = mi_size_high[bsize];
+      const int bw = mi_size_wide[bsize];
+      // Blocks sit on their own grid, as in partition search.
+      for (int mi_row = 0; mi_row < kMiRows; mi_row += bh) {
+        for (int mi_col = 0; mi_col < kMiCols; mi_col += bw) {
+          int count, ref_count;
+          const double sum =
+              av1_perceptual_map_log_sum(&plane, bsize, mi_row, mi_col, &count);
+          const double ref_sum =
+              BruteForceLogSum(factors, rows, cols, unit_mi_log2, bsize,
+                               mi_row, mi_col, &ref_count);
+          ASSERT_EQ(ref_count, count) << "bsize " << b << " at " << mi_row
+                                      << ", " << mi_col;
+          ASSERT_NEAR(ref_sum, sum, 1e-9) << "bsize " << b << " at " << mi_row
+                                          << ", " << mi_col;
+        }
+      }
+    }
+  }
+  av1_free_perceptual_maps(planes);
+}
+
+}  // namespace
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <cstdlib>
+#include <vector>
+
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+#include "config/aom_config.h"
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/pyramid.h"
+#include "aom_dsp/variance.h"
+#include "aom_scale/yv12config.h"
+#include "av1/encoder/encoder.h"
+#include "av1/encoder/mcomp.h"
+#include "test/acm_random.h"
+
+#if !CONFIG_REALTIME_ONLY
+namespace {
+
+const int kWidth = 256;
+const int kHeight = 192;
+const int kBorder = 64;
+const int kPyramidLevels = 4;
+
+class PyramidSearchTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // The 16x16 windows shrink to 8x8 on the coarser levels.
+    memset(fn_ptr_, 0, sizeof(fn_ptr_));
+    fn_ptr_[BLOCK_8X8].sdf = aom_sad8x8;
+    fn_ptr_[BLOCK_16X16].sdf = aom_sad16x16;
+    memset(&src_, 0, sizeof(src_));
+    memset(&ref_, 0, sizeof(ref_));
+    ASSERT_EQ(aom_alloc_frame_buffer(&src_, kWidth, kHeight, 1, 1, 0, kBorder,
+                                     0, kPyramidLevels, 0),
+              0);
+    ASSERT_EQ(aom_alloc_frame_buffer(&ref_, kWidth, kHeight, 1, 1, 0, kBorder,
+                                     0, kPyramidLevels, 0),
+              0);
+    // Smooth the noise, so that the texture survives the downsampling.
+    libaom_test::ACMRandom rnd(libaom_test::ACMRandom::DeterministicSeed());
+    const int noise_width = kWidth + 2 * kBorder;
+    const int noise_height = kHeight + 2 * kBorder;
+    std::vector<int> noise(noise_width * noise_height);
+    for (int &v : noise) v = rnd.Rand8();
+    texture_.resize(noise_width * noise_height);
+    for (int y = 4; y < noise_height - 4; ++y) {
+      for (int x = 4; x < noise_width - 4; ++x) {
+        int sum = 0;
+        for (int i = -4; i < 4; ++i) {
+          for (int j = -4; j < 4; ++j) {
+            sum += noise[(y + i) * noise_width + x + j];
+          }
+        }
+        texture_[y * noise_width + x] = sum / 64;
+      }
+    }
+  }
+
+  void TearDown() override {
+    aom_free_frame_buffer(&src_);
+    aom_free_frame_buffer(&ref_);
+  }
+
+  // Fills the frame with the texture displaced by (dy, dx).
+  void FillFrame(YV12_BUFFER_CONFIG *frame, int dy, int dx) {
+    const int noise_width = kWidth + 2 * kBorder;
+    for (int y = 0; y < kHeight; ++y) {
+      for (int x = 0; x < kWidth; ++x) {
+        frame->y_buffer[y * frame->y_stride + x] = static_cast<uint8_t>(
+            texture_[(y + dy + kBorder) * noise_width + x + dx + kBorder]);
+      }
+    }
+    aom_compute_pyramid(frame, 8, frame->y_pyramid);
+  }
+
+  aom_variance_fn_ptr_t fn_ptr_[BLOCK_SIZES_ALL];
+  YV12_BUFFER_CONFIG src_;
+  YV12_BUFFER_CONFIG ref_;
+  std::vector<int> texture_;
+};
+
+TEST_F(PyramidSearchTest, FindsLargeMotion) {
+  const int kMvRow = -22;
+  const int kMvCol = 37;
+  FillFrame(&src_, 0, 0);
+  FillFrame(&ref_, -kMvRow, -kMvCol);
+
+  const FullMvLimits limits = { -kBorder, kBorder, -kBorder, kBorder };
+  const int x = 112;
+  const int y = 80;
+  FULLPEL_MV mv;
+  ASSERT_TRUE(av1_pyramid_full_pixel_search(fn_ptr_, src_.y_pyramid,
+                                            ref_.y_pyramid, x, y, 16, 16,
+                                            kPyramidLevels, kZeroFullMv,
+                                            &limits, &mv));
+  EXPECT_LE(abs(mv.row - kMvRow), PYRAMID_SEARCH_REFINE_RANGE);
+  EXPECT_LE(abs(mv.col - kMvCol), PYRAMID_SEARCH_REFINE_RANGE);
+}
+
+TEST_F(PyramidSearchTest, StaysInLimits) {
+  FillFrame(&src_, 0, 0);
+  FillFrame(&ref_, 0, -40);
+
+  // The true mv is out of the limits, which the result must respect.
+  const FullMvLimits limits = { -8, 8, -8, 8 };
+  FULLPEL_MV mv;
+  ASSERT_TRUE(av1_pyramid_full_pixel_search(fn_ptr_, src_.y_pyramid,
+                                            ref_.y_pyramid, 64, 64, 16, 16,
+                                            kPyramidLevels, kZeroFullMv,
+                                            &limits, &mv));
+  EXPECT_GE(mv.col, limits.col_min);
+  EXPECT_LE(mv.col, limits.col_max);
+  EXPECT_GE(mv.row, limits.row_min);
+  EXPECT_LE(mv.row, limits.row_max);
+}
+
+}  // namespace
+#endif  // !CONFIG_REALTIME_ONLY
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <string.h>
+
+#include "config/aom_config.h"
+#include "config/av1_rtcd.h"
+
+#include "av1/encoder/saliency_map.h"
+#include "test/acm_random.h"
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMaxWidth = 75;
+const int kStride = kMaxWidth + 2 * SALIENCY_BORDER;
+
+typedef void (*DecimateRowFunc)(const float *const *rows, int width,
+                                float *tmp, float *dst);
+typedef void (*GaborRowFunc)(const float *const *rows, int width,
+                             const float *kernel, float *dst);
+
+class SaliencyMapKernelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    rnd_.Reset(libaom_test::ACMRandom::DeterministicSeed());
+  }
+
+  // Fills the rows, borders included, with values in [-1, 1).
+  void FillRows() {
+    for (int i = 0; i < SALIENCY_GABOR_TAPS * kStride; ++i) {
+      input_[i] = (rnd_.Rand16() - 32768) / 32768.0f;
+    }
+  }
+
+  void GetRows(const float **rows, int num_rows, int column) {
+    for (int k = 0; k < num_rows; ++k) {
+      rows[k] = input_ + k * kStride + SALIENCY_BORDER + column;
+    }
+  }
+
+  libaom_test::ACMRandom rnd_;
+  float input_[SALIENCY_GABOR_TAPS * kStride];
+  float ref_tmp_[kMaxWidth + 4];
+  float tmp_[kMaxWidth + 4];
+  float ref_dst_[kMaxWidth];
+  float dst_[kMaxWidth];
+};
+
+class SaliencyDecimateTest
+    : public SaliencyMapKernelTest,
+      public ::testing::WithParamInterface<DecimateRowFunc> {};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(SaliencyDecimateTest);
+
+TEST_P(SaliencyDecimateTest, MatchesC) {
+  const DecimateRowFunc test_impl = GetParam();
+  const float *rows[5];
+  for (int iter = 0; iter < 200; ++iter) {
+    FillRows();
+    GetRows(rows, 5, -2);
+    const int width = 1 + rnd_(kMaxWidth);
+    memset(ref_dst_, 0, sizeof(ref_dst_));
+    memset(dst_, 0, sizeof(dst_));
+    av1_saliency_decimate_row_c(rows, width, ref_tmp_, ref_dst_);
+    test_impl(rows, width, tmp_, dst_);
+    for (int x = 0; x < kMaxWidth; ++x) {
+      ASSERT_EQ(ref_dst_[x], dst_[x]) << "width " << width << " at " << x;
+    }
+  }
+}
+
+class SaliencyGaborTest : public SaliencyMapKernelTest,
+                          public ::testing::WithParamInterface<GaborRowFunc> {
+};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(SaliencyGaborTest);
+
+TEST_P(SaliencyGaborTest, MatchesC) {
+  const GaborRowFunc test_impl = GetParam();
+  const float *rows[SALIENCY_GABOR_TAPS];
+  float kernel[SALIENCY_GABOR_TAPS * SALIENCY_GABOR_TAPS];
+  for (int iter = 0; iter < 200; ++iter) {
+    FillRows();
+    GetRows(rows, SALIENCY_GABOR_TAPS, -SALIENCY_BORDER);
+    for (int i = 0; i < SALIENCY_GABOR_TAPS * SALIENCY_GABOR_TAPS; ++i) {
+      kernel[i] = (rnd_.Rand16() - 32768) / 32768.0f;
+    }
+    const int width = 1 + rnd_(kMaxWidth);
+    memset(ref_dst_, 0, sizeof(ref_dst_));
+    memset(dst_, 0, sizeof(dst_));
+    av1_saliency_gabor_row_c(rows, width, kernel, ref_dst_);
+    test_impl(rows, width, kernel, dst_);
+    for (int x = 0; x < kMaxWidth; ++x) {
+      ASSERT_EQ(ref_dst_[x], dst_[x]) << "width " << width << " at " << x;
+    }
+  }
+}
+
+#if HAVE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, SaliencyDecimateTest,
+                         ::testing::Values(av1_saliency_decimate_row_avx2));
+INSTANTIATE_TEST_SUITE_P(AVX2, SaliencyGaborTest,
+                         ::testing::Values(av1_saliency_gabor_row_avx2));
+#endif
+
+}  // namespace
@@ -23,13 +23,14 @@
 
 namespace {
 
-// Parameters: cpu-used, row-mt.
-class AV1SBQPSweepTest : public ::libaom_test::CodecTestWith2Params<int, bool>,
-                         public ::libaom_test::EncoderTest {
+// Parameters: cpu-used, row-mt, sweep mode.
+class AV1SBQPSweepTest
+    : public ::libaom_test::CodecTestWith3Params<int, bool, int>,
+      public ::libaom_test::EncoderTest {
  protected:
   AV1SBQPSweepTest()
       : EncoderTest(GET_PARAM(0)), set_cpu_used_(GET_PARAM(1)),
-        row_mt_(GET_PARAM(2)) {
+        row_mt_(GET_PARAM(2)), sweep_mode_(GET_PARAM(3)) {
     init_flags_ = AOM_CODEC_USE_PSNR;
     aom_codec_dec_cfg_t cfg = aom_codec_dec_cfg_t();
     cfg.w = 1280;
@@ -109,14 +110,14 @@ class AV1SBQPSweepTest : public ::libaom_test::CodecTestWith2Params<int, bool>,
     cfg_.rc_target_bitrate = 1000;
 
     // Encode without sb_qp_sweep
-    use_sb_sweep_ = false;
+    use_sb_sweep_ = 0;
     sum_frame_size_ = 0;
     ASSERT_NO_FATAL_FAILURE(RunLoop(&video));
     const double psnr_1 = GetAveragePsnr();
     const size_t avg_frame_size_1 = sum_frame_size_ / nframes_;
 
     // Encode with sb_qp_sweep
-    use_sb_sweep_ = true;
+    use_sb_sweep_ = sweep_mode_;
     sum_frame_size_ = 0;
     ASSERT_NO_FATAL_FAILURE(RunLoop(&video));
     const double psnr_2 = GetAveragePsnr();
@@ -130,9 +131,10 @@ class AV1SBQPSweepTest : public ::libaom_test::CodecTestWith2Params<int, bool>,
     }
   }
 
-  bool use_sb_sweep_;
+  int use_sb_sweep_;
   int set_cpu_used_;
   bool row_mt_;
+  int sweep_mode_;
   double psnr_;
   unsigned int nframes_;
   size_t sum_frame_size_;
@@ -142,6 +144,6 @@ class AV1SBQPSweepTest : public ::libaom_test::CodecTestWith2Params<int, bool>,
 TEST_P(AV1SBQPSweepTest, SweepMatchTest) { DoTest(); }
 
 AV1_INSTANTIATE_TEST_SUITE(AV1SBQPSweepTest, ::testing::Range(4, 6),
-                           ::testing::Bool());
+                           ::testing::Bool(), ::testing::Values(1, 2));
 
 }  // namespace
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "config/aom_config.h"
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/ssimulacra2.h"
+#include "aom_scale/yv12config.h"
+#include "test/acm_random.h"
+#include "test/util.h"
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMaxWidth = 75;
+const int kPadded = kMaxWidth + 2 * SSIMULACRA2_BLUR_RADIUS;
+
+typedef void (*BlurRowFunc)(const float *src, float *dst, int width,
+                            const float *kernel);
+typedef void (*BlurColFunc)(const float *const *rows, float *dst, int width,
+                            const float *kernel);
+typedef void (*SsimRowFunc)(const float *mu1, const float *mu2,
+                            const float *s1122, const float *s12, int width,
+                            double *sums, float *map, float map_weight);
+typedef void (*EdgeRowFunc)(const float *img1, const float *mu1,
+                            const float *img2, const float *mu2, int width,
+                            double *sums, float *map, float artifact_weight,
+                            float detail_weight);
+
+struct Ssimulacra2Funcs {
+  BlurRowFunc blur_row;
+  BlurColFunc blur_col;
+  SsimRowFunc ssim_row;
+  EdgeRowFunc edge_row;
+};
+
+void ExpectSumsNear(const double *ref, const double *test, int n) {
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(ref[i], test[i], 1e-4 * std::fabs(ref[i]) + 1e-5) << i;
+  }
+}
+
+class Ssimulacra2KernelTest : public ::testing::TestWithParam<Ssimulacra2Funcs> {
+ protected:
+  void SetUp() override {
+    rnd_.Reset(libaom_test::ACMRandom::DeterministicSeed());
+    double total = 0.0;
+    for (int k = 0; k < SSIMULACRA2_BLUR_TAPS; ++k) {
+      kernel_[k] = 0.1f + rnd_.Rand8() / 255.0f;
+      total += kernel_[k];
+    }
+    for (int k = 0; k < SSIMULACRA2_BLUR_TAPS; ++k) {
+      kernel_[k] = static_cast<float>(kernel_[k] / total);
+    }
+  }
+
+  // XYB-like values: mostly in [0, 1] with some outliers.
+  float RandFloat() {
+    return rnd_.Rand16() / 65535.0f * ((rnd_(16) == 0) ? 4.0f : 1.0f);
+  }
+
+  void FillRows() {
+    for (int r = 0; r < 6; ++r) {
+      for (int x = 0; x < kPadded; ++x) rows_[r][x] = RandFloat();
+    }
+  }
+
+  libaom_test::ACMRandom rnd_;
+  float kernel_[SSIMULACRA2_BLUR_TAPS];
+  float rows_[6][kPadded];
+};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(Ssimulacra2KernelTest);
+
+TEST_P(Ssimulacra2KernelTest, BlurMatchesC) {
+  const Ssimulacra2Funcs funcs = GetParam();
+  float src[SSIMULACRA2_BLUR_TAPS][kPadded];
+  const float *rows[SSIMULACRA2_BLUR_TAPS];
+  float ref_dst[kMaxWidth], dst[kMaxWidth];
+  for (int iter = 0; iter < 200; ++iter) {
+    for (int k = 0; k < SSIMULACRA2_BLUR_TAPS; ++k) {
+      for (int x = 0; x < kPadded; ++x) src[k][x] = RandFloat();
+      // Repeated rows, as at the frame edges.
+      rows[k] = src[(iter & 1) ? k : rnd_(SSIMULACRA2_BLUR_TAPS)];
+    }
+    const int width = 1 + rnd_(kMaxWidth);
+
+    aom_ssimulacra2_blur_row_c(src[0], ref_dst, width, kernel_);
+    funcs.blur_row(src[0], dst, width, kernel_);
+    for (int x = 0; x < width; ++x) {
+      ASSERT_EQ(ref_dst[x], dst[x]) << "row, width " << width << " at " << x;
+    }
+
+    aom_ssimulacra2_blur_col_c(rows, ref_dst, width, kernel_);
+    funcs.blur_col(rows, dst, width, kernel_);
+    for (int x = 0; x < width; ++x) {
+      ASSERT_EQ(ref_dst[x], dst[x]) << "col, width " << width << " at " << x;
+    }
+  }
+}
+
+TEST_P(Ssimulacra2KernelTest, StatsMatchC) {
+  const Ssimulacra2Funcs funcs = GetParam();
+  float ref_map[kMaxWidth], map[kMaxWidth];
+  for (int iter = 0; iter < 200; ++iter) {
+    FillRows();
+    const int width = 1 + rnd_(kMaxWidth);
+    // Keep s1122 consistent with the means so that the denominators stay
+    // positive, as they do for real blurred planes.
+    for (int x = 0; x < width; ++x) {
+      rows_[2][x] = rows_[0][x] * rows_[0][x] + rows_[1][x] * rows_[1][x] +
+                    rows_[2][x] * 0.01f;
+      rows_[3][x] = rows_[0][x] * rows_[1][x] + (rows_[3][x] - 0.5f) * 0.01f;
+    }
+    for (int x = 0; x < kMaxWidth; ++x) ref_map[x] = map[x] = RandFloat();
+
+    double ref_sums[2] = { 0.5, 0.25 }, sums[2] = { 0.5, 0.25 };
+    aom_ssimulacra2_ssim_row_c(rows_[0], rows_[1], rows_[2], rows_[3], width,
+                               ref_sums, ref_map, 3.5f);
+    funcs.ssim_row(rows_[0], rows_[1], rows_[2], rows_[3], width, sums, map,
+                   3.5f);
+    ExpectSumsNear(ref_sums, sums, 2);
+    for (int x = 0; x < kMaxWidth; ++x) {
+      ASSERT_FLOAT_EQ(ref_map[x], map[x]) << "ssim, width " << width;
+    }
+
+    double ref_edge[4] = { 0 }, edge[4] = { 0 };
+    aom_ssimulacra2_edge_row_c(rows_[0], rows_[4], rows_[1], rows_[5], width,
+                               ref_edge, ref_map, 0.75f, 12.0f);
+    funcs.edge_row(rows_[0], rows_[4], rows_[1], rows_[5], width, edge, map,
+                   0.75f, 12.0f);
+    ExpectSumsNear(ref_edge, edge, 4);
+    for (int x = 0; x < kMaxWidth; ++x) {
+      ASSERT_FLOAT_EQ(ref_map[x], map[x]) << "edge, width " << width;
+    }
+
+    // Without a map only the sums are produced.
+    double ref_nomap[2] = { 0 }, nomap[2] = { 0 };
+    aom_ssimulacra2_ssim_row_c(rows_[0], rows_[1], rows_[2], rows_[3], width,
+                               ref_nomap, nullptr, 1.0f);
+    funcs.ssim_row(rows_[0], rows_[1], rows_[2], rows_[3], width, nomap,
+                   nullptr, 1.0f);
+    ExpectSumsNear(ref_nomap, nomap, 2);
+  }
+}
+
+#if HAVE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(
+    SSE4_1, Ssimulacra2KernelTest,
+    ::testing::Values(Ssimulacra2Funcs{ aom_ssimulacra2_blur_row_sse4_1,
+                                        aom_ssimulacra2_blur_col_sse4_1,
+                                        aom_ssimulacra2_ssim_row_sse4_1,
+                                        aom_ssimulacra2_edge_row_sse4_1 }));
+#endif
+
+#if HAVE_AVX2
+INSTANTIATE_TEST_SUITE_P(
+    AVX2, Ssimulacra2KernelTest,
+    ::testing::Values(Ssimulacra2Funcs{ aom_ssimulacra2_blur_row_avx2,
+                                        aom_ssimulacra2_blur_col_avx2,
+                                        aom_ssimulacra2_ssim_row_avx2,
+                                        aom_ssimulacra2_edge_row_avx2 }));
+#endif
+
+class Ssimulacra2ScoreTest : public ::testing::TestWithParam<int> {
+ protected:
+  void SetUp() override {
+    rnd_.Reset(libaom_test::ACMRandom::DeterministicSeed());
+    memset(&buffers_, 0, sizeof(buffers_));
+    memset(&src_, 0, sizeof(src_));
+    memset(&dst_, 0, sizeof(dst_));
+    const int use_highbitdepth = GetParam() > 8;
+    ASSERT_EQ(aom_alloc_frame_buffer(&src_, kWidth, kHeight, 1, 1,
+                                     use_highbitdepth, 32, 16, 0, 0),
+              0);
+    ASSERT_EQ(aom_alloc_frame_buffer(&dst_, kWidth, kHeight, 1, 1,
+                                     use_highbitdepth, 32, 16, 0, 0),
+              0);
+  }
+
+  void TearDown() override {
+    aom_free_frame_buffer(&src_);
+    aom_free_frame_buffer(&dst_);
+    aom_free_ssimulacra2_buffers(&buffers_);
+  }
+
+  void SetPixel(YV12_BUFFER_CONFIG *img, int plane, int x, int y, int value) {
+    uint8_t *const buf = plane == 0   ? img->y_buffer
+                         : plane == 1 ? img->u_buffer
+                                      : img->v_buffer;
+    const int stride = plane == 0 ? img->y_stride : img->uv_stride;
+    if (img->flags & YV12_FLAG_HIGHBITDEPTH) {
+      CONVERT_TO_SHORTPTR(buf)[y * stride + x] = value;
+    } else {
+      buf[y * stride + x] = value;
+    }
+  }
+
+  // Smooth gradients with some texture, copied to the distorted frame with
+  // noise of the given amplitude (in 8-bit units).
+  void FillFrames(int noise) {
+    const int bit_depth = GetParam();
+    const int shift = bit_depth - 8;
+    const int max_value = (1 << bit_depth) - 1;
+    for (int plane = 0; plane < 3; ++plane) {
+      const int w = plane ? kWidth / 2 : kWidth;
+      const int h = plane ? kHeight / 2 : kHeight;
+      for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+          const int base =
+              plane ? 128 + (x - y) / 4 : 32 + x + y + ((x / 4 + y / 4) & 1) * 24;
+          const int value = clamp(base << shift, 0, max_value);
+          const int offset =
+              noise ? (rnd_(2 * noise + 1) - noise) << shift : 0;
+          SetPixel(&src_, plane, x, y, value);
+          SetPixel(&dst_, plane, x, y, clamp(value + offset, 0, max_value));
+        }
+      }
+    }
+  }
+
+  double Score(float *map) {
+    double score = 0.0;
+    EXPECT_TRUE(aom_calc_ssimulacra2(&src_, &dst_, GetParam(),
+                                     AOM_CICP_MC_BT_709, AOM_CR_STUDIO_RANGE,
+                                     &buffers_, &score, map));
+    return score;
+  }
+
+  static const int kWidth = 96;
+  static const int kHeight = 72;
+  libaom_test::ACMRandom rnd_;
+  YV12_BUFFER_CONFIG src_;
+  YV12_BUFFER_CONFIG dst_;
+  AomSsimulacra2Buffers buffers_;
+};
+
+TEST_P(Ssimulacra2ScoreTest, IdenticalFramesScore100) {
+  FillFrames(0);
+  float map[kWidth * kHeight];
+  EXPECT_DOUBLE_EQ(Score(map), 100.0);
+  for (int i = 0; i < kWidth * kHeight; ++i) ASSERT_EQ(map[i], 0.0f) << i;
+}
+
+TEST_P(Ssimulacra2ScoreTest, ScoreDropsWithDistortion) {
+  FillFrames(2);
+  const double light = Score(nullptr);
+  FillFrames(12);
+  float map[kWidth * kHeight];
+  const double heavy = Score(map);
+  EXPECT_LT(light, 100.0);
+  EXPECT_LT(heavy, light);
+  double total = 0.0;
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    ASSERT_GE(map[i], 0.0f) << i;
+    total += map[i];
+  }
+  EXPECT_GT(total, 0.0);
+}
+
+TEST_P(Ssimulacra2ScoreTest, RejectsTinyFrames) {
+  YV12_BUFFER_CONFIG tiny;
+  memset(&tiny, 0, sizeof(tiny));
+  ASSERT_EQ(aom_alloc_frame_buffer(&tiny, 7, 7, 1, 1, GetParam() > 8, 32, 16,
+                                   0, 0),
+            0);
+  double score = 0.0;
+  EXPECT_FALSE(aom_calc_ssimulacra2(&tiny, &tiny, GetParam(),
+                                    AOM_CICP_MC_BT_709, AOM_CR_STUDIO_RANGE,
+                                    &buffers_, &score, nullptr));
+  aom_free_frame_buffer(&tiny);
+}
+
+INSTANTIATE_TEST_SUITE_P(C, Ssimulacra2ScoreTest,
+                         ::testing::Values(8
+#if CONFIG_AV1_HIGHBITDEPTH
+                                           ,
+                                           10
+#endif
+                                           ));
+
+}  // namespace
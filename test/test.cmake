@@ -99,6 +99,7 @@ list(APPEND AOM_UNIT_TEST_ENCODER_SOURCES
 add_to_libaom_test_srcs(AOM_UNIT_TEST_ENCODER_SOURCES)
 
 list(APPEND AOM_ENCODE_PERF_TEST_SOURCES "${AOM_ROOT}/test/encode_perf_test.cc")
+list(APPEND AOM_ENCODER_STATS_TEST_SOURCES "${AOM_ROOT}/test/aomstats_test.cc")
 list(APPEND AOM_UNIT_TEST_WEBM_SOURCES "${AOM_ROOT}/test/webm_video_source.h")
 add_to_libaom_test_srcs(AOM_UNIT_TEST_WEBM_SOURCES)
 list(APPEND AOM_TEST_INTRA_PRED_SPEED_SOURCES "${AOM_GEN_SRC_DIR}/usage_exit.c"
@@ -208,8 +209,10 @@ if(NOT BUILD_SHARED_LIBS)
               "${AOM_ROOT}/test/noise_model_test.cc"
               "${AOM_ROOT}/test/obmc_sad_test.cc"
               "${AOM_ROOT}/test/obmc_variance_test.cc"
+              "${AOM_ROOT}/test/perceptual_map_test.cc"
               "${AOM_ROOT}/test/pickrst_test.cc"
               "${AOM_ROOT}/test/sad_test.cc"
+              "${AOM_ROOT}/test/ssimulacra2_test.cc"
               "${AOM_ROOT}/test/subtract_test.cc"
               "${AOM_ROOT}/test/reconinter_test.cc"
               "${AOM_ROOT}/test/sum_squares_test.cc"
@@ -221,6 +224,7 @@ if(NOT BUILD_SHARED_LIBS)
               "${AOM_ROOT}/test/warp_filter_test_util.cc"
               "${AOM_ROOT}/test/warp_filter_test_util.h"
               "${AOM_ROOT}/test/webmenc_test.cc"
+              "${AOM_ROOT}/test/yuv_to_linear_rgb_test.cc"
               "${AOM_ROOT}/test/av1_k_means_test.cc")
 
   list(APPEND AOM_UNIT_TEST_ENCODER_INTRIN_SSE4_1
@@ -229,7 +233,8 @@ if(NOT BUILD_SHARED_LIBS)
 
   if(NOT CONFIG_REALTIME_ONLY)
     list(APPEND AOM_UNIT_TEST_ENCODER_INTRIN_SSE4_1
-                "${AOM_ROOT}/test/corner_match_test.cc")
+                "${AOM_ROOT}/test/corner_match_test.cc"
+                "${AOM_ROOT}/test/disflow_test.cc")
   endif()
 
   if(CONFIG_ACCOUNTING)
@@ -254,6 +259,7 @@ if(NOT BUILD_SHARED_LIBS)
                 "${AOM_ROOT}/test/film_grain_table_test.cc"
                 "${AOM_ROOT}/test/kf_test.cc"
                 "${AOM_ROOT}/test/lossless_test.cc"
+                "${AOM_ROOT}/test/pyramid_search_test.cc"
                 "${AOM_ROOT}/test/quant_test.cc"
                 "${AOM_ROOT}/test/ratectrl_test.cc"
                 "${AOM_ROOT}/test/rd_test.cc"
@@ -355,6 +361,16 @@ if(NOT BUILD_SHARED_LIBS)
     list(APPEND AOM_UNIT_TEST_ENCODER_SOURCES "${AOM_ROOT}/test/hash_test.cc")
   endif()
 
+  if(CONFIG_TUNE_VMAF AND (HAVE_SSE4_1 OR HAVE_AVX2))
+    list(APPEND AOM_UNIT_TEST_ENCODER_SOURCES
+                "${AOM_ROOT}/test/unsharp_rect_test.cc")
+  endif()
+
+  if(CONFIG_SALIENCY_MAP AND HAVE_AVX2)
+    list(APPEND AOM_UNIT_TEST_ENCODER_SOURCES
+                "${AOM_ROOT}/test/saliency_map_test.cc")
+  endif()
+
   if(CONFIG_REALTIME_ONLY)
     list(REMOVE_ITEM AOM_UNIT_TEST_ENCODER_SOURCES
                      "${AOM_ROOT}/test/end_to_end_qmpsnr_test.cc"
@@ -475,6 +491,11 @@ function(setup_aom_test_targets)
       target_sources(test_libaom PRIVATE ${AOM_ENCODE_PERF_TEST_SOURCES})
     endif()
 
+    if(ENABLE_EXAMPLES)
+      target_sources(test_libaom PRIVATE ${AOM_ENCODER_STATS_TEST_SOURCES}
+                     $<TARGET_OBJECTS:aom_encoder_stats>)
+    endif()
+
     if(NOT BUILD_SHARED_LIBS)
       add_executable(test_intra_pred_speed
                      ${AOM_TEST_INTRA_PRED_SPEED_SOURCES}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <tuple>
+
+#include "config/aom_config.h"
+#include "config/av1_rtcd.h"
+
+#include "test/acm_random.h"
+#include "test/util.h"
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+namespace {
+
+const int kStride = 80;
+const int kMaxWidth = 72;
+const int kMaxHeight = 20;
+const double kAmounts[] = { 0.0, 0.05, 0.35, 1.01, 1.5, -0.3 };
+
+typedef void (*UnsharpRectFunc)(const uint8_t *source, int source_stride,
+                                const uint8_t *blurred, int blurred_stride,
+                                uint8_t *dst, int dst_stride, int w, int h,
+                                double amount);
+
+class UnsharpRectTest : public ::testing::TestWithParam<UnsharpRectFunc> {
+ protected:
+  void SetUp() override {
+    rnd_.Reset(libaom_test::ACMRandom::DeterministicSeed());
+  }
+
+  libaom_test::ACMRandom rnd_;
+  uint8_t source_[kStride * kMaxHeight];
+  uint8_t blurred_[kStride * kMaxHeight];
+  uint8_t ref_dst_[kStride * kMaxHeight];
+  uint8_t dst_[kStride * kMaxHeight];
+};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(UnsharpRectTest);
+
+TEST_P(UnsharpRectTest, MatchesC) {
+  const UnsharpRectFunc test_impl = GetParam();
+  for (int iter = 0; iter < 200; ++iter) {
+    for (int i = 0; i < kStride * kMaxHeight; ++i) {
+      source_[i] = rnd_.Rand8();
+      // Alternate between random and smooth blurred planes.
+      blurred_[i] = (iter & 1) ? rnd_.Rand8()
+                               : clamp(source_[i] + rnd_(9) - 4, 0, 255);
+      ref_dst_[i] = dst_[i] = 0;
+    }
+    const int w = 1 + rnd_(kMaxWidth);
+    const int h = 1 + rnd_(kMaxHeight);
+    const double amount = kAmounts[iter % 6];
+    av1_unsharp_rect_c(source_, kStride, blurred_, kStride, ref_dst_, kStride,
+                       w, h, amount);
+    test_impl(source_, kStride, blurred_, kStride, dst_, kStride, w, h,
+              amount);
+    for (int i = 0; i < kStride * kMaxHeight; ++i) {
+      ASSERT_EQ(ref_dst_[i], dst_[i])
+          << "w " << w << " h " << h << " amount " << amount << " at " << i;
+    }
+  }
+}
+
+#if HAVE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE4_1, UnsharpRectTest,
+                         ::testing::Values(av1_unsharp_rect_sse4_1));
+#endif
+
+#if HAVE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, UnsharpRectTest,
+                         ::testing::Values(av1_unsharp_rect_avx2));
+#endif
+
+typedef void (*HighbdUnsharpRectFunc)(const uint16_t *source,
+                                      int source_stride,
+                                      const uint16_t *blurred,
+                                      int blurred_stride, uint16_t *dst,
+                                      int dst_stride, int w, int h,
+                                      double amount, int bit_depth);
+typedef std::tuple<HighbdUnsharpRectFunc, int> HighbdUnsharpRectParam;
+
+class HighbdUnsharpRectTest
+    : public ::testing::TestWithParam<HighbdUnsharpRectParam> {
+ protected:
+  void SetUp() override {
+    rnd_.Reset(libaom_test::ACMRandom::DeterministicSeed());
+  }
+
+  libaom_test::ACMRandom rnd_;
+  uint16_t source_[kStride * kMaxHeight];
+  uint16_t blurred_[kStride * kMaxHeight];
+  uint16_t ref_dst_[kStride * kMaxHeight];
+  uint16_t dst_[kStride * kMaxHeight];
+};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(HighbdUnsharpRectTest);
+
+TEST_P(HighbdUnsharpRectTest, MatchesC) {
+  const HighbdUnsharpRectFunc test_impl = GET_PARAM(0);
+  const int bit_depth = GET_PARAM(1);
+  const int mask = (1 << bit_depth) - 1;
+  for (int iter = 0; iter < 200; ++iter) {
+    for (int i = 0; i < kStride * kMaxHeight; ++i) {
+      source_[i] = rnd_.Rand16() & mask;
+      blurred_[i] = (iter & 1) ? rnd_.Rand16() & mask
+                               : clamp(source_[i] + rnd_(9) - 4, 0, mask);
+      ref_dst_[i] = dst_[i] = 0;
+    }
+    const int w = 1 + rnd_(kMaxWidth);
+    const int h = 1 + rnd_(kMaxHeight);
+    const double amount = kAmounts[iter % 6];
+    av1_highbd_unsharp_rect_c(source_, kStride, blurred_, kStride, ref_dst_,
+                              kStride, w, h, amount, bit_depth);
+    test_impl(source_, kStride, blurred_, kStride, dst_, kStride, w, h, amount,
+              bit_depth);
+    for (int i = 0; i < kStride * kMaxHeight; ++i) {
+      ASSERT_EQ(ref_dst_[i], dst_[i])
+          << "w " << w << " h " << h << " amount " << amount << " at " << i;
+    }
+  }
+}
+
+#if HAVE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(
+    SSE4_1, HighbdUnsharpRectTest,
+    ::testing::Combine(::testing::Values(av1_highbd_unsharp_rect_sse4_1),
+                       ::testing::Values(8, 10, 12)));
+#endif
+
+#if HAVE_AVX2
+INSTANTIATE_TEST_SUITE_P(
+    AVX2, HighbdUnsharpRectTest,
+    ::testing::Combine(::testing::Values(av1_highbd_unsharp_rect_avx2),
+                       ::testing::Values(8, 10, 12)));
+#endif
+
+}  // namespace
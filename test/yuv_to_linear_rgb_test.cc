@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2023, Alliance for Open Media. All rights reserved
+ *
+ * This source code is subject to the terms of the BSD 2 Clause License and
+ * the Alliance for Open Media Patent License 1.0. If the BSD 2 Clause License
+ * was not distributed with this source code in the LICENSE file, you can
+ * obtain it at www.aomedia.org/license/software. If the Alliance for Open
+ * Media Patent License 1.0 was not distributed with this source code in the
+ * PATENTS file, you can obtain it at www.aomedia.org/license/patent.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "config/aom_config.h"
+#include "config/aom_dsp_rtcd.h"
+
+#include "aom_dsp/yuv_to_linear_rgb.h"
+#include "test/acm_random.h"
+#include "third_party/googletest/src/googletest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMaxWidth = 77;
+
+typedef void (*YuvToLinearRgbRowFunc)(const uint16_t *y, const uint16_t *u,
+                                      const uint16_t *v, int width, int ss_x,
+                                      const YuvToRgbCoeffs *coeffs,
+                                      const float *lut, float *rgb);
+
+class YuvToLinearRgbTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    rnd_.Reset(libaom_test::ACMRandom::DeterministicSeed());
+    aom_init_srgb_eotf_lut(lut_);
+  }
+
+  void FillRow(int bit_depth) {
+    const int mask = (1 << bit_depth) - 1;
+    for (int x = 0; x < kMaxWidth; ++x) {
+      y_[x] = rnd_.Rand16() & mask;
+      u_[x] = rnd_.Rand16() & mask;
+      v_[x] = rnd_.Rand16() & mask;
+    }
+  }
+
+  libaom_test::ACMRandom rnd_;
+  float lut_[AOM_SRGB_EOTF_LUT_SIZE + 1];
+  uint16_t y_[kMaxWidth];
+  uint16_t u_[kMaxWidth];
+  uint16_t v_[kMaxWidth];
+  float ref_rgb_[3 * kMaxWidth];
+  float rgb_[3 * kMaxWidth];
+};
+
+double SrgbToLinear(double v) {
+  v = std::min(std::max(v, 0.0), 1.0);
+  return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+TEST_F(YuvToLinearRgbTest, MatchesTransferFunction) {
+  const aom_matrix_coefficients_t matrices[] = { AOM_CICP_MC_BT_601,
+                                                 AOM_CICP_MC_BT_709,
+                                                 AOM_CICP_MC_BT_2020_NCL };
+  for (int bit_depth = 10; bit_depth <= 12; bit_depth += 2) {
+    for (const aom_matrix_coefficients_t mc : matrices) {
+      for (int range = 0; range < 2; ++range) {
+        YuvToRgbCoeffs coeffs;
+        aom_init_yuv_to_rgb_coeffs(bit_depth, mc,
+                                   range ? AOM_CR_FULL_RANGE
+                                         : AOM_CR_STUDIO_RANGE,
+                                   &coeffs);
+        FillRow(bit_depth);
+        aom_highbd_yuv_to_linear_rgb_row_c(y_, u_, v_, kMaxWidth, 0, &coeffs,
+                                           lut_, rgb_);
+        for (int x = 0; x < kMaxWidth; ++x) {
+          const double luma = (y_[x] - coeffs.y_offset) * coeffs.y_scale;
+          const double cb = (u_[x] - coeffs.uv_offset) * coeffs.uv_scale;
+          const double cr = (v_[x] - coeffs.uv_offset) * coeffs.uv_scale;
+          const double expected[3] = {
+            SrgbToLinear(luma + coeffs.r_from_v * cr),
+            SrgbToLinear(luma + coeffs.g_from_u * cb + coeffs.g_from_v * cr),
+            SrgbToLinear(luma + coeffs.b_from_u * cb)
+          };
+          for (int c = 0; c < 3; ++c) {
+            ASSERT_NEAR(expected[c], rgb_[3 * x + c], 1e-5)
+                << "bit depth " << bit_depth << " at " << x << "." << c;
+          }
+        }
+      }
+    }
+  }
+}
+
+class YuvToLinearRgbSimdTest
+    : public YuvToLinearRgbTest,
+      public ::testing::WithParamInterface<YuvToLinearRgbRowFunc> {};
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(YuvToLinearRgbSimdTest);
+
+TEST_P(YuvToLinearRgbSimdTest, MatchesC) {
+  const YuvToLinearRgbRowFunc test_impl = GetParam();
+  for (int iter = 0; iter < 400; ++iter) {
+    const int bit_depth = 10 + 2 * rnd_(2);
+    const int ss_x = rnd_(2);
+    YuvToRgbCoeffs coeffs;
+    aom_init_yuv_to_rgb_coeffs(
+        bit_depth,
+        rnd_(2) ? AOM_CICP_MC_BT_709 : AOM_CICP_MC_BT_2020_NCL,
+        rnd_(2) ? AOM_CR_FULL_RANGE : AOM_CR_STUDIO_RANGE, &coeffs);
+    FillRow(bit_depth);
+    const int width = 1 + rnd_(kMaxWidth);
+    for (int i = 0; i < 3 * kMaxWidth; ++i) ref_rgb_[i] = rgb_[i] = -1.0f;
+    aom_highbd_yuv_to_linear_rgb_row_c(y_, u_, v_, width, ss_x, &coeffs, lut_,
+                                       ref_rgb_);
+    test_impl(y_, u_, v_, width, ss_x, &coeffs, lut_, rgb_);
+    for (int i = 0; i < 3 * kMaxWidth; ++i) {
+      ASSERT_EQ(ref_rgb_[i], rgb_[i])
+          << "width " << width << " ss_x " << ss_x << " at " << i;
+    }
+  }
+}
+
+#if HAVE_AVX2
+INSTANTIATE_TEST_SUITE_P(
+    AVX2, YuvToLinearRgbSimdTest,
+    ::testing::Values(aom_highbd_yuv_to_linear_rgb_row_avx2));
+#endif
+
+}  // namespace